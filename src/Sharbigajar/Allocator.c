@@ -0,0 +1,238 @@
+
+// Sharbigajar.Allocator
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Effectno.h"
+#include "Allocator.h"
+
+
+
+// type Allocator
+
+static void *heapReallocate (void *state, void *old, size_t oldSize, size_t newSize) {
+    (void) state;
+    (void) oldSize;
+
+    if (newSize == 0) {
+        free (old);
+        return NULL;
+    }
+
+    return realloc (old, newSize);
+}
+
+const Allocator heapAllocator = {
+    .reallocate = heapReallocate,
+    .state      = NULL
+};
+
+void *allocMemory (Allocator allocator, size_t size) {
+    return allocator.reallocate (allocator.state, NULL, 0, size);
+}
+
+void *reallocMemory (Allocator allocator, void *old, size_t oldSize, size_t newSize) {
+    return allocator.reallocate (allocator.state, old, oldSize, newSize);
+}
+
+void freeMemory (Allocator allocator, void *old, size_t size) {
+    if (old)
+        allocator.reallocate (allocator.state, old, size, 0);
+}
+
+
+// type Arena
+
+// Everything in an arena is aligned for any type, and takes up at least
+// one unit of alignment, so no two allocations share an address.
+//
+#define ARENA_ALIGN 16
+
+static size_t arenaSize (size_t n) {
+    return n ? (n + ARENA_ALIGN - 1) & ~(size_t) (ARENA_ALIGN - 1) : ARENA_ALIGN;
+}
+
+// A block's memory starts just after its header.
+//
+static char *blockData (ArenaBlock *block) {
+    return (char *) block + arenaSize (sizeof (ArenaBlock));
+}
+
+static ArenaBlock *newArenaBlock (size_t size, ArenaBlock *next) {
+    ArenaBlock *block = (ArenaBlock *) malloc (arenaSize (sizeof (ArenaBlock)) + size);
+    if (!block) {
+        effectno = StandardError;
+        printf ("error: newArenaBlock: out of memory for %zu bytes\n", size);
+        return NULL;
+    }
+
+    block->next = next;
+    block->size = size;
+
+    return block;
+}
+
+// Create a new arena, starting with a block of 'size' bytes. If there's
+// no memory for it, the arena starts with no blocks, and tries again on
+// the first allocation.
+//
+Arena newArena (size_t size) {
+    ArenaBlock *block = newArenaBlock (arenaSize (size), NULL);
+
+    return (Arena) {
+        .first      = block,
+        .current    = block,
+        .used       = 0
+    };
+}
+
+void freeArena (Arena arena) {
+    ArenaBlock *block = arena.first;
+
+    while (block) {
+        ArenaBlock *next = block->next;
+        free (block);
+        block = next;
+    }
+}
+
+// Move an arena on to a block with room for 'size' bytes: the next one,
+// left over from before a reset, if it's big enough, and otherwise a new
+// one, at least twice as big as the current one. Returns 0, leaving the
+// arena as it was, if there's no memory for a new one.
+//
+static int nextArenaBlock (Arena *arena, size_t size) {
+    ArenaBlock *next = arena->current ? arena->current->next : arena->first;
+
+    if (!next || next->size < size) {
+        size_t blockSize = arena->current ? arena->current->size * 2 : 0;
+        if (blockSize < size)
+            blockSize = size;
+
+        next = newArenaBlock (blockSize, next);
+        if (!next)
+            return 0;
+
+        if (arena->current)
+            arena->current->next = next;
+        else
+            arena->first = next;
+    }
+
+    arena->current = next;
+    arena->used = 0;
+    return 1;
+}
+
+// Allocate 'size' bytes from an arena, or return NULL if it's out of
+// memory.
+//
+void *arenaAlloc (Arena *arena, size_t size) {
+    size = arenaSize (size);
+
+    if ((!arena->current || arena->current->size - arena->used < size) &&
+        !nextArenaBlock (arena, size))
+        return NULL;
+
+    void *p = blockData (arena->current) + arena->used;
+    arena->used += size;
+
+    return p;
+}
+
+ArenaMark markArena (const Arena *arena) {
+    return (ArenaMark) {
+        .block  = arena->current,
+        .used   = arena->used
+    };
+}
+
+// Free everything allocated from an arena since a mark was taken.
+//
+void resetArenaTo (Arena *arena, ArenaMark mark) {
+    arena->current = mark.block;
+    arena->used = mark.used;
+}
+
+// Free everything allocated from an arena.
+//
+void resetArena (Arena *arena) {
+    arena->current = arena->first;
+    arena->used = 0;
+}
+
+// The most recent allocation can be resized or freed in place. Anything
+// else stays where it is when it shrinks, is copied to a new allocation
+// when it grows, and is left until the next reset when it's freed.
+//
+static void *arenaReallocate (void *state, void *old, size_t oldSize, size_t newSize) {
+    Arena *arena = (Arena *) state;
+
+    if (old && arena->current &&
+        (char *) old + arenaSize (oldSize) == blockData (arena->current) + arena->used)
+    {
+        size_t start = (size_t) ((char *) old - blockData (arena->current));
+
+        if (newSize == 0) {
+            arena->used = start;
+            return NULL;
+        }
+        if (start + arenaSize (newSize) <= arena->current->size) {
+            arena->used = start + arenaSize (newSize);
+            return old;
+        }
+    }
+
+    if (newSize == 0)
+        return NULL;
+    if (old && newSize <= oldSize)
+        return old;
+
+    void *p = arenaAlloc (arena, newSize);
+    if (p && old)
+        memcpy (p, old, oldSize);
+
+    return p;
+}
+
+// Allocate from an arena through the allocator interface.
+//
+Allocator arenaAllocator (Arena *arena) {
+    return (Allocator) {
+        .reallocate = arenaReallocate,
+        .state      = arena
+    };
+}
+
+
+// type FrameArena
+
+FrameArena newFrameArena (size_t size) {
+    return (FrameArena) {
+        .arenas = { newArena (size), newArena (size) },
+        .frame  = 0
+    };
+}
+
+void freeFrameArena (FrameArena frameArenas) {
+    freeArena (frameArenas.arenas[0]);
+    freeArena (frameArenas.arenas[1]);
+}
+
+// Start a new frame, freeing everything allocated the frame before last,
+// and return the arena to use during it.
+//
+Arena *beginFrame (FrameArena *frameArenas) {
+    Arena *arena = &frameArenas->arenas[++frameArenas->frame & 1];
+    resetArena (arena);
+
+    return arena;
+}
+
+// The arena for the current frame.
+//
+Arena *frameArena (FrameArena *frameArenas) {
+    return &frameArenas->arenas[frameArenas->frame & 1];
+}
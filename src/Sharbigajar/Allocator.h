@@ -0,0 +1,95 @@
+
+#ifndef SHARBIGAJAR_ALLOCATOR_H
+#define SHARBIGAJAR_ALLOCATOR_H
+
+#include <stddef.h>
+
+// Somewhere to get memory from.
+//
+// 'reallocate' does everything, like 'realloc': given no old block it
+// allocates, given a new size of 0 it frees, and otherwise it resizes.
+// It's told the old block's size, so allocators needn't remember sizes
+// themselves.
+//
+typedef struct Allocator Allocator;
+
+struct Allocator {
+    void *(*reallocate) (void *, void *, size_t, size_t);
+    void *state;
+};
+
+// 'malloc', 'realloc' and 'free'.
+//
+extern const Allocator heapAllocator;
+
+void *allocMemory (Allocator, size_t);
+void *reallocMemory (Allocator, void *, size_t, size_t);
+void freeMemory (Allocator, void *, size_t);
+
+
+// Bump allocator.
+//
+// Allocating just moves a pointer along the current block, and freeing
+// does nothing, except for the most recent allocation, which can also be
+// grown or shrunk in place. Everything goes at once with a reset, either
+// of the whole arena or back to a mark taken earlier.
+//
+// When a block runs out, the arena moves on to a bigger one. Blocks are
+// kept across resets, so once an arena has grown big enough for its
+// work, it doesn't touch the system heap again until it's freed.
+//
+typedef struct ArenaBlock ArenaBlock;
+
+struct ArenaBlock {
+    ArenaBlock *next;
+    size_t size;
+};
+
+typedef struct Arena Arena;
+
+struct Arena {
+    ArenaBlock *first;
+    ArenaBlock *current;
+    size_t used;
+    // ^ Bytes used in 'current'.
+};
+
+// A point in an arena to reset back to.
+//
+typedef struct ArenaMark ArenaMark;
+
+struct ArenaMark {
+    ArenaBlock *block;
+    size_t used;
+};
+
+Arena newArena (size_t);
+void freeArena (Arena);
+
+void *arenaAlloc (Arena *, size_t);
+
+ArenaMark markArena (const Arena *);
+void resetArenaTo (Arena *, ArenaMark);
+void resetArena (Arena *);
+
+Allocator arenaAllocator (Arena *);
+
+
+// A pair of arenas for per-frame work, used alternately. Starting a frame
+// resets one of them, and leaves the other alone, so what the last frame
+// allocated lasts until the end of this one.
+//
+typedef struct FrameArena FrameArena;
+
+struct FrameArena {
+    Arena arenas[2];
+    unsigned int frame;
+};
+
+FrameArena newFrameArena (size_t);
+void freeFrameArena (FrameArena);
+
+Arena *beginFrame (FrameArena *);
+Arena *frameArena (FrameArena *);
+
+#endif
@@ -0,0 +1,192 @@
+
+// Sharbigajar.Backend.Reflection
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <GL/glew.h>
+
+#include "Name.h"
+#include "Text.h"
+#include "Backend/Reflection.h"
+
+
+
+// type ProgramReflection
+
+// Intern a name GL gave, leaving off the '[0]' it puts on arrays.
+//
+static Name internActiveName (const char name[], GLsizei length) {
+    if (length > 3 && strcmp (name + length - 3, "[0]") == 0)
+        length -= 3;
+
+    return internText ((Text) {name, (unsigned int) length});
+}
+
+static void reflectAttribs (ProgramReflection *reflection) {
+    GLint numAttribs = 0, maxLength = 0;
+    glGetProgramiv (reflection->program, GL_ACTIVE_ATTRIBUTES, &numAttribs);
+    glGetProgramiv (reflection->program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxLength);
+
+    char *name = (char *) malloc (maxLength + 1);
+    reflection->attribs = (ProgramAttrib *) malloc (numAttribs * sizeof (ProgramAttrib));
+    reflection->numAttribs = numAttribs;
+
+    for (GLint attribIx = 0; attribIx < numAttribs; attribIx++) {
+        ProgramAttrib *attrib = &reflection->attribs[attribIx];
+        GLsizei length = 0;
+
+        glGetActiveAttrib
+            ( reflection->program, attribIx, maxLength + 1, &length
+            , &attrib->size, &attrib->type, name );
+
+        attrib->name = internActiveName (name, length);
+        attrib->location = glGetAttribLocation (reflection->program, name);
+    }
+
+    free (name);
+}
+
+static void reflectUniforms (ProgramReflection *reflection, int hasBlocks) {
+    GLint numUniforms = 0, maxLength = 0;
+    glGetProgramiv (reflection->program, GL_ACTIVE_UNIFORMS, &numUniforms);
+    glGetProgramiv (reflection->program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+    char *name = (char *) malloc (maxLength + 1);
+    reflection->uniforms = (ProgramUniform *) malloc (numUniforms * sizeof (ProgramUniform));
+    reflection->numUniforms = numUniforms;
+
+    for (GLint uniformIx = 0; uniformIx < numUniforms; uniformIx++) {
+        ProgramUniform *uniform = &reflection->uniforms[uniformIx];
+        GLsizei length = 0;
+
+        glGetActiveUniform
+            ( reflection->program, uniformIx, maxLength + 1, &length
+            , &uniform->size, &uniform->type, name );
+
+        uniform->name = internActiveName (name, length);
+        uniform->location = glGetUniformLocation (reflection->program, name);
+        uniform->block = -1;
+        uniform->offset = -1;
+        uniform->arrayStride = -1;
+        uniform->matrixStride = -1;
+    }
+
+    free (name);
+
+    if (!hasBlocks || numUniforms == 0)
+        return;
+
+    // Ask for where each uniform is in its block all at once.
+    GLuint *indices = (GLuint *) malloc (numUniforms * sizeof (GLuint));
+    GLint *values = (GLint *) malloc (numUniforms * sizeof (GLint));
+    for (GLint uniformIx = 0; uniformIx < numUniforms; uniformIx++)
+        indices[uniformIx] = uniformIx;
+
+    const struct { GLenum pname; size_t field; } fields[] = {
+        { GL_UNIFORM_BLOCK_INDEX,   offsetof (ProgramUniform, block)        },
+        { GL_UNIFORM_OFFSET,        offsetof (ProgramUniform, offset)       },
+        { GL_UNIFORM_ARRAY_STRIDE,  offsetof (ProgramUniform, arrayStride)  },
+        { GL_UNIFORM_MATRIX_STRIDE, offsetof (ProgramUniform, matrixStride) }
+    };
+
+    for (unsigned int fieldIx = 0; fieldIx < sizeof (fields) / sizeof (fields[0]); fieldIx++) {
+        glGetActiveUniformsiv
+            (reflection->program, numUniforms, indices, fields[fieldIx].pname, values);
+
+        for (GLint uniformIx = 0; uniformIx < numUniforms; uniformIx++)
+            *(GLint *) ((char *) &reflection->uniforms[uniformIx] + fields[fieldIx].field)
+                = values[uniformIx];
+    }
+
+    free (indices);
+    free (values);
+}
+
+static void reflectBlocks (ProgramReflection *reflection) {
+    GLint numBlocks = 0, maxLength = 0;
+    glGetProgramiv (reflection->program, GL_ACTIVE_UNIFORM_BLOCKS, &numBlocks);
+    glGetProgramiv (reflection->program, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxLength);
+
+    char *name = (char *) malloc (maxLength + 1);
+    reflection->blocks = (ProgramBlock *) malloc (numBlocks * sizeof (ProgramBlock));
+    reflection->numBlocks = numBlocks;
+
+    for (GLint blockIx = 0; blockIx < numBlocks; blockIx++) {
+        ProgramBlock *block = &reflection->blocks[blockIx];
+        GLsizei length = 0;
+
+        glGetActiveUniformBlockName
+            (reflection->program, blockIx, maxLength + 1, &length, name);
+        glGetActiveUniformBlockiv
+            (reflection->program, blockIx, GL_UNIFORM_BLOCK_DATA_SIZE, &block->size);
+
+        block->name = internActiveName (name, length);
+        block->index = blockIx;
+    }
+
+    free (name);
+}
+
+// Find everything active in a linked program. Names are interned, so
+// like interning, this is for one thread at a time.
+//
+ProgramReflection reflectProgram (const GLuint program) {
+    ProgramReflection reflection = {
+        .program    = program,
+        .attribs    = NULL,
+        .numAttribs = 0,
+        .uniforms   = NULL,
+        .numUniforms = 0,
+        .blocks     = NULL,
+        .numBlocks  = 0
+    };
+
+    int hasBlocks = GLEW_VERSION_3_1 || GLEW_ARB_uniform_buffer_object;
+
+    reflectAttribs (&reflection);
+    reflectUniforms (&reflection, hasBlocks);
+    if (hasBlocks)
+        reflectBlocks (&reflection);
+
+    return reflection;
+}
+
+void freeProgramReflection (ProgramReflection reflection) {
+    free (reflection.attribs);
+    free (reflection.uniforms);
+    free (reflection.blocks);
+}
+
+
+// Find an attribute by name, or NULL if the program doesn't have it.
+//
+const ProgramAttrib *findAttrib (const ProgramReflection *reflection, Name name) {
+    for (unsigned int attribIx = 0; attribIx < reflection->numAttribs; attribIx++)
+        if (reflection->attribs[attribIx].name == name)
+            return &reflection->attribs[attribIx];
+
+    return NULL;
+}
+
+// Find a uniform by name, or NULL if the program doesn't have it.
+//
+const ProgramUniform *findUniform (const ProgramReflection *reflection, Name name) {
+    for (unsigned int uniformIx = 0; uniformIx < reflection->numUniforms; uniformIx++)
+        if (reflection->uniforms[uniformIx].name == name)
+            return &reflection->uniforms[uniformIx];
+
+    return NULL;
+}
+
+// Find a uniform block by name, or NULL if the program doesn't have it.
+//
+const ProgramBlock *findBlock (const ProgramReflection *reflection, Name name) {
+    for (unsigned int blockIx = 0; blockIx < reflection->numBlocks; blockIx++)
+        if (reflection->blocks[blockIx].name == name)
+            return &reflection->blocks[blockIx];
+
+    return NULL;
+}
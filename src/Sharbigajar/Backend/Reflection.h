@@ -0,0 +1,83 @@
+
+#ifndef SHARBIGAJAR_BACKEND_REFLECTION_H
+#define SHARBIGAJAR_BACKEND_REFLECTION_H
+
+#include <GL/glew.h>
+
+#include "Name.h"
+
+
+
+// An active attribute of a linked program.
+//
+typedef struct ProgramAttrib ProgramAttrib;
+
+struct ProgramAttrib {
+    Name name;
+    GLenum type;
+    GLint size;
+    GLint location;
+};
+
+// An active uniform of a linked program. Arrays are named without their
+// '[0]', and 'size' is their length.
+//
+// Uniforms in the default block have a 'location', and a 'block' of -1.
+// Ones in a uniform block have a location of -1, and are placed in the
+// block's buffer by 'offset', 'arrayStride' and 'matrixStride' instead.
+//
+typedef struct ProgramUniform ProgramUniform;
+
+struct ProgramUniform {
+    Name name;
+    GLenum type;
+    GLint size;
+    GLint location;
+
+    GLint block;
+    // ^ Index into the program's blocks.
+    GLint offset;
+    GLint arrayStride;
+    GLint matrixStride;
+};
+
+// An active uniform block of a linked program, 'size' bytes long.
+//
+typedef struct ProgramBlock ProgramBlock;
+
+struct ProgramBlock {
+    Name name;
+    GLuint index;
+    GLint size;
+};
+
+
+// Everything active in a linked program, asked of GL once, so nothing
+// needs asking again while drawing.
+//
+// Uniform blocks need GL 3.1 or ARB_uniform_buffer_object; without them,
+// a program has no blocks.
+//
+typedef struct ProgramReflection ProgramReflection;
+
+struct ProgramReflection {
+    GLuint program;
+
+    ProgramAttrib *attribs;
+    unsigned int numAttribs;
+
+    ProgramUniform *uniforms;
+    unsigned int numUniforms;
+
+    ProgramBlock *blocks;
+    unsigned int numBlocks;
+};
+
+ProgramReflection reflectProgram (const GLuint);
+void freeProgramReflection (ProgramReflection);
+
+const ProgramAttrib *findAttrib (const ProgramReflection *, Name);
+const ProgramUniform *findUniform (const ProgramReflection *, Name);
+const ProgramBlock *findBlock (const ProgramReflection *, Name);
+
+#endif
@@ -0,0 +1,272 @@
+
+// Sharbigajar.Backend.ShaderBatch
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <GL/glew.h>
+
+#include "Allocator.h"
+#include "Effectno.h"
+#include "Text.h"
+#include "Backend/Shaders.h"
+#include "Backend/ShaderBatch.h"
+
+
+
+// type ShaderBatch
+
+// Read every source file of a batch, in order. A file that can't be read
+// gets a text with no array. Sources up to 'numRead' belong to the GL
+// thread from then on.
+//
+static void *readBatchSources (void *context) {
+    ShaderBatch *batch = (ShaderBatch *) context;
+
+    for (unsigned int shaderIx = 0; shaderIx < batch->numShaders; shaderIx++) {
+        batch->sources[shaderIx] = textFromFile (batch->infos[shaderIx].filename);
+        __atomic_store_n (&batch->numRead, shaderIx + 1, __ATOMIC_RELEASE);
+    }
+
+    return NULL;
+}
+
+// Submit a list of programs to be compiled, starting with reading their
+// sources on another thread. This needs a current GL context, and so do
+// updates, on the same thread.
+//
+ShaderBatch *submitShaderBatch (unsigned int numPrograms, const ProgramInfo infos[]) {
+    ShaderBatch *batch = (ShaderBatch *) calloc (1, sizeof (ShaderBatch));
+
+    unsigned int numShaders = 0, numAttribs = 0;
+    for (unsigned int programIx = 0; programIx < numPrograms; programIx++) {
+        numShaders += infos[programIx].numShaders;
+        numAttribs += infos[programIx].numAttribs;
+    }
+
+    batch->programs = (BatchProgram *) malloc (numPrograms * sizeof (BatchProgram));
+    batch->numPrograms = numPrograms;
+    batch->numPending = numPrograms;
+
+    batch->infos = (ShaderInfo *) malloc (numShaders * sizeof (ShaderInfo));
+    batch->sources = (Text *) calloc (numShaders, sizeof (Text));
+    batch->shaders = (GLuint *) calloc (numShaders, sizeof (GLuint));
+    batch->numShaders = numShaders;
+
+    batch->attribs = (AttribBinding *) malloc (numAttribs * sizeof (AttribBinding));
+    batch->numAttribs = numAttribs;
+
+    for (unsigned int programIx = 0, shaderIx = 0, attribIx = 0;
+         programIx < numPrograms; programIx++)
+    {
+        batch->programs[programIx] = (BatchProgram) {
+            .program        = 0,
+            .status         = ProgramPending,
+            .log            = {0, 0},
+            .firstShader    = shaderIx,
+            .numShaders     = infos[programIx].numShaders,
+            .firstAttrib    = attribIx,
+            .numAttribs     = infos[programIx].numAttribs
+        };
+
+        memcpy
+            ( batch->infos + shaderIx, infos[programIx].shaders
+            , infos[programIx].numShaders * sizeof (ShaderInfo) );
+        shaderIx += infos[programIx].numShaders;
+
+        if (infos[programIx].numAttribs)
+            memcpy
+                ( batch->attribs + attribIx, infos[programIx].attribs
+                , infos[programIx].numAttribs * sizeof (AttribBinding) );
+        attribIx += infos[programIx].numAttribs;
+    }
+
+    // Let the driver use as many threads as it likes.
+    batch->parallel = GLEW_KHR_parallel_shader_compile;
+    batch->background = batch->parallel;
+    if (batch->parallel)
+        glMaxShaderCompilerThreadsKHR (0xffffffff);
+
+    batch->reading = pthread_create (&batch->reader, NULL, readBatchSources, batch) == 0;
+    if (!batch->reading)
+        readBatchSources (batch);
+
+    return batch;
+}
+
+// Free a batch, once its sources have all been read. Its programs belong
+// to whoever submitted it, and are left alone; shaders that are still
+// around aren't.
+//
+void freeShaderBatch (ShaderBatch *batch) {
+    if (batch->reading)
+        pthread_join (batch->reader, NULL);
+
+    for (unsigned int shaderIx = 0; shaderIx < batch->numShaders; shaderIx++) {
+        if (batch->shaders[shaderIx])
+            glDeleteShader (batch->shaders[shaderIx]);
+        freeText (batch->sources[shaderIx]);
+    }
+
+    for (unsigned int programIx = 0; programIx < batch->numPrograms; programIx++)
+        freeText (batch->programs[programIx].log);
+
+    free (batch->programs);
+    free (batch->infos);
+    free (batch->sources);
+    free (batch->shaders);
+    free (batch->attribs);
+    free (batch);
+}
+
+
+// Finish off a program once the driver's done with it: check how it went,
+// report and keep any errors, and get rid of its shaders.
+//
+static void finishBatchProgram (ShaderBatch *batch, BatchProgram *program) {
+    int success = program->program != 0;
+    TextBuilder log = newTextBuilder (0);
+
+    for (unsigned int shaderIx = program->firstShader;
+         shaderIx < program->firstShader + program->numShaders; shaderIx++)
+    {
+        const ShaderInfo info = batch->infos[shaderIx];
+        GLuint shader = batch->shaders[shaderIx];
+
+        if (!shader) {
+            formatToBuilder (&log, "%s: failed to open\n", info.filename.array);
+            success = 0;
+        }
+        else if (!checkShaderCompiled (heapAllocator, info, shader)) {
+            formatToBuilder (&log, "%s:\n", info.filename.array);
+            appendShaderLog (&log, shader);
+            success = 0;
+        }
+
+        if (shader) {
+            if (program->program)
+                glDetachShader (program->program, shader);
+            glDeleteShader (shader);
+            batch->shaders[shaderIx] = 0;
+        }
+    }
+
+    if (success && !checkProgramLinked (heapAllocator, program->program)) {
+        appendStringToBuilder (&log, "link:\n");
+        appendProgramLog (&log, program->program);
+        success = 0;
+    }
+
+    if (!success && program->program) {
+        glDeleteProgram (program->program);
+        program->program = 0;
+    }
+
+    if (success)
+        freeTextBuilder (log);
+    else
+        program->log = buildText (log);
+
+    program->status = success ? ProgramReady : ProgramFailed;
+    batch->numPending--;
+}
+
+// Whether the driver's done linking a program, without waiting for it.
+//
+static int isProgramDone (const ShaderBatch *batch, const BatchProgram *program) {
+    if (!batch->parallel || !program->program)
+        return 1;
+
+    GLint done = GL_FALSE;
+    glGetProgramiv (program->program, GL_COMPLETION_STATUS_KHR, &done);
+    return done;
+}
+
+// Start compiling a program's shaders, whose sources have all been read,
+// and linking them, with its attributes bound first. GL copies the
+// sources, so they can go straight away. Returns 0 if a shader couldn't
+// even be started.
+//
+static int startBatchProgram (ShaderBatch *batch, BatchProgram *program) {
+    int complete = 1;
+
+    for (unsigned int shaderIx = program->firstShader;
+         shaderIx < program->firstShader + program->numShaders; shaderIx++)
+    {
+        if (batch->sources[shaderIx].array) {
+            batch->shaders[shaderIx] = startShaderCompile
+                (batch->infos[shaderIx], batch->sources[shaderIx]);
+
+            freeText (batch->sources[shaderIx]);
+            batch->sources[shaderIx] = (Text) {0, 0};
+        }
+        else {
+            effectno = IOError;
+            printf
+                ( "error: startBatchProgram: failed to open %s\n"
+                , batch->infos[shaderIx].filename.array );
+        }
+
+        complete &= batch->shaders[shaderIx] != 0;
+    }
+
+    if (!complete)
+        return 0;
+
+    program->program = glCreateProgram ();
+    if (program->numAttribs)
+        bindAttribs
+            ( program->numAttribs, batch->attribs + program->firstAttrib
+            , program->program );
+
+    for (unsigned int shaderIx = program->firstShader;
+         shaderIx < program->firstShader + program->numShaders; shaderIx++)
+        glAttachShader (program->program, batch->shaders[shaderIx]);
+
+    glLinkProgram (program->program);
+
+    if (batch->parallel)
+        batch->background = !isProgramDone (batch, program);
+
+    return 1;
+}
+
+// Move a batch along, and return the number of programs still pending.
+//
+unsigned int updateShaderBatch (ShaderBatch *batch) {
+    unsigned int numRead = __atomic_load_n (&batch->numRead, __ATOMIC_ACQUIRE);
+
+    while (batch->numStarted < batch->numPrograms) {
+        BatchProgram *program = &batch->programs[batch->numStarted];
+        if (program->firstShader + program->numShaders > numRead)
+            break;
+
+        batch->numStarted++;
+        if (startBatchProgram (batch, program) && !batch->background)
+            break;
+    }
+
+    // Finish whatever the driver's done with.
+    for (unsigned int programIx = 0; programIx < batch->numStarted; programIx++) {
+        BatchProgram *program = &batch->programs[programIx];
+
+        if (program->status == ProgramPending && isProgramDone (batch, program))
+            finishBatchProgram (batch, program);
+    }
+
+    return batch->numPending;
+}
+
+// Wait for every program in a batch to be ready or failed.
+//
+void finishShaderBatch (ShaderBatch *batch) {
+    if (batch->reading)
+        pthread_join (batch->reader, NULL);
+    batch->reading = 0;
+
+    batch->parallel = 0;
+    batch->background = 1;
+    updateShaderBatch (batch);
+}
@@ -0,0 +1,108 @@
+
+#ifndef SHARBIGAJAR_BACKEND_SHADER_BATCH_H
+#define SHARBIGAJAR_BACKEND_SHADER_BATCH_H
+
+#include <pthread.h>
+
+#include <GL/glew.h>
+
+#include "Text.h"
+#include "Backend/Shaders.h"
+
+
+
+// Description of a shader program: the shaders to compile and link, and
+// the locations to bind its attributes to before linking, as with
+// 'compileBoundShaderProgram'.
+//
+typedef struct ProgramInfo ProgramInfo;
+
+struct ProgramInfo {
+    unsigned int numShaders;
+    const ShaderInfo *shaders;
+
+    unsigned int numAttribs;
+    const AttribBinding *attribs;
+};
+
+
+typedef enum ProgramStatus ProgramStatus;
+
+enum ProgramStatus {
+    ProgramPending,
+    ProgramReady,
+    ProgramFailed,
+};
+
+// A program in a batch. Once 'status' isn't pending any more, 'program'
+// is ready to use, or failed and deleted, with the errors reported and
+// kept in 'log' until the batch is freed.
+//
+typedef struct BatchProgram BatchProgram;
+
+struct BatchProgram {
+    GLuint program;
+    ProgramStatus status;
+    Text log;
+
+    unsigned int firstShader;
+    unsigned int numShaders;
+
+    unsigned int firstAttrib;
+    unsigned int numAttribs;
+};
+
+
+// Many shader programs, compiled and linked together without waiting on
+// each other.
+//
+// A thread reads the source files, in order, from the moment the batch
+// is submitted. Each 'updateShaderBatch', say once a frame, starts the
+// driver compiling and linking programs whose sources have all been
+// read, then checks on the programs it's started.
+//
+// With KHR_parallel_shader_compile, drivers can do that work on threads
+// of their own, and the checks only ask whether they're done, so an
+// update starts every program it can and never waits. Drivers without
+// it, and some with it, do the work right there in 'glLinkProgram'. If
+// a program's done as soon as it's linked, that must be happening, so
+// each update only starts one program, and frames are only held up by
+// one program at a time.
+//
+// 'numRead' is the number of sources the reading thread has finished
+// with; only that thread writes it, and 'sources' up to it.
+//
+typedef struct ShaderBatch ShaderBatch;
+
+struct ShaderBatch {
+    BatchProgram *programs;
+    unsigned int numPrograms;
+
+    ShaderInfo *infos;
+    Text *sources;
+    GLuint *shaders;
+    unsigned int numShaders;
+
+    AttribBinding *attribs;
+    unsigned int numAttribs;
+
+    unsigned int numRead;
+    unsigned int numStarted;
+    unsigned int numPending;
+
+    int parallel;
+    int background;
+    // ^ Whether the driver seems to be compiling in the background.
+
+    pthread_t reader;
+    int reading;
+    // ^ Whether 'reader' is still to be joined.
+};
+
+ShaderBatch *submitShaderBatch (unsigned int, const ProgramInfo []);
+void freeShaderBatch (ShaderBatch *);
+
+unsigned int updateShaderBatch (ShaderBatch *);
+void finishShaderBatch (ShaderBatch *);
+
+#endif
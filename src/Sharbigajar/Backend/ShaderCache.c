@@ -0,0 +1,365 @@
+
+// Sharbigajar.Backend.ShaderCache
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <GL/glew.h>
+
+#include "Allocator.h"
+#include "Effectno.h"
+#include "Text.h"
+#include "Backend/Shaders.h"
+#include "Backend/ShaderCache.h"
+
+
+
+// type ShaderCache
+
+// Start of every cache file, followed by 'length' bytes of program binary
+// in the driver's 'format'.
+//
+typedef struct CacheHeader CacheHeader;
+
+struct CacheHeader {
+    char magic[8];
+    uint64_t key;
+    uint32_t format;
+    uint32_t length;
+};
+
+static const char cacheMagic[8] = "SGPROG1";
+
+// Cache files are named by their key, in 16 hex digits, and this suffix.
+//
+#define CACHE_SUFFIX ".prog"
+#define CACHE_NAME_LENGTH (16 + sizeof (CACHE_SUFFIX) - 1)
+
+// Open a shader cache in a directory, creating the directory if it isn't
+// there already.
+//
+ShaderCache newShaderCache (const char directory[], size_t maxSize) {
+    mkdir (directory, 0755);
+
+    GLint numFormats = 0;
+    glGetIntegerv (GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+
+    TextBuilder driver = newTextBuilder (256);
+    formatToBuilder
+        ( &driver, "%s\n%s\n%s"
+        , (const char *) glGetString (GL_VENDOR)
+        , (const char *) glGetString (GL_RENDERER)
+        , (const char *) glGetString (GL_VERSION) );
+
+    Text driverText = buildText (driver);
+    uint64_t driverHash = hashText (driverText);
+    freeText (driverText);
+
+    ShaderCache cache = {
+        .directory      = copyTextFromString (directory),
+        .maxSize        = maxSize,
+        .driverHash     = driverHash,
+        .enabled        = numFormats > 0,
+        .sizeEstimate   = 0,
+        .hits           = 0,
+        .misses         = 0
+    };
+
+    if (cache.enabled)
+        trimShaderCache (&cache);
+
+    return cache;
+}
+
+void freeShaderCache (ShaderCache cache) {
+    freeText (cache.directory);
+}
+
+
+// Hash everything a program binary depends on: the driver, and each
+// shader's type and source text.
+//
+static uint64_t programKey
+    ( Allocator allocator, const ShaderCache *cache
+    , unsigned int numShaders, const ShaderInfo infos[], const Text sources[] )
+{
+    unsigned int numParts = 1 + 2 * numShaders;
+    uint64_t *parts = (uint64_t *) allocMemory (allocator, numParts * sizeof (uint64_t));
+
+    parts[0] = cache->driverHash;
+    for (unsigned int shaderIx = 0; shaderIx < numShaders; shaderIx++) {
+        parts[1 + 2 * shaderIx] = infos[shaderIx].shaderType;
+        parts[2 + 2 * shaderIx] = hashText (sources[shaderIx]);
+    }
+
+    uint64_t key = hashText
+        ((Text) { (const char *) parts, numParts * sizeof (uint64_t) });
+
+    freeMemory (allocator, parts, numParts * sizeof (uint64_t));
+
+    return key;
+}
+
+static Text cachePath (Allocator allocator, const ShaderCache *cache, uint64_t key) {
+    TextBuilder path = newTextBuilderWith (allocator, cache->directory.length + 1 + CACHE_NAME_LENGTH);
+
+    formatToBuilder
+        ( &path, "%s/%016llx" CACHE_SUFFIX
+        , cache->directory.array, (unsigned long long) key );
+
+    return buildText (path);
+}
+
+
+// Load a program from its cache file, if there is one and the driver
+// takes it. Anything else in the file's place is deleted.
+//
+static int loadCachedProgram
+    (Allocator allocator, const GLuint program, Text path, uint64_t key)
+{
+    if (access (path.array, R_OK) != 0)
+        return 0;
+
+    EffectType effect = effectno;
+    Text entry = textFromFileWith (allocator, path);
+    if (!entry.array) {
+        effectno = effect;
+        return 0;
+    }
+
+    CacheHeader header;
+    GLint linked = 0;
+
+    if (entry.length >= sizeof (CacheHeader)) {
+        memcpy (&header, entry.array, sizeof (CacheHeader));
+
+        if (memcmp (header.magic, cacheMagic, sizeof (cacheMagic)) == 0
+            && header.key == key
+            && header.length == entry.length - sizeof (CacheHeader))
+        {
+            glProgramBinary
+                ( program, header.format
+                , entry.array + sizeof (CacheHeader), header.length );
+            glGetProgramiv (program, GL_LINK_STATUS, &linked);
+        }
+    }
+
+    freeTextWith (allocator, entry);
+
+    // Mark the entry as used just now, for 'trimShaderCache'.
+    if (linked)
+        utimensat (AT_FDCWD, path.array, NULL, 0);
+    else
+        unlink (path.array);
+
+    return linked;
+}
+
+// Save a freshly linked program to its cache file, and give the size of
+// the file, or 0 if it wasn't saved. It's written to a temporary file
+// first and renamed into place, so nothing else reading the cache ever
+// sees half an entry.
+//
+static size_t storeCachedProgram
+    (Allocator allocator, const GLuint program, Text path, uint64_t key)
+{
+    GLint linked = 0, length = 0;
+    glGetProgramiv (program, GL_LINK_STATUS, &linked);
+    glGetProgramiv (program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (!linked || length <= 0)
+        return 0;
+
+    size_t size = sizeof (CacheHeader) + length;
+    char *entry = (char *) allocMemory (allocator, size);
+
+    GLsizei written = 0;
+    GLenum format = 0;
+    glGetProgramBinary (program, length, &written, &format, entry + sizeof (CacheHeader));
+
+    CacheHeader header = {
+        .key    = key,
+        .format = format,
+        .length = written
+    };
+    memcpy (header.magic, cacheMagic, sizeof (cacheMagic));
+    memcpy (entry, &header, sizeof (CacheHeader));
+
+    TextBuilder tempPath = newTextBuilderWith (allocator, path.length + 16);
+    formatToBuilder (&tempPath, "%s.%d", path.array, (int) getpid ());
+
+    int fd = open (tempPath.array, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    size_t total = sizeof (CacheHeader) + written;
+    int saved = fd >= 0 && write (fd, entry, total) == (ssize_t) total;
+
+    if (fd >= 0)
+        close (fd);
+    if (saved && rename (tempPath.array, path.array) != 0)
+        saved = 0;
+    if (!saved)
+        unlink (tempPath.array);
+
+    freeTextBuilder (tempPath);
+    freeMemory (allocator, entry, size);
+
+    return saved ? total : 0;
+}
+
+
+// Compile a list of shaders into a GL program, or load it from a cache.
+//
+const GLuint compileCachedShaderProgram
+    (ShaderCache *cache, unsigned int numShaders, const ShaderInfo infos[])
+{
+    return compileCachedShaderProgramWith (heapAllocator, cache, numShaders, infos);
+}
+
+// Compile a list of shaders into a GL program, or load it from a cache,
+// taking the temporary memory that needs from 'allocator'.
+//
+// The sources are always read, to find the key. If one can't be read,
+// this does what 'compileShaderProgram' does, errors and all.
+//
+const GLuint compileCachedShaderProgramWith
+    ( Allocator allocator, ShaderCache *cache
+    , unsigned int numShaders, const ShaderInfo infos[] )
+{
+    if (!cache->enabled)
+        return compileShaderProgramWith (allocator, numShaders, infos);
+
+    Text *sources = (Text *) allocMemory (allocator, numShaders * sizeof (Text));
+    unsigned int numSources = 0;
+
+    EffectType effect = effectno;
+    for (; numSources < numShaders; numSources++) {
+        sources[numSources] = textFromFileWith (allocator, infos[numSources].filename);
+        if (!sources[numSources].array)
+            break;
+    }
+
+    GLuint program = 0;
+
+    if (numSources == numShaders) {
+        uint64_t key = programKey (allocator, cache, numShaders, infos, sources);
+        Text path = cachePath (allocator, cache, key);
+
+        program = glCreateProgram ();
+
+        if (loadCachedProgram (allocator, program, path, key)) {
+            cache->hits++;
+        }
+        else {
+            cache->misses++;
+
+            GLuint *shaders = (GLuint *) allocMemory (allocator, numShaders * sizeof (GLuint));
+            for (unsigned int shaderIx = 0; shaderIx < numShaders; shaderIx++)
+                shaders[shaderIx] = compileShaderText (allocator, infos[shaderIx], sources[shaderIx]);
+
+            glProgramParameteri (program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+            linkShaderProgram (program, numShaders, shaders);
+
+            for (unsigned int shaderIx = 0; shaderIx < numShaders; shaderIx++)
+                glDeleteShader (shaders[shaderIx]);
+            freeMemory (allocator, shaders, numShaders * sizeof (GLuint));
+
+            cache->sizeEstimate += storeCachedProgram (allocator, program, path, key);
+            if (cache->sizeEstimate > cache->maxSize)
+                trimShaderCache (cache);
+        }
+
+        freeTextWith (allocator, path);
+    }
+
+    // Free in reverse, so an arena gets everything back.
+    while (numSources > 0)
+        freeTextWith (allocator, sources[--numSources]);
+    freeMemory (allocator, sources, numShaders * sizeof (Text));
+
+    if (program == 0) {
+        effectno = effect;
+        return compileShaderProgramWith (allocator, numShaders, infos);
+    }
+
+    return program;
+}
+
+
+// A cache file, for 'trimShaderCache'.
+//
+typedef struct CacheFile CacheFile;
+
+struct CacheFile {
+    char name[CACHE_NAME_LENGTH + 1];
+    off_t size;
+    struct timespec used;
+};
+
+static int compareCacheFiles (const void *a, const void *b) {
+    const struct timespec
+        *p = &((const CacheFile *) a)->used,
+        *q = &((const CacheFile *) b)->used;
+
+    if (p->tv_sec != q->tv_sec)
+        return p->tv_sec < q->tv_sec ? -1 : 1;
+    return (p->tv_nsec > q->tv_nsec) - (p->tv_nsec < q->tv_nsec);
+}
+
+// Delete the least recently used cache files until the rest fit in the
+// cache's 'maxSize', and start its size estimate again from what's left.
+// With no memory to list every file, only those listed so far count.
+//
+void trimShaderCache (ShaderCache *cache) {
+    DIR *dir = opendir (cache->directory.array);
+    if (!dir)
+        return;
+
+    CacheFile *files = NULL;
+    unsigned int numFiles = 0, maxFiles = 0;
+    size_t total = 0;
+
+    struct dirent *dirEntry;
+    while ((dirEntry = readdir (dir))) {
+        const char *name = dirEntry->d_name;
+        struct stat status;
+
+        if (strlen (name) != CACHE_NAME_LENGTH
+            || strcmp (name + 16, CACHE_SUFFIX) != 0
+            || fstatat (dirfd (dir), name, &status, 0) != 0)
+            continue;
+
+        if (numFiles == maxFiles) {
+            unsigned int grownMax = maxFiles ? maxFiles * 2 : 64;
+            CacheFile *grown = (CacheFile *) realloc (files, grownMax * sizeof (CacheFile));
+            if (!grown)
+                break;
+
+            files = grown;
+            maxFiles = grownMax;
+        }
+
+        CacheFile *file = &files[numFiles++];
+        memcpy (file->name, name, sizeof (file->name));
+        file->size = status.st_size;
+        file->used = status.st_mtim;
+
+        total += status.st_size;
+    }
+
+    if (total > cache->maxSize) {
+        qsort (files, numFiles, sizeof (CacheFile), compareCacheFiles);
+
+        for (unsigned int fileIx = 0; fileIx < numFiles && total > cache->maxSize; fileIx++)
+            if (unlinkat (dirfd (dir), files[fileIx].name, 0) == 0)
+                total -= files[fileIx].size;
+    }
+
+    cache->sizeEstimate = total;
+
+    free (files);
+    closedir (dir);
+}
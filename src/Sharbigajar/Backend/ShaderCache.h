@@ -0,0 +1,59 @@
+
+#ifndef SHARBIGAJAR_BACKEND_SHADER_CACHE_H
+#define SHARBIGAJAR_BACKEND_SHADER_CACHE_H
+
+#include <stdint.h>
+
+#include <GL/glew.h>
+
+#include "Allocator.h"
+#include "Text.h"
+#include "Backend/Shaders.h"
+
+
+
+// On-disk cache of linked shader programs, as 'glGetProgramBinary' gives
+// them, one file per program in 'directory'.
+//
+// A program's key is a hash of its shaders' source texts and types, and
+// of the GL vendor, renderer and version, so editing a shader or moving
+// to another driver just misses the cache. Entries the driver rejects
+// anyway are deleted and compiled again. Once the files add up to more
+// than 'maxSize' bytes, the ones least recently used are deleted.
+//
+// Rather than look through the directory on every miss, a cache keeps an
+// estimate of its size: counted when it's made, and added to with each
+// program it stores. Only when that passes 'maxSize' is the directory
+// counted, and trimmed, again.
+//
+// A cache needs a current GL context to be made and used. Drivers with
+// no binary formats get a cache that compiles everything, every time.
+//
+typedef struct ShaderCache ShaderCache;
+
+struct ShaderCache {
+    Text directory;
+    size_t maxSize;
+
+    uint64_t driverHash;
+    int enabled;
+
+    size_t sizeEstimate;
+
+    unsigned int hits;
+    unsigned int misses;
+};
+
+#define SHADER_CACHE_DEFAULT_SIZE (64 * 1024 * 1024)
+
+ShaderCache newShaderCache (const char [], size_t);
+void freeShaderCache (ShaderCache);
+
+const GLuint compileCachedShaderProgram
+    (ShaderCache *, unsigned int, const ShaderInfo []);
+const GLuint compileCachedShaderProgramWith
+    (Allocator, ShaderCache *, unsigned int, const ShaderInfo []);
+
+void trimShaderCache (ShaderCache *);
+
+#endif
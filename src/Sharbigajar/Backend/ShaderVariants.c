@@ -0,0 +1,538 @@
+
+// Sharbigajar.Backend.ShaderVariants
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <GL/glew.h>
+
+#include "Allocator.h"
+#include "Effectno.h"
+#include "Name.h"
+#include "Text.h"
+#include "Backend/Shaders.h"
+#include "Backend/ShaderVariants.h"
+
+
+
+// type ShaderVariants
+
+// Deepest '#include's can nest, which is also as far as an include cycle
+// gets before it's caught.
+//
+#define MAX_INCLUDE_DEPTH 16
+
+// A stage whose source couldn't be preprocessed.
+//
+#define NO_SHADER ((unsigned int) -1)
+
+// Make a set of variants of the program the given shaders make up, with
+// nothing compiled yet.
+//
+ShaderVariants newShaderVariants (unsigned int numStages, const ShaderInfo infos[]) {
+    ShaderInfo *copies = (ShaderInfo *) malloc (numStages * sizeof (ShaderInfo));
+    memcpy (copies, infos, numStages * sizeof (ShaderInfo));
+
+    return (ShaderVariants) {
+        .infos      = copies,
+        .numStages  = numStages,
+        .sources    = NULL,
+        .numSources = 0,
+        .maxSources = 0,
+        .shaders    = NULL,
+        .numShaders = 0,
+        .maxShaders = 0,
+        .variants   = NULL,
+        .numVariants = 0,
+        .maxVariants = 0,
+        .arena      = newArena (1024)
+    };
+}
+
+// Free a set of variants, and delete all their shaders and programs.
+//
+void freeShaderVariants (ShaderVariants variants) {
+    for (unsigned int variantIx = 0; variantIx < variants.numVariants; variantIx++) {
+        GLuint program = variants.variants[variantIx].program;
+
+        // Programs can be shared, and only go once.
+        int first = 1;
+        for (unsigned int otherIx = 0; otherIx < variantIx && first; otherIx++)
+            first = variants.variants[otherIx].program != program;
+
+        if (program && first)
+            glDeleteProgram (program);
+    }
+
+    for (unsigned int shaderIx = 0; shaderIx < variants.numShaders; shaderIx++) {
+        if (variants.shaders[shaderIx].shader)
+            glDeleteShader (variants.shaders[shaderIx].shader);
+        freeText (variants.shaders[shaderIx].source);
+    }
+
+    for (unsigned int sourceIx = 0; sourceIx < variants.numSources; sourceIx++)
+        freeText (variants.sources[sourceIx].text);
+
+    free (variants.infos);
+    free (variants.sources);
+    free (variants.shaders);
+    free (variants.variants);
+    freeArena (variants.arena);
+}
+
+
+// Get the text of a source file, reading it the first time. Gives a text
+// with no array if the file can't be read.
+//
+static Text sourceText (ShaderVariants *variants, Name file) {
+    for (unsigned int sourceIx = 0; sourceIx < variants->numSources; sourceIx++)
+        if (variants->sources[sourceIx].file == file)
+            return variants->sources[sourceIx].text;
+
+    Text text = textFromFile (nameText (file));
+    if (!text.array)
+        return text;
+
+    if (variants->numSources == variants->maxSources) {
+        variants->maxSources = variants->maxSources ? variants->maxSources * 2 : 8;
+        variants->sources = (VariantSource *) realloc
+            (variants->sources, variants->maxSources * sizeof (VariantSource));
+    }
+
+    variants->sources[variants->numSources++] = (VariantSource) {file, text};
+    return text;
+}
+
+// Find the file an '#include' means: relative to the including file's
+// directory, unless it's an absolute path.
+//
+static Name includedFile (Name includer, Text path) {
+    Text includerName = nameText (includer);
+    const char *slash = strrchr (includerName.array, '/');
+
+    if (path.array[0] == '/' || !slash)
+        return internText (path);
+
+    TextBuilder builder = newTextBuilder (includerName.length + path.length);
+    appendToBuilder (&builder, (Text) {includerName.array, slash + 1 - includerName.array});
+    appendToBuilder (&builder, path);
+
+    Name file = internText ((Text) {builder.array, builder.length});
+    freeTextBuilder (builder);
+
+    return file;
+}
+
+
+// Whether a line is a given preprocessor directive, and if so, what
+// follows the directive's name.
+//
+static int matchDirective (Text line, const char directive[], Text *rest) {
+    const char *p = line.array, *end = line.array + line.length;
+    unsigned int length = strlen (directive);
+
+    while (p < end && (*p == ' ' || *p == '\t'))
+        p++;
+    if (p == end || *p != '#')
+        return 0;
+    p++;
+    while (p < end && (*p == ' ' || *p == '\t'))
+        p++;
+
+    if ((unsigned int) (end - p) < length || memcmp (p, directive, length) != 0)
+        return 0;
+    p += length;
+    if (p < end && *p != ' ' && *p != '\t' && *p != '"')
+        return 0;
+
+    *rest = (Text) {p, end - p};
+    return 1;
+}
+
+// Get the path out of what follows '#include', which has to be quoted.
+//
+static int includePath (Text rest, Text *path) {
+    const char *p = rest.array, *end = rest.array + rest.length;
+
+    while (p < end && (*p == ' ' || *p == '\t'))
+        p++;
+    if (p == end || *p != '"')
+        return 0;
+
+    const char *close = memchr (p + 1, '"', end - p - 1);
+    if (!close || close == p + 1)
+        return 0;
+
+    *path = (Text) {p + 1, close - p - 1};
+    return 1;
+}
+
+static int isNameChar (char c) {
+    return isalnum ((unsigned char) c) || c == '_';
+}
+
+// Whether a name appears in a text as a whole identifier.
+//
+static int mentionsName (Text text, Text name) {
+    const char *p = text.array, *end = text.array + text.length;
+
+    while (name.length && (unsigned int) (end - p) >= name.length) {
+        const char *found = memchr (p, name.array[0], end - p - name.length + 1);
+        if (!found)
+            return 0;
+
+        const char *after = found + name.length;
+        if (memcmp (found, name.array, name.length) == 0
+            && (found == text.array || !isNameChar (found[-1]))
+            && (after == end || !isNameChar (*after)))
+            return 1;
+
+        p = found + 1;
+    }
+
+    return 0;
+}
+
+
+// State of preprocessing one stage's source.
+//
+typedef struct Expansion Expansion;
+
+struct Expansion {
+    ShaderVariants *variants;
+    TextBuilder out;
+
+    int version;
+    // ^ From the '#version' line, which changes what '#line' means.
+    unsigned int versionEnd;
+    unsigned int versionLine;
+    // ^ Where the defines go, after the '#version' line if there is one,
+    //   and the line number after it.
+    unsigned int numFiles;
+};
+
+// Carry on numbering lines from 'line', in source string 'source', so
+// GL's errors point at the right file and line. Before GLSL 3.30, '#line'
+// numbers the line after it, rather than the next one.
+//
+static void lineDirective
+    (TextBuilder *builder, int version, unsigned int line, unsigned int source)
+{
+    formatToBuilder (builder, "#line %u %u\n", version < 330 ? line - 1 : line, source);
+}
+
+// Append a file's text to the expansion, line by line, replacing each
+// '#include' with the file it names.
+//
+static int expandFile
+    ( Expansion *expansion, Name file, Text text
+    , unsigned int sourceNumber, unsigned int depth )
+{
+    const char *p = text.array, *end = text.array + text.length;
+
+    for (unsigned int lineNo = 1; p < end; lineNo++) {
+        const char *eol = memchr (p, '\n', end - p);
+        Text line = {p, (eol ? eol : end) - p};
+        p = eol ? eol + 1 : end;
+
+        Text rest, path;
+
+        if (depth == 0 && !expansion->versionEnd && matchDirective (line, "version", &rest)) {
+            appendToBuilder (&expansion->out, line);
+            appendCharToBuilder (&expansion->out, '\n');
+
+            expansion->version = (int) strtol (rest.array, NULL, 10);
+            expansion->versionEnd = expansion->out.length;
+            expansion->versionLine = lineNo + 1;
+        }
+        else if (matchDirective (line, "include", &rest)) {
+            if (!includePath (rest, &path) || depth + 1 >= MAX_INCLUDE_DEPTH) {
+                effectno = ShaderIncludeError;
+                printf
+                    ( "error: preprocessShader: %s #include at %s:%u\n"
+                    , depth + 1 >= MAX_INCLUDE_DEPTH ? "too deep an" : "bad"
+                    , nameText (file).array, lineNo );
+                return 0;
+            }
+
+            Name included = includedFile (file, path);
+            Text includedText = sourceText (expansion->variants, included);
+            if (!includedText.array) {
+                effectno = IOError;
+                printf
+                    ( "error: preprocessShader: failed to open %s\n"
+                      "       included from %s:%u\n"
+                    , nameText (included).array, nameText (file).array, lineNo );
+                return 0;
+            }
+
+            // Say which source string is which file, for reading GL's
+            // errors by.
+            unsigned int includedNumber = ++expansion->numFiles;
+            formatToBuilder
+                ( &expansion->out, "// %u: %s\n"
+                , includedNumber, nameText (included).array );
+            lineDirective (&expansion->out, expansion->version, 1, includedNumber);
+
+            if (!expandFile (expansion, included, includedText, includedNumber, depth + 1))
+                return 0;
+
+            lineDirective (&expansion->out, expansion->version, lineNo + 1, sourceNumber);
+        }
+        else {
+            appendToBuilder (&expansion->out, line);
+            appendCharToBuilder (&expansion->out, '\n');
+        }
+    }
+
+    return 1;
+}
+
+// Preprocess a shader's source for a set of defines: resolve its
+// includes, and put in the defines it mentions. Returns the expanded
+// text, to be freed by the caller, or sets 'effectno' and gives a text
+// with no array.
+//
+Text preprocessShader
+    ( ShaderVariants *variants, const ShaderInfo info
+    , unsigned int numDefines, const ShaderDefine defines[] )
+{
+    Text text = sourceText (variants, info.file);
+    if (!text.array) {
+        effectno = IOError;
+        printf ("error: preprocessShader: failed to open %s\n", info.filename.array);
+        return (Text) {0, 0};
+    }
+
+    Expansion expansion = {
+        .variants       = variants,
+        .out            = newTextBuilder (text.length),
+        .version        = 110,
+        .versionEnd     = 0,
+        .versionLine    = 1,
+        .numFiles       = 0
+    };
+
+    if (!expandFile (&expansion, info.file, text, 0, 0)) {
+        freeTextBuilder (expansion.out);
+        return (Text) {0, 0};
+    }
+
+    Text body = {
+        expansion.out.array + expansion.versionEnd,
+        expansion.out.length - expansion.versionEnd
+    };
+
+    // The defines go in after '#version', which has to come first.
+    TextBuilder defined = newTextBuilder (expansion.out.length + numDefines * 32);
+    appendToBuilder (&defined, (Text) {expansion.out.array, expansion.versionEnd});
+
+    unsigned int numDefined = 0;
+    for (unsigned int defineIx = 0; defineIx < numDefines; defineIx++) {
+        Text name = nameText (defines[defineIx].name);
+        if (!mentionsName (body, name))
+            continue;
+
+        formatToBuilder
+            ( &defined, "#define %s %.*s\n", name.array
+            , (int) defines[defineIx].value.length, defines[defineIx].value.array );
+        numDefined++;
+    }
+
+    if (numDefined)
+        lineDirective (&defined, expansion.version, expansion.versionLine, 0);
+
+    appendToBuilder (&defined, body);
+    freeTextBuilder (expansion.out);
+
+    return buildText (defined);
+}
+
+
+// Find the shader compiled from an expanded source, or compile it. Takes
+// the source either way, and gives the shader's index.
+//
+static unsigned int findShader (ShaderVariants *variants, const ShaderInfo info, Text source) {
+    uint64_t hash = hashText (source);
+
+    for (unsigned int shaderIx = 0; shaderIx < variants->numShaders; shaderIx++) {
+        const VariantShader *shader = &variants->shaders[shaderIx];
+
+        if (shader->hash == hash && shader->shaderType == info.shaderType
+            && textEquals (shader->source, source))
+        {
+            freeText (source);
+            return shaderIx;
+        }
+    }
+
+    GLuint shader = startShaderCompile (info, source);
+    if (shader && !checkShaderCompiled (heapAllocator, info, shader)) {
+        glDeleteShader (shader);
+        shader = 0;
+    }
+
+    if (variants->numShaders == variants->maxShaders) {
+        variants->maxShaders = variants->maxShaders ? variants->maxShaders * 2 : 8;
+        variants->shaders = (VariantShader *) realloc
+            (variants->shaders, variants->maxShaders * sizeof (VariantShader));
+    }
+
+    variants->shaders[variants->numShaders] = (VariantShader) {
+        .hash       = hash,
+        .shaderType = info.shaderType,
+        .source     = source,
+        .shader     = shader
+    };
+
+    return variants->numShaders++;
+}
+
+// Find a program already linked from the same shaders as a variant.
+//
+static GLuint findProgram (const ShaderVariants *variants, const unsigned int shaders[]) {
+    for (unsigned int variantIx = 0; variantIx < variants->numVariants; variantIx++) {
+        const ShaderVariant *variant = &variants->variants[variantIx];
+
+        if (variant->program && memcmp
+            (variant->shaders, shaders, variants->numStages * sizeof (unsigned int)) == 0)
+            return variant->program;
+    }
+
+    return 0;
+}
+
+// Build a variant that hasn't been asked for before: preprocess and
+// compile each stage, or find it compiled already, and link them, unless
+// another variant has the same shaders.
+//
+static const GLuint buildVariant
+    ( ShaderVariants *variants, uint64_t key
+    , unsigned int numDefines, const ShaderDefine defines[] )
+{
+    ArenaMark mark = markArena (&variants->arena);
+
+    ShaderVariant variant = {
+        .key        = key,
+        .defines    = (ShaderDefine *) arenaAlloc
+            (&variants->arena, numDefines * sizeof (ShaderDefine)),
+        .numDefines = numDefines,
+        .shaders    = (unsigned int *) arenaAlloc
+            (&variants->arena, variants->numStages * sizeof (unsigned int)),
+        .program    = 0
+    };
+
+    int copied = variant.defines && variant.shaders;
+
+    for (unsigned int defineIx = 0; copied && defineIx < numDefines; defineIx++) {
+        Text value = defines[defineIx].value;
+        char *array = (char *) arenaAlloc (&variants->arena, value.length + 1);
+        if (!array) {
+            copied = 0;
+            break;
+        }
+
+        if (value.length)
+            memcpy (array, value.array, value.length);
+        array[value.length] = '\0';
+
+        variant.defines[defineIx] = (ShaderDefine) {defines[defineIx].name, {array, value.length}};
+    }
+
+    // Give back what did fit, and leave the variant to be asked for again
+    if (!copied) {
+        resetArenaTo (&variants->arena, mark);
+        effectno = StandardError;
+        printf ("error: buildVariant: no memory for the variant's defines\n");
+        return 0;
+    }
+
+    int complete = 1;
+    GLuint *handles = (GLuint *) malloc (variants->numStages * sizeof (GLuint));
+
+    for (unsigned int stageIx = 0; stageIx < variants->numStages; stageIx++) {
+        const ShaderInfo info = variants->infos[stageIx];
+        Text source = preprocessShader (variants, info, numDefines, defines);
+
+        variant.shaders[stageIx] = source.array ? findShader (variants, info, source) : NO_SHADER;
+        handles[stageIx] = source.array ? variants->shaders[variant.shaders[stageIx]].shader : 0;
+        complete &= handles[stageIx] != 0;
+    }
+
+    if (complete)
+        variant.program = findProgram (variants, variant.shaders);
+
+    if (complete && !variant.program) {
+        variant.program = linkShaderProgram
+            (glCreateProgram (), variants->numStages, handles);
+
+        if (!checkProgramLinked (heapAllocator, variant.program)) {
+            glDeleteProgram (variant.program);
+            variant.program = 0;
+        }
+    }
+
+    free (handles);
+
+    if (variants->numVariants == variants->maxVariants) {
+        variants->maxVariants = variants->maxVariants ? variants->maxVariants * 2 : 8;
+        variants->variants = (ShaderVariant *) realloc
+            (variants->variants, variants->maxVariants * sizeof (ShaderVariant));
+    }
+
+    variants->variants[variants->numVariants++] = variant;
+    return variant.program;
+}
+
+// Get the program for a set of defines, in any order, building it the
+// first time it's asked for. Gives 0, and sets 'effectno' the first time,
+// if it doesn't build.
+//
+const GLuint variantProgram
+    (ShaderVariants *variants, unsigned int numDefines, const ShaderDefine defines[])
+{
+    if (numDefines > SHADER_MAX_DEFINES) {
+        effectno = StandardError;
+        printf
+            ( "error: variantProgram: %u defines, out of at most %u\n"
+            , numDefines, SHADER_MAX_DEFINES );
+        return 0;
+    }
+
+    // Sort the defines by name, so their order doesn't matter, and hash
+    // them without copying any text.
+    ShaderDefine sorted[SHADER_MAX_DEFINES];
+    uint64_t words[2 * SHADER_MAX_DEFINES];
+
+    for (unsigned int defineIx = 0; defineIx < numDefines; defineIx++) {
+        unsigned int sortIx = defineIx;
+        for (; sortIx > 0 && sorted[sortIx - 1].name > defines[defineIx].name; sortIx--)
+            sorted[sortIx] = sorted[sortIx - 1];
+        sorted[sortIx] = defines[defineIx];
+    }
+
+    for (unsigned int defineIx = 0; defineIx < numDefines; defineIx++) {
+        words[2 * defineIx] = sorted[defineIx].name;
+        words[2 * defineIx + 1] = hashText (sorted[defineIx].value);
+    }
+
+    uint64_t key = hashText ((Text) {(const char *) words, numDefines * 2 * sizeof (uint64_t)});
+
+    for (unsigned int variantIx = 0; variantIx < variants->numVariants; variantIx++) {
+        const ShaderVariant *variant = &variants->variants[variantIx];
+        if (variant->key != key || variant->numDefines != numDefines)
+            continue;
+
+        int same = 1;
+        for (unsigned int defineIx = 0; defineIx < numDefines && same; defineIx++)
+            same = variant->defines[defineIx].name == sorted[defineIx].name
+                && textEquals (variant->defines[defineIx].value, sorted[defineIx].value);
+
+        if (same)
+            return variant->program;
+    }
+
+    return buildVariant (variants, key, numDefines, sorted);
+}
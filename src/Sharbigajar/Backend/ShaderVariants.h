@@ -0,0 +1,118 @@
+
+#ifndef SHARBIGAJAR_BACKEND_SHADER_VARIANTS_H
+#define SHARBIGAJAR_BACKEND_SHADER_VARIANTS_H
+
+#include <stdint.h>
+
+#include <GL/glew.h>
+
+#include "Allocator.h"
+#include "Name.h"
+#include "Text.h"
+#include "Backend/Shaders.h"
+
+
+
+// A '#define' to build a shader variant with. 'value' can be empty.
+//
+typedef struct ShaderDefine ShaderDefine;
+
+struct ShaderDefine {
+    Name name;
+    Text value;
+};
+
+// Most defines a single variant can have.
+//
+#define SHADER_MAX_DEFINES 32
+
+
+// A shader source file, read once and kept for every variant after.
+//
+typedef struct VariantSource VariantSource;
+
+struct VariantSource {
+    Name file;
+    Text text;
+};
+
+// A shader compiled from one expanded source. Variants whose expanded
+// sources come out the same share it.
+//
+typedef struct VariantShader VariantShader;
+
+struct VariantShader {
+    uint64_t hash;
+    GLenum shaderType;
+    Text source;
+    GLuint shader;
+    // ^ 0 if it failed to compile.
+};
+
+// One permutation of defines, and the program it built. 'defines' are
+// sorted by name, and 'key' is their hash. Variants whose shaders are all
+// the same share a program.
+//
+typedef struct ShaderVariant ShaderVariant;
+
+struct ShaderVariant {
+    uint64_t key;
+    ShaderDefine *defines;
+    unsigned int numDefines;
+
+    unsigned int *shaders;
+    // ^ Indices into 'shaders' of the set, one per stage.
+    GLuint program;
+    // ^ 0 if it failed to build.
+};
+
+
+// Every variant of one shader program, built from the same source files
+// with different sets of defines, like lighting models or levels of
+// detail.
+//
+// The sources are preprocessed first: '#include "file"' lines are
+// replaced by the file, found relative to the one including it, and
+// the defines go in after the '#version' line. Only the defines a stage
+// actually mentions go into it, so stages a define makes no difference
+// to come out the same, and are compiled once between them.
+//
+// Nothing's compiled until a variant is first asked for; after that,
+// asking again finds the program from a hash of the defines, without
+// allocating. Variants that failed to build are remembered too, and
+// give 0 without being tried again.
+//
+// The set owns its shaders and programs, and needs a current GL context
+// to be used and freed.
+//
+typedef struct ShaderVariants ShaderVariants;
+
+struct ShaderVariants {
+    ShaderInfo *infos;
+    unsigned int numStages;
+
+    VariantSource *sources;
+    unsigned int numSources;
+    unsigned int maxSources;
+
+    VariantShader *shaders;
+    unsigned int numShaders;
+    unsigned int maxShaders;
+
+    ShaderVariant *variants;
+    unsigned int numVariants;
+    unsigned int maxVariants;
+
+    Arena arena;
+    // ^ For the variants' defines and shader lists.
+};
+
+ShaderVariants newShaderVariants (unsigned int, const ShaderInfo []);
+void freeShaderVariants (ShaderVariants);
+
+Text preprocessShader
+    (ShaderVariants *, const ShaderInfo, unsigned int, const ShaderDefine []);
+
+const GLuint variantProgram (ShaderVariants *, unsigned int, const ShaderDefine []);
+
+#endif
@@ -0,0 +1,339 @@
+
+// Sharbigajar.Backend.ShaderWatcher
+
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <GL/glew.h>
+
+#include "Effectno.h"
+#include "Name.h"
+#include "Text.h"
+#include "Backend/Shaders.h"
+#include "Backend/ShaderBatch.h"
+#include "Backend/ShaderWatcher.h"
+
+
+
+// type ShaderWatcher
+
+#define WATCH_EVENTS (IN_CLOSE_WRITE | IN_MOVED_TO)
+
+// Flag the watched files named in a buffer of inotify events.
+//
+static int flagFiles (ShaderWatcher *watcher, const char buffer[], size_t length) {
+    int changed = 0;
+
+    pthread_mutex_lock (&watcher->lock);
+
+    for (const char *p = buffer; p < buffer + length; ) {
+        const struct inotify_event *event = (const struct inotify_event *) p;
+        p += sizeof (struct inotify_event) + event->len;
+
+        if (event->len == 0)
+            continue;
+
+        for (unsigned int fileIx = 0; fileIx < watcher->numFiles; fileIx++) {
+            WatchedFile *file = &watcher->files[fileIx];
+
+            if (file->wd == event->wd && strcmp (file->base.array, event->name) == 0) {
+                file->dirty = 1;
+                changed = 1;
+            }
+        }
+    }
+
+    pthread_mutex_unlock (&watcher->lock);
+
+    return changed;
+}
+
+// Wait for watched files to change, until told to quit.
+//
+static void *watchFiles (void *context) {
+    ShaderWatcher *watcher = (ShaderWatcher *) context;
+
+    char buffer[4096]
+        __attribute__ ((aligned (__alignof__ (struct inotify_event))));
+
+    struct pollfd fds[2] = {
+        { .fd = watcher->inotify,   .events = POLLIN },
+        { .fd = watcher->quit,      .events = POLLIN }
+    };
+
+    while (1) {
+        if (poll (fds, 2, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        if (fds[1].revents)
+            break;
+
+        ssize_t length = read (watcher->inotify, buffer, sizeof (buffer));
+        if (length > 0 && flagFiles (watcher, buffer, length))
+            __atomic_store_n (&watcher->changed, 1, __ATOMIC_RELEASE);
+    }
+
+    return NULL;
+}
+
+// Create a new shader watcher, with nothing to watch yet, or set
+// 'effectno' and return NULL if inotify isn't there.
+//
+ShaderWatcher *newShaderWatcher (void) {
+    ShaderWatcher *watcher = (ShaderWatcher *) calloc (1, sizeof (ShaderWatcher));
+
+    watcher->inotify = inotify_init1 (IN_CLOEXEC);
+    watcher->quit = eventfd (0, EFD_CLOEXEC);
+
+    pthread_mutex_init (&watcher->lock, NULL);
+
+    if (watcher->inotify < 0 || watcher->quit < 0
+        || pthread_create (&watcher->watcher, NULL, watchFiles, watcher) != 0)
+    {
+        effectno = IOError;
+        printf ("error: newShaderWatcher: failed to start watching files\n");
+
+        if (watcher->inotify >= 0)
+            close (watcher->inotify);
+        if (watcher->quit >= 0)
+            close (watcher->quit);
+        pthread_mutex_destroy (&watcher->lock);
+        free (watcher);
+
+        return NULL;
+    }
+
+    return watcher;
+}
+
+// Stop watching, and delete every program being watched.
+//
+void freeShaderWatcher (ShaderWatcher *watcher) {
+    uint64_t one = 1;
+    if (write (watcher->quit, &one, sizeof (one)) == sizeof (one))
+        pthread_join (watcher->watcher, NULL);
+
+    close (watcher->inotify);
+    close (watcher->quit);
+    pthread_mutex_destroy (&watcher->lock);
+
+    if (watcher->batch) {
+        finishShaderBatch (watcher->batch);
+        for (unsigned int programIx = 0; programIx < watcher->batch->numPrograms; programIx++)
+            glDeleteProgram (watcher->batch->programs[programIx].program);
+        freeShaderBatch (watcher->batch);
+    }
+
+    for (unsigned int programIx = 0; programIx < watcher->numPrograms; programIx++) {
+        glDeleteProgram (watcher->programs[programIx].program);
+        freeText (watcher->programs[programIx].log);
+        free (watcher->programs[programIx].shaders);
+        free (watcher->programs[programIx].attribs);
+    }
+
+    free (watcher->programs);
+    free (watcher->files);
+    free (watcher->batchPrograms);
+    free (watcher);
+}
+
+
+// Start watching a file, unless it's watched already.
+//
+static void watchFile (ShaderWatcher *watcher, const ShaderInfo info) {
+    for (unsigned int fileIx = 0; fileIx < watcher->numFiles; fileIx++)
+        if (watcher->files[fileIx].file == info.file)
+            return;
+
+    Text filename = nameText (info.file);
+    const char *slash = strrchr (filename.array, '/');
+
+    TextBuilder directory = newTextBuilder (filename.length);
+    if (!slash)
+        appendStringToBuilder (&directory, ".");
+    else if (slash == filename.array)
+        appendStringToBuilder (&directory, "/");
+    else
+        appendToBuilder (&directory, (Text) {filename.array, slash - filename.array});
+
+    int wd = inotify_add_watch (watcher->inotify, directory.array, WATCH_EVENTS);
+    if (wd < 0) {
+        effectno = IOError;
+        printf ("error: watchFile: failed to watch %s\n", directory.array);
+    }
+
+    freeTextBuilder (directory);
+
+    const char *base = slash ? slash + 1 : filename.array;
+
+    pthread_mutex_lock (&watcher->lock);
+
+    if (watcher->numFiles == watcher->maxFiles) {
+        watcher->maxFiles = watcher->maxFiles ? watcher->maxFiles * 2 : 16;
+        watcher->files = (WatchedFile *) realloc
+            (watcher->files, watcher->maxFiles * sizeof (WatchedFile));
+    }
+
+    watcher->files[watcher->numFiles++] = (WatchedFile) {
+        .file   = info.file,
+        .base   = { base, filename.length - (base - filename.array) },
+        .wd     = wd,
+        .dirty  = 0,
+        .reload = 0
+    };
+
+    pthread_mutex_unlock (&watcher->lock);
+}
+
+// Start watching a program, built from the given shaders with its
+// attributes bound as given, and return its index in the watcher.
+//
+unsigned int watchShaderProgram
+    ( ShaderWatcher *watcher, const GLuint program
+    , unsigned int numShaders, const ShaderInfo infos[]
+    , unsigned int numAttribs, const AttribBinding bindings[] )
+{
+    if (watcher->numPrograms == watcher->maxPrograms) {
+        watcher->maxPrograms = watcher->maxPrograms ? watcher->maxPrograms * 2 : 16;
+        watcher->programs = (WatchedProgram *) realloc
+            (watcher->programs, watcher->maxPrograms * sizeof (WatchedProgram));
+    }
+
+    ShaderInfo *shaders = (ShaderInfo *) malloc (numShaders * sizeof (ShaderInfo));
+    memcpy (shaders, infos, numShaders * sizeof (ShaderInfo));
+
+    AttribBinding *attribs = (AttribBinding *) malloc (numAttribs * sizeof (AttribBinding));
+    if (numAttribs)
+        memcpy (attribs, bindings, numAttribs * sizeof (AttribBinding));
+
+    watcher->programs[watcher->numPrograms] = (WatchedProgram) {
+        .program    = program,
+        .generation = 0,
+        .log        = {0, 0},
+        .shaders    = shaders,
+        .numShaders = numShaders,
+        .attribs    = attribs,
+        .numAttribs = numAttribs
+    };
+
+    for (unsigned int shaderIx = 0; shaderIx < numShaders; shaderIx++)
+        watchFile (watcher, infos[shaderIx]);
+
+    return watcher->numPrograms++;
+}
+
+// The program to draw with, for a program being watched.
+//
+GLuint watchedProgram (const ShaderWatcher *watcher, unsigned int programIx) {
+    return watcher->programs[programIx].program;
+}
+
+
+// Whether a program uses any file that's to be reloaded.
+//
+static int needsReload (const ShaderWatcher *watcher, const WatchedProgram *program) {
+    for (unsigned int shaderIx = 0; shaderIx < program->numShaders; shaderIx++)
+        for (unsigned int fileIx = 0; fileIx < watcher->numFiles; fileIx++)
+            if (watcher->files[fileIx].reload
+                && watcher->files[fileIx].file == program->shaders[shaderIx].file)
+                return 1;
+
+    return 0;
+}
+
+// Submit a batch recompiling every program using a changed file.
+//
+static void startReload (ShaderWatcher *watcher) {
+    pthread_mutex_lock (&watcher->lock);
+
+    __atomic_store_n (&watcher->changed, 0, __ATOMIC_RELAXED);
+    for (unsigned int fileIx = 0; fileIx < watcher->numFiles; fileIx++) {
+        watcher->files[fileIx].reload = watcher->files[fileIx].dirty;
+        watcher->files[fileIx].dirty = 0;
+    }
+
+    pthread_mutex_unlock (&watcher->lock);
+
+    ProgramInfo *infos = (ProgramInfo *) malloc (watcher->numPrograms * sizeof (ProgramInfo));
+    unsigned int numReloads = 0;
+
+    watcher->batchPrograms = (unsigned int *) realloc
+        (watcher->batchPrograms, watcher->numPrograms * sizeof (unsigned int));
+
+    for (unsigned int programIx = 0; programIx < watcher->numPrograms; programIx++) {
+        const WatchedProgram *program = &watcher->programs[programIx];
+        if (!needsReload (watcher, program))
+            continue;
+
+        infos[numReloads] = (ProgramInfo) {
+            program->numShaders, program->shaders, program->numAttribs, program->attribs
+        };
+        watcher->batchPrograms[numReloads++] = programIx;
+    }
+
+    if (numReloads)
+        watcher->batch = submitShaderBatch (numReloads, infos);
+
+    free (infos);
+}
+
+// Put the programs of a finished batch in place of the old ones, or keep
+// their errors. Returns how many were put in place.
+//
+static unsigned int finishReload (ShaderWatcher *watcher) {
+    ShaderBatch *batch = watcher->batch;
+    unsigned int numSwapped = 0;
+
+    for (unsigned int batchIx = 0; batchIx < batch->numPrograms; batchIx++) {
+        BatchProgram *reloaded = &batch->programs[batchIx];
+        WatchedProgram *program = &watcher->programs[watcher->batchPrograms[batchIx]];
+
+        freeText (program->log);
+
+        if (reloaded->status == ProgramReady) {
+            glDeleteProgram (program->program);
+            program->program = reloaded->program;
+            program->generation++;
+            program->log = (Text) {0, 0};
+            numSwapped++;
+        }
+        else {
+            program->log = reloaded->log;
+            reloaded->log = (Text) {0, 0};
+        }
+    }
+
+    freeShaderBatch (batch);
+    watcher->batch = NULL;
+
+    return numSwapped;
+}
+
+// Move reloading along, between frames. Returns the number of programs
+// that have just been replaced.
+//
+unsigned int updateShaderWatcher (ShaderWatcher *watcher) {
+    if (watcher->batch) {
+        if (updateShaderBatch (watcher->batch))
+            return 0;
+
+        return finishReload (watcher);
+    }
+
+    if (__atomic_load_n (&watcher->changed, __ATOMIC_ACQUIRE))
+        startReload (watcher);
+
+    return 0;
+}
@@ -0,0 +1,101 @@
+
+#ifndef SHARBIGAJAR_BACKEND_SHADER_WATCHER_H
+#define SHARBIGAJAR_BACKEND_SHADER_WATCHER_H
+
+#include <pthread.h>
+
+#include <GL/glew.h>
+
+#include "Name.h"
+#include "Text.h"
+#include "Backend/Shaders.h"
+#include "Backend/ShaderBatch.h"
+
+
+
+// A shader program being watched. 'program' is the one to draw with,
+// and changes whenever it's reloaded, which bumps 'generation'. 'log'
+// has the errors from the last reload that failed, if it hasn't been
+// reloaded since. Each reload binds 'attribs' again, so attributes stay
+// where they were.
+//
+typedef struct WatchedProgram WatchedProgram;
+
+struct WatchedProgram {
+    GLuint program;
+    unsigned int generation;
+    Text log;
+
+    ShaderInfo *shaders;
+    unsigned int numShaders;
+
+    AttribBinding *attribs;
+    unsigned int numAttribs;
+};
+
+// A shader file being watched, by watching its directory, since editors
+// often save by writing a new file and renaming it over the old one.
+// 'dirty' is set by the watching thread, and 'reload' is the GL thread's
+// copy of it.
+//
+typedef struct WatchedFile WatchedFile;
+
+struct WatchedFile {
+    Name file;
+    Text base;
+    // ^ The file's name within its directory.
+    int wd;
+
+    int dirty;
+    int reload;
+};
+
+
+// Reloads shader programs when their files change.
+//
+// A thread waits on inotify for files to be written, and flags them.
+// 'updateShaderWatcher', once a frame, recompiles every program using a
+// flagged file in a 'ShaderBatch', without holding up frames. Once the
+// batch is done, each program that compiled takes the place of the old
+// one, between frames; one that didn't leaves the old one in use, and
+// keeps the errors. Until then, and while nothing changes, an update is
+// a single check of a flag.
+//
+// A watcher owns the programs it's given, and deletes old ones when new
+// ones take their place.
+//
+typedef struct ShaderWatcher ShaderWatcher;
+
+struct ShaderWatcher {
+    WatchedProgram *programs;
+    unsigned int numPrograms;
+    unsigned int maxPrograms;
+
+    WatchedFile *files;
+    unsigned int numFiles;
+    unsigned int maxFiles;
+
+    ShaderBatch *batch;
+    unsigned int *batchPrograms;
+    // ^ Which program each one in 'batch' is.
+
+    int inotify;
+    int quit;
+    pthread_t watcher;
+    pthread_mutex_t lock;
+    // ^ Guards the files' 'dirty' flags, and 'files' itself from the
+    //   watching thread.
+    int changed;
+};
+
+ShaderWatcher *newShaderWatcher (void);
+void freeShaderWatcher (ShaderWatcher *);
+
+unsigned int watchShaderProgram
+    ( ShaderWatcher *, const GLuint
+    , unsigned int, const ShaderInfo [], unsigned int, const AttribBinding [] );
+GLuint watchedProgram (const ShaderWatcher *, unsigned int);
+
+unsigned int updateShaderWatcher (ShaderWatcher *);
+
+#endif
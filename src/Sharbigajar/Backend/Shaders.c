@@ -7,7 +7,9 @@
 
 #include <GL/glew.h>
 
+#include "Allocator.h"
 #include "Effectno.h"
+#include "Name.h"
 #include "Text.h"
 #include "Backend/Shaders.h"
 
@@ -15,34 +17,31 @@
 
 // type ShaderInfo
 
-// Create a new shader info by wrapping strings in text objects.
+// Create a new shader info by wrapping strings in text objects. The
+// filename is interned, and 'filename' is the interned copy.
 //
 ShaderInfo newShaderInfo
     (GLenum shaderType, const char filename[], const char description[])
 {
+    Name file = internString (filename);
+
     return (ShaderInfo) {
-        .filename       = textFromString (filename),
+        .filename       = nameText (file),
+        .file           = file,
         .shaderType     = shaderType,
         .description    = textFromString (description)
     };
 }
 
 
-// Load a GL shader from a file and compile it.
+// Hand a GL shader's source text to the driver to compile, without
+// waiting to see how that goes.
 //
-static const GLuint loadGLShader (const ShaderInfo info)
-{
-    Text shaderSrc = textFromFile (info.filename);
-    if (effectno == IOError) {
-        printf
-            ( "error: loadGLShader: failed to open %s\n", info.filename.array );
-        return 0;
-    }
-
+const GLuint startShaderCompile (const ShaderInfo info, Text shaderSrc) {
     GLuint shaderHandle = glCreateShader (info.shaderType);
     if (shaderHandle == 0) {
         effectno = ShaderCreateError;
-        printf ("error: loadGLShader: failed to create shader\n");
+        printf ("error: startShaderCompile: failed to create shader\n");
         return 0;
     }
 
@@ -59,30 +58,115 @@ static const GLuint loadGLShader (const ShaderInfo info)
     glShaderSource (shaderHandle, 1, shaderSourceStrings, shaderSourceLengths);
     glCompileShader (shaderHandle);
 
-    // Report any shader compilation errors.
+    return shaderHandle;
+}
+
+// Compile a GL shader from source text already in memory. Any error log
+// is only needed for the duration, so it comes from 'allocator'.
+//
+const GLuint compileShaderText
+    (Allocator allocator, const ShaderInfo info, Text shaderSrc)
+{
+    GLuint shaderHandle = startShaderCompile (info, shaderSrc);
+
+    if (shaderHandle && !checkShaderCompiled (allocator, info, shaderHandle))
+        glDeleteShader (shaderHandle);
+
+    return shaderHandle;
+}
+
+// Check that a shader compiled, or set 'effectno' and report the errors
+// GL gave. This waits for the compile to finish, if it hasn't already.
+//
+int checkShaderCompiled
+    (Allocator allocator, const ShaderInfo info, const GLuint shaderHandle)
+{
     int success;
     glGetShaderiv (shaderHandle, GL_COMPILE_STATUS, &success);
     if (!success) {
         effectno = ShaderCompileError;
 
         printf
-            ( "error: loadGLShader: shader compilation error\n"
+            ( "error: checkShaderCompiled: shader compilation error\n"
               "       in shader file: %s\n"
               "       GL reported:\n", info.filename.array );
 
-        GLint logLen = 0;
-        glGetShaderiv (shaderHandle, GL_INFO_LOG_LENGTH, &logLen);
+        TextBuilder log = newTextBuilderWith (allocator, 0);
+        appendShaderLog (&log, shaderHandle);
+        printf ("%s\n", log.array);
+
+        freeTextBuilder (log);
+    }
+
+    return success;
+}
 
-        GLchar *log = (GLchar *) malloc (logLen);
-        glGetShaderInfoLog (shaderHandle, logLen, &logLen, log);
-        printf ("%s\n", log);
+// Check that a program linked, or set 'effectno' and report the errors
+// GL gave. This waits for the link to finish, if it hasn't already.
+//
+int checkProgramLinked (Allocator allocator, const GLuint program) {
+    int success;
+    glGetProgramiv (program, GL_LINK_STATUS, &success);
+    if (!success) {
+        effectno = ShaderLinkError;
 
-        free (log);
+        printf
+            ( "error: checkProgramLinked: shader program link error\n"
+              "       GL reported:\n" );
 
-        glDeleteShader (shaderHandle);
+        TextBuilder log = newTextBuilderWith (allocator, 0);
+        appendProgramLog (&log, program);
+        printf ("%s\n", log.array);
+
+        freeTextBuilder (log);
+    }
+
+    return success;
+}
+
+// Append the info log GL keeps for a shader to a text builder.
+//
+void appendShaderLog (TextBuilder *builder, const GLuint shaderHandle) {
+    GLint logLen = 0;
+    glGetShaderiv (shaderHandle, GL_INFO_LOG_LENGTH, &logLen);
+    if (logLen <= 0)
+        return;
+
+    if (!reserveBuilder (builder, logLen))
+        return;
+    glGetShaderInfoLog (shaderHandle, logLen + 1, &logLen, builder->array + builder->length);
+    builder->length += logLen;
+}
+
+// Append the info log GL keeps for a program to a text builder.
+//
+void appendProgramLog (TextBuilder *builder, const GLuint program) {
+    GLint logLen = 0;
+    glGetProgramiv (program, GL_INFO_LOG_LENGTH, &logLen);
+    if (logLen <= 0)
+        return;
+
+    if (!reserveBuilder (builder, logLen))
+        return;
+    glGetProgramInfoLog (program, logLen + 1, &logLen, builder->array + builder->length);
+    builder->length += logLen;
+}
+
+// Load a GL shader from a file and compile it. The source is only needed
+// for the duration, so it comes from 'allocator'.
+//
+static const GLuint loadGLShader (Allocator allocator, const ShaderInfo info)
+{
+    Text shaderSrc = textFromFileWith (allocator, info.filename);
+    if (!shaderSrc.array) {
+        printf
+            ( "error: loadGLShader: failed to open %s\n", info.filename.array );
+        return 0;
     }
 
-    freeText (shaderSrc);
+    GLuint shaderHandle = compileShaderText (allocator, info, shaderSrc);
+
+    freeTextWith (allocator, shaderSrc);
 
     return shaderHandle;
 }
@@ -93,23 +177,54 @@ static const GLuint loadGLShader (const ShaderInfo info)
 const GLuint compileShaderProgram
     (unsigned int numShaders, const ShaderInfo infos[])
 {
-    GLuint program = glCreateProgram ();
-    GLuint *shaders = (GLuint *) malloc (numShaders * sizeof (GLuint));
+    return compileShaderProgramWith (heapAllocator, numShaders, infos);
+}
+
+// Load and compile a list of shaders, and link them into a GL program
+// made already, with any attribute bindings it needs.
+//
+static const GLuint buildShaderProgram
+    ( Allocator allocator, const GLuint program
+    , unsigned int numShaders, const ShaderInfo infos[] )
+{
+    GLuint *shaders = (GLuint *) allocMemory (allocator, numShaders * sizeof (GLuint));
 
     for (unsigned int shaderIx = 0; shaderIx < numShaders; shaderIx++) {
-        const GLuint shader = loadGLShader (infos[shaderIx]);
+        shaders[shaderIx] = loadGLShader (allocator, infos[shaderIx]);
         // ^ TODO: Handle side-effects
-        glAttachShader (program, shader);
-        shaders[shaderIx] = shader;
     }
 
+    linkShaderProgram (program, numShaders, shaders);
+
+    freeMemory (allocator, shaders, numShaders * sizeof (GLuint));
+
+    return program;
+}
+
+// Compile a list of shaders into a GL program, taking the temporary
+// memory that needs from 'allocator'. With an arena, that's all freed
+// again by the time this returns.
+//
+const GLuint compileShaderProgramWith
+    (Allocator allocator, unsigned int numShaders, const ShaderInfo infos[])
+{
+    return buildShaderProgram (allocator, glCreateProgram (), numShaders, infos);
+}
+
+// Link compiled shaders into a GL program, leaving them detached again
+// afterwards.
+//
+const GLuint linkShaderProgram
+    (const GLuint program, unsigned int numShaders, const GLuint shaders[])
+{
+    for (unsigned int shaderIx = 0; shaderIx < numShaders; shaderIx++)
+        glAttachShader (program, shaders[shaderIx]);
+
     glLinkProgram (program);
 
     for (unsigned int shaderIx = 0; shaderIx < numShaders; shaderIx++)
         glDetachShader (program, shaders[shaderIx]);
 
-    free (shaders);
-
     glValidateProgram (program);
     return program;
 }
@@ -117,22 +232,90 @@ const GLuint compileShaderProgram
 
 // type AttribBinding
 
-// Create attribute bindings within a GL program.
+// Bind attributes to locations in a GL program. Bindings only count when
+// a program is linked, so this is for programs that haven't been yet;
+// binding in one that has sets 'effectno', and does nothing until it's
+// linked again.
 //
 const GLuint bindAttribs
     ( unsigned int numAttribs
     , const AttribBinding bindings[]
     , const GLuint program )
 {
-    glUseProgram (program);
+    GLint linked = GL_FALSE;
+    glGetProgramiv (program, GL_LINK_STATUS, &linked);
+    if (linked) {
+        effectno = StandardError;
+        printf
+            ( "error: bindAttribs: program %u is already linked, so its\n"
+              "       bindings won't change until it's linked again\n", program );
+    }
 
     for (unsigned int attrIx = 0; attrIx < numAttribs; attrIx++)
         glBindAttribLocation
-            (program, bindings[attrIx].bindPoint, bindings[attrIx].name);
-
-    glUseProgram (0);
+            ( program, bindings[attrIx].bindPoint
+            , nameText (bindings[attrIx].name).array );
 
     return program;
 }
 
+// Compile a list of shaders into a GL program, with its attributes bound
+// to the given locations before it's linked.
+//
+const GLuint compileBoundShaderProgram
+    ( unsigned int numShaders, const ShaderInfo infos[]
+    , unsigned int numAttribs, const AttribBinding bindings[] )
+{
+    GLuint program = bindAttribs (numAttribs, bindings, glCreateProgram ());
+    return buildShaderProgram (heapAllocator, program, numShaders, infos);
+}
+
+
+// type ProgramUniforms
+
+// A location that hasn't been looked up yet. GL itself only uses -1, for
+// uniforms the program doesn't have.
+//
+#define UNKNOWN_LOCATION (-2)
+
+ProgramUniforms newProgramUniforms (GLuint program) {
+    return (ProgramUniforms) {
+        .program        = program,
+        .locations      = NULL,
+        .numLocations   = 0
+    };
+}
+
+void freeProgramUniforms (ProgramUniforms uniforms) {
+    free (uniforms.locations);
+}
+
+// Move on to another program, such as a reloaded one, forgetting every
+// location looked up so far.
+//
+void resetProgramUniforms (ProgramUniforms *uniforms, GLuint program) {
+    uniforms->program = program;
+
+    for (unsigned int nameIx = 0; nameIx < uniforms->numLocations; nameIx++)
+        uniforms->locations[nameIx] = UNKNOWN_LOCATION;
+}
 
+// Get the location of a uniform, or -1 if the program doesn't have it.
+//
+GLint uniformLocation (ProgramUniforms *uniforms, Name name) {
+    if (name >= uniforms->numLocations) {
+        unsigned int numLocations = countNames () + 1;
+
+        uniforms->locations = (GLint *) realloc
+            (uniforms->locations, numLocations * sizeof (GLint));
+        for (unsigned int nameIx = uniforms->numLocations; nameIx < numLocations; nameIx++)
+            uniforms->locations[nameIx] = UNKNOWN_LOCATION;
+        uniforms->numLocations = numLocations;
+    }
+
+    if (uniforms->locations[name] == UNKNOWN_LOCATION)
+        uniforms->locations[name] = glGetUniformLocation
+            (uniforms->program, nameText (name).array);
+
+    return uniforms->locations[name];
+}
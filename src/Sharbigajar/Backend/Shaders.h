@@ -4,6 +4,8 @@
 
 #include <GL/glew.h>
 
+#include "Name.h"
+
 
 
 // General shader information.
@@ -12,6 +14,8 @@ typedef struct ShaderInfo ShaderInfo;
 
 struct ShaderInfo {
     Text filename;
+    Name file;
+    // ^ The filename, interned.
     GLenum shaderType;
 
     Text description;
@@ -21,6 +25,17 @@ ShaderInfo newShaderInfo (GLenum, const char [], const char []);
 
 
 const GLuint compileShaderProgram (unsigned int, const ShaderInfo []);
+const GLuint compileShaderProgramWith (Allocator, unsigned int, const ShaderInfo []);
+
+const GLuint startShaderCompile (const ShaderInfo, Text);
+const GLuint compileShaderText (Allocator, const ShaderInfo, Text);
+const GLuint linkShaderProgram (const GLuint, unsigned int, const GLuint []);
+
+int checkShaderCompiled (Allocator, const ShaderInfo, const GLuint);
+int checkProgramLinked (Allocator, const GLuint);
+
+void appendShaderLog (TextBuilder *, const GLuint);
+void appendProgramLog (TextBuilder *, const GLuint);
 
 
 // Shader program attribute bindings information.
@@ -28,10 +43,34 @@ const GLuint compileShaderProgram (unsigned int, const ShaderInfo []);
 typedef struct AttribBinding AttribBinding;
 
 struct AttribBinding {
-    const char *name;
+    Name name;
     const GLuint bindPoint;
 };
 
 const GLuint bindAttribs (unsigned int, const AttribBinding [], const GLuint);
+const GLuint compileBoundShaderProgram
+    (unsigned int, const ShaderInfo [], unsigned int, const AttribBinding []);
+
+
+// Uniform locations in a shader program, looked up by name.
+//
+// Each location is asked of GL the first time it's needed and then kept,
+// in an array indexed by name, so after that finding one is a single
+// array read, with no strings involved.
+//
+typedef struct ProgramUniforms ProgramUniforms;
+
+struct ProgramUniforms {
+    GLuint program;
+
+    GLint *locations;
+    unsigned int numLocations;
+};
+
+ProgramUniforms newProgramUniforms (GLuint);
+void freeProgramUniforms (ProgramUniforms);
+void resetProgramUniforms (ProgramUniforms *, GLuint);
+
+GLint uniformLocation (ProgramUniforms *, Name);
 
 #endif
@@ -0,0 +1,342 @@
+
+// Sharbigajar.Backend.Uniforms
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <GL/glew.h>
+
+#include "Effectno.h"
+#include "Name.h"
+#include "Backend/Reflection.h"
+#include "Backend/Uniforms.h"
+
+
+
+// type UniformType
+
+static const UniformType uniformTypes[] = {
+    { GL_FLOAT,             1, 1, 'f' },
+    { GL_FLOAT_VEC2,        1, 2, 'f' },
+    { GL_FLOAT_VEC3,        1, 3, 'f' },
+    { GL_FLOAT_VEC4,        1, 4, 'f' },
+    { GL_INT,               1, 1, 'i' },
+    { GL_INT_VEC2,          1, 2, 'i' },
+    { GL_INT_VEC3,          1, 3, 'i' },
+    { GL_INT_VEC4,          1, 4, 'i' },
+    { GL_UNSIGNED_INT,      1, 1, 'u' },
+    { GL_UNSIGNED_INT_VEC2, 1, 2, 'u' },
+    { GL_UNSIGNED_INT_VEC3, 1, 3, 'u' },
+    { GL_UNSIGNED_INT_VEC4, 1, 4, 'u' },
+    { GL_BOOL,              1, 1, 'i' },
+    { GL_BOOL_VEC2,         1, 2, 'i' },
+    { GL_BOOL_VEC3,         1, 3, 'i' },
+    { GL_BOOL_VEC4,         1, 4, 'i' },
+
+    { GL_FLOAT_MAT2,        2, 2, 'f' },
+    { GL_FLOAT_MAT3,        3, 3, 'f' },
+    { GL_FLOAT_MAT4,        4, 4, 'f' },
+    { GL_FLOAT_MAT2x3,      2, 3, 'f' },
+    { GL_FLOAT_MAT2x4,      2, 4, 'f' },
+    { GL_FLOAT_MAT3x2,      3, 2, 'f' },
+    { GL_FLOAT_MAT3x4,      3, 4, 'f' },
+    { GL_FLOAT_MAT4x2,      4, 2, 'f' },
+    { GL_FLOAT_MAT4x3,      4, 3, 'f' },
+
+    { GL_SAMPLER_1D,                1, 1, 'i' },
+    { GL_SAMPLER_2D,                1, 1, 'i' },
+    { GL_SAMPLER_3D,                1, 1, 'i' },
+    { GL_SAMPLER_CUBE,              1, 1, 'i' },
+    { GL_SAMPLER_1D_SHADOW,         1, 1, 'i' },
+    { GL_SAMPLER_2D_SHADOW,         1, 1, 'i' },
+    { GL_SAMPLER_2D_ARRAY,          1, 1, 'i' },
+    { GL_SAMPLER_2D_ARRAY_SHADOW,   1, 1, 'i' },
+    { GL_SAMPLER_CUBE_SHADOW,       1, 1, 'i' },
+    { GL_SAMPLER_2D_RECT,           1, 1, 'i' },
+    { GL_SAMPLER_BUFFER,            1, 1, 'i' },
+    { GL_SAMPLER_2D_MULTISAMPLE,    1, 1, 'i' },
+    { GL_INT_SAMPLER_2D,            1, 1, 'i' },
+    { GL_UNSIGNED_INT_SAMPLER_2D,   1, 1, 'i' }
+};
+
+// Get the shape of a uniform type, or NULL for types uniforms can't be
+// set as, like images, or that aren't listed.
+//
+const UniformType *uniformType (GLenum type) {
+    for (unsigned int typeIx = 0; typeIx < sizeof (uniformTypes) / sizeof (uniformTypes[0]); typeIx++)
+        if (uniformTypes[typeIx].type == type)
+            return &uniformTypes[typeIx];
+
+    return NULL;
+}
+
+
+// type UniformStore
+
+// A name with no slot in a store.
+//
+#define NO_SLOT ((unsigned int) -1)
+
+// Make a store for the default block's uniforms of a program, with
+// nothing set yet.
+//
+UniformStore newUniformStore (const ProgramReflection *reflection) {
+    unsigned int numSlots = 0, size = 0;
+
+    for (unsigned int uniformIx = 0; uniformIx < reflection->numUniforms; uniformIx++) {
+        const ProgramUniform *uniform = &reflection->uniforms[uniformIx];
+        numSlots += uniform->location >= 0 && uniformType (uniform->type);
+    }
+
+    UniformStore store = {
+        .program    = reflection->program,
+        .slots      = (UniformSlot *) malloc (numSlots * sizeof (UniformSlot)),
+        .numSlots   = numSlots,
+        .slotIxs    = NULL,
+        .numNames   = countNames () + 1,
+        .values     = NULL,
+        .known      = (uint64_t *) calloc ((numSlots + 63) / 64, sizeof (uint64_t)),
+        .dirty      = (uint64_t *) calloc ((numSlots + 63) / 64, sizeof (uint64_t))
+    };
+
+    store.slotIxs = (unsigned int *) malloc (store.numNames * sizeof (unsigned int));
+    for (Name name = 0; name < store.numNames; name++)
+        store.slotIxs[name] = NO_SLOT;
+
+    for (unsigned int uniformIx = 0, slotIx = 0; uniformIx < reflection->numUniforms; uniformIx++) {
+        const ProgramUniform *uniform = &reflection->uniforms[uniformIx];
+        const UniformType *type = uniformType (uniform->type);
+        if (uniform->location < 0 || !type)
+            continue;
+
+        unsigned int length = uniform->size * type->columns * type->rows * 4;
+
+        store.slots[slotIx] = (UniformSlot) {
+            .name       = uniform->name,
+            .type       = type,
+            .location   = uniform->location,
+            .count      = uniform->size,
+            .offset     = size,
+            .length     = length
+        };
+
+        store.slotIxs[uniform->name] = slotIx++;
+        size += length;
+    }
+
+    store.values = (unsigned char *) calloc (size ? size : 1, 1);
+
+    return store;
+}
+
+void freeUniformStore (UniformStore store) {
+    free (store.slots);
+    free (store.slotIxs);
+    free (store.values);
+    free (store.known);
+    free (store.dirty);
+}
+
+// Set a uniform's value: the whole of it, packed, in floats, ints or
+// unsigned ints, as its type is. Returns 0 if the program doesn't have
+// it, which like in GL is otherwise fine.
+//
+int setUniform (UniformStore *store, Name name, const void *values) {
+    if (name >= store->numNames || store->slotIxs[name] == NO_SLOT)
+        return 0;
+
+    unsigned int slotIx = store->slotIxs[name];
+    const UniformSlot *slot = &store->slots[slotIx];
+    uint64_t bit = (uint64_t) 1 << (slotIx % 64);
+
+    unsigned char *value = store->values + slot->offset;
+    if ((store->known[slotIx / 64] & bit) && memcmp (value, values, slot->length) == 0)
+        return 1;
+
+    memcpy (value, values, slot->length);
+    store->known[slotIx / 64] |= bit;
+    store->dirty[slotIx / 64] |= bit;
+
+    return 1;
+}
+
+static void uploadSlot (const UniformSlot *slot, const void *value) {
+    const GLint location = slot->location, count = slot->count;
+    const UniformType *type = slot->type;
+
+    if (type->columns > 1) {
+        switch (type->type) {
+            case GL_FLOAT_MAT2:     glUniformMatrix2fv   (location, count, GL_FALSE, value); break;
+            case GL_FLOAT_MAT3:     glUniformMatrix3fv   (location, count, GL_FALSE, value); break;
+            case GL_FLOAT_MAT4:     glUniformMatrix4fv   (location, count, GL_FALSE, value); break;
+            case GL_FLOAT_MAT2x3:   glUniformMatrix2x3fv (location, count, GL_FALSE, value); break;
+            case GL_FLOAT_MAT2x4:   glUniformMatrix2x4fv (location, count, GL_FALSE, value); break;
+            case GL_FLOAT_MAT3x2:   glUniformMatrix3x2fv (location, count, GL_FALSE, value); break;
+            case GL_FLOAT_MAT3x4:   glUniformMatrix3x4fv (location, count, GL_FALSE, value); break;
+            case GL_FLOAT_MAT4x2:   glUniformMatrix4x2fv (location, count, GL_FALSE, value); break;
+            case GL_FLOAT_MAT4x3:   glUniformMatrix4x3fv (location, count, GL_FALSE, value); break;
+        }
+    }
+    else if (type->kind == 'f') {
+        switch (type->rows) {
+            case 1: glUniform1fv (location, count, value); break;
+            case 2: glUniform2fv (location, count, value); break;
+            case 3: glUniform3fv (location, count, value); break;
+            case 4: glUniform4fv (location, count, value); break;
+        }
+    }
+    else if (type->kind == 'i') {
+        switch (type->rows) {
+            case 1: glUniform1iv (location, count, value); break;
+            case 2: glUniform2iv (location, count, value); break;
+            case 3: glUniform3iv (location, count, value); break;
+            case 4: glUniform4iv (location, count, value); break;
+        }
+    }
+    else {
+        switch (type->rows) {
+            case 1: glUniform1uiv (location, count, value); break;
+            case 2: glUniform2uiv (location, count, value); break;
+            case 3: glUniform3uiv (location, count, value); break;
+            case 4: glUniform4uiv (location, count, value); break;
+        }
+    }
+}
+
+// Upload every uniform that's changed since the last upload, to the
+// program, which has to be in use. Returns how many that was.
+//
+unsigned int uploadUniforms (UniformStore *store) {
+    unsigned int numUploads = 0;
+
+    for (unsigned int wordIx = 0; wordIx < (store->numSlots + 63) / 64; wordIx++) {
+        for (uint64_t dirty = store->dirty[wordIx]; dirty; dirty &= dirty - 1) {
+            const UniformSlot *slot = &store->slots[wordIx * 64 + __builtin_ctzll (dirty)];
+            uploadSlot (slot, store->values + slot->offset);
+            numUploads++;
+        }
+
+        store->dirty[wordIx] = 0;
+    }
+
+    return numUploads;
+}
+
+
+// type UniformBuffer
+
+// Make a buffer for one of a program's uniform blocks, and bind it and
+// the block to 'binding'. Sets 'effectno', and gives a buffer of 0, if
+// the program has no such block.
+//
+UniformBuffer newUniformBuffer
+    (const ProgramReflection *reflection, Name blockName, GLuint binding)
+{
+    UniformBuffer buffer = {0};
+
+    const ProgramBlock *block = findBlock (reflection, blockName);
+    if (!block) {
+        effectno = StandardError;
+        printf
+            ( "error: newUniformBuffer: program %u has no uniform block %s\n"
+            , reflection->program, nameText (blockName).array );
+        return buffer;
+    }
+
+    for (unsigned int uniformIx = 0; uniformIx < reflection->numUniforms; uniformIx++)
+        buffer.numMembers += reflection->uniforms[uniformIx].block == (GLint) block->index;
+
+    buffer.members = (ProgramUniform *) malloc (buffer.numMembers * sizeof (ProgramUniform));
+    for (unsigned int uniformIx = 0, memberIx = 0; uniformIx < reflection->numUniforms; uniformIx++)
+        if (reflection->uniforms[uniformIx].block == (GLint) block->index)
+            buffer.members[memberIx++] = reflection->uniforms[uniformIx];
+
+    buffer.binding = binding;
+    buffer.block = blockName;
+    buffer.size = block->size;
+    buffer.data = (unsigned char *) calloc (block->size, 1);
+    buffer.dirty = 1;
+
+    glGenBuffers (1, &buffer.buffer);
+    glBindBuffer (GL_UNIFORM_BUFFER, buffer.buffer);
+    glBufferData (GL_UNIFORM_BUFFER, buffer.size, NULL, GL_STREAM_DRAW);
+    glBindBuffer (GL_UNIFORM_BUFFER, 0);
+
+    glBindBufferBase (GL_UNIFORM_BUFFER, binding, buffer.buffer);
+    glUniformBlockBinding (reflection->program, block->index, binding);
+
+    return buffer;
+}
+
+void freeUniformBuffer (UniformBuffer buffer) {
+    if (buffer.buffer)
+        glDeleteBuffers (1, &buffer.buffer);
+
+    free (buffer.members);
+    free (buffer.data);
+}
+
+// Set a member of the block, by the name GL gives it, from its whole
+// value packed like 'setUniform' takes it. Spreads it out by the block's
+// strides, and marks the buffer dirty if anything changed. Returns 0 if
+// the block has no such member.
+//
+int setBufferUniform (UniformBuffer *buffer, Name name, const void *values) {
+    const ProgramUniform *member = NULL;
+    for (unsigned int memberIx = 0; memberIx < buffer->numMembers && !member; memberIx++)
+        if (buffer->members[memberIx].name == name)
+            member = &buffer->members[memberIx];
+
+    const UniformType *type = member ? uniformType (member->type) : NULL;
+    if (!type)
+        return 0;
+
+    const unsigned char *from = (const unsigned char *) values;
+    const unsigned int columnLength = type->rows * 4;
+
+    for (GLint elementIx = 0; elementIx < member->size; elementIx++) {
+        for (unsigned int columnIx = 0; columnIx < type->columns; columnIx++) {
+            unsigned char *to = buffer->data + member->offset
+                + elementIx * member->arrayStride + columnIx * member->matrixStride;
+
+            if (memcmp (to, from, columnLength) != 0) {
+                memcpy (to, from, columnLength);
+                buffer->dirty = 1;
+            }
+            from += columnLength;
+        }
+    }
+
+    return 1;
+}
+
+// Upload the buffer if anything in it changed, once a frame, before
+// drawing. Giving GL the whole buffer again lets the driver hand over
+// fresh memory rather than wait for draws still reading the old one.
+// Returns whether it uploaded.
+//
+int uploadUniformBuffer (UniformBuffer *buffer) {
+    if (!buffer->dirty || !buffer->buffer)
+        return 0;
+
+    glBindBuffer (GL_UNIFORM_BUFFER, buffer->buffer);
+    glBufferData (GL_UNIFORM_BUFFER, buffer->size, buffer->data, GL_STREAM_DRAW);
+    glBindBuffer (GL_UNIFORM_BUFFER, 0);
+
+    buffer->dirty = 0;
+    return 1;
+}
+
+// Have another program read a uniform block from 'binding', as with a
+// buffer made for the block in some other program. Returns 0 if the
+// program has no such block.
+//
+int bindUniformBlock (const ProgramReflection *reflection, Name blockName, GLuint binding) {
+    const ProgramBlock *block = findBlock (reflection, blockName);
+    if (!block)
+        return 0;
+
+    glUniformBlockBinding (reflection->program, block->index, binding);
+    return 1;
+}
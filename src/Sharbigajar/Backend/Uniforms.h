@@ -0,0 +1,114 @@
+
+#ifndef SHARBIGAJAR_BACKEND_UNIFORMS_H
+#define SHARBIGAJAR_BACKEND_UNIFORMS_H
+
+#include <stdint.h>
+
+#include <GL/glew.h>
+
+#include "Name.h"
+#include "Backend/Reflection.h"
+
+
+
+// The shape of a GLSL uniform type: 'columns' of 'rows' components each,
+// which are floats, ints or unsigned ints by 'kind'. Bools and samplers
+// are set as ints.
+//
+typedef struct UniformType UniformType;
+
+struct UniformType {
+    GLenum type;
+    unsigned char columns;
+    unsigned char rows;
+    char kind;
+    // ^ 'f', 'i' or 'u'.
+};
+
+const UniformType *uniformType (GLenum);
+
+
+// A uniform in a store, with 'length' bytes of value at 'offset'.
+//
+typedef struct UniformSlot UniformSlot;
+
+struct UniformSlot {
+    Name name;
+    const UniformType *type;
+    GLint location;
+    GLint count;
+
+    unsigned int offset;
+    unsigned int length;
+};
+
+// Values of a program's uniforms, kept on the CPU side, so setting one
+// to what it is already costs a comparison rather than a GL call.
+//
+// Setting a value marks its slot dirty if it changed, and uploading
+// sends only the dirty ones, then clears them. A uniform is never
+// uploaded before it's first set, so the program keeps any value its
+// source gives it until then. Uniforms in blocks aren't here; they go
+// in a 'UniformBuffer'.
+//
+// Slots are found by name with a single array read, like in
+// 'ProgramUniforms'.
+//
+typedef struct UniformStore UniformStore;
+
+struct UniformStore {
+    GLuint program;
+
+    UniformSlot *slots;
+    unsigned int numSlots;
+
+    unsigned int *slotIxs;
+    // ^ Indexed by name.
+    unsigned int numNames;
+
+    unsigned char *values;
+    uint64_t *known;
+    uint64_t *dirty;
+    // ^ Bit sets, by slot.
+};
+
+UniformStore newUniformStore (const ProgramReflection *);
+void freeUniformStore (UniformStore);
+
+int setUniform (UniformStore *, Name, const void *);
+unsigned int uploadUniforms (UniformStore *);
+
+
+// A buffer of uniforms for a uniform block, such as per-frame data that
+// every program shares, like the view and projection.
+//
+// Members are set on the CPU side, laid out as the block says, and the
+// whole buffer is uploaded at most once a frame, if anything changed.
+// Programs sharing the buffer need its block at the same 'binding',
+// which 'bindUniformBlock' sees to, and the same layout, which
+// 'layout (std140)' sees to.
+//
+typedef struct UniformBuffer UniformBuffer;
+
+struct UniformBuffer {
+    GLuint buffer;
+    GLuint binding;
+    Name block;
+
+    ProgramUniform *members;
+    unsigned int numMembers;
+
+    unsigned char *data;
+    unsigned int size;
+    int dirty;
+};
+
+UniformBuffer newUniformBuffer (const ProgramReflection *, Name, GLuint);
+void freeUniformBuffer (UniformBuffer);
+
+int setBufferUniform (UniformBuffer *, Name, const void *);
+int uploadUniformBuffer (UniformBuffer *);
+
+int bindUniformBlock (const ProgramReflection *, Name, GLuint);
+
+#endif
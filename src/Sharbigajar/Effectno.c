@@ -5,6 +5,6 @@
 
 
 
-EffectType effectno = AllOK;
+_Thread_local EffectType effectno = AllOK;
 
-int effectInfo;
+_Thread_local int effectInfo;
@@ -16,12 +16,16 @@ enum EffectType {
 // OpenGL errors
     ShaderCreateError,
     ShaderCompileError,
+    ShaderLinkError,
+    ShaderIncludeError,
 };
 
 
-extern EffectType effectno;
+// Like 'errno', each thread has its own.
+//
+extern _Thread_local EffectType effectno;
 
-extern int effectInfo;
+extern _Thread_local int effectInfo;
 
 #endif
 
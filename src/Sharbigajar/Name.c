@@ -0,0 +1,144 @@
+
+// Sharbigajar.Name
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "Allocator.h"
+#include "Name.h"
+#include "Text.h"
+
+
+
+// type Name
+
+// A name's text, and its hash, kept to skip most comparisons and to
+// rehash without reading the text again.
+//
+typedef struct NameEntry NameEntry;
+
+struct NameEntry {
+    Text text;
+    uint64_t hash;
+};
+
+// Open-addressed hash table of names, probed linearly. 'slots' holds
+// names, with 'NoName' for empty slots, and is kept at most half full.
+// 'entries' is indexed by name, and the texts live in 'arena'.
+//
+static struct {
+    NameEntry *entries;
+    unsigned int numEntries;
+    unsigned int maxEntries;
+
+    Name *slots;
+    unsigned int slotMask;
+
+    Arena arena;
+} names = {0};
+
+
+// Find the slot where a text is, or where it would go.
+//
+static Name *findSlot (Text text, uint64_t hash) {
+    unsigned int slotIx = (unsigned int) hash & names.slotMask;
+
+    while (names.slots[slotIx] != NoName) {
+        const NameEntry *entry = &names.entries[names.slots[slotIx]];
+        if (entry->hash == hash && textEquals (entry->text, text))
+            break;
+        slotIx = (slotIx + 1) & names.slotMask;
+    }
+
+    return &names.slots[slotIx];
+}
+
+static void growSlots (void) {
+    unsigned int numSlots = names.slots ? (names.slotMask + 1) * 2 : 256;
+
+    free (names.slots);
+    names.slots = (Name *) calloc (numSlots, sizeof (Name));
+    names.slotMask = numSlots - 1;
+
+    for (Name name = 1; name <= names.numEntries; name++)
+        *findSlot (names.entries[name].text, names.entries[name].hash) = name;
+}
+
+static Name addName (Text text, uint64_t hash) {
+    if (!names.entries)
+        names.arena = newArena (4096);
+
+    if (names.numEntries + 1 >= names.maxEntries) {
+        names.maxEntries = names.maxEntries ? names.maxEntries * 2 : 128;
+        names.entries = (NameEntry *) realloc
+            (names.entries, names.maxEntries * sizeof (NameEntry));
+    }
+
+    char *array = (char *) arenaAlloc (&names.arena, (text.length + 1) * sizeof (char));
+    if (text.length)
+        memcpy (array, text.array, text.length * sizeof (char));
+    array[text.length] = '\0';
+
+    Name name = ++names.numEntries;
+    names.entries[name] = (NameEntry) {
+        .text   = { .array = array, .length = text.length },
+        .hash   = hash
+    };
+
+    return name;
+}
+
+// Intern a text, copying it the first time it's seen.
+//
+Name internText (Text text) {
+    if (2 * (names.numEntries + 1) > names.slotMask)
+        growSlots ();
+
+    uint64_t hash = hashText (text);
+    Name *slot = findSlot (text, hash);
+
+    if (*slot == NoName)
+        *slot = addName (text, hash);
+
+    return *slot;
+}
+
+Name internString (const char string[]) {
+    return internText (textFromString (string));
+}
+
+// Find a text's name without interning it, or 'NoName' if it's never
+// been interned.
+//
+Name findName (Text text) {
+    if (!names.slots)
+        return NoName;
+
+    return *findSlot (text, hashText (text));
+}
+
+// Get a name's text, which is followed by a '\0', and stays put until
+// 'freeNames'.
+//
+Text nameText (Name name) {
+    if (name == NoName || name > names.numEntries)
+        return (Text) {"", 0};
+
+    return names.entries[name].text;
+}
+
+unsigned int countNames (void) {
+    return names.numEntries;
+}
+
+// Forget every name, and free the table.
+//
+void freeNames (void) {
+    if (names.entries)
+        freeArena (names.arena);
+
+    free (names.entries);
+    free (names.slots);
+
+    memset (&names, 0, sizeof (names));
+}
@@ -0,0 +1,31 @@
+
+#ifndef SHARBIGAJAR_NAME_H
+#define SHARBIGAJAR_NAME_H
+
+#include "Text.h"
+
+// Interned name, for shader files, attributes, uniforms and the like.
+//
+// Interning the same text twice gives the same name, so names are equal
+// exactly when their texts are, and comparing them is comparing two
+// integers. Names are numbered from 1 in the order they're first seen,
+// and never change or go away until 'freeNames', so they can index
+// arrays directly. 0 is 'NoName', which no text interns to.
+//
+// There's one table for the whole process, and it isn't thread-safe:
+// intern everything from one thread, or lock around it.
+//
+typedef unsigned int Name;
+
+#define NoName 0
+
+Name internText (Text);
+Name internString (const char []);
+Name findName (Text);
+
+Text nameText (Name);
+unsigned int countNames (void);
+
+void freeNames (void);
+
+#endif
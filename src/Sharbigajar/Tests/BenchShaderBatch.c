@@ -0,0 +1,129 @@
+
+// Sharbigajar.Tests.BenchShaderBatch
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <SDL2/SDL.h>
+#include <GL/glew.h>
+
+#include "Text.h"
+#include "Backend/Shaders.h"
+#include "Backend/ShaderBatch.h"
+#include "Tests/GLTest.h"
+
+
+
+// Benchmark for compiling a few dozen shader programs while a loading
+// screen keeps drawing: one after another with 'compileShaderProgram',
+// which holds up the frame for all of it, next to a 'ShaderBatch' updated
+// once a frame. For the batch, the longest update is how long a frame
+// was held up, and the rest of the time is free for other work.
+//
+// Sources are new for every round and run, as in BenchShaderCache. For
+// Mesa's llvmpipe, run with 'LIBGL_ALWAYS_SOFTWARE=1'.
+
+#define NUM_PROGRAMS 32
+#define NUM_ROUNDS 5
+
+static ShaderInfo infos[NUM_PROGRAMS][2];
+static char paths[NUM_PROGRAMS][2][256];
+
+static double compileSerially (void) {
+    GLuint programs[NUM_PROGRAMS];
+    double start = benchNow ();
+
+    for (unsigned int programIx = 0; programIx < NUM_PROGRAMS; programIx++)
+        programs[programIx] = compileShaderProgram (2, infos[programIx]);
+
+    double ns = benchNow () - start;
+
+    for (unsigned int programIx = 0; programIx < NUM_PROGRAMS; programIx++)
+        glDeleteProgram (programs[programIx]);
+
+    return ns;
+}
+
+// Compile a batch, updating it every millisecond or so as a frame would,
+// and return the time until it's done. 'longest' gets the longest update.
+//
+static double compileBatch (double *longest, unsigned int *frames) {
+    ProgramInfo programs[NUM_PROGRAMS];
+    for (unsigned int programIx = 0; programIx < NUM_PROGRAMS; programIx++)
+        programs[programIx] = (ProgramInfo) {2, infos[programIx], 0, NULL};
+
+    double start = benchNow ();
+    ShaderBatch *batch = submitShaderBatch (NUM_PROGRAMS, programs);
+    unsigned int pending = NUM_PROGRAMS;
+
+    while (pending) {
+        double frameStart = benchNow ();
+        pending = updateShaderBatch (batch);
+
+        double frame = benchNow () - frameStart;
+        if (frame > *longest)
+            *longest = frame;
+        (*frames)++;
+
+        while (pending && benchNow () - frameStart < 1e6)
+            ;
+    }
+
+    double ns = benchNow () - start;
+
+    for (unsigned int programIx = 0; programIx < NUM_PROGRAMS; programIx++) {
+        if (batch->programs[programIx].status != ProgramReady)
+            printf ("error: compileBatch: program %u failed\n", programIx);
+        glDeleteProgram (batch->programs[programIx].program);
+    }
+    freeShaderBatch (batch);
+
+    return ns;
+}
+
+int main (void) {
+    GLTestContext context = newGLTestContext ("BenchShaderBatch");
+
+    printf
+        ( "%s, %s, KHR_parallel_shader_compile: %s\n"
+        , glGetString (GL_RENDERER), glGetString (GL_VERSION)
+        , GLEW_KHR_parallel_shader_compile ? "yes" : "no" );
+
+    char directory[64];
+    snprintf (directory, sizeof (directory), "/tmp/BenchShaderBatch.%d", (int) getpid ());
+    mkdir (directory, 0755);
+    makeProgramInfos (directory, NUM_PROGRAMS, infos, paths);
+
+    double serial = 0, batched = 0, longest = 0;
+    unsigned int frames = 0;
+
+    for (unsigned int round = 0; round < NUM_ROUNDS; round++) {
+        for (unsigned int programIx = 0; programIx < NUM_PROGRAMS; programIx++)
+            writeProgram (directory, programIx, 2 * round);
+        serial += compileSerially ();
+
+        for (unsigned int programIx = 0; programIx < NUM_PROGRAMS; programIx++)
+            writeProgram (directory, programIx, 2 * round + 1);
+        batched += compileBatch (&longest, &frames);
+    }
+
+    printf
+        ( "%-24s %10.1f ms/batch %10.1f ms longest frame\n"
+          "%-24s %10.1f ms/batch %10.1f ms longest frame %8.1f frames/batch\n"
+        , "compileShaderProgram", serial / NUM_ROUNDS / 1e6, serial / NUM_ROUNDS / 1e6
+        , "ShaderBatch", batched / NUM_ROUNDS / 1e6, longest / 1e6, (double) frames / NUM_ROUNDS );
+
+    for (unsigned int programIx = 0; programIx < NUM_PROGRAMS; programIx++) {
+        unlink (paths[programIx][0]);
+        unlink (paths[programIx][1]);
+    }
+    rmdir (directory);
+
+    freeGLTestContext (context);
+
+    return 0;
+}
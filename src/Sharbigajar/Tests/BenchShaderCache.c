@@ -0,0 +1,118 @@
+
+// Sharbigajar.Tests.BenchShaderCache
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <SDL2/SDL.h>
+#include <GL/glew.h>
+
+#include "Text.h"
+#include "Backend/Shaders.h"
+#include "Backend/ShaderCache.h"
+#include "Tests/GLTest.h"
+
+
+
+// Benchmark for starting up with a few dozen shader programs: compiling
+// them all, as 'compileShaderProgram' does, next to going through a
+// 'ShaderCache' when it's empty (compile and save) and when it's warm
+// (load). Each round of each run writes new sources, so nothing's left
+// over from before, in the cache or in the driver's own shader cache.
+//
+// For Mesa's llvmpipe, run with 'LIBGL_ALWAYS_SOFTWARE=1'. Mesa's program
+// binaries come from its shader cache, so with that turned off there are
+// no binary formats, and the cache just compiles.
+
+#define NUM_PROGRAMS 32
+#define NUM_ROUNDS 5
+
+static ShaderInfo infos[NUM_PROGRAMS][2];
+static char paths[NUM_PROGRAMS][2][256];
+
+// Wait for a program to be ready, as a renderer would before drawing.
+//
+static void finishProgram (GLuint program) {
+    GLint linked;
+    glGetProgramiv (program, GL_LINK_STATUS, &linked);
+    if (!linked)
+        printf ("error: finishProgram: program %u didn't link\n", program);
+}
+
+static double startUp (ShaderCache *cache) {
+    GLuint programs[NUM_PROGRAMS];
+    double start = benchNow ();
+
+    for (unsigned int programIx = 0; programIx < NUM_PROGRAMS; programIx++) {
+        programs[programIx] = cache
+            ? compileCachedShaderProgram (cache, 2, infos[programIx])
+            : compileShaderProgram (2, infos[programIx]);
+        finishProgram (programs[programIx]);
+    }
+
+    double ns = benchNow () - start;
+
+    for (unsigned int programIx = 0; programIx < NUM_PROGRAMS; programIx++)
+        glDeleteProgram (programs[programIx]);
+
+    return ns;
+}
+
+int main (void) {
+    GLTestContext context = newGLTestContext ("BenchShaderCache");
+
+    printf ("%s, %s\n", glGetString (GL_RENDERER), glGetString (GL_VERSION));
+
+    char directory[64], cacheDirectory[80];
+    snprintf (directory, sizeof (directory), "/tmp/BenchShaderCache.%d", (int) getpid ());
+    snprintf (cacheDirectory, sizeof (cacheDirectory), "%s/cache", directory);
+    mkdir (directory, 0755);
+    makeProgramInfos (directory, NUM_PROGRAMS, infos, paths);
+
+    double uncached = 0, cold = 0, warm = 0;
+
+    for (unsigned int round = 0; round < NUM_ROUNDS; round++) {
+        for (unsigned int programIx = 0; programIx < NUM_PROGRAMS; programIx++)
+            writeProgram (directory, programIx, 2 * round);
+        uncached += startUp (NULL);
+
+        for (unsigned int programIx = 0; programIx < NUM_PROGRAMS; programIx++)
+            writeProgram (directory, programIx, 2 * round + 1);
+
+        ShaderCache cache = newShaderCache (cacheDirectory, SHADER_CACHE_DEFAULT_SIZE);
+        cold += startUp (&cache);
+        freeShaderCache (cache);
+
+        cache = newShaderCache (cacheDirectory, SHADER_CACHE_DEFAULT_SIZE);
+        warm += startUp (&cache);
+        if (cache.hits != NUM_PROGRAMS)
+            printf ("error: main: only %u of %u programs were cached\n", cache.hits, NUM_PROGRAMS);
+
+        cache.maxSize = 0;
+        trimShaderCache (&cache);
+        freeShaderCache (cache);
+    }
+
+    printf
+        ( "%-24s %10.1f ms/startup %8.2f ms/program\n"
+          "%-24s %10.1f ms/startup %8.2f ms/program\n"
+          "%-24s %10.1f ms/startup %8.2f ms/program\n"
+        , "compileShaderProgram", uncached / NUM_ROUNDS / 1e6, uncached / NUM_ROUNDS / NUM_PROGRAMS / 1e6
+        , "cache, cold", cold / NUM_ROUNDS / 1e6, cold / NUM_ROUNDS / NUM_PROGRAMS / 1e6
+        , "cache, warm", warm / NUM_ROUNDS / 1e6, warm / NUM_ROUNDS / NUM_PROGRAMS / 1e6 );
+
+    for (unsigned int programIx = 0; programIx < NUM_PROGRAMS; programIx++) {
+        unlink (paths[programIx][0]);
+        unlink (paths[programIx][1]);
+    }
+    rmdir (cacheDirectory);
+    rmdir (directory);
+
+    freeGLTestContext (context);
+
+    return 0;
+}
@@ -0,0 +1,131 @@
+
+// Sharbigajar.Tests.BenchTextFromFile
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Effectno.h"
+#include "Text.h"
+
+
+
+// Benchmark for loading 1 KB, 1 MB and 1 GB files: the old 'textFromFile',
+// which grew its buffer 1024 bytes at a time, next to the new one and
+// 'mapTextFromFile'. Files are written first, so they're read from the
+// page cache. Mapping a file costs little until its pages are touched,
+// so the mapped file is also timed with a read of every page.
+
+static double benchNow (void) {
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static volatile uint64_t benchSink;
+
+// 'textFromFile' as it was.
+//
+static Text oldTextFromFile (Text filename) {
+    FILE *fp = fopen(filename.array, "r");
+    if (!fp) {
+        effectno = IOError;
+        return (Text) {0, 0};
+    }
+
+    unsigned int
+        size    = 1024,
+        total   = 0,
+        count;
+    char *buf = (char *) malloc (size);
+
+    while ((count = fread (buf + total, 1, size - total, fp))) {
+        total += count;
+        if (total == size) {
+            size += 1024;
+            buf = (char *) realloc (buf, size);
+        }
+    }
+
+    fclose (fp);
+
+    return (Text) { buf, total };
+}
+
+static uint64_t touchPages (Text text) {
+    uint64_t sum = 0;
+    for (unsigned int ix = 0; ix < text.length; ix += 4096)
+        sum += (unsigned char) text.array[ix];
+    return sum;
+}
+
+static void report (const char name[], unsigned int size, double ns, unsigned int repeats) {
+    printf
+        ( "%-28s %10u bytes %14.0f ns/file %10.1f MB/s\n"
+        , name, size, ns / repeats, (double) size * repeats / ns * 1e3 );
+}
+
+static void benchFile (const char path[], unsigned int size, unsigned int repeats) {
+    FILE *file = fopen (path, "wb");
+    if (!file) {
+        printf ("error: benchFile: can't write %s\n", path);
+        return;
+    }
+
+    char block[4096];
+    for (unsigned int ix = 0; ix < sizeof (block); ix++)
+        block[ix] = (char) ('a' + ix % 23);
+    for (unsigned int written = 0; written < size; written += sizeof (block))
+        fwrite (block, 1, size - written < sizeof (block) ? size - written : sizeof (block), file);
+    fclose (file);
+
+    Text filename = textFromString (path);
+    double start = benchNow ();
+
+    for (unsigned int rep = 0; rep < repeats; rep++) {
+        Text text = oldTextFromFile (filename);
+        benchSink += text.length;
+        freeText (text);
+    }
+    report ("old textFromFile", size, benchNow () - start, repeats);
+
+    start = benchNow ();
+    for (unsigned int rep = 0; rep < repeats; rep++) {
+        Text text = textFromFile (filename);
+        benchSink += text.length;
+        freeText (text);
+    }
+    report ("textFromFile", size, benchNow () - start, repeats);
+
+    start = benchNow ();
+    for (unsigned int rep = 0; rep < repeats; rep++) {
+        FileText fileText = mapTextFromFile (filename);
+        benchSink += fileText.text.length;
+        freeFileText (fileText);
+    }
+    report ("mapTextFromFile", size, benchNow () - start, repeats);
+
+    start = benchNow ();
+    for (unsigned int rep = 0; rep < repeats; rep++) {
+        FileText fileText = mapTextFromFile (filename);
+        benchSink += touchPages (fileText.text);
+        freeFileText (fileText);
+    }
+    report ("mapTextFromFile + touch", size, benchNow () - start, repeats);
+
+    unlink (path);
+}
+
+int main (void) {
+    char path[64];
+    snprintf (path, sizeof (path), "/tmp/BenchTextFromFile.%d", (int) getpid ());
+
+    benchFile (path, 1 << 10, 10000);
+    benchFile (path, 1 << 20, 100);
+    benchFile (path, 1 << 30, 1);
+
+    return 0;
+}
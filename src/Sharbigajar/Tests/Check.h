@@ -0,0 +1,26 @@
+
+#ifndef SHARBIGAJAR_TESTS_CHECK_H
+#define SHARBIGAJAR_TESTS_CHECK_H
+
+#include <stdio.h>
+
+// Checks for the test programs. 'CHECK' counts and reports a condition
+// that doesn't hold, and 'checkReport' prints the count at the end and
+// gives the program's exit status.
+//
+static unsigned int failures = 0;
+
+#define CHECK(cond)                                                     \
+    do {                                                                \
+        if (!(cond)) {                                                  \
+            failures++;                                                 \
+            printf ("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);     \
+        }                                                               \
+    } while (0)
+
+static inline int checkReport (void) {
+    printf ("%s: %u failures\n", failures ? "FAIL" : "OK", failures);
+    return failures != 0;
+}
+
+#endif
@@ -0,0 +1,144 @@
+
+#ifndef SHARBIGAJAR_TESTS_GL_TEST_H
+#define SHARBIGAJAR_TESTS_GL_TEST_H
+
+#include <stdio.h>
+#include <time.h>
+
+#include <unistd.h>
+
+#include <SDL2/SDL.h>
+#include <GL/glew.h>
+
+#include "Backend/Shaders.h"
+
+// Shared helpers for the test and benchmark programs that need GL.
+
+
+
+// GL context on a hidden window, for programs that compile shaders but
+// never draw to the screen.
+//
+typedef struct GLTestContext GLTestContext;
+
+struct GLTestContext {
+    SDL_Window *window;
+    SDL_GLContext glcontext;
+};
+
+static inline GLTestContext newGLTestContext (const char title[]) {
+    SDL_Init (SDL_INIT_VIDEO);
+
+    SDL_Window *window = SDL_CreateWindow
+        ( title
+        , SDL_WINDOWPOS_CENTERED
+        , SDL_WINDOWPOS_CENTERED
+        , 64
+        , 64
+        , SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN );
+
+    SDL_GLContext glcontext = SDL_GL_CreateContext (window);
+    glewInit ();
+
+    return (GLTestContext) {
+        .window     = window,
+        .glcontext  = glcontext
+    };
+}
+
+static inline void freeGLTestContext (GLTestContext context) {
+    SDL_GL_DeleteContext (context.glcontext);
+    SDL_DestroyWindow (context.window);
+    SDL_Quit ();
+}
+
+// Replace a file's contents with a string.
+//
+static inline void writeFile (const char path[], const char contents[]) {
+    FILE *file = fopen (path, "w");
+    fputs (contents, file);
+    fclose (file);
+}
+
+// Monotonic wall-clock time in nanoseconds.
+//
+static inline double benchNow (void) {
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// A vertex and fragment shader with some lighting maths in, different
+// for every program, round and run, so nothing is left over from before
+// in any cache.
+//
+static inline void writeProgram (const char directory[], unsigned int programIx, unsigned int round) {
+    char path[256];
+    FILE *file;
+
+    snprintf (path, sizeof (path), "%s/Vertex%u.glsl", directory, programIx);
+    file = fopen (path, "w");
+    fprintf
+        ( file
+        , "#version 120\n"
+          "// Run %d\n"
+          "attribute vec3 position;\n"
+          "attribute vec3 normal;\n"
+          "uniform mat4 model, view, projection;\n"
+          "varying vec3 worldNormal, worldPosition;\n"
+          "void main (void) {\n"
+          "    vec4 world = model * vec4 (position * %u.%u, 1);\n"
+          "    worldPosition = world.xyz;\n"
+          "    worldNormal = normalize (mat3 (model) * normal);\n"
+          "    gl_Position = projection * view * world;\n"
+          "}\n"
+        , (int) getpid (), programIx + 1, round );
+    fclose (file);
+
+    snprintf (path, sizeof (path), "%s/Fragment%u.glsl", directory, programIx);
+    file = fopen (path, "w");
+    fprintf
+        ( file
+        , "#version 120\n"
+          "// Run %d\n"
+          "uniform vec3 lightPositions[8];\n"
+          "uniform vec3 lightColours[8];\n"
+          "uniform vec3 eye;\n"
+          "uniform vec4 colour;\n"
+          "varying vec3 worldNormal, worldPosition;\n"
+          "vec3 light (int ix, vec3 n, vec3 v) {\n"
+          "    vec3 l = normalize (lightPositions[ix] - worldPosition);\n"
+          "    vec3 h = normalize (l + v);\n"
+          "    float d = length (lightPositions[ix] - worldPosition);\n"
+          "    float diffuse = max (dot (n, l), 0.0);\n"
+          "    float specular = pow (max (dot (n, h), 0.0), %u.0);\n"
+          "    return lightColours[ix] * (diffuse + specular) / (1.0 + 0.%u * d * d);\n"
+          "}\n"
+          "void main (void) {\n"
+          "    vec3 n = normalize (worldNormal);\n"
+          "    vec3 v = normalize (eye - worldPosition);\n"
+          "    vec3 sum = vec3 (0.0);\n"
+          "    for (int ix = 0; ix < 8; ix++)\n"
+          "        sum += light (ix, n, v);\n"
+          "    gl_FragColor = vec4 (colour.rgb * sum, colour.a);\n"
+          "}\n"
+        , (int) getpid (), 8 + programIx, round + 1 );
+    fclose (file);
+}
+
+// Paths and shader infos for the programs 'writeProgram' writes.
+//
+static inline void makeProgramInfos
+    ( const char directory[], unsigned int numPrograms
+    , ShaderInfo infos[][2], char paths[][2][256] )
+{
+    for (unsigned int programIx = 0; programIx < numPrograms; programIx++) {
+        snprintf (paths[programIx][0], 256, "%s/Vertex%u.glsl", directory, programIx);
+        snprintf (paths[programIx][1], 256, "%s/Fragment%u.glsl", directory, programIx);
+
+        infos[programIx][0] = newShaderInfo (GL_VERTEX_SHADER, paths[programIx][0], "vertex");
+        infos[programIx][1] = newShaderInfo (GL_FRAGMENT_SHADER, paths[programIx][1], "fragment");
+    }
+}
+
+#endif
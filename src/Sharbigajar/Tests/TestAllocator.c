@@ -0,0 +1,161 @@
+
+// Sharbigajar.Tests.TestAllocator
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "Allocator.h"
+#include "Effectno.h"
+#include "Text.h"
+#include "Tests/Check.h"
+
+
+
+static unsigned int countBlocks (const Arena *arena) {
+    unsigned int n = 0;
+    for (ArenaBlock *block = arena->first; block; block = block->next)
+        n++;
+    return n;
+}
+
+static void checkArena (void) {
+    Arena arena = newArena (256);
+
+    // Allocations are aligned and don't overlap.
+    char *a = (char *) arenaAlloc (&arena, 3);
+    char *b = (char *) arenaAlloc (&arena, 0);
+    char *c = (char *) arenaAlloc (&arena, 40);
+    CHECK ((uintptr_t) a % 16 == 0 && (uintptr_t) b % 16 == 0 && (uintptr_t) c % 16 == 0);
+    CHECK (a < b && b < c);
+    memset (c, 0x5A, 40);
+
+    // Resetting to a mark frees everything after it.
+    ArenaMark mark = markArena (&arena);
+    char *d = (char *) arenaAlloc (&arena, 64);
+    resetArenaTo (&arena, mark);
+    CHECK (arenaAlloc (&arena, 64) == d);
+    resetArenaTo (&arena, mark);
+
+    // Running out moves on to bigger blocks, which are kept for next time.
+    for (unsigned int ix = 0; ix < 100; ix++)
+        memset (arenaAlloc (&arena, 100), (int) ix, 100);
+
+    unsigned int blocks = countBlocks (&arena);
+    CHECK (blocks > 1 && blocks < 10);
+    CHECK (c[39] == 0x5A);
+
+    for (unsigned int frame = 0; frame < 10; frame++) {
+        resetArena (&arena);
+        for (unsigned int ix = 0; ix < 100; ix++)
+            arenaAlloc (&arena, 100);
+    }
+
+    CHECK (countBlocks (&arena) == blocks);
+
+    // Allocations bigger than a whole block get a block of their own.
+    resetArena (&arena);
+    char *big = (char *) arenaAlloc (&arena, 1 << 20);
+    memset (big, 1, 1 << 20);
+    CHECK (arena.current->size >= 1 << 20);
+
+    freeArena (arena);
+}
+
+// Through the allocator interface, the last allocation resizes and frees
+// in place, anything else shrinks in place, and grows by copying.
+//
+static void checkArenaAllocator (void) {
+    Arena arena = newArena (1024);
+    Allocator allocator = arenaAllocator (&arena);
+
+    char *a = (char *) allocMemory (allocator, 10);
+    memcpy (a, "abcdefghi", 10);
+
+    CHECK (reallocMemory (allocator, a, 10, 100) == a);
+    size_t used = arena.used;
+
+    char *b = (char *) allocMemory (allocator, 16);
+    char *moved = (char *) reallocMemory (allocator, a, 100, 200);
+    CHECK (moved != a && strcmp (moved, "abcdefghi") == 0);
+
+    size_t usedBefore = arena.used;
+    CHECK (reallocMemory (allocator, b, 16, 8) == b);
+    CHECK (arena.used == usedBefore);
+
+    freeMemory (allocator, moved, 200);
+    freeMemory (allocator, b, 16);
+    CHECK (arena.used == used);
+
+    freeArena (arena);
+}
+
+// Text built in an arena takes nothing from the heap, and freed in the
+// reverse order it was made, it all goes back.
+//
+static void checkTextInArena (void) {
+    char path[64];
+    snprintf (path, sizeof (path), "/tmp/TestAllocator.%d", (int) getpid ());
+
+    FILE *file = fopen (path, "wb");
+    fputs ("#version 330\nvoid main () {}\n", file);
+    fclose (file);
+
+    Arena arena = newArena (1 << 16);
+    Allocator allocator = arenaAllocator (&arena);
+    ArenaMark mark = markArena (&arena);
+
+    Text source = textFromFileWith (allocator, textFromString (path));
+    CHECK (strcmp (source.array, "#version 330\nvoid main () {}\n") == 0);
+
+    TextBuilder builder = newTextBuilderWith (allocator, 0);
+    for (unsigned int ix = 0; ix < 1000; ix++)
+        formatToBuilder (&builder, "uniform vec4 u%u;\n", ix);
+    Text uniforms = buildText (builder);
+    CHECK (strncmp (uniforms.array + uniforms.length - 19, "uniform vec4 u999;\n", 19) == 0);
+    CHECK (countBlocks (&arena) == 1);
+
+    Text copy = copyTextFromStringWith (allocator, "main");
+    Text joined = concatTextWith (allocator, copy, textFromString (" ()"));
+    CHECK (strcmp (joined.array, "main ()") == 0);
+
+    freeTextWith (allocator, joined);
+    freeTextWith (allocator, copy);
+    freeTextWith (allocator, uniforms);
+    freeTextWith (allocator, source);
+    CHECK (arena.current == mark.block && arena.used == mark.used);
+
+    freeArena (arena);
+    unlink (path);
+}
+
+// What one frame allocates lasts through the next, and is then reused.
+//
+static void checkFrameArena (void) {
+    FrameArena frames = newFrameArena (4096);
+
+    Arena *arena = beginFrame (&frames);
+    CHECK (frameArena (&frames) == arena);
+    char *last = (char *) arenaAlloc (arena, 32);
+    strcpy (last, "frame 1");
+
+    arena = beginFrame (&frames);
+    char *now = (char *) arenaAlloc (arena, 32);
+    strcpy (now, "frame 2");
+    CHECK (strcmp (last, "frame 1") == 0);
+
+    beginFrame (&frames);
+    CHECK (arenaAlloc (frameArena (&frames), 32) == last);
+
+    freeFrameArena (frames);
+}
+
+int main (void) {
+    checkArena ();
+    checkArenaAllocator ();
+    checkTextInArena ();
+    checkFrameArena ();
+
+    return checkReport ();
+}
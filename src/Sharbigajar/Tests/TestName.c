@@ -0,0 +1,89 @@
+
+// Sharbigajar.Tests.TestName
+
+#include <stdio.h>
+#include <string.h>
+
+#include "Name.h"
+#include "Text.h"
+#include "Tests/Check.h"
+
+
+
+static void checkHash (void) {
+    const char string[] = "uniform vec4 colour; uniform mat4 view;";
+    Text text = textFromString (string);
+
+    // Equal texts hash the same wherever they are.
+    char copy[sizeof (string)];
+    memcpy (copy, string, sizeof (string));
+    CHECK (hashText (text) == hashText (textFromString (copy)));
+
+    // Every prefix hashes differently, including ones that only differ in
+    // length, with zeros in the tail.
+    for (unsigned int n = 0; n < text.length; n++)
+        for (unsigned int m = n + 1; m <= text.length; m++)
+            CHECK (hashText ((Text) {string, n}) != hashText ((Text) {string, m}));
+
+    const char zeros[16] = {0};
+    CHECK (hashText ((Text) {zeros, 3}) != hashText ((Text) {zeros, 4}));
+
+    CHECK (textEquals (text, textFromString (copy)));
+    CHECK (!textEquals (text, (Text) {string, 7}));
+    CHECK (textEquals ((Text) {NULL, 0}, textFromString ("")));
+}
+
+static void checkIntern (void) {
+    CHECK (countNames () == 0);
+    CHECK (findName (textFromString ("position")) == NoName);
+
+    Name position = internString ("position");
+    Name colour = internString ("colour");
+    CHECK (position != NoName && colour != NoName && position != colour);
+    CHECK (internString ("position") == position);
+    CHECK (internText ((Text) {"colours", 6}) == colour);
+    CHECK (countNames () == 2);
+
+    // The table keeps its own copy of the text.
+    char buffer[] = "view";
+    Name view = internString (buffer);
+    buffer[0] = 'x';
+    CHECK (strcmp (nameText (view).array, "view") == 0 && nameText (view).length == 4);
+    CHECK (findName (textFromString ("view")) == view);
+    CHECK (findName (textFromString ("xiew")) == NoName);
+
+    CHECK (nameText (NoName).length == 0);
+    CHECK (internString ("") != NoName && nameText (internString ("")).length == 0);
+
+    // Names and texts stay put as the table grows.
+    const char *viewArray = nameText (view).array;
+    char string[32];
+
+    for (unsigned int ix = 0; ix < 100000; ix++) {
+        snprintf (string, sizeof (string), "u%u", ix);
+        internString (string);
+    }
+
+    CHECK (countNames () == 100004);
+    CHECK (internString ("position") == position && nameText (view).array == viewArray);
+
+    unsigned int found = 0;
+    for (unsigned int ix = 0; ix < 100000; ix++) {
+        snprintf (string, sizeof (string), "u%u", ix);
+        Name name = findName (textFromString (string));
+        found += name != NoName && strcmp (nameText (name).array, string) == 0;
+    }
+    CHECK (found == 100000);
+
+    freeNames ();
+    CHECK (countNames () == 0 && findName (textFromString ("position")) == NoName);
+    CHECK (internString ("colour") == 1);
+    freeNames ();
+}
+
+int main (void) {
+    checkHash ();
+    checkIntern ();
+
+    return checkReport ();
+}
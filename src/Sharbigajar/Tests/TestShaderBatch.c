@@ -0,0 +1,126 @@
+
+// Sharbigajar.Tests.TestShaderBatch
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <SDL2/SDL.h>
+#include <GL/glew.h>
+
+#include "Effectno.h"
+#include "Text.h"
+#include "Backend/Shaders.h"
+#include "Backend/ShaderBatch.h"
+#include "Tests/Check.h"
+#include "Tests/GLTest.h"
+
+
+
+// Run from the Tests directory, like TestShaders, with a GL context on a
+// hidden window.
+
+static char directory[64], brokenPath[80], dimPath[80];
+
+static int isUsable (GLuint program) {
+    GLint linked = 0;
+    glGetProgramiv (program, GL_LINK_STATUS, &linked);
+    return linked && glGetUniformLocation (program, "colour") >= 0;
+}
+
+static void checkBatch (int wait) {
+    const ShaderInfo
+        good[] = {
+            newShaderInfo (GL_VERTEX_SHADER, "TestVertexShader.glsl", "vertex"),
+            newShaderInfo (GL_FRAGMENT_SHADER, "TestFragmentShader.glsl", "fragment")
+        },
+        broken[] = {
+            good[0],
+            newShaderInfo (GL_FRAGMENT_SHADER, brokenPath, "broken")
+        },
+        missing[] = {
+            newShaderInfo (GL_VERTEX_SHADER, "NoSuchShader.glsl", "missing"),
+            good[1]
+        },
+        dim[] = {
+            good[0],
+            newShaderInfo (GL_FRAGMENT_SHADER, dimPath, "dim")
+        };
+
+    const ProgramInfo programs[] = {
+        {2, good, 0, NULL},
+        {2, broken, 0, NULL},
+        {2, missing, 0, NULL},
+        {2, dim, 0, NULL}
+    };
+
+    ShaderBatch *batch = submitShaderBatch (4, programs);
+    CHECK (batch->numPrograms == 4 && batch->numShaders == 8);
+
+    if (wait) {
+        finishShaderBatch (batch);
+    }
+    else {
+        // Updates keep going until everything's done, however long that
+        // takes the reader and the driver.
+        unsigned int frames = 0;
+        while (updateShaderBatch (batch) && frames < 10000) {
+            usleep (100);
+            frames++;
+        }
+        CHECK (frames < 10000);
+    }
+
+    CHECK (batch->numPending == 0 && updateShaderBatch (batch) == 0);
+
+    CHECK (batch->programs[0].status == ProgramReady && isUsable (batch->programs[0].program));
+    CHECK (batch->programs[1].status == ProgramFailed && batch->programs[1].program == 0);
+    CHECK (batch->programs[2].status == ProgramFailed && batch->programs[2].program == 0);
+    CHECK (batch->programs[3].status == ProgramReady && isUsable (batch->programs[3].program));
+    CHECK (batch->programs[0].program != batch->programs[3].program);
+
+    // Failures keep their errors.
+    CHECK (batch->programs[0].log.length == 0 && batch->programs[3].log.length == 0);
+    CHECK (batch->programs[1].log.length > strlen (brokenPath) + 2);
+    CHECK (strncmp (batch->programs[1].log.array, brokenPath, strlen (brokenPath)) == 0);
+    CHECK (strstr (batch->programs[2].log.array, "NoSuchShader.glsl: failed to open") != NULL);
+
+    // The shaders are all gone, and the programs are left.
+    for (unsigned int shaderIx = 0; shaderIx < batch->numShaders; shaderIx++)
+        CHECK (batch->shaders[shaderIx] == 0);
+
+    GLuint programA = batch->programs[0].program, programB = batch->programs[3].program;
+    freeShaderBatch (batch);
+
+    CHECK (glIsProgram (programA) && glIsProgram (programB));
+    glDeleteProgram (programA);
+    glDeleteProgram (programB);
+}
+
+int main (void) {
+    GLTestContext context = newGLTestContext ("TestShaderBatch");
+
+    snprintf (directory, sizeof (directory), "/tmp/TestShaderBatch.%d", (int) getpid ());
+    snprintf (brokenPath, sizeof (brokenPath), "%s/Broken.glsl", directory);
+    snprintf (dimPath, sizeof (dimPath), "%s/Dim.glsl", directory);
+    mkdir (directory, 0755);
+
+    writeFile (brokenPath, "#version 120\nuniform vec4 colour;\nvoid main (void) { gl_FragColor = colour * nothing; }\n");
+    writeFile (dimPath, "#version 120\nuniform vec4 colour;\nvoid main (void) { gl_FragColor = colour * 0.5; }\n");
+
+    printf ("KHR_parallel_shader_compile: %s\n", GLEW_KHR_parallel_shader_compile ? "yes" : "no");
+
+    checkBatch (0);
+    checkBatch (1);
+
+    unlink (brokenPath);
+    unlink (dimPath);
+    rmdir (directory);
+
+    freeGLTestContext (context);
+
+    return checkReport ();
+}
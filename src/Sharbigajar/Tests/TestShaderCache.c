@@ -0,0 +1,191 @@
+
+// Sharbigajar.Tests.TestShaderCache
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <SDL2/SDL.h>
+#include <GL/glew.h>
+
+#include "Effectno.h"
+#include "Text.h"
+#include "Backend/Shaders.h"
+#include "Backend/ShaderCache.h"
+#include "Tests/Check.h"
+#include "Tests/GLTest.h"
+
+
+
+// Run from the Tests directory, like TestShaders, with a GL context on a
+// hidden window. The cache and the edited shader live in a temporary
+// directory.
+
+static char directory[64], cacheDirectory[80], shaderPath[80];
+
+static unsigned int countCacheFiles (void) {
+    DIR *dir = opendir (cacheDirectory);
+    unsigned int n = 0;
+
+    struct dirent *dirEntry;
+    while ((dirEntry = readdir (dir)))
+        n += strstr (dirEntry->d_name, ".prog") != NULL;
+
+    closedir (dir);
+    return n;
+}
+
+static size_t cacheSize (void) {
+    DIR *dir = opendir (cacheDirectory);
+    size_t size = 0;
+
+    struct dirent *dirEntry;
+    struct stat status;
+    while ((dirEntry = readdir (dir)))
+        if (strstr (dirEntry->d_name, ".prog") && fstatat (dirfd (dir), dirEntry->d_name, &status, 0) == 0)
+            size += status.st_size;
+
+    closedir (dir);
+    return size;
+}
+
+static int isLinked (GLuint program) {
+    GLint linked = 0, numUniforms = 0;
+    glGetProgramiv (program, GL_LINK_STATUS, &linked);
+    glGetProgramiv (program, GL_ACTIVE_UNIFORMS, &numUniforms);
+    return linked && numUniforms == 1 && glGetUniformLocation (program, "colour") >= 0;
+}
+
+static void checkCache (void) {
+    const ShaderInfo infos[] = {
+        newShaderInfo (GL_VERTEX_SHADER, "TestVertexShader.glsl", "vertex"),
+        newShaderInfo (GL_FRAGMENT_SHADER, "TestFragmentShader.glsl", "fragment")
+    };
+
+    // The first time compiles and saves the program.
+    ShaderCache cache = newShaderCache (cacheDirectory, SHADER_CACHE_DEFAULT_SIZE);
+    CHECK (cache.enabled);
+
+    GLuint program = compileCachedShaderProgram (&cache, 2, infos);
+    CHECK (isLinked (program));
+    CHECK (cache.hits == 0 && cache.misses == 1 && countCacheFiles () == 1);
+    glDeleteProgram (program);
+    freeShaderCache (cache);
+
+    // After that it's loaded, even by a new cache.
+    cache = newShaderCache (cacheDirectory, SHADER_CACHE_DEFAULT_SIZE);
+    program = compileCachedShaderProgram (&cache, 2, infos);
+    CHECK (isLinked (program));
+    CHECK (cache.hits == 1 && cache.misses == 0);
+    glDeleteProgram (program);
+
+    // Another driver misses.
+    cache.driverHash++;
+    program = compileCachedShaderProgram (&cache, 2, infos);
+    CHECK (isLinked (program));
+    CHECK (cache.misses == 1 && countCacheFiles () == 2);
+    glDeleteProgram (program);
+    cache.driverHash--;
+
+    // So does an edited shader, and only it.
+    writeFile (shaderPath, "#version 120\nuniform vec4 colour;\nvoid main (void) { gl_FragColor = colour * 0.5; }\n");
+    const ShaderInfo edited[] = {
+        infos[0],
+        newShaderInfo (GL_FRAGMENT_SHADER, shaderPath, "edited")
+    };
+
+    program = compileCachedShaderProgram (&cache, 2, edited);
+    CHECK (isLinked (program) && cache.misses == 2);
+    glDeleteProgram (program);
+
+    program = compileCachedShaderProgram (&cache, 2, edited);
+    CHECK (isLinked (program) && cache.hits == 2 && cache.misses == 2);
+    glDeleteProgram (program);
+
+    // A broken entry is thrown away and replaced.
+    DIR *dir = opendir (cacheDirectory);
+    struct dirent *dirEntry;
+    char path[384];
+    while ((dirEntry = readdir (dir))) {
+        if (strstr (dirEntry->d_name, ".prog")) {
+            snprintf (path, sizeof (path), "%s/%s", cacheDirectory, dirEntry->d_name);
+            writeFile (path, "SGPROG1 but not really");
+        }
+    }
+    closedir (dir);
+
+    program = compileCachedShaderProgram (&cache, 2, infos);
+    CHECK (isLinked (program) && cache.misses == 3);
+    glDeleteProgram (program);
+
+    program = compileCachedShaderProgram (&cache, 2, infos);
+    CHECK (isLinked (program) && cache.hits == 3);
+    glDeleteProgram (program);
+
+    // A missing file is reported like 'compileShaderProgram' does.
+    const ShaderInfo missing[] = {
+        infos[0],
+        newShaderInfo (GL_FRAGMENT_SHADER, "NoSuchShader.glsl", "missing")
+    };
+
+    program = compileCachedShaderProgram (&cache, 2, missing);
+    CHECK (effectno == IOError && cache.misses == 3);
+    glDeleteProgram (program);
+
+    freeShaderCache (cache);
+
+    // Trimming keeps the most recently used files that fit.
+    cache = newShaderCache (cacheDirectory, 1);
+    program = compileCachedShaderProgram (&cache, 2, edited);
+    CHECK (countCacheFiles () == 0);
+    glDeleteProgram (program);
+    freeShaderCache (cache);
+
+    cache = newShaderCache (cacheDirectory, SHADER_CACHE_DEFAULT_SIZE);
+    glDeleteProgram (compileCachedShaderProgram (&cache, 2, edited));
+    glDeleteProgram (compileCachedShaderProgram (&cache, 2, infos));
+    CHECK (cache.misses == 2 && countCacheFiles () == 2);
+
+    // The size estimate follows what's stored, without counting again.
+    CHECK (cache.sizeEstimate == cacheSize ());
+
+    usleep (10000);
+    glDeleteProgram (compileCachedShaderProgram (&cache, 2, edited));
+    CHECK (cache.hits == 1);
+
+    cache.maxSize = cacheSize () - 1;
+    trimShaderCache (&cache);
+    CHECK (countCacheFiles () == 1);
+
+    glDeleteProgram (compileCachedShaderProgram (&cache, 2, edited));
+    glDeleteProgram (compileCachedShaderProgram (&cache, 2, infos));
+    CHECK (cache.hits == 2 && cache.misses == 3);
+
+    cache.maxSize = 1;
+    trimShaderCache (&cache);
+    CHECK (countCacheFiles () == 0);
+    freeShaderCache (cache);
+}
+
+int main (void) {
+    GLTestContext context = newGLTestContext ("TestShaderCache");
+
+    snprintf (directory, sizeof (directory), "/tmp/TestShaderCache.%d", (int) getpid ());
+    snprintf (cacheDirectory, sizeof (cacheDirectory), "%s/cache", directory);
+    snprintf (shaderPath, sizeof (shaderPath), "%s/Edited.glsl", directory);
+    mkdir (directory, 0755);
+
+    checkCache ();
+
+    unlink (shaderPath);
+    rmdir (cacheDirectory);
+    rmdir (directory);
+
+    freeGLTestContext (context);
+
+    return checkReport ();
+}
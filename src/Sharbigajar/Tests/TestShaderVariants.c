@@ -0,0 +1,250 @@
+
+// Sharbigajar.Tests.TestShaderVariants
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <SDL2/SDL.h>
+#include <GL/glew.h>
+
+#include "Effectno.h"
+#include "Name.h"
+#include "Text.h"
+#include "Backend/Shaders.h"
+#include "Backend/ShaderVariants.h"
+#include "Tests/Check.h"
+#include "Tests/GLTest.h"
+
+
+
+// Shaders are written to a temporary directory, with a GL context on a
+// hidden window.
+
+static char directory[64];
+
+static const char *files[][2] = {
+    { "Vertex.glsl",
+        "#version 120\n"
+        "attribute vec2 position;\n"
+        "void main (void) {\n"
+        "#ifdef LOD\n"
+        "    gl_Position = vec4 (position * LOD, 0, 1);\n"
+        "#else\n"
+        "    gl_Position = vec4 (position, 0, 1);\n"
+        "#endif\n"
+        "}\n" },
+    { "Fragment.glsl",
+        "#version 120\n"
+        "#include \"Common/Light.glsl\"\n"
+        "uniform vec4 colour;\n"
+        "void main (void) { gl_FragColor = light (colour); }\n" },
+    { "Common/Light.glsl",
+        "vec4 light (vec4 colour) {\n"
+        "#ifdef LIT\n"
+        "    return colour * 0.5;\n"
+        "#else\n"
+        "    return colour;\n"
+        "#endif\n"
+        "}\n" },
+    { "Error.glsl",
+        "#version 120\n"
+        "uniform vec4 colour;\n"
+        "#include \"Common/Error.glsl\"\n"
+        "void main (void) { gl_FragColor = colour; }\n"
+        "nothing;\n" },
+    { "Common/Error.glsl",
+        "// Fine so far.\n"
+        "nothing;\n" },
+    { "Missing.glsl",
+        "#version 120\n"
+        "#include \"NoSuchFile.glsl\"\n" },
+    { "Cycle.glsl",
+        "#version 120\n"
+        "#include \"Cycle.glsl\"\n" }
+};
+
+#define NUM_FILES (sizeof (files) / sizeof (files[0]))
+
+static char *path (const char file[]) {
+    static char paths[4][128];
+    static unsigned int pathIx = 0;
+
+    char *p = paths[pathIx++ % 4];
+    snprintf (p, 128, "%s/%s", directory, file);
+    return p;
+}
+
+static void writeFiles (void) {
+    mkdir (directory, 0755);
+    mkdir (path ("Common"), 0755);
+
+    for (unsigned int fileIx = 0; fileIx < NUM_FILES; fileIx++)
+        writeFile (path (files[fileIx][0]), files[fileIx][1]);
+}
+
+static void removeFiles (void) {
+    for (unsigned int fileIx = 0; fileIx < NUM_FILES; fileIx++)
+        unlink (path (files[fileIx][0]));
+    rmdir (path ("Common"));
+    rmdir (directory);
+}
+
+static void checkPreprocess (void) {
+    const ShaderInfo infos[] = {
+        newShaderInfo (GL_VERTEX_SHADER, path ("Vertex.glsl"), "vertex"),
+        newShaderInfo (GL_FRAGMENT_SHADER, path ("Fragment.glsl"), "fragment"),
+        newShaderInfo (GL_FRAGMENT_SHADER, path ("Error.glsl"), "error")
+    };
+
+    ShaderVariants variants = newShaderVariants (2, infos);
+    const ShaderDefine defines[] = {
+        {internString ("LIT"), textFromString ("")},
+        {internString ("LOD"), textFromString ("0.5")}
+    };
+
+    // Includes are replaced, and the defines a stage mentions go in after
+    // '#version'.
+    Text fragment = preprocessShader (&variants, infos[1], 2, defines);
+    CHECK (strncmp (fragment.array, "#version 120\n#define LIT \n#line 1 0\n", 36) == 0);
+    CHECK (strstr (fragment.array, "return colour * 0.5;") != NULL);
+    CHECK (strstr (fragment.array, "#include") == NULL);
+    CHECK (strstr (fragment.array, "LOD") == NULL);
+    freeText (fragment);
+
+    Text vertex = preprocessShader (&variants, infos[0], 2, defines);
+    CHECK (strncmp (vertex.array, "#version 120\n#define LOD 0.5\n", 29) == 0);
+    CHECK (strstr (vertex.array, "LIT") == NULL);
+    freeText (vertex);
+
+    Text plain = preprocessShader (&variants, infos[0], 0, NULL);
+    CHECK (strcmp (plain.array, files[0][1]) == 0);
+    freeText (plain);
+
+    // Errors point at the file and line they're on, in and after includes.
+    Text error = preprocessShader (&variants, infos[2], 2, defines);
+    GLuint shader = startShaderCompile (infos[2], error);
+    TextBuilder log = newTextBuilder (0);
+    appendShaderLog (&log, shader);
+    CHECK (strstr (log.array, "1:2(") != NULL);
+    CHECK (strstr (error.array, "// 1: ") != NULL && strstr (error.array, "Common/Error.glsl\n") != NULL);
+    glDeleteShader (shader);
+    freeTextBuilder (log);
+    freeText (error);
+
+    Text afterError = preprocessShader (&variants, infos[2], 0, NULL);
+    const char *after = strstr (afterError.array, "nothing;\n#line") + strlen ("nothing;\n");
+    shader = startShaderCompile
+        (infos[2], (Text) {after, afterError.length - (after - afterError.array)});
+    log = newTextBuilder (0);
+    appendShaderLog (&log, shader);
+    CHECK (strstr (log.array, "0:5(") != NULL);
+    glDeleteShader (shader);
+    freeTextBuilder (log);
+    freeText (afterError);
+
+    freeShaderVariants (variants);
+}
+
+static void checkVariants (void) {
+    const ShaderInfo infos[] = {
+        newShaderInfo (GL_VERTEX_SHADER, path ("Vertex.glsl"), "vertex"),
+        newShaderInfo (GL_FRAGMENT_SHADER, path ("Fragment.glsl"), "fragment")
+    };
+
+    ShaderVariants variants = newShaderVariants (2, infos);
+    Name lit = internString ("LIT"), lod = internString ("LOD"), unused = internString ("UNUSED");
+
+    // Nothing's compiled until it's asked for.
+    CHECK (variants.numShaders == 0 && variants.numVariants == 0);
+
+    GLuint plain = variantProgram (&variants, 0, NULL);
+    CHECK (plain != 0 && variants.numShaders == 2 && variants.numSources == 3);
+    CHECK (variantProgram (&variants, 0, NULL) == plain && variants.numVariants == 1);
+
+    // Each stage is only compiled again for defines it mentions.
+    const ShaderDefine litDefines[] = {{lit, textFromString ("")}};
+    GLuint litProgram = variantProgram (&variants, 1, litDefines);
+    CHECK (litProgram != 0 && litProgram != plain && variants.numShaders == 3);
+
+    const ShaderDefine lodDefines[] = {{lod, textFromString ("0.5")}};
+    GLuint lodProgram = variantProgram (&variants, 1, lodDefines);
+    CHECK (lodProgram != 0 && lodProgram != plain && lodProgram != litProgram);
+    CHECK (variants.numShaders == 4);
+
+    // The order of the defines doesn't matter, and their values do.
+    const ShaderDefine
+        both[] = {{lit, textFromString ("")}, {lod, textFromString ("0.5")}},
+        reversed[] = {{lod, textFromString ("0.5")}, {lit, textFromString ("")}},
+        other[] = {{lod, textFromString ("0.25")}, {lit, textFromString ("")}};
+
+    GLuint bothProgram = variantProgram (&variants, 2, both);
+    CHECK (bothProgram != 0 && variants.numShaders == 4);
+    CHECK (variantProgram (&variants, 2, reversed) == bothProgram);
+    CHECK (variantProgram (&variants, 2, other) != bothProgram && variants.numShaders == 5);
+    CHECK (variants.numVariants == 5);
+
+    // Defines nothing mentions give the same program.
+    const ShaderDefine unusedDefines[] = {{unused, textFromString ("1")}};
+    CHECK (variantProgram (&variants, 1, unusedDefines) == plain);
+    CHECK (variants.numShaders == 5 && variants.numVariants == 6);
+
+    GLint linked = 0;
+    glGetProgramiv (bothProgram, GL_LINK_STATUS, &linked);
+    CHECK (linked && glGetUniformLocation (bothProgram, "colour") >= 0);
+
+    freeShaderVariants (variants);
+    CHECK (!glIsProgram (plain) && !glIsProgram (bothProgram));
+}
+
+static void checkFailures (void) {
+    const ShaderInfo
+        missing[] = {
+            newShaderInfo (GL_VERTEX_SHADER, path ("Vertex.glsl"), "vertex"),
+            newShaderInfo (GL_FRAGMENT_SHADER, path ("Missing.glsl"), "missing")
+        },
+        cycle[] = {
+            missing[0],
+            newShaderInfo (GL_FRAGMENT_SHADER, path ("Cycle.glsl"), "cycle")
+        },
+        error[] = {
+            missing[0],
+            newShaderInfo (GL_FRAGMENT_SHADER, path ("Error.glsl"), "error")
+        };
+
+    ShaderVariants variants = newShaderVariants (2, missing);
+    CHECK (variantProgram (&variants, 0, NULL) == 0 && effectno == IOError);
+
+    // Failures are remembered, and not tried again.
+    CHECK (variantProgram (&variants, 0, NULL) == 0 && variants.numVariants == 1);
+    freeShaderVariants (variants);
+
+    variants = newShaderVariants (2, cycle);
+    CHECK (variantProgram (&variants, 0, NULL) == 0 && effectno == ShaderIncludeError);
+    freeShaderVariants (variants);
+
+    variants = newShaderVariants (2, error);
+    CHECK (variantProgram (&variants, 0, NULL) == 0 && effectno == ShaderCompileError);
+    CHECK (variants.numShaders == 2 && variants.shaders[1].shader == 0);
+    freeShaderVariants (variants);
+}
+
+int main (void) {
+    GLTestContext context = newGLTestContext ("TestShaderVariants");
+
+    snprintf (directory, sizeof (directory), "/tmp/TestShaderVariants.%d", (int) getpid ());
+    writeFiles ();
+
+    checkPreprocess ();
+    checkVariants ();
+    checkFailures ();
+
+    removeFiles ();
+
+    freeGLTestContext (context);
+
+    return checkReport ();
+}
@@ -0,0 +1,160 @@
+
+// Sharbigajar.Tests.TestShaderWatcher
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <SDL2/SDL.h>
+#include <GL/glew.h>
+
+#include "Effectno.h"
+#include "Name.h"
+#include "Text.h"
+#include "Backend/Shaders.h"
+#include "Backend/ShaderWatcher.h"
+#include "Tests/Check.h"
+#include "Tests/GLTest.h"
+
+
+
+// Shaders are written to a temporary directory and changed under the
+// watcher's feet, with a GL context on a hidden window.
+
+static char directory[64], vertexPath[80], fragmentPath[80], otherPath[80], tempPath[96];
+
+static const char
+    *vertexSource =
+        "#version 120\n"
+        "attribute vec2 position;\n"
+        "void main (void) { gl_Position = vec4 (position, 0, 1); }\n",
+    *fragmentSource =
+        "#version 120\n"
+        "uniform vec4 colour;\n"
+        "void main (void) { gl_FragColor = colour; }\n",
+    *dimSource =
+        "#version 120\n"
+        "uniform vec4 colour;\n"
+        "uniform float dim;\n"
+        "void main (void) { gl_FragColor = colour * dim; }\n",
+    *brokenSource =
+        "#version 120\n"
+        "uniform vec4 colour;\n"
+        "void main (void) { gl_FragColor = colour * nothing; }\n";
+
+// Update once a millisecond or so, as frames would, until a program's
+// generation or log changes, or a while has gone by.
+//
+static unsigned int runFrames (ShaderWatcher *watcher, unsigned int programIx) {
+    const WatchedProgram *program = &watcher->programs[programIx];
+    unsigned int generation = program->generation, swapped = 0;
+    const char *log = program->log.array;
+
+    for (unsigned int frame = 0; frame < 5000; frame++) {
+        swapped += updateShaderWatcher (watcher);
+        if (program->generation != generation || program->log.array != log)
+            break;
+        usleep (1000);
+    }
+
+    return swapped;
+}
+
+static void checkWatcher (void) {
+    writeFile (vertexPath, vertexSource);
+    writeFile (fragmentPath, fragmentSource);
+
+    const ShaderInfo infos[] = {
+        newShaderInfo (GL_VERTEX_SHADER, vertexPath, "vertex"),
+        newShaderInfo (GL_FRAGMENT_SHADER, fragmentPath, "fragment")
+    };
+
+    ShaderWatcher *watcher = newShaderWatcher ();
+    CHECK (watcher != NULL);
+
+    // 'position' is bound somewhere a driver wouldn't put it by itself.
+    const AttribBinding bindings[] = { {internString ("position"), 3} };
+
+    GLuint original = compileBoundShaderProgram (2, infos, 1, bindings);
+    unsigned int programIx = watchShaderProgram (watcher, original, 2, infos, 1, bindings);
+    unsigned int otherIx = watchShaderProgram
+        (watcher, compileShaderProgram (2, infos), 1, infos, 0, NULL);
+    CHECK (watchedProgram (watcher, programIx) == original);
+    CHECK (glGetAttribLocation (original, "position") == 3);
+
+    // Nothing changes, so nothing happens.
+    unsigned int swapped = 0;
+    for (unsigned int frame = 0; frame < 100; frame++)
+        swapped += updateShaderWatcher (watcher);
+    CHECK (swapped == 0 && watcher->batch == NULL);
+
+    // Nor does writing another file in the same directory.
+    writeFile (otherPath, "not a shader");
+    swapped = runFrames (watcher, programIx);
+    CHECK (swapped == 0 && watcher->programs[programIx].generation == 0);
+
+    // Writing a shader reloads the program that uses it, and no other.
+    writeFile (fragmentPath, dimSource);
+    swapped = runFrames (watcher, programIx);
+    CHECK (swapped == 1 && watcher->programs[programIx].generation == 1);
+    CHECK (watcher->programs[otherIx].generation == 0);
+
+    GLuint reloaded = watchedProgram (watcher, programIx);
+    CHECK (reloaded != original && !glIsProgram (original));
+    CHECK (glGetUniformLocation (reloaded, "dim") >= 0);
+
+    // It keeps its attributes where they were bound.
+    CHECK (glGetAttribLocation (reloaded, "position") == 3);
+
+    // A broken shader leaves the last good program, and its errors.
+    writeFile (fragmentPath, brokenSource);
+    swapped = runFrames (watcher, programIx);
+    CHECK (swapped == 0 && watcher->programs[programIx].generation == 1);
+    CHECK (watchedProgram (watcher, programIx) == reloaded && glIsProgram (reloaded));
+    CHECK (watcher->programs[programIx].log.length > 0);
+    CHECK (strstr (watcher->programs[programIx].log.array, fragmentPath) != NULL);
+
+    // Saving by renaming a new file over the old one works too, and clears
+    // the errors.
+    writeFile (tempPath, fragmentSource);
+    rename (tempPath, fragmentPath);
+    swapped = runFrames (watcher, programIx);
+    CHECK (swapped == 1 && watcher->programs[programIx].generation == 2);
+    CHECK (watcher->programs[programIx].log.length == 0);
+    CHECK (glGetUniformLocation (watchedProgram (watcher, programIx), "dim") < 0);
+
+    // A shader used by both programs reloads both, in one go.
+    writeFile (vertexPath, vertexSource);
+    swapped = runFrames (watcher, programIx);
+    if (watcher->programs[otherIx].generation == 0)
+        swapped += runFrames (watcher, otherIx);
+    CHECK (swapped == 2);
+    CHECK (watcher->programs[programIx].generation == 3 && watcher->programs[otherIx].generation == 1);
+
+    freeShaderWatcher (watcher);
+}
+
+int main (void) {
+    GLTestContext context = newGLTestContext ("TestShaderWatcher");
+
+    snprintf (directory, sizeof (directory), "/tmp/TestShaderWatcher.%d", (int) getpid ());
+    snprintf (vertexPath, sizeof (vertexPath), "%s/Vertex.glsl", directory);
+    snprintf (fragmentPath, sizeof (fragmentPath), "%s/Fragment.glsl", directory);
+    snprintf (otherPath, sizeof (otherPath), "%s/Other.txt", directory);
+    snprintf (tempPath, sizeof (tempPath), "%s/Fragment.glsl.new", directory);
+    mkdir (directory, 0755);
+
+    checkWatcher ();
+
+    unlink (vertexPath);
+    unlink (fragmentPath);
+    unlink (otherPath);
+    rmdir (directory);
+
+    freeGLTestContext (context);
+
+    return checkReport ();
+}
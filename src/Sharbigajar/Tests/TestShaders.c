@@ -9,8 +9,11 @@
 #include <GL/glew.h>
 
 #include "Effectno.h"
+#include "Name.h"
 #include "Text.h"
 #include "Backend/Shaders.h"
+#include "Backend/Reflection.h"
+#include "Backend/Uniforms.h"
 
 
 
@@ -70,7 +73,12 @@ int main (void) {
             , "A test fragment shader" )
     };
 
-    const GLuint program = compileShaderProgram (2, progInfo);
+    // Attributes have to be bound before the program's linked.
+    const AttribBinding bindings[] = {
+        {internString ("position"), 0}
+    };
+
+    const GLuint program = compileBoundShaderProgram (2, progInfo, 1, bindings);
 
     GLuint vertexArray;
     glGenVertexArrays (1, &vertexArray);
@@ -83,14 +91,10 @@ int main (void) {
     glBindBuffer (GL_ELEMENT_ARRAY_BUFFER   , indexBuffer   );
 
 
-    // Bind attributes and uniforms.
-    const AttribBinding bindings[] = {
-        {"position", 0}
-    };
-
-    bindAttribs (1, bindings, program);
-
-    GLuint uColour = glGetUniformLocation (program, "colour");
+    // Find the program's uniforms.
+    ProgramReflection reflection = reflectProgram (program);
+    UniformStore uniforms = newUniformStore (&reflection);
+    const Name colourName = internString ("colour");
 
 
     // Enter main loop.
@@ -101,7 +105,8 @@ int main (void) {
         float colour[4] = { 1.f, 1.f, 1.f, 1.f };
 
         glUseProgram (program);
-        glUniform4fv (uColour, 1, colour);
+        setUniform (&uniforms, colourName, colour);
+        uploadUniforms (&uniforms);
 
         float vertices[6] = {
             -0.5, -0.5,
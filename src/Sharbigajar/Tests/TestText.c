@@ -0,0 +1,219 @@
+
+// Sharbigajar.Tests.TestText
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "Effectno.h"
+#include "Text.h"
+#include "Tests/Check.h"
+
+
+
+static int textIs (Text text, const char string[]) {
+    return text.length == strlen (string) &&
+        memcmp (text.array, string, text.length) == 0;
+}
+
+static void checkBuilder (void) {
+    TextBuilder builder = newTextBuilder (4);
+    CHECK (builder.length == 0 && builder.array[0] == '\0');
+
+    appendStringToBuilder (&builder, "vec3 ");
+    appendToBuilder (&builder, textFromString ("position"));
+    appendCharToBuilder (&builder, ';');
+    CHECK (strcmp (builder.array, "vec3 position;") == 0);
+    CHECK (builder.capacity >= builder.length);
+
+    // Formatting that fits, and formatting that has to grow the builder.
+    builder.length = 0;
+    reserveBuilder (&builder, 64);
+    unsigned int capacity = builder.capacity;
+
+    formatToBuilder (&builder, "#version %d\n", 330);
+    CHECK (builder.capacity == capacity);
+    formatToBuilder (&builder, "%0200d", 7);
+    CHECK (builder.length == 13 + 200 && builder.capacity > capacity);
+    CHECK (strncmp (builder.array, "#version 330\n0000", 17) == 0);
+    CHECK (builder.array[builder.length - 1] == '7' && builder.array[builder.length] == '\0');
+
+    // Many small appends only grow the builder a few times.
+    TextBuilder lines = newTextBuilder (0);
+    unsigned int grows = 0;
+
+    for (unsigned int ix = 0; ix < 100000; ix++) {
+        capacity = lines.capacity;
+        formatToBuilder (&lines, "line %u\n", ix);
+        grows += lines.capacity != capacity;
+    }
+
+    CHECK (grows < 30);
+    CHECK (strncmp (lines.array + lines.length - 11, "line 99999\n", 11) == 0);
+    freeTextBuilder (lines);
+
+    Text text = buildText (builder);
+    CHECK (text.length == 213);
+    freeText (text);
+
+    text = concatText (textFromString ("abc"), textFromString ("def"));
+    CHECK (textIs (text, "abcdef") && text.array[6] == '\0');
+    freeText (text);
+}
+
+static void checkRope (void) {
+    TextRope rope = newTextRope ();
+    CHECK (textIs (flattenRope (&rope), ""));
+
+    appendToRope (&rope, textFromString ("uniform "));
+    appendToRope (&rope, textFromString (""));
+    appendToRope (&rope, textFromString ("mat4 view;"));
+    CHECK (rope.numPieces == 2 && rope.length == 18);
+
+    Text flat = flattenRope (&rope);
+    CHECK (textIs (flat, "uniform mat4 view;") && flat.array[flat.length] == '\0');
+    CHECK (rope.numPieces == 1);
+
+    // Flattening again is free, until something else is appended.
+    CHECK (flattenRope (&rope).array == flat.array);
+
+    TextRope tail = newTextRope ();
+    for (unsigned int ix = 0; ix < 100; ix++)
+        appendToRope (&tail, textFromString ("\n"));
+
+    appendRopeToRope (&rope, &tail);
+    CHECK (rope.numPieces == 101 && rope.length == 118);
+
+    flat = flattenRope (&rope);
+    CHECK (flat.length == 118 && strncmp (flat.array, "uniform mat4 view;\n\n", 20) == 0);
+    CHECK (flat.array[117] == '\n' && flat.array[118] == '\0');
+
+    freeTextRope (tail);
+    freeTextRope (rope);
+}
+
+// An allocator that gives out 'budget' allocations and then fails, as an
+// arena does when there's no memory for another block.
+//
+static void *budgetReallocate (void *state, void *old, size_t oldSize, size_t newSize) {
+    unsigned int *budget = (unsigned int *) state;
+    (void) oldSize;
+
+    if (newSize == 0) {
+        free (old);
+        return NULL;
+    }
+    if (*budget == 0)
+        return NULL;
+
+    (*budget)--;
+    return realloc (old, newSize);
+}
+
+// Running out of memory sets 'effectno', gives text with no array, and
+// leaves builders and ropes as they were.
+//
+static void checkOutOfMemory (void) {
+    unsigned int budget = 1;
+    Allocator allocator = { .reallocate = budgetReallocate, .state = &budget };
+
+    MutText mutText = newMutTextWith (allocator, 8);
+    CHECK (mutText.array != NULL);
+    freeMutTextWith (allocator, mutText);
+
+    effectno = AllOK;
+    CHECK (newMutTextWith (allocator, 8).array == NULL && effectno == StandardError);
+    CHECK (copyTextFromStringWith (allocator, "abc").array == NULL);
+    CHECK (concatTextWith (allocator, textFromString ("a"), textFromString ("b")).array == NULL);
+
+    TextBuilder builder = newTextBuilderWith (allocator, 16);
+    appendStringToBuilder (&builder, "lost");
+    appendCharToBuilder (&builder, ';');
+    formatToBuilder (&builder, "%d", 1);
+    CHECK (builder.array == NULL && buildText (builder).array == NULL);
+
+    budget = 1;
+    builder = newTextBuilderWith (allocator, 4);
+    appendStringToBuilder (&builder, "vec3");
+
+    effectno = AllOK;
+    appendStringToBuilder (&builder, " position");
+    formatToBuilder (&builder, "%0100d", 7);
+    CHECK (effectno == StandardError && strcmp (builder.array, "vec3") == 0);
+    freeTextBuilder (builder);
+
+    TextRope rope = newTextRopeWith (allocator);
+    appendToRope (&rope, textFromString ("uniform"));
+    CHECK (rope.numPieces == 0 && flattenRope (&rope).array == NULL);
+    freeTextRope (rope);
+}
+
+// Write 'size' characters of a pattern to a file.
+//
+static void writeFile (const char path[], unsigned int size) {
+    FILE *file = fopen (path, "wb");
+    for (unsigned int ix = 0; ix < size; ix++)
+        fputc ('a' + ix % 23, file);
+    fclose (file);
+}
+
+static int holdsPattern (Text text, unsigned int size) {
+    if (text.length != size || text.array[size] != '\0')
+        return 0;
+
+    for (unsigned int ix = 0; ix < size; ix++)
+        if (text.array[ix] != (char) ('a' + ix % 23))
+            return 0;
+
+    return 1;
+}
+
+// Files read or mapped come back the same, '\0'-terminated, whatever
+// their size, including sizes that are exactly whole pages.
+//
+static void checkFiles (void) {
+    char path[64];
+    snprintf (path, sizeof (path), "/tmp/TestText.%d", (int) getpid ());
+
+    const unsigned int sizes[] = { 0, 1, 1000, 4096, TEXT_MAP_MIN_SIZE - 1, TEXT_MAP_MIN_SIZE, 1000000 };
+
+    for (unsigned int ix = 0; ix < sizeof (sizes) / sizeof (sizes[0]); ix++) {
+        writeFile (path, sizes[ix]);
+
+        Text text = textFromFile (textFromString (path));
+        CHECK (holdsPattern (text, sizes[ix]));
+        freeText (text);
+
+        FileText fileText = mapTextFromFile (textFromString (path));
+        CHECK (holdsPattern (fileText.text, sizes[ix]));
+        CHECK ((fileText.mapSize != 0) == (sizes[ix] >= TEXT_MAP_MIN_SIZE));
+        freeFileText (fileText);
+    }
+
+    // A file read to a known size takes one allocation, with no trimming
+    unsigned int budget = 2;
+    Allocator allocator = { .reallocate = budgetReallocate, .state = &budget };
+    writeFile (path, 1000);
+
+    Text text = textFromFileWith (allocator, textFromString (path));
+    CHECK (holdsPattern (text, 1000) && budget == 1);
+    freeTextWith (allocator, text);
+
+    unlink (path);
+
+    effectno = AllOK;
+    CHECK (textFromFile (textFromString (path)).array == NULL && effectno == IOError);
+
+    effectno = AllOK;
+    CHECK (mapTextFromFile (textFromString (path)).text.array == NULL && effectno == IOError);
+}
+
+int main (void) {
+    checkBuilder ();
+    checkRope ();
+    checkOutOfMemory ();
+    checkFiles ();
+
+    return checkReport ();
+}
@@ -0,0 +1,237 @@
+
+// Sharbigajar.Tests.TestUniforms
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <SDL2/SDL.h>
+#include <GL/glew.h>
+
+#include "Effectno.h"
+#include "Name.h"
+#include "Text.h"
+#include "Backend/Shaders.h"
+#include "Backend/Reflection.h"
+#include "Backend/Uniforms.h"
+#include "Tests/Check.h"
+#include "Tests/GLTest.h"
+
+
+
+// Shaders are written to a temporary directory, with a GL context on a
+// hidden window. Uniform blocks need GLSL 1.40.
+
+static char directory[64], vertexPath[96], fragmentPath[96];
+
+#define FRAME_BLOCK                                                     \
+    "layout (std140) uniform Frame {\n"                                 \
+    "    mat4 view;\n"                                                  \
+    "    vec4 tint[2];\n"                                               \
+    "    float time;\n"                                                 \
+    "};\n"
+
+static const char
+    *vertexSource =
+        "#version 140\n"
+        FRAME_BLOCK
+        "in vec2 position;\n"
+        "in vec4 extra;\n"
+        "uniform vec2 offset;\n"
+        "void main (void) {\n"
+        "    gl_Position = view * vec4 (position + offset + extra.xy, 0, 1);\n"
+        "}\n",
+    *fragmentSource =
+        "#version 140\n"
+        FRAME_BLOCK
+        "uniform vec4 colour;\n"
+        "uniform float weights[3];\n"
+        "uniform int mode;\n"
+        "out vec4 fragColour;\n"
+        "void main (void) {\n"
+        "    fragColour = colour * weights[mode] * tint[1] * time;\n"
+        "}\n";
+
+static void checkReflection (const ShaderInfo infos[]) {
+    const AttribBinding bindings[] = {
+        {internString ("position"), 3},
+        {internString ("extra"), 5}
+    };
+
+    // Attributes are bound before linking, so the bindings hold.
+    GLuint program = compileBoundShaderProgram (2, infos, 2, bindings);
+    ProgramReflection reflection = reflectProgram (program);
+
+    CHECK (reflection.numAttribs == 2);
+    CHECK (findAttrib (&reflection, bindings[0].name)->location == 3);
+    CHECK (findAttrib (&reflection, bindings[1].name)->location == 5);
+    CHECK (findAttrib (&reflection, internString ("colour")) == NULL);
+
+    // Binding in a program that's linked already doesn't work, and says so.
+    bindAttribs (2, bindings, program);
+    CHECK (effectno == StandardError);
+
+    const ProgramUniform
+        *colour = findUniform (&reflection, internString ("colour")),
+        *weights = findUniform (&reflection, internString ("weights")),
+        *view = findUniform (&reflection, internString ("view")),
+        *tint = findUniform (&reflection, internString ("tint")),
+        *time = findUniform (&reflection, internString ("time"));
+
+    CHECK (colour && colour->type == GL_FLOAT_VEC4 && colour->location >= 0 && colour->block == -1);
+    CHECK (weights && weights->size == 3 && weights->location >= 0);
+
+    // Block members have no location, but a place in the block.
+    const ProgramBlock *frame = findBlock (&reflection, internString ("Frame"));
+    CHECK (reflection.numBlocks == 1 && frame && frame->size >= 100);
+
+    CHECK (view && frame && view->location == -1 && view->block == (GLint) frame->index);
+    CHECK (view && view->offset == 0 && view->matrixStride == 16);
+    CHECK (tint && tint->size == 2 && tint->offset == 64 && tint->arrayStride == 16);
+    CHECK (time && time->offset == 96);
+
+    freeProgramReflection (reflection);
+    glDeleteProgram (program);
+}
+
+static void checkStore (const ShaderInfo infos[]) {
+    GLuint program = compileShaderProgram (2, infos);
+    ProgramReflection reflection = reflectProgram (program);
+    UniformStore store = newUniformStore (&reflection);
+
+    const Name
+        colourName = internString ("colour"),
+        weightsName = internString ("weights"),
+        modeName = internString ("mode");
+
+    // Block members and unknown names aren't in the store.
+    CHECK (store.numSlots == 4);
+    CHECK (!setUniform (&store, internString ("view"), (float [16]) {0}));
+    CHECK (!setUniform (&store, internString ("TestUniforms.nothing"), (float [4]) {0}));
+
+    glUseProgram (program);
+
+    // Nothing's uploaded until it's set, and then only once it changes.
+    CHECK (uploadUniforms (&store) == 0);
+
+    const float white[4] = {1, 1, 1, 1}, red[4] = {1, 0, 0, 1};
+    CHECK (setUniform (&store, colourName, white));
+    CHECK (uploadUniforms (&store) == 1);
+
+    for (unsigned int frame = 0; frame < 10; frame++)
+        setUniform (&store, colourName, white);
+    CHECK (uploadUniforms (&store) == 0);
+
+    setUniform (&store, colourName, red);
+    setUniform (&store, weightsName, (float [3]) {0.25f, 0.5f, 0.75f});
+    setUniform (&store, modeName, (GLint [1]) {2});
+    CHECK (uploadUniforms (&store) == 3);
+    CHECK (uploadUniforms (&store) == 0);
+
+    float value[4] = {0};
+    glGetUniformfv (program, glGetUniformLocation (program, "colour"), value);
+    CHECK (memcmp (value, red, sizeof (red)) == 0);
+    glGetUniformfv (program, glGetUniformLocation (program, "weights[2]"), value);
+    CHECK (value[0] == 0.75f);
+
+    GLint mode = 0;
+    glGetUniformiv (program, glGetUniformLocation (program, "mode"), &mode);
+    CHECK (mode == 2);
+
+    glUseProgram (0);
+
+    freeUniformStore (store);
+    freeProgramReflection (reflection);
+    glDeleteProgram (program);
+}
+
+static void checkBuffer (const ShaderInfo infos[]) {
+    GLuint program = compileShaderProgram (2, infos), other = compileShaderProgram (2, infos);
+    ProgramReflection reflection = reflectProgram (program), otherReflection = reflectProgram (other);
+
+    const Name frameName = internString ("Frame");
+
+    UniformBuffer buffer = newUniformBuffer (&reflection, frameName, 1);
+    CHECK (buffer.buffer != 0 && buffer.numMembers == 3);
+    CHECK (bindUniformBlock (&otherReflection, frameName, 1));
+
+    GLint binding = -1;
+    glGetActiveUniformBlockiv
+        (other, findBlock (&otherReflection, frameName)->index, GL_UNIFORM_BLOCK_BINDING, &binding);
+    CHECK (binding == 1);
+
+    // It starts out uploaded once, and then only when it changes.
+    CHECK (uploadUniformBuffer (&buffer) == 1);
+    CHECK (uploadUniformBuffer (&buffer) == 0);
+
+    float view[16], tint[8];
+    for (unsigned int ix = 0; ix < 16; ix++)
+        view[ix] = ix;
+    for (unsigned int ix = 0; ix < 8; ix++)
+        tint[ix] = ix * 0.5f;
+    const float time = 42;
+
+    CHECK (setBufferUniform (&buffer, internString ("view"), view));
+    CHECK (setBufferUniform (&buffer, internString ("tint"), tint));
+    CHECK (setBufferUniform (&buffer, internString ("time"), &time));
+    CHECK (!setBufferUniform (&buffer, internString ("colour"), view));
+    CHECK (uploadUniformBuffer (&buffer) == 1);
+
+    setBufferUniform (&buffer, internString ("view"), view);
+    setBufferUniform (&buffer, internString ("time"), &time);
+    CHECK (uploadUniformBuffer (&buffer) == 0);
+
+    // The members are where the block says, in what GL has.
+    float data[28];
+    glBindBuffer (GL_UNIFORM_BUFFER, buffer.buffer);
+    glGetBufferSubData (GL_UNIFORM_BUFFER, 0, sizeof (data), data);
+    glBindBuffer (GL_UNIFORM_BUFFER, 0);
+
+    CHECK (memcmp (data, view, sizeof (view)) == 0);
+    CHECK (memcmp (data + 16, tint, sizeof (tint)) == 0);
+    CHECK (data[24] == time);
+
+    freeUniformBuffer (buffer);
+
+    buffer = newUniformBuffer (&reflection, internString ("NoSuchBlock"), 2);
+    CHECK (buffer.buffer == 0 && effectno == StandardError);
+    CHECK (uploadUniformBuffer (&buffer) == 0);
+    freeUniformBuffer (buffer);
+
+    freeProgramReflection (reflection);
+    freeProgramReflection (otherReflection);
+    glDeleteProgram (program);
+    glDeleteProgram (other);
+}
+
+int main (void) {
+    GLTestContext context = newGLTestContext ("TestUniforms");
+
+    snprintf (directory, sizeof (directory), "/tmp/TestUniforms.%d", (int) getpid ());
+    snprintf (vertexPath, sizeof (vertexPath), "%s/Vertex.glsl", directory);
+    snprintf (fragmentPath, sizeof (fragmentPath), "%s/Fragment.glsl", directory);
+    mkdir (directory, 0755);
+
+    writeFile (vertexPath, vertexSource);
+    writeFile (fragmentPath, fragmentSource);
+
+    const ShaderInfo infos[] = {
+        newShaderInfo (GL_VERTEX_SHADER, vertexPath, "vertex"),
+        newShaderInfo (GL_FRAGMENT_SHADER, fragmentPath, "fragment")
+    };
+
+    checkReflection (infos);
+    checkStore (infos);
+    checkBuffer (infos);
+
+    unlink (vertexPath);
+    unlink (fragmentPath);
+    rmdir (directory);
+
+    freeGLTestContext (context);
+
+    return checkReport ();
+}
@@ -1,10 +1,18 @@
 
 // Sharbigajar.Text
 
+#include <limits.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Allocator.h"
 #include "Effectno.h"
 #include "Text.h"
 
@@ -14,8 +22,16 @@
 // Create a new empty text object with space for 'n' characters.
 //
 MutText newMutText (unsigned int n) {
-    char *array = (char *) malloc (n * sizeof (char));
-    
+    return newMutTextWith (heapAllocator, n);
+}
+
+MutText newMutTextWith (Allocator allocator, unsigned int n) {
+    char *array = (char *) allocMemory (allocator, n * sizeof (char));
+    if (!array) {
+        effectno = StandardError;
+        return (MutText) {0, 0};
+    }
+
     array[0] = '\0';
 
     return (MutText) {
@@ -25,7 +41,13 @@ MutText newMutText (unsigned int n) {
 }
 
 void freeMutText (MutText mutText) {
-    free (mutText.array);
+    freeMutTextWith (heapAllocator, mutText);
+}
+
+// Free a mutable text object made with an allocator.
+//
+void freeMutTextWith (Allocator allocator, MutText mutText) {
+    freeMemory (allocator, mutText.array, mutText.length * sizeof (char));
 }
 
 
@@ -42,7 +64,13 @@ Text solidifyText (MutText mutText) {
 // Free a text object.
 //
 void freeText (Text text) {
-    free (text.array);
+    free ((void *) text.array);
+}
+
+// Free a text object made with an allocator.
+//
+void freeTextWith (Allocator allocator, Text text) {
+    freeMemory (allocator, (void *) text.array, (text.length + 1) * sizeof (char));
 }
 
 
@@ -58,32 +86,39 @@ Text textFromString (const char string[]) {
 // Copy the contents of a string to a text object.
 //
 Text copyTextFromString (const char string[]) {
+    return copyTextFromStringWith (heapAllocator, string);
+}
+
+Text copyTextFromStringWith (Allocator allocator, const char string[]) {
     unsigned int length = strlen (string);
-    MutText mutText = newMutText (length + 1);
+    MutText mutText = newMutTextWith (allocator, length + 1);
+    if (!mutText.array)
+        return (Text) {0, 0};
 
     memcpy (mutText.array, string, length * sizeof (char));
     mutText.array[length] = '\0';
+    mutText.length = length;
 
     return solidifyText (mutText);
 }
 
 
-// Concatenate two text objects together.
+// Concatenate two text objects together into a new one.
+//
+// Joining more than two pieces this way copies the text built so far
+// every time, so use a 'TextBuilder' or a 'TextRope' for that.
 //
 Text concatText (Text fst, Text snd) {
-    unsigned int
-        fstLen = fst.length,
-        sndLen = snd.length,
-        newLen = fstLen + sndLen;
+    return concatTextWith (heapAllocator, fst, snd);
+}
 
-    MutText mutText = newMutText (newLen);
+Text concatTextWith (Allocator allocator, Text fst, Text snd) {
+    TextBuilder builder = newTextBuilderWith (allocator, fst.length + snd.length);
 
-    void *p = mutText.array;
-    memcpy (p, fst.array, fstLen * sizeof (char));
-    p += fstLen * sizeof (char);
-    memcpy (p, snd.array, sndLen * sizeof (char));
+    appendToBuilder (&builder, fst);
+    appendToBuilder (&builder, snd);
 
-    return solidifyText (mutText);
+    return buildText (builder);
 }
 
 // Append a string to the end of a text object.
@@ -93,33 +128,424 @@ Text appendText (Text fst, const char string[]) {
 }
 
 
-// Read the contents of a file to a text object.
+// Hash a text object's contents, eight characters at a time.
 //
-Text textFromFile (Text filename) {
-    FILE *fp = fopen(filename.array, "r");
-    if (!fp) {
+// Each step folds the next eight characters in and multiplies them by a
+// constant, keeping both halves of the 128-bit product, and a last mix
+// spreads the final characters over every bit. That's the same on every
+// run of the same build, so the hash can go into files, but not between
+// machines of different byte orders.
+//
+static uint64_t mixHash (uint64_t a, uint64_t b) {
+    unsigned __int128 product = (unsigned __int128) a * b;
+    return (uint64_t) product ^ (uint64_t) (product >> 64);
+}
+
+uint64_t hashText (Text text) {
+    const uint64_t k0 = 0xa0761d6478bd642full, k1 = 0xe7037ed1a0b428dbull;
+
+    const char *p = text.array;
+    unsigned int n = text.length;
+    uint64_t h = k0 ^ n;
+
+    for (; n >= 8; p += 8, n -= 8) {
+        uint64_t word;
+        memcpy (&word, p, 8);
+        h = mixHash (h ^ word, k1);
+    }
+
+    uint64_t tail = 0;
+    if (n)
+        memcpy (&tail, p, n);
+
+    return mixHash (mixHash (h ^ tail, k1), k0 ^ text.length);
+}
+
+int textEquals (Text fst, Text snd) {
+    return fst.length == snd.length
+        && (fst.length == 0 || memcmp (fst.array, snd.array, fst.length * sizeof (char)) == 0);
+}
+
+
+// Open a file for reading and find out how big it is, or set 'effectno'
+// and return -1. 'size' is 0 for anything but a regular file, since
+// pipes and the like don't know their size up front.
+//
+static int openTextFile (Text filename, unsigned int *size) {
+    struct stat status;
+    int fd = open (filename.array, O_RDONLY);
+
+    if (fd < 0 || fstat (fd, &status) != 0 || status.st_size >= UINT_MAX) {
+        if (fd >= 0)
+            close (fd);
         effectno = IOError;
+        return -1;
+    }
+
+    *size = S_ISREG (status.st_mode) ? (unsigned int) status.st_size : 0;
+    return fd;
+}
+
+// Read everything left in a file into a new text object, expecting
+// 'size' characters. With the right size, that's a single allocation
+// the size of the file and its '\0', and a single read, plus one more
+// read to see the end of the file.
+//
+static Text readTextFile (Allocator allocator, int fd, unsigned int size) {
+    TextBuilder builder = newTextBuilderWith (allocator, size ? size : 4096);
+    if (!builder.array)
         return (Text) {0, 0};
+
+    ssize_t count;
+
+    do {
+        if (builder.length < builder.capacity) {
+            count = read (fd, builder.array + builder.length, builder.capacity - builder.length);
+        }
+        else {
+            // Full, so only grow if there turns out to be more
+            char more[256];
+            count = read (fd, more, sizeof (more));
+            if (count > 0) {
+                if (!reserveBuilder (&builder, count))
+                    break;
+                memcpy (builder.array + builder.length, more, count);
+            }
+        }
+
+        if (count > 0)
+            builder.length += count;
+    } while (count > 0);
+
+    // A failed read, or no memory to go on with
+    if (count != 0) {
+        freeTextBuilder (builder);
+        if (count < 0)
+            effectno = IOError;
+        return (Text) {0, 0};
+    }
+
+    builder.array[builder.length] = '\0';
+
+    return buildText (builder);
+}
+
+// Read the contents of a file to a text object, followed by a '\0'.
+//
+Text textFromFile (Text filename) {
+    return textFromFileWith (heapAllocator, filename);
+}
+
+Text textFromFileWith (Allocator allocator, Text filename) {
+    unsigned int size;
+    int fd = openTextFile (filename, &size);
+    if (fd < 0)
+        return (Text) {0, 0};
+
+    Text text = readTextFile (allocator, fd, size);
+    close (fd);
+
+    return text;
+}
+
+
+// type TextBuilder
+
+// Create a new empty text builder with room for 'n' characters.
+//
+TextBuilder newTextBuilder (unsigned int n) {
+    return newTextBuilderWith (heapAllocator, n);
+}
+
+TextBuilder newTextBuilderWith (Allocator allocator, unsigned int n) {
+    char *array = (char *) allocMemory (allocator, (n + 1) * sizeof (char));
+    if (!array) {
+        effectno = StandardError;
+        return (TextBuilder) {
+            .array      = NULL,
+            .length     = 0,
+            .capacity   = 0,
+            .allocator  = allocator
+        };
+    }
+
+    array[0] = '\0';
+
+    return (TextBuilder) {
+        .array      = array,
+        .length     = 0,
+        .capacity   = n,
+        .allocator  = allocator
+    };
+}
+
+void freeTextBuilder (TextBuilder builder) {
+    freeMemory (builder.allocator, builder.array, (builder.capacity + 1) * sizeof (char));
+}
+
+// Make sure a text builder has room for 'n' more characters. Returns 0,
+// leaving the builder as it was, if there's no memory for them.
+//
+int reserveBuilder (TextBuilder *builder, unsigned int n) {
+    unsigned int needed = builder->length + n;
+    if (needed <= builder->capacity && builder->array)
+        return 1;
+
+    unsigned int capacity = builder->capacity * 2;
+    if (capacity < needed)
+        capacity = needed;
+
+    char *array = (char *) reallocMemory
+        ( builder->allocator, builder->array
+        , builder->array ? (builder->capacity + 1) * sizeof (char) : 0
+        , (capacity + 1) * sizeof (char) );
+
+    if (!array) {
+        effectno = StandardError;
+        return 0;
+    }
+
+    if (!builder->array)
+        array[0] = '\0';
+
+    builder->array = array;
+    builder->capacity = capacity;
+    return 1;
+}
+
+// Append text to the end of a text builder.
+//
+void appendToBuilder (TextBuilder *builder, Text text) {
+    if (!reserveBuilder (builder, text.length))
+        return;
+
+    memcpy (builder->array + builder->length, text.array, text.length * sizeof (char));
+    builder->length += text.length;
+    builder->array[builder->length] = '\0';
+}
+
+void appendStringToBuilder (TextBuilder *builder, const char string[]) {
+    appendToBuilder (builder, textFromString (string));
+}
+
+void appendCharToBuilder (TextBuilder *builder, char c) {
+    if (!reserveBuilder (builder, 1))
+        return;
+
+    builder->array[builder->length++] = c;
+    builder->array[builder->length] = '\0';
+}
+
+// Append 'printf'-style formatted text to the end of a text builder,
+// formatting straight into its array. Only when that runs out of room
+// does it grow and format again.
+//
+void formatToBuilder (TextBuilder *builder, const char format[], ...) {
+    if (!reserveBuilder (builder, 0))
+        return;
+
+    va_list args, retry;
+    va_start (args, format);
+    va_copy (retry, args);
+
+    unsigned int room = builder->capacity - builder->length;
+    int n = vsnprintf (builder->array + builder->length, room + 1, format, args);
+
+    if (n > 0 && (unsigned int) n > room) {
+        if (reserveBuilder (builder, n)) {
+            vsnprintf (builder->array + builder->length, n + 1, format, retry);
+        }
+        else {
+            // Take back what didn't fit the first time.
+            builder->array[builder->length] = '\0';
+            n = 0;
+        }
     }
 
-    unsigned int
-        size    = 1024,
-        total   = 0,
-        count;
-    char *buf = (char *) malloc (size);
-
-    while ((count = fread (buf + total, 1, size - total, fp))) {
-        total += count;
-        if (total == size) {
-            size += 1024;
-            buf = (char *) realloc (buf, size);
+    if (n > 0)
+        builder->length += n;
+
+    va_end (retry);
+    va_end (args);
+}
+
+// Turn a text builder into an immutable text object, handing over its
+// array, trimmed to fit. A builder that never got any memory gives a
+// text with no array.
+//
+Text buildText (TextBuilder builder) {
+    if (builder.array && builder.capacity > builder.length) {
+        char *array = (char *) reallocMemory
+            ( builder.allocator, builder.array
+            , (builder.capacity + 1) * sizeof (char), (builder.length + 1) * sizeof (char) );
+
+        // Trimming can only fail by keeping the whole array.
+        if (array)
+            builder.array = array;
+    }
+
+    return (Text) {
+        .array  = builder.array,
+        .length = builder.length
+    };
+}
+
+
+// type TextRope
+
+TextRope newTextRope (void) {
+    return newTextRopeWith (heapAllocator);
+}
+
+TextRope newTextRopeWith (Allocator allocator) {
+    return (TextRope) {
+        .pieces     = NULL,
+        .numPieces  = 0,
+        .maxPieces  = 0,
+        .length     = 0,
+        .flat       = NULL,
+        .flatLength = 0,
+        .allocator  = allocator
+    };
+}
+
+// Free a rope's piece list and its flattened text, if it has one. The
+// pieces themselves belong to whoever appended them.
+//
+void freeTextRope (TextRope rope) {
+    freeMemory (rope.allocator, rope.pieces, rope.maxPieces * sizeof (Text));
+    freeMemory (rope.allocator, rope.flat, (rope.flatLength + 1) * sizeof (char));
+}
+
+// Append a piece to the end of a rope, without copying it.
+//
+void appendToRope (TextRope *rope, Text text) {
+    if (text.length == 0)
+        return;
+
+    if (rope->numPieces == rope->maxPieces) {
+        unsigned int maxPieces = rope->maxPieces ? rope->maxPieces * 2 : 8;
+
+        Text *pieces = (Text *) reallocMemory
+            ( rope->allocator, rope->pieces
+            , rope->maxPieces * sizeof (Text), maxPieces * sizeof (Text) );
+
+        if (!pieces) {
+            effectno = StandardError;
+            return;
         }
+
+        rope->pieces = pieces;
+        rope->maxPieces = maxPieces;
+    }
+
+    rope->pieces[rope->numPieces++] = text;
+    rope->length += text.length;
+}
+
+// Append all of one rope's pieces to the end of another. The second
+// rope has to outlive the first if it owns a flattened piece.
+//
+void appendRopeToRope (TextRope *rope, const TextRope *other) {
+    for (unsigned int pieceIx = 0; pieceIx < other->numPieces; pieceIx++)
+        appendToRope (rope, other->pieces[pieceIx]);
+}
+
+// Get the whole text of a rope in one array, followed by a '\0'.
+//
+// The first time, and after anything's been appended since, the pieces
+// are copied into one new array, which replaces them all.
+//
+Text flattenRope (TextRope *rope) {
+    if (rope->flat && rope->numPieces == 1)
+        return rope->pieces[0];
+
+    char *flat = (char *) allocMemory (rope->allocator, (rope->length + 1) * sizeof (char));
+    if (!flat) {
+        effectno = StandardError;
+        return (Text) {0, 0};
+    }
+
+    char *p = flat;
+
+    for (unsigned int pieceIx = 0; pieceIx < rope->numPieces; pieceIx++) {
+        memcpy (p, rope->pieces[pieceIx].array, rope->pieces[pieceIx].length * sizeof (char));
+        p += rope->pieces[pieceIx].length;
     }
 
-    MutText mutText = {
-        .array  = buf,
-        .length = total
+    *p = '\0';
+
+    freeMemory (rope->allocator, rope->flat, (rope->flatLength + 1) * sizeof (char));
+    rope->flat = flat;
+    rope->flatLength = rope->length;
+
+    Text text = {
+        .array  = flat,
+        .length = rope->length
     };
 
-    return solidifyText (mutText);
+    rope->numPieces = 0;
+    rope->length = 0;
+    appendToRope (rope, text);
+
+    return text;
+}
+
+
+// type FileText
+
+// Size of a file's mapping: the file, and at least one more byte, rounded
+// up to whole pages.
+//
+static size_t fileMapSize (unsigned int length) {
+    size_t page = (size_t) sysconf (_SC_PAGESIZE);
+    return ((size_t) length + page) / page * page;
+}
+
+// Get the contents of a file as a read-only text object, followed by a
+// '\0', without copying them if the file's big enough.
+//
+// The mapping is first reserved as zeroed anonymous memory, one byte
+// bigger than the file, and the file mapped over the start of it. So
+// the '\0' on the end is there even when the file fills its last page.
+//
+FileText mapTextFromFile (Text filename) {
+    unsigned int size;
+    int fd = openTextFile (filename, &size);
+    if (fd < 0)
+        return (FileText) { {0, 0}, 0 };
+
+    if (size < TEXT_MAP_MIN_SIZE) {
+        FileText fileText = { readTextFile (heapAllocator, fd, size), 0 };
+        close (fd);
+        return fileText;
+    }
+
+    size_t mapSize = fileMapSize (size);
+    void *base = mmap (NULL, mapSize, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (base == MAP_FAILED ||
+        mmap (base, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        if (base != MAP_FAILED)
+            munmap (base, mapSize);
+        close (fd);
+        effectno = IOError;
+        return (FileText) { {0, 0}, 0 };
+    }
+
+    close (fd);
+
+    return (FileText) {
+        .text       = { .array = (const char *) base, .length = size },
+        .mapSize    = mapSize
+    };
+}
+
+// Unmap or free a file's text, whichever 'mapTextFromFile' did.
+//
+void freeFileText (FileText fileText) {
+    if (fileText.mapSize)
+        munmap ((void *) fileText.text.array, fileText.mapSize);
+    else
+        free ((void *) fileText.text.array);
 }
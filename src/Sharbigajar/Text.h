@@ -2,6 +2,21 @@
 #ifndef SHARBIGAJAR_TEXT_H
 #define SHARBIGAJAR_TEXT_H
 
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Allocator.h"
+
+// Text objects are allocated from the heap, or from any allocator with
+// the '...With' versions of the functions that make them. Those have to
+// be freed with the same allocator, if they're freed at all rather than
+// going with an arena reset.
+//
+// When an allocation fails, 'effectno' is set to 'StandardError', and
+// what would have been made has no array, as when a file can't be read.
+// A builder or rope that can't grow is left as it was.
+//
+
 // Mutable text object.
 //
 typedef struct MutText MutText;
@@ -12,7 +27,9 @@ struct MutText {
 };
 
 MutText newMutText (unsigned int);
+MutText newMutTextWith (Allocator, unsigned int);
 void freeMutText (MutText);
+void freeMutTextWith (Allocator, MutText);
 
 
 // Immutable text object.
@@ -26,17 +43,109 @@ struct Text {
 
 Text solidifyText (MutText);
 void freeText (Text);
+void freeTextWith (Allocator, Text);
 
 
 Text textFromString (const char []);
 Text copyTextFromString (const char []);
+Text copyTextFromStringWith (Allocator, const char []);
 
 
 Text concatText (Text, Text);
+Text concatTextWith (Allocator, Text, Text);
 Text appendText (Text, const char []);
 
 
+uint64_t hashText (Text);
+int textEquals (Text, Text);
+
+
 Text textFromFile (Text);
+Text textFromFileWith (Allocator, Text);
+
+
+// Text of a file, from 'mapTextFromFile'. Files of at least
+// 'TEXT_MAP_MIN_SIZE' bytes are mapped into memory rather than read,
+// and 'mapSize' is the size of the mapping; smaller ones are read like
+// 'textFromFile' does, and 'mapSize' is 0. Either way, 'freeFileText'
+// gets rid of it.
+//
+#define TEXT_MAP_MIN_SIZE (64 * 1024)
+
+typedef struct FileText FileText;
+
+struct FileText {
+    Text text;
+    size_t mapSize;
+};
+
+FileText mapTextFromFile (Text);
+void freeFileText (FileText);
+
+
+// Growable text, for building text up piece by piece.
+//
+// 'length' characters are in use out of 'capacity', and a '\0' always
+// follows them. Whenever an append runs out of room the capacity at
+// least doubles, so building a text of 'n' characters copies each one a
+// constant number of times on average, however many pieces it's made of.
+//
+typedef struct TextBuilder TextBuilder;
+
+struct TextBuilder {
+    char *array;
+    unsigned int length;
+    unsigned int capacity;
+
+    Allocator allocator;
+};
+
+TextBuilder newTextBuilder (unsigned int);
+TextBuilder newTextBuilderWith (Allocator, unsigned int);
+void freeTextBuilder (TextBuilder);
+
+int reserveBuilder (TextBuilder *, unsigned int);
+
+void appendToBuilder (TextBuilder *, Text);
+void appendStringToBuilder (TextBuilder *, const char []);
+void appendCharToBuilder (TextBuilder *, char);
+void formatToBuilder (TextBuilder *, const char [], ...)
+    __attribute__ ((format (printf, 2, 3)));
+
+Text buildText (TextBuilder);
+
+
+// Text assembled from pieces without copying them, for very large texts
+// like shader sources and logs.
+//
+// The pieces are borrowed, and have to outlive the rope. Only when
+// something needs the whole text in one array does 'flattenRope' copy
+// them into one, which the rope then owns and uses as its only piece.
+// Where an API takes a list of pieces anyway, like 'glShaderSource',
+// the pieces can be passed straight through.
+//
+typedef struct TextRope TextRope;
+
+struct TextRope {
+    Text *pieces;
+    unsigned int numPieces;
+    unsigned int maxPieces;
+
+    unsigned int length;
+    char *flat;
+    unsigned int flatLength;
+
+    Allocator allocator;
+};
+
+TextRope newTextRope (void);
+TextRope newTextRopeWith (Allocator);
+void freeTextRope (TextRope);
+
+void appendToRope (TextRope *, Text);
+void appendRopeToRope (TextRope *, const TextRope *);
+
+Text flattenRope (TextRope *);
 
 #endif
 
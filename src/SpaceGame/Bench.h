@@ -0,0 +1,107 @@
+
+// SpaceGame.Bench
+
+#ifndef SPACE_GAME_BENCH_H
+#define SPACE_GAME_BENCH_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Shared helpers for the test and benchmark programs.
+
+
+
+// Deterministic pseudo-random numbers (splitmix64), so that every test
+// run sees exactly the same inputs.
+//
+static inline uint64_t nextRandom (uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Checks for the test programs. 'CHECK' counts and reports a condition
+// that doesn't hold, and 'checkReport' prints the count at the end and
+// gives the program's exit status.
+//
+static unsigned int failures = 0;
+
+#define CHECK(cond)                                                     \
+    do {                                                                \
+        if (!(cond)) {                                                  \
+            failures++;                                                 \
+            printf ("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);     \
+        }                                                               \
+    } while (0)
+
+static inline int checkReport (void) {
+    printf ("%s: %u failures\n", failures ? "FAIL" : "OK", failures);
+    return failures != 0;
+}
+
+// Monotonic wall-clock time in nanoseconds.
+//
+static inline double benchNow (void) {
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Print a string as a JSON string literal.
+//
+static inline void benchPrintJsonString (const char s[]) {
+    printf ("\"");
+    for (const char *c = s; *c; c++)
+        printf (*c == '"' || *c == '\\' ? "\\%c" : "%c", *c);
+    printf ("\"");
+}
+
+// Report the cost of 'ops' operations that took 'ns' nanoseconds, when
+// run over arrays of 'batch' elements at a time, or 0 if that doesn't
+// apply.
+//
+// Reports are a table for reading by default. With 'BENCH_FORMAT=json'
+// in the environment, each is one JSON object per line instead, for
+// scripts to compare across commits; 'BENCH_LABEL', say a commit hash,
+// is copied into every one of them.
+//
+static inline void benchReportBatch (const char name[], unsigned int batch, double ns, uint64_t ops) {
+    const char
+        *format = getenv ("BENCH_FORMAT"),
+        *label  = getenv ("BENCH_LABEL");
+
+    if (!format || strcmp (format, "json") != 0) {
+        char column[64];
+        snprintf (column, sizeof (column), batch ? "%s [%u]" : "%s", name, batch);
+        printf ("%-32s %10.3f ns/op\n", column, ns / ops);
+        return;
+    }
+
+    printf ("{\"name\": ");
+    benchPrintJsonString (name);
+
+    printf
+        ( ", \"batch\": %u, \"ops\": %llu, \"ns_per_op\": %.4f, \"ops_per_sec\": %.6g"
+        , batch, (unsigned long long) ops, ns / ops, ops / ns * 1e9 );
+
+    if (label) {
+        printf (", \"label\": ");
+        benchPrintJsonString (label);
+    }
+
+    printf ("}\n");
+}
+
+static inline void benchReport (const char name[], double ns, uint64_t ops) {
+    benchReportBatch (name, 0, ns, ops);
+}
+
+// Keep the optimiser from throwing away benchmarked results.
+//
+static volatile uint64_t benchSink;
+
+#endif
@@ -0,0 +1,107 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Bench.h"
+#include "FixedPrecision.h"
+#include "Newtonian.h"
+#include "BodySystem.h"
+#include "CameraSpace.h"
+
+
+
+// Benchmark for camera-relative positions: a frame's worth of 100k
+// bodies written into an instance buffer with each kernel, as floats and
+// as halves, against converting every body one at a time with
+// 'fpToFloat'.
+
+#define NUM_BODIES 100000
+#define NUM_FRAMES 200
+
+// Instance layout of a typical renderer: position, then a colour.
+//
+typedef struct Instance Instance;
+
+struct Instance {
+    float position[3];
+    uint32_t colour;
+};
+
+static BodySystem randomSystem (void) {
+    BodySystem system = newBodySystem (NUM_BODIES);
+    uint64_t seed = 42;
+
+    for (unsigned int ix = 0; ix < NUM_BODIES; ix++) {
+        Newtonian newt = {
+            .mass = fpFromInt (1),
+            .position = {
+                newFixedPrec ((int64_t) (nextRandom (&seed) % 4000000000) - 2000000000, nextRandom (&seed)),
+                newFixedPrec ((int64_t) (nextRandom (&seed) % 4000000000) - 2000000000, nextRandom (&seed)),
+                newFixedPrec ((int64_t) (nextRandom (&seed) % 4000000) - 2000000, nextRandom (&seed))
+            }
+        };
+
+        addBody (&system, newt);
+    }
+
+    return system;
+}
+
+static void benchKernel (const char name[], const BodySystem *system, VertexFormat format, CameraKernel kernel) {
+    if (bestCameraKernel (kernel) != kernel)
+        return;
+
+    Instance *instances = calloc (NUM_BODIES, sizeof (Instance));
+    CameraTarget target = { instances, sizeof (Instance), format, 1e-6 };
+    Vec3FixedPrec camera = { newFixedPrec (149597870, 0), fpFromInt (0), fpFromInt (0) };
+
+    double start = benchNow ();
+    for (unsigned int frame = 0; frame < NUM_FRAMES; frame++) {
+        camera.x.decPart += 0x1000000000;
+        writeCameraPositionsWith (system, camera, target, kernel);
+    }
+    double ns = (benchNow () - start) / NUM_FRAMES;
+
+    printf
+        ( "%-16s %-6s %7u bodies %10.3f us/frame %8.3f ns/body\n"
+        , name, format == VERTEX_FORMAT_FLOAT ? "float" : "half", NUM_BODIES
+        , ns * 1e-3, ns / NUM_BODIES );
+
+    benchSink ^= instances[NUM_BODIES - 1].position[0] != 0;
+    free (instances);
+}
+
+static void benchFpToFloat (const BodySystem *system) {
+    Instance *instances = calloc (NUM_BODIES, sizeof (Instance));
+
+    double start = benchNow ();
+    for (unsigned int frame = 0; frame < NUM_FRAMES; frame++)
+        for (unsigned int ix = 0; ix < NUM_BODIES; ix++) {
+            instances[ix].position[0] = fpToFloat (getColumn (system->posX, ix));
+            instances[ix].position[1] = fpToFloat (getColumn (system->posY, ix));
+            instances[ix].position[2] = fpToFloat (getColumn (system->posZ, ix));
+        }
+    double ns = (benchNow () - start) / NUM_FRAMES;
+
+    printf
+        ( "%-16s %-6s %7u bodies %10.3f us/frame %8.3f ns/body\n"
+        , "fpToFloat", "float", NUM_BODIES, ns * 1e-3, ns / NUM_BODIES );
+
+    benchSink ^= instances[NUM_BODIES - 1].position[0] != 0;
+    free (instances);
+}
+
+int main (void) {
+    BodySystem system = randomSystem ();
+
+    for (VertexFormat format = VERTEX_FORMAT_FLOAT; format <= VERTEX_FORMAT_HALF; format++) {
+        benchKernel ("scalar", &system, format, CAMERA_KERNEL_SCALAR);
+        benchKernel ("AVX2", &system, format, CAMERA_KERNEL_AVX2);
+        benchKernel ("AVX-512", &system, format, CAMERA_KERNEL_AVX512);
+    }
+
+    benchFpToFloat (&system);
+
+    freeBodySystem (system);
+    return 0;
+}
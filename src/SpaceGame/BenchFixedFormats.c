@@ -0,0 +1,45 @@
+
+#include <stdio.h>
+
+#include "Bench.h"
+#include "FixedPrecision.h"
+#include "FixedFormats.h"
+
+
+
+// Benchmark for the narrow fixed-point formats against 'FixedPrec', for
+// the same operations on values in the same range.
+
+#define BENCH_ITERS 2000000
+
+#define BENCH_FORMAT(NAME, Type, prefix, EXPR)                          \
+    do {                                                                \
+        Type acc = prefix##FromInt (0);                                 \
+        uint64_t seed = 42;                                             \
+        double start = benchNow ();                                     \
+        for (unsigned int ix = 0; ix < BENCH_ITERS; ix++) {             \
+            Type x = prefix##FromDouble                                 \
+                (1 + (nextRandom (&seed) >> 11) * 0x1p-45);             \
+            acc = prefix##Add (acc, EXPR);                              \
+        }                                                               \
+        benchReport (NAME, benchNow () - start, BENCH_ITERS);           \
+        benchSink ^= (uint64_t) prefix##ToDouble (acc);                 \
+    } while (0)
+
+#define BENCH_ALL(Type, prefix)                                         \
+    do {                                                                \
+        Type one = prefix##FromInt (1);                                 \
+        BENCH_FORMAT (#prefix " (baseline)", Type, prefix, x);          \
+        BENCH_FORMAT (#prefix "Mul", Type, prefix, prefix##Mul (x, x)); \
+        BENCH_FORMAT (#prefix "Div", Type, prefix, prefix##Div (one, x)); \
+        BENCH_FORMAT (#prefix "Sqrt", Type, prefix, prefix##Sqrt (x));  \
+    } while (0)
+
+int main (void) {
+    BENCH_ALL (FixedPrec, fp);
+    BENCH_ALL (Q32x32, q32x32);
+    BENCH_ALL (Q16x48, q16x48);
+    BENCH_ALL (Q96x32, q96x32);
+
+    return 0;
+}
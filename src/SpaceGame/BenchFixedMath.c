@@ -0,0 +1,67 @@
+
+#include <math.h>
+#include <stdio.h>
+
+#include "Bench.h"
+#include "FixedPrecision.h"
+#include "FixedMath.h"
+
+
+
+// Benchmark for the fixed-precision transcendental functions, next to the
+// C library's double versions for scale, over arrays of arguments.
+
+#define BENCH_COUNT 4096
+#define BENCH_REPEATS 100
+
+static FixedPrec fixedArgs[BENCH_COUNT], fixedArgs2[BENCH_COUNT], fixedOut[BENCH_COUNT], fixedOut2[BENCH_COUNT];
+static double doubleArgs[BENCH_COUNT], doubleArgs2[BENCH_COUNT], doubleOut[BENCH_COUNT], doubleOut2[BENCH_COUNT];
+
+// Fill the arguments with values between 'lo' and 'hi'.
+//
+static void fillArgs (double lo, double hi) {
+    uint64_t seed = 42;
+
+    for (unsigned int ix = 0; ix < BENCH_COUNT; ix++) {
+        doubleArgs[ix] = lo + (hi - lo) * (nextRandom (&seed) >> 11) * 0x1p-53;
+        doubleArgs2[ix] = lo + (hi - lo) * (nextRandom (&seed) >> 11) * 0x1p-53;
+        fixedArgs[ix] = fpFromDouble (doubleArgs[ix]);
+        fixedArgs2[ix] = fpFromDouble (doubleArgs2[ix]);
+    }
+}
+
+#define BENCH_LOOP(NAME, BODY)                                          \
+    do {                                                                \
+        double start = benchNow ();                                     \
+        for (unsigned int rep = 0; rep < BENCH_REPEATS; rep++)          \
+            BODY;                                                       \
+        benchReport (NAME, benchNow () - start, BENCH_COUNT * BENCH_REPEATS); \
+        benchSink ^= fixedOut[0].decPart ^ (uint64_t) doubleOut[0];     \
+    } while (0)
+
+int main (void) {
+    fillArgs (-100, 100);
+    BENCH_LOOP ("fpSinCosArray", fpSinCosArray (fixedArgs, fixedOut, fixedOut2, BENCH_COUNT));
+    BENCH_LOOP ("sin + cos (double)", for (unsigned int ix = 0; ix < BENCH_COUNT; ix++) {
+        doubleOut[ix] = sin (doubleArgs[ix]);
+        doubleOut2[ix] = cos (doubleArgs[ix]);
+    });
+
+    BENCH_LOOP ("fpAtan2Array", fpAtan2Array (fixedArgs, fixedArgs2, fixedOut, BENCH_COUNT));
+    BENCH_LOOP ("atan2 (double)", for (unsigned int ix = 0; ix < BENCH_COUNT; ix++)
+        doubleOut[ix] = atan2 (doubleArgs[ix], doubleArgs2[ix]));
+
+    fillArgs (-40, 40);
+    BENCH_LOOP ("fpExpArray", fpExpArray (fixedArgs, fixedOut, BENCH_COUNT));
+    BENCH_LOOP ("exp (double)", for (unsigned int ix = 0; ix < BENCH_COUNT; ix++)
+        doubleOut[ix] = exp (doubleArgs[ix]));
+
+    fillArgs (1e-6, 1e6);
+    BENCH_LOOP ("fpLogArray", fpLogArray (fixedArgs, fixedOut, BENCH_COUNT));
+    BENCH_LOOP ("log (double)", for (unsigned int ix = 0; ix < BENCH_COUNT; ix++)
+        doubleOut[ix] = log (doubleArgs[ix]));
+
+    benchSink ^= fixedOut2[0].decPart ^ (uint64_t) doubleOut2[0];
+
+    return 0;
+}
@@ -0,0 +1,90 @@
+
+#include <stdio.h>
+
+#include "Bench.h"
+#include "FixedPrecision.h"
+
+
+
+// Benchmark for the 'FixedPrecision.h' operations, and in particular the
+// division-free reciprocal square root against the naive route through
+// 'fpSqrt' and 'fpDiv'.
+
+#define BENCH_ITERS 2000000
+
+#define BENCH_FP(NAME, EXPR)                                            \
+    do {                                                                \
+        FixedPrec acc = fpFromInt (0);                                  \
+        uint64_t seed = 42;                                             \
+        double start = benchNow ();                                     \
+        for (unsigned int ix = 0; ix < BENCH_ITERS; ix++) {             \
+            FixedPrec x = newFixedPrec                                  \
+                (nextRandom (&seed) >> 40, nextRandom (&seed));         \
+            acc = fpAdd (acc, EXPR);                                    \
+        }                                                               \
+        benchReport (NAME, benchNow () - start, BENCH_ITERS);           \
+        benchSink ^= acc.wholePart ^ acc.decPart;                       \
+    } while (0)
+
+// The same operations over arrays of 'batch' values at a time, from ones
+// that fit in L1 to ones that don't fit in L2, with the same total count.
+//
+#define BENCH_BATCH_TOTAL (1 << 21)
+
+static FixedPrec batchIn[1 << 16], batchOut[1 << 16];
+
+static const unsigned int batchSizes[] = { 16, 256, 4096, 1 << 16 };
+
+#define NUM_BATCH_SIZES (sizeof (batchSizes) / sizeof (batchSizes[0]))
+
+#define BENCH_FP_BATCH(NAME, EXPR)                                      \
+    do {                                                                \
+        for (unsigned int size = 0; size < NUM_BATCH_SIZES; size++) {   \
+            unsigned int batch = batchSizes[size];                      \
+            double start = benchNow ();                                 \
+            for (unsigned int rep = 0; rep < BENCH_BATCH_TOTAL / batch; rep++) \
+                for (unsigned int ix = 0; ix < batch; ix++) {           \
+                    FixedPrec x = batchIn[ix];                          \
+                    batchOut[ix] = EXPR;                                \
+                }                                                       \
+            benchReportBatch (NAME, batch, benchNow () - start, BENCH_BATCH_TOTAL); \
+            benchSink ^= batchOut[batch - 1].decPart;                   \
+        }                                                               \
+    } while (0)
+
+static inline FixedPrec invCubeRsqrt (FixedPrec r2) {
+    FixedPrec invR = fpRsqrt (r2);
+    return fpMul (invR, fpSqr (invR));
+}
+
+static inline FixedPrec invCubeNaive (FixedPrec r2) {
+    return fpDiv (fpFromInt (1), fpMul (r2, fpSqrt (r2)));
+}
+
+int main (void) {
+    FixedPrec one = fpFromInt (1);
+
+    BENCH_FP ("(baseline)", x);
+    BENCH_FP ("fpMul", fpMul (x, x));
+    BENCH_FP ("fpDiv", fpDiv (one, x));
+    BENCH_FP ("fpSqrt", fpSqrt (x));
+
+    BENCH_FP ("fpRsqrt", fpRsqrt (x));
+    BENCH_FP ("1 / fpSqrt", fpDiv (one, fpSqrt (x)));
+
+    // 'x' standing in for 'r^2', as in the gravity kernel.
+    BENCH_FP ("r^-3 via fpRsqrt", invCubeRsqrt (x));
+    BENCH_FP ("r^-3 via fpDiv, fpSqrt", invCubeNaive (x));
+
+    uint64_t seed = 42;
+    for (unsigned int ix = 0; ix < 1 << 16; ix++)
+        batchIn[ix] = newFixedPrec (nextRandom (&seed) >> 40, nextRandom (&seed));
+
+    BENCH_FP_BATCH ("fpAdd", fpAdd (x, one));
+    BENCH_FP_BATCH ("fpMul", fpMul (x, x));
+    BENCH_FP_BATCH ("fpDiv", fpDiv (one, x));
+    BENCH_FP_BATCH ("fpSqrt", fpSqrt (x));
+    BENCH_FP_BATCH ("fpRsqrt", fpRsqrt (x));
+
+    return 0;
+}
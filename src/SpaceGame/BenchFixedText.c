@@ -0,0 +1,79 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Bench.h"
+#include "FixedPrecision.h"
+#include "Text.h"
+#include "FixedText.h"
+
+
+
+// Benchmark for printing and reading fixed-precision values as decimals,
+// next to printing doubles with 'snprintf' and reading them with 'strtod'
+// for scale. Coordinates with random fractions need 19 or 20 digits;
+// coordinates on a grid of 1/1024 need a few.
+
+#define BENCH_COUNT 4096
+#define BENCH_REPEATS 100
+
+static FixedPrec values[BENCH_COUNT], parsed[BENCH_COUNT];
+static double doubles[BENCH_COUNT];
+static char texts[BENCH_COUNT][FP_TEXT_MAX + 1], doubleTexts[BENCH_COUNT][32];
+static unsigned int lengths[BENCH_COUNT];
+
+static void fillValues (uint64_t fractionMask) {
+    uint64_t seed = 42;
+
+    for (unsigned int ix = 0; ix < BENCH_COUNT; ix++) {
+        values[ix] = newFixedPrec
+            ( (int64_t) (nextRandom (&seed) % 2000000) - 1000000
+            , nextRandom (&seed) & fractionMask );
+        doubles[ix] = fpToDouble (values[ix]);
+
+        lengths[ix] = fpFormatChars (values[ix], texts[ix]);
+        texts[ix][lengths[ix]] = '\0';
+        snprintf (doubleTexts[ix], sizeof (doubleTexts[ix]), "%.17g", doubles[ix]);
+    }
+}
+
+#define BENCH_LOOP(NAME, BODY)                                          \
+    do {                                                                \
+        double start = benchNow ();                                     \
+        for (unsigned int rep = 0; rep < BENCH_REPEATS; rep++)          \
+            for (unsigned int ix = 0; ix < BENCH_COUNT; ix++)           \
+                BODY;                                                   \
+        benchReport (NAME, benchNow () - start, BENCH_COUNT * BENCH_REPEATS); \
+    } while (0)
+
+static void benchValues (const char format[], const char parse[]) {
+    char buffer[64];
+
+    BENCH_LOOP (format, benchSink += fpFormatChars (values[ix], buffer));
+    BENCH_LOOP (parse, benchSink += fpParseChars (texts[ix], lengths[ix], &parsed[ix]));
+    benchSink ^= parsed[0].decPart;
+}
+
+int main (void) {
+    char buffer[64];
+
+    fillValues (UINT64_MAX);
+    benchValues ("fpFormatChars", "fpParseChars");
+
+    BENCH_LOOP ("snprintf %.17g (double)",
+        benchSink += snprintf (buffer, sizeof (buffer), "%.17g", doubles[ix]));
+    BENCH_LOOP ("strtod (double)", benchSink += (uint64_t) strtod (doubleTexts[ix], NULL));
+
+    fillValues (0xFFC0000000000000ULL);
+    benchValues ("fpFormatChars (1/1024 grid)", "fpParseChars (1/1024 grid)");
+
+    double start = benchNow ();
+    for (unsigned int rep = 0; rep < BENCH_REPEATS; rep++) {
+        Text text = fpArrayToText (values, BENCH_COUNT, '\n');
+        benchSink += text.length;
+        freeText (text);
+    }
+    benchReportBatch ("fpArrayToText", BENCH_COUNT, benchNow () - start, BENCH_COUNT * BENCH_REPEATS);
+
+    return 0;
+}
@@ -0,0 +1,83 @@
+
+#include <stdio.h>
+
+#include "Bench.h"
+#include "FixedPrecision.h"
+#include "Newtonian.h"
+#include "BodySystem.h"
+#include "Gravity.h"
+
+
+
+// Benchmark for the all-pairs gravity kernels, in pair interactions per
+// second, and against calling 'gravity' on every pair.
+
+static BodySystem randomSystem (unsigned int numBodies) {
+    BodySystem system = newBodySystem (numBodies);
+    uint64_t seed = 42;
+
+    for (unsigned int ix = 0; ix < numBodies; ix++) {
+        Newtonian newt = {
+            .mass = newFixedPrec (1, nextRandom (&seed)),
+            .position = {
+                newFixedPrec ((int64_t) (nextRandom (&seed) % 2000) - 1000, nextRandom (&seed)),
+                newFixedPrec ((int64_t) (nextRandom (&seed) % 2000) - 1000, nextRandom (&seed)),
+                newFixedPrec ((int64_t) (nextRandom (&seed) % 2000) - 1000, nextRandom (&seed))
+            }
+        };
+
+        addBody (&system, newt);
+    }
+
+    return system;
+}
+
+static void reportPairs (const char name[], unsigned int numBodies, double ns) {
+    double pairs = (double) numBodies * (numBodies - 1) / 2;
+    printf
+        ( "%-12s %6u bodies %10.3f ms %8.2f Mpairs/s\n"
+        , name, numBodies, ns * 1e-6, pairs / ns * 1e3 );
+}
+
+static void benchKernel (const char name[], GravityKernel kernel, unsigned int numBodies) {
+    if (bestGravityKernel (kernel) != kernel)
+        return;
+
+    BodySystem system = randomSystem (numBodies);
+
+    double start = benchNow ();
+    computeAccelerationsWith (&system, kernel);
+    reportPairs (name, numBodies, benchNow () - start);
+
+    benchSink ^= system.accX.decPart[0];
+    freeBodySystem (system);
+}
+
+static void benchNaive (unsigned int numBodies) {
+    BodySystem system = randomSystem (numBodies);
+    FixedPrec acc = fpFromInt (0);
+
+    double start = benchNow ();
+    for (unsigned int i = 0; i < numBodies; i++)
+    for (unsigned int j = i + 1; j < numBodies; j++)
+        acc = fpAdd (acc, gravity (gatherBody (&system, i), gatherBody (&system, j)).x);
+
+    reportPairs ("gravity", numBodies, benchNow () - start);
+
+    benchSink ^= acc.decPart;
+    freeBodySystem (system);
+}
+
+int main (void) {
+    unsigned int sizes[] = { 1000, 4000, 10000 };
+
+    for (unsigned int ix = 0; ix < sizeof (sizes) / sizeof (sizes[0]); ix++) {
+        benchKernel ("scalar", GRAVITY_KERNEL_SCALAR, sizes[ix]);
+        benchKernel ("avx2", GRAVITY_KERNEL_AVX2, sizes[ix]);
+        benchKernel ("avx512", GRAVITY_KERNEL_AVX512, sizes[ix]);
+    }
+
+    benchNaive (1000);
+
+    return 0;
+}
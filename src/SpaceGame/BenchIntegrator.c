@@ -0,0 +1,94 @@
+
+#include <math.h>
+#include <stdio.h>
+
+#include "Bench.h"
+#include "FixedPrecision.h"
+#include "Newtonian.h"
+#include "BodySystem.h"
+#include "Gravity.h"
+#include "Integrator.h"
+
+
+
+// Benchmark for the block timestep integrator: a star with planets, each
+// with a moon, and a disc of light debris, integrated for several orbits
+// of the outermost planet. Reports the energy drift, and the force
+// evaluations against stepping every body at the finest level in use.
+
+static Newtonian bodyAt (double mass, double x, double y, double vx, double vy) {
+    return (Newtonian) {
+        .mass       = fpFromDouble (mass),
+        .position   = { fpFromDouble (x), fpFromDouble (y), fpFromInt (0) },
+        .velocity   = { fpFromDouble (vx), fpFromDouble (vy), fpFromInt (0) }
+    };
+}
+
+static BodySystem planetarySystem (unsigned int numDebris) {
+    BodySystem system = newBodySystem (9 + numDebris);
+    uint64_t seed = 42;
+
+    addBody (&system, bodyAt (1000, 0, 0, 0, 0));
+
+    for (unsigned int ix = 0; ix < 4; ix++) {
+        double
+            radius  = 50 << ix,
+            speed   = sqrt (1000 / radius);
+
+        addBody (&system, bodyAt (1, radius, 0, 0, speed));
+        addBody (&system, bodyAt (0.001, radius + 0.5, 0, 0, speed + sqrt (2)));
+    }
+
+    for (unsigned int ix = 0; ix < numDebris; ix++) {
+        double
+            radius  = 1000 + 2000 * ((nextRandom (&seed) >> 11) * 0x1p-53),
+            angle   = 6.283185307179586 * ((nextRandom (&seed) >> 11) * 0x1p-53),
+            speed   = sqrt (1000 / radius);
+
+        addBody (&system, bodyAt
+            ( 1e-6
+            , radius * cos (angle), radius * sin (angle)
+            , -speed * sin (angle), speed * cos (angle) ));
+    }
+
+    return system;
+}
+
+int main (void) {
+    BodySystem system = planetarySystem (500);
+    Integrator integrator = newIntegrator (fpFromInt (16), 14);
+
+    double
+        startEnergy = kineticEnergy (&system) + potentialEnergy (&system),
+        start       = benchNow ();
+    unsigned int numSteps = 40;
+    uint64_t finest = 0;
+
+    for (unsigned int step = 1; step <= numSteps; step++) {
+        integrate (&integrator, &system);
+
+        for (unsigned int ix = 0; ix < system.numBodies; ix++)
+            if (system.timeLevels[ix] > finest)
+                finest = system.timeLevels[ix];
+
+        if (step % 10 == 0) {
+            double energy = kineticEnergy (&system) + potentialEnergy (&system);
+            printf
+                ( "t = %6.0f  energy drift %+.3e\n"
+                , fpToDouble (integrator.time), energy / startEnergy - 1 );
+        }
+    }
+
+    double ns = benchNow () - start;
+    uint64_t uniform = (uint64_t) numSteps * system.numBodies << finest;
+
+    printf ("%u bodies, %u steps, finest level %lu\n", system.numBodies, numSteps, (unsigned long) finest);
+    printf ("substeps                 %10lu\n", (unsigned long) integrator.substeps);
+    printf ("force evaluations        %10lu\n", (unsigned long) integrator.forceEvaluations);
+    printf ("at the finest level      %10lu  (%.1fx)\n"
+        , (unsigned long) uniform, (double) uniform / integrator.forceEvaluations);
+    benchReport ("integrate", ns, numSteps);
+
+    freeBodySystem (system);
+    return 0;
+}
@@ -0,0 +1,104 @@
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Bench.h"
+#include "FixedPrecision.h"
+#include "Newtonian.h"
+#include "BodySystem.h"
+#include "Gravity.h"
+#include "Octree.h"
+
+
+
+// Benchmark for the Barnes-Hut solver: time and accuracy against direct
+// summation for a range of opening angles, on a star with a disc of
+// planets and debris around it.
+
+static BodySystem discSystem (unsigned int numBodies) {
+    BodySystem system = newBodySystem (numBodies);
+    uint64_t seed = 42;
+
+    Newtonian star = { .mass = fpFromInt (1000000) };
+    addBody (&system, star);
+
+    for (unsigned int ix = 1; ix < numBodies; ix++) {
+        double
+            radius  = 1000 + 100000 * ((nextRandom (&seed) >> 11) * 0x1p-53),
+            angle   = 6.283185307179586 * ((nextRandom (&seed) >> 11) * 0x1p-53),
+            height  = 100 * ((nextRandom (&seed) >> 11) * 0x1p-53 - 0.5);
+
+        Newtonian newt = {
+            .mass = newFixedPrec (nextRandom (&seed) % 10, nextRandom (&seed)),
+            .position = {
+                fpFromDouble (radius * cos (angle)),
+                fpFromDouble (radius * sin (angle)),
+                fpFromDouble (height)
+            }
+        };
+
+        addBody (&system, newt);
+    }
+
+    return system;
+}
+
+static void benchSize (unsigned int numBodies) {
+    BodySystem system = discSystem (numBodies);
+
+    double start = benchNow ();
+    computeAccelerationsWith (&system, GRAVITY_KERNEL_AUTO);
+    double directNs = benchNow () - start;
+
+    printf ("%6u bodies  direct        %10.3f ms\n", numBodies, directNs * 1e-6);
+
+    double *exact = malloc (3 * numBodies * sizeof (double));
+    for (unsigned int ix = 0; ix < numBodies; ix++) {
+        exact[3 * ix] = fpToDouble (getColumn (system.accX, ix));
+        exact[3 * ix + 1] = fpToDouble (getColumn (system.accY, ix));
+        exact[3 * ix + 2] = fpToDouble (getColumn (system.accZ, ix));
+    }
+
+    double thetas[] = { 0.2, 0.3, 0.5, 0.7, 1.0 };
+    for (unsigned int thIx = 0; thIx < sizeof (thetas) / sizeof (thetas[0]); thIx++) {
+        start = benchNow ();
+        computeTreeAccelerations (&system, thetas[thIx]);
+        double treeNs = benchNow () - start;
+
+        // RMS error relative to the RMS acceleration, and the worst one.
+        double sumErr2 = 0, sumAcc2 = 0, worst = 0;
+        for (unsigned int ix = 0; ix < numBodies; ix++) {
+            double
+                ex = fpToDouble (getColumn (system.accX, ix)) - exact[3 * ix],
+                ey = fpToDouble (getColumn (system.accY, ix)) - exact[3 * ix + 1],
+                ez = fpToDouble (getColumn (system.accZ, ix)) - exact[3 * ix + 2],
+                err2 = ex * ex + ey * ey + ez * ez,
+                acc2 = exact[3 * ix] * exact[3 * ix] +
+                    exact[3 * ix + 1] * exact[3 * ix + 1] +
+                    exact[3 * ix + 2] * exact[3 * ix + 2];
+
+            sumErr2 += err2;
+            sumAcc2 += acc2;
+            if (err2 > worst * worst * acc2)
+                worst = sqrt (err2 / acc2);
+        }
+
+        printf
+            ( "%6u bodies  theta %.2f    %10.3f ms  rms %.2e  max %.2e\n"
+            , numBodies, thetas[thIx], treeNs * 1e-6
+            , sqrt (sumErr2 / sumAcc2), worst );
+    }
+
+    free (exact);
+    freeBodySystem (system);
+}
+
+int main (void) {
+    unsigned int sizes[] = { 1000, 10000, 50000 };
+
+    for (unsigned int ix = 0; ix < sizeof (sizes) / sizeof (sizes[0]); ix++)
+        benchSize (sizes[ix]);
+
+    return 0;
+}
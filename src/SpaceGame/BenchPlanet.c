@@ -0,0 +1,151 @@
+
+#include <math.h>
+#include <stdio.h>
+
+#include "Bench.h"
+#include "FixedPrecision.h"
+#include "Newtonian.h"
+#include "BodySystem.h"
+#include "FixedMath.h"
+#include "Gravity.h"
+#include "Integrator.h"
+#include "Planet.h"
+
+
+
+// Benchmark for bodies on rails: the Kepler solver across eccentricities,
+// evaluating planets and moons, and a solar system of asteroids with the
+// planets on rails against the same system with the planets integrated
+// as bodies.
+
+#define NUM_PLANETS 8
+
+static void benchKepler (double e) {
+    uint64_t seed = 5, sum = 0;
+    double start = benchNow ();
+
+    for (unsigned int ix = 0; ix < 1000000; ix++)
+        sum += solveKepler
+            ( fpMul (newFixedPrec (0, nextRandom (&seed)), fpTwoPi)
+            , fpFromDouble (e) ).decPart;
+
+    char name[32];
+    snprintf (name, sizeof (name), "solveKepler e=%.3f", e);
+    benchReport (name, benchNow () - start, 1000000);
+    benchSink ^= sum;
+}
+
+// A sun, 8 planets at roughly the right spacing and eccentricity, and a
+// moon around each of the outer four.
+//
+static unsigned int solarSystem (Planet planets[]) {
+    double
+        axes[NUM_PLANETS] = { 39, 72, 100, 152, 520, 954, 1922, 3007 },
+        eccs[NUM_PLANETS] = { 0.206, 0.007, 0.017, 0.093, 0.049, 0.057, 0.046, 0.010 };
+
+    unsigned int numPlanets = 0;
+    Planet *sun = &planets[numPlanets++];
+    *sun = newPlanet (fpFromInt (1000000), NULL, (OrbitalElements) { 0 });
+
+    for (unsigned int ix = 0; ix < NUM_PLANETS; ix++) {
+        Planet *planet = &planets[numPlanets++];
+        *planet = newPlanet (fpFromInt (ix < 4 ? 3 : 300), sun, (OrbitalElements) {
+            .semiMajorAxis  = axes[ix],
+            .eccentricity   = eccs[ix],
+            .inclination    = 0.02 * ix,
+            .meanAnomaly    = ix
+        });
+
+        if (ix >= 4)
+            planets[numPlanets++] = newPlanet (fpFromInt (1), planet, (OrbitalElements) {
+                .semiMajorAxis  = 5,
+                .eccentricity   = 0.01,
+                .meanAnomaly    = ix
+            });
+    }
+
+    return numPlanets;
+}
+
+static void addAsteroids (BodySystem *system, unsigned int numAsteroids) {
+    uint64_t seed = 9;
+
+    for (unsigned int ix = 0; ix < numAsteroids; ix++) {
+        double
+            radius  = 220 + 110 * ((nextRandom (&seed) >> 11) * 0x1p-53),
+            angle   = 6.283185307179586 * ((nextRandom (&seed) >> 11) * 0x1p-53),
+            speed   = sqrt (NEWTONIAN_G * 1000000 / radius);
+
+        Newtonian newt = {
+            .mass       = fpFromDouble (1e-6),
+            .position   = { fpFromDouble (radius * cos (angle)), fpFromDouble (radius * sin (angle)) },
+            .velocity   = { fpFromDouble (-speed * sin (angle)), fpFromDouble (speed * cos (angle)) }
+        };
+
+        addBody (system, newt);
+    }
+}
+
+static void benchSolarSystem (int onRails, unsigned int numAsteroids, unsigned int numSteps) {
+    Planet planets[1 + 2 * NUM_PLANETS];
+    unsigned int numPlanets = solarSystem (planets);
+
+    BodySystem system = newBodySystem (numPlanets + numAsteroids);
+    Integrator integrator = newIntegrator (fpFromInt (1), 8);
+
+    if (onRails) {
+        integrator.planets = planets;
+        integrator.numPlanets = numPlanets;
+    } else
+        for (unsigned int ix = 0; ix < numPlanets; ix++)
+            addBody (&system, planetAt (&planets[ix], fpFromInt (0)));
+
+    addAsteroids (&system, numAsteroids);
+
+    double start = benchNow ();
+    for (unsigned int step = 0; step < numSteps; step++)
+        integrate (&integrator, &system);
+    double ns = benchNow () - start;
+
+    // How far the integrated Earth has got from where it should be.
+    double earthError = 0;
+    if (!onRails) {
+        Newtonian
+            earth = gatherBody (&system, 3),
+            exact = planetAt (&planets[3], integrator.time);
+
+        earthError = fpToDouble (fp3Distance (earth.position, exact.position));
+    }
+
+    printf
+        ( "%-8s %5u asteroids %4u steps %10.3f ms  %10lu force evaluations  earth off by %.2e\n"
+        , onRails ? "rails" : "n-body", numAsteroids, numSteps, ns * 1e-6
+        , (unsigned long) integrator.forceEvaluations, earthError );
+
+    freeBodySystem (system);
+}
+
+int main (void) {
+    double eccentricities[] = { 0.0167, 0.2, 0.7, 0.97, 0.9999 };
+    for (unsigned int ix = 0; ix < sizeof (eccentricities) / sizeof (eccentricities[0]); ix++)
+        benchKepler (eccentricities[ix]);
+
+    Planet planets[1 + 2 * NUM_PLANETS];
+    unsigned int numPlanets = solarSystem (planets);
+    uint64_t seed = 3;
+
+    double start = benchNow ();
+    for (unsigned int ix = 0; ix < 1000000; ix++) {
+        Newtonian newt = planetAt
+            (&planets[numPlanets - 1], fpFromInt ((int64_t) (nextRandom (&seed) % 100000)));
+        benchSink ^= newt.position.x.decPart;
+    }
+    benchReport ("planetAt, moon", benchNow () - start, 1000000);
+
+    benchSolarSystem (1, 0, 100);
+    benchSolarSystem (0, 0, 100);
+    benchSolarSystem (1, 300, 20);
+    benchSolarSystem (0, 300, 20);
+
+    return 0;
+}
@@ -0,0 +1,123 @@
+
+#include <math.h>
+#include <stdio.h>
+
+#include "Bench.h"
+#include "FixedPrecision.h"
+#include "Newtonian.h"
+#include "BodySystem.h"
+#include "Gravity.h"
+#include "Integrator.h"
+#include "ThreadPool.h"
+
+
+
+// Benchmark for thread scaling: direct forces, tree forces and whole
+// integrator steps, on 1, 2, 4, ... workers up to every core there is,
+// with the speedup over one worker. The end state hashes are printed too,
+// and have to be the same on every line.
+
+static BodySystem discSystem (unsigned int numBodies) {
+    BodySystem system = newBodySystem (numBodies);
+    uint64_t seed = 42;
+
+    Newtonian star = { .mass = fpFromInt (1000000) };
+    addBody (&system, star);
+
+    for (unsigned int ix = 1; ix < numBodies; ix++) {
+        double
+            radius  = 1000 + 100000 * ((nextRandom (&seed) >> 11) * 0x1p-53),
+            angle   = 6.283185307179586 * ((nextRandom (&seed) >> 11) * 0x1p-53),
+            height  = 100 * ((nextRandom (&seed) >> 11) * 0x1p-53 - 0.5),
+            speed   = sqrt (1000000 / radius);
+
+        Newtonian newt = {
+            .mass = newFixedPrec (nextRandom (&seed) % 10, nextRandom (&seed)),
+            .position = {
+                fpFromDouble (radius * cos (angle)),
+                fpFromDouble (radius * sin (angle)),
+                fpFromDouble (height)
+            },
+            .velocity = {
+                fpFromDouble (-speed * sin (angle)),
+                fpFromDouble (speed * cos (angle)),
+                fpFromInt (0)
+            }
+        };
+
+        addBody (&system, newt);
+    }
+
+    return system;
+}
+
+typedef enum Workload Workload;
+
+enum Workload {
+    WORKLOAD_DIRECT,
+    WORKLOAD_TREE,
+    WORKLOAD_INTEGRATE
+};
+
+// Time a workload on a pool, returning nanoseconds, and the end state's
+// hash in 'hash'.
+//
+static double runWorkload (Workload workload, ThreadPool *pool, uint64_t *hash) {
+    unsigned int numBodies =
+        workload == WORKLOAD_DIRECT ? 10000 :
+        workload == WORKLOAD_TREE ? 50000 : 20000;
+
+    BodySystem system = discSystem (numBodies);
+    system.threadPool = pool;
+    system.gravitySolver =
+        workload == WORKLOAD_DIRECT ? GRAVITY_SOLVER_DIRECT : GRAVITY_SOLVER_TREE;
+
+    Integrator integrator = newIntegrator (fpFromInt (64), 3);
+
+    double start = benchNow ();
+
+    if (workload == WORKLOAD_INTEGRATE)
+        integrate (&integrator, &system);
+    else
+        computeAccelerations (&system);
+
+    double ns = benchNow () - start;
+
+    *hash = hashBodySystem (&system);
+    freeBodySystem (system);
+    return ns;
+}
+
+int main (void) {
+    const char *names[] = { "direct 10k", "tree 50k", "integrate 20k" };
+    unsigned int cores = availableCores ();
+
+    printf ("%u cores\n", cores);
+
+    for (Workload workload = WORKLOAD_DIRECT; workload <= WORKLOAD_INTEGRATE; workload++) {
+        double single = 0;
+
+        for (unsigned int workers = 1;; workers *= 2) {
+            if (workers > cores)
+                workers = cores;
+
+            ThreadPool *pool = newThreadPool (workers);
+            uint64_t hash;
+            double ns = runWorkload (workload, pool, &hash);
+            freeThreadPool (pool);
+
+            if (workers == 1)
+                single = ns;
+
+            printf
+                ( "%-16s %3u workers  %10.3f ms  speedup %5.2f  hash %016llx\n"
+                , names[workload], workers, ns * 1e-6, single / ns
+                , (unsigned long long) hash );
+
+            if (workers == cores)
+                break;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,112 @@
+
+#include <stdio.h>
+
+#include "Bench.h"
+#include "WideInt.h"
+
+
+
+// Microbenchmark for the 'WideInt.h' primitives, comparing the selected
+// backend against the reference limb code.
+
+#define BENCH_ITERS 20000000
+
+#define BENCH_128(NAME, EXPR)                                           \
+    do {                                                                \
+        UInt128 acc = newUInt128 (1, 1);                                \
+        uint64_t seed = 42;                                             \
+        double start = benchNow ();                                     \
+        for (unsigned int ix = 0; ix < BENCH_ITERS; ix++) {             \
+            UInt128 b = newUInt128 (seed, ix);                          \
+            seed += 0x9E3779B97F4A7C15ULL;                              \
+            acc = EXPR;                                                 \
+        }                                                               \
+        benchReport (NAME, benchNow () - start, BENCH_ITERS);           \
+        benchSink ^= acc.hi ^ acc.lo;                                   \
+    } while (0)
+
+// The same operations over arrays of 'batch' values at a time, from ones
+// that fit in L1 to ones that don't fit in L2, with the same total count.
+//
+#define BENCH_BATCH_TOTAL (1 << 22)
+
+static UInt128 batchA[1 << 16], batchB[1 << 16], batchOut[1 << 16];
+static Quotient128 batchQuotients[1 << 16];
+
+static const unsigned int batchSizes[] = { 16, 256, 4096, 1 << 16 };
+
+#define NUM_BATCH_SIZES (sizeof (batchSizes) / sizeof (batchSizes[0]))
+
+#define BENCH_128_BATCH(NAME, STATEMENT)                                \
+    do {                                                                \
+        for (unsigned int size = 0; size < NUM_BATCH_SIZES; size++) {   \
+            unsigned int batch = batchSizes[size];                      \
+            double start = benchNow ();                                 \
+            for (unsigned int rep = 0; rep < BENCH_BATCH_TOTAL / batch; rep++) \
+                STATEMENT;                                              \
+            benchReportBatch (NAME, batch, benchNow () - start, BENCH_BATCH_TOTAL); \
+            benchSink ^= batchOut[batch - 1].lo ^ batchQuotients[batch - 1].quotient.lo; \
+        }                                                               \
+    } while (0)
+
+int main (void) {
+    printf ("wide-int backend: %d\n", WIDE_INT_BACKEND);
+
+    BENCH_128 ("add128u", add128u (acc, b));
+    BENCH_128 ("add128uRef", add128uRef (acc, b));
+
+    BENCH_128 ("sub128u", sub128u (b, acc));
+    BENCH_128 ("sub128uRef", sub128uRef (b, acc));
+
+    BENCH_128 ("adc64u", adc64u (acc.lo ^ acc.hi, b.hi));
+    BENCH_128 ("adc64uRef", adc64uRef (acc.lo ^ acc.hi, b.hi));
+
+    BENCH_128 ("mul64u", mul64u (acc.lo | 1, b.hi));
+    BENCH_128 ("mul64uRef", mul64uRef (acc.lo | 1, b.hi));
+
+    // Division, against the bit-serial reference loop. Both 64-bit and
+    // 128-bit divisors take different paths through 'div128u'.
+    BENCH_128
+        ( "div128u (64-bit)"
+        , div128u (b, newUInt128 (0, acc.lo | 1)).quotient );
+    BENCH_128
+        ( "div128u (128-bit)"
+        , div128u (b, newUInt128 (acc.lo >> 32 | 1, acc.hi)).quotient );
+    BENCH_128
+        ( "div128uRef (64-bit)"
+        , div128uRef (b, newUInt128 (0, acc.lo | 1)).quotient );
+    BENCH_128
+        ( "div128uRef (128-bit)"
+        , div128uRef (b, newUInt128 (acc.lo >> 32 | 1, acc.hi)).quotient );
+
+    // Many numbers by the same divisor. The divisor goes through a
+    // volatile so the compiler can't specialise the division for it.
+    volatile uint64_t sameDivisor = 0x123456789ABCDEFULL;
+    uint64_t divisor = sameDivisor;
+    Reciprocal64 recip = newReciprocal64 (divisor);
+
+    BENCH_128
+        ( "divByReciprocal128u"
+        , add128u (acc, divByReciprocal128u (b, recip).quotient) );
+    BENCH_128
+        ( "div128u (same divisor)"
+        , add128u (acc, div128u (b, newUInt128 (0, divisor)).quotient) );
+
+    uint64_t seed = 42;
+    for (unsigned int ix = 0; ix < 1 << 16; ix++) {
+        batchA[ix] = newUInt128 (nextRandom (&seed), nextRandom (&seed));
+        batchB[ix] = shr128u (newUInt128 (nextRandom (&seed), nextRandom (&seed)), 64 + ix % 64);
+        batchB[ix].lo |= 1;
+    }
+
+    BENCH_128_BATCH ("add128u", for (unsigned int ix = 0; ix < batch; ix++)
+        batchOut[ix] = add128u (batchA[ix], batchB[ix]));
+    BENCH_128_BATCH ("mul128u", for (unsigned int ix = 0; ix < batch; ix++)
+        batchOut[ix] = mul128u (batchA[ix], batchB[ix]).hi);
+    BENCH_128_BATCH ("div128u", for (unsigned int ix = 0; ix < batch; ix++)
+        batchQuotients[ix] = div128u (batchA[ix], batchB[ix]));
+    BENCH_128_BATCH ("divAllByReciprocal128u"
+        , divAllByReciprocal128u (batch, batchA, batchQuotients, recip));
+
+    return 0;
+}
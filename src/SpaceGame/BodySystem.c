@@ -0,0 +1,314 @@
+
+// SpaceGame.BodySystem
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "FixedPrecision.h"
+#include "Newtonian.h"
+#include "BodySystem.h"
+
+
+
+// type BodySystem
+
+// Allocate a cache-line-aligned array of 'n' 64-bit limbs.
+//
+// 'aligned_alloc' wants the size to be a multiple of the alignment.
+//
+static uint64_t *allocLimbs (unsigned int n) {
+    size_t
+        align   = BODY_SYSTEM_ALIGNMENT,
+        size    = ((size_t) n * sizeof (uint64_t) + align - 1) & ~(align - 1);
+
+    return aligned_alloc (align, size ? size : align);
+}
+
+// List every limb array of a body system, so that allocation, copying
+// and snapshots can treat them uniformly.
+//
+void listLimbArrays (BodySystem *system, uint64_t **arrays[]) {
+    FixedPrecColumn *columns[] = {
+        &system->mass,
+        &system->posX, &system->posY, &system->posZ,
+        &system->velX, &system->velY, &system->velZ,
+        &system->accX, &system->accY, &system->accZ,
+        &system->prevAccX, &system->prevAccY, &system->prevAccZ
+    };
+
+    for (unsigned int colIx = 0; colIx < BODY_SYSTEM_LIMB_ARRAYS / 2; colIx++) {
+        arrays[2 * colIx] = &columns[colIx]->wholePart;
+        arrays[2 * colIx + 1] = &columns[colIx]->decPart;
+    }
+
+    arrays[BODY_SYSTEM_LIMB_ARRAYS - 1] = &system->timeLevels;
+}
+
+// Free every array of a body system, or unmap them all at once if they
+// came from a snapshot.
+//
+static void releaseArrays (BodySystem *system) {
+    if (system->mapping) {
+        munmap (system->mapping, system->mappingSize);
+        system->mapping = NULL;
+        return;
+    }
+
+    uint64_t **arrays[BODY_SYSTEM_LIMB_ARRAYS];
+    listLimbArrays (system, arrays);
+
+    for (unsigned int arrIx = 0; arrIx < BODY_SYSTEM_LIMB_ARRAYS; arrIx++)
+        free (*arrays[arrIx]);
+
+    free (system->handleToIndex);
+    free (system->indexToHandle);
+    free (system->freeHandles);
+}
+
+// Grow every array of a body system to hold 'capacity' bodies.
+//
+// Everything is allocated up front, so on failure the body system is
+// left untouched and 0 is returned.
+//
+static int growBodySystem (BodySystem *system, unsigned int capacity) {
+    uint64_t **arrays[BODY_SYSTEM_LIMB_ARRAYS];
+    uint64_t *grown[BODY_SYSTEM_LIMB_ARRAYS];
+    listLimbArrays (system, arrays);
+
+    int ok = 1;
+    for (unsigned int arrIx = 0; arrIx < BODY_SYSTEM_LIMB_ARRAYS; arrIx++)
+        ok &= (grown[arrIx] = allocLimbs (capacity)) != NULL;
+
+    uint32_t
+        *handleToIndex  = malloc (capacity * sizeof (uint32_t)),
+        *indexToHandle  = malloc (capacity * sizeof (uint32_t)),
+        *freeHandles    = malloc (capacity * sizeof (uint32_t));
+
+    ok &= handleToIndex && indexToHandle && freeHandles;
+
+    if (!ok) {
+        for (unsigned int arrIx = 0; arrIx < BODY_SYSTEM_LIMB_ARRAYS; arrIx++)
+            free (grown[arrIx]);
+
+        free (handleToIndex);
+        free (indexToHandle);
+        free (freeHandles);
+        return 0;
+    }
+
+    for (unsigned int arrIx = 0; arrIx < BODY_SYSTEM_LIMB_ARRAYS; arrIx++)
+        if (*arrays[arrIx])
+            memcpy
+                ( grown[arrIx], *arrays[arrIx]
+                , system->numBodies * sizeof (uint64_t) );
+
+    if (system->handleToIndex) {
+        memcpy
+            ( handleToIndex, system->handleToIndex
+            , system->numHandles * sizeof (uint32_t) );
+        memcpy
+            ( indexToHandle, system->indexToHandle
+            , system->numBodies * sizeof (uint32_t) );
+        memcpy
+            ( freeHandles, system->freeHandles
+            , system->numFreeHandles * sizeof (uint32_t) );
+    }
+
+    releaseArrays (system);
+
+    for (unsigned int arrIx = 0; arrIx < BODY_SYSTEM_LIMB_ARRAYS; arrIx++)
+        *arrays[arrIx] = grown[arrIx];
+
+    system->handleToIndex   = handleToIndex;
+    system->indexToHandle   = indexToHandle;
+    system->freeHandles     = freeHandles;
+    system->capacity        = capacity;
+
+    return 1;
+}
+
+// Create a new empty body system with space for 'capacity' bodies.
+//
+BodySystem newBodySystem (unsigned int capacity) {
+    BodySystem system;
+    memset (&system, 0, sizeof (system));
+
+    system.softening = newFixedPrec (0, 1ULL << 32);
+    system.gravitySolver = GRAVITY_SOLVER_DIRECT;
+    system.openingAngle = 0.5;
+
+    if (!growBodySystem (&system, capacity ? capacity : 1))
+        printf ("error: newBodySystem: out of memory\n");
+
+    return system;
+}
+
+// Free all the arrays of a body system.
+//
+void freeBodySystem (BodySystem system) {
+    releaseArrays (&system);
+}
+
+
+// Add a body to the end of a body system, growing it if needed. A body
+// system whose first allocation failed has a capacity of 0, and starts
+// again from 1.
+//
+BodyHandle addBody (BodySystem *system, Newtonian newt) {
+    if (!system->numFreeHandles && system->numHandles == BODY_HANDLE_MAX_SLOTS) {
+        printf ("error: addBody: out of handles\n");
+        return INVALID_BODY_HANDLE;
+    }
+
+    if (system->numBodies == system->capacity &&
+        !growBodySystem (system, system->capacity ? system->capacity * 2 : 1))
+    {
+        printf ("error: addBody: out of memory\n");
+        return INVALID_BODY_HANDLE;
+    }
+
+    BodyHandle handle =
+        system->numFreeHandles
+            ? system->freeHandles[--system->numFreeHandles]
+            : system->numHandles++;
+
+    unsigned int ix = system->numBodies++;
+
+    system->handleToIndex[bodyHandleSlot (handle)] = ix;
+    system->indexToHandle[ix] = handle;
+
+    scatterBody (system, ix, newt);
+
+    setColumn (system->accX, ix, fpFromInt (0));
+    setColumn (system->accY, ix, fpFromInt (0));
+    setColumn (system->accZ, ix, fpFromInt (0));
+
+    setColumn (system->prevAccX, ix, fpFromInt (0));
+    setColumn (system->prevAccY, ix, fpFromInt (0));
+    setColumn (system->prevAccZ, ix, fpFromInt (0));
+    system->timeLevels[ix] = UNSET_TIME_LEVEL;
+
+    return handle;
+}
+
+// Remove a body from a body system.
+//
+// The last body is moved into the hole, so this is O(1), but it changes
+// that body's index. The body's slot goes on the free list as the next
+// generation's handle.
+//
+void removeBody (BodySystem *system, BodyHandle handle) {
+    unsigned int ix = bodyIndex (system, handle);
+    if (ix == INVALID_BODY_HANDLE) {
+        printf ("error: removeBody: invalid handle %u\n", handle);
+        return;
+    }
+
+    unsigned int last = --system->numBodies;
+
+    if (ix != last) {
+        uint64_t **arrays[BODY_SYSTEM_LIMB_ARRAYS];
+        listLimbArrays (system, arrays);
+
+        for (unsigned int arrIx = 0; arrIx < BODY_SYSTEM_LIMB_ARRAYS; arrIx++)
+            (*arrays[arrIx])[ix] = (*arrays[arrIx])[last];
+
+        BodyHandle moved = system->indexToHandle[last];
+        system->indexToHandle[ix] = moved;
+        system->handleToIndex[bodyHandleSlot (moved)] = ix;
+    }
+
+    system->handleToIndex[bodyHandleSlot (handle)] = INVALID_BODY_HANDLE;
+    system->freeHandles[system->numFreeHandles++] = handle + (1U << BODY_HANDLE_SLOT_BITS);
+}
+
+// Find the current index of a body from its handle.
+//
+// Returns 'INVALID_BODY_HANDLE' if the handle doesn't refer to a body,
+// including one from an earlier generation of its slot.
+//
+unsigned int bodyIndex (const BodySystem *system, BodyHandle handle) {
+    unsigned int slot = bodyHandleSlot (handle);
+    if (slot >= system->numHandles)
+        return INVALID_BODY_HANDLE;
+
+    unsigned int ix = system->handleToIndex[slot];
+    if (ix == INVALID_BODY_HANDLE || system->indexToHandle[ix] != handle)
+        return INVALID_BODY_HANDLE;
+
+    return ix;
+}
+
+
+// Copy a body out of a body system into a 'Newtonian'.
+//
+Newtonian gatherBody (const BodySystem *system, unsigned int ix) {
+    return (Newtonian) {
+        .mass = getColumn (system->mass, ix),
+
+        .position = {
+            .x = getColumn (system->posX, ix),
+            .y = getColumn (system->posY, ix),
+            .z = getColumn (system->posZ, ix)
+        },
+
+        .velocity = {
+            .x = getColumn (system->velX, ix),
+            .y = getColumn (system->velY, ix),
+            .z = getColumn (system->velZ, ix)
+        }
+    };
+}
+
+// Copy a 'Newtonian' into a body system.
+//
+void scatterBody (BodySystem *system, unsigned int ix, Newtonian newt) {
+    setColumn (system->mass, ix, newt.mass);
+
+    setColumn (system->posX, ix, newt.position.x);
+    setColumn (system->posY, ix, newt.position.y);
+    setColumn (system->posZ, ix, newt.position.z);
+
+    setColumn (system->velX, ix, newt.velocity.x);
+    setColumn (system->velY, ix, newt.velocity.y);
+    setColumn (system->velZ, ix, newt.velocity.z);
+}
+
+
+static inline uint64_t mixHash (uint64_t hash, uint64_t value) {
+    hash = (hash ^ value) * 0x100000001B3ULL;
+    return hash ^ (hash >> 29);
+}
+
+// Hash of the state of every body in a body system, for telling whether
+// two runs came out exactly the same.
+//
+// Every limb array is hashed, in order, so this covers the integrator
+// state and accelerations too, and then the handle arrays, so a snapshot
+// whose handles were damaged doesn't match either. It isn't
+// cryptographic, just well mixed.
+//
+uint64_t hashBodySystem (const BodySystem *system) {
+    BodySystem copy = *system;
+    uint64_t **arrays[BODY_SYSTEM_LIMB_ARRAYS];
+    listLimbArrays (&copy, arrays);
+
+    uint64_t hash = 0xCBF29CE484222325ULL ^ system->numBodies;
+
+    for (unsigned int arrIx = 0; arrIx < BODY_SYSTEM_LIMB_ARRAYS; arrIx++)
+    for (unsigned int ix = 0; ix < system->numBodies; ix++)
+        hash = mixHash (hash, (*arrays[arrIx])[ix]);
+
+    hash = mixHash (hash, ((uint64_t) system->numHandles << 32) | system->numFreeHandles);
+
+    for (unsigned int handle = 0; handle < system->numHandles; handle++)
+        hash = mixHash (hash, system->handleToIndex[handle]);
+    for (unsigned int ix = 0; ix < system->numBodies; ix++)
+        hash = mixHash (hash, system->indexToHandle[ix]);
+    for (unsigned int freeIx = 0; freeIx < system->numFreeHandles; freeIx++)
+        hash = mixHash (hash, system->freeHandles[freeIx]);
+
+    return hash;
+}
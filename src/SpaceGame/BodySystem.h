@@ -0,0 +1,159 @@
+
+#ifndef SPACE_GAME_BODY_SYSTEM_H
+#define SPACE_GAME_BODY_SYSTEM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "FixedPrecision.h"
+#include "Newtonian.h"
+#include "ThreadPool.h"
+
+// Alignment of every array in a body system, in bytes. One cache line.
+//
+#define BODY_SYSTEM_ALIGNMENT 64
+
+// Column of fixed-precision values, stored as two separate arrays of
+// 64-bit limbs rather than an array of 'FixedPrec's.
+//
+// Keeping the whole and fraction parts apart means a kernel can load
+// consecutive limbs of consecutive bodies straight into vector lanes.
+//
+// The whole parts are stored as unsigned limbs, like the fractions, so
+// code that handles every limb array alike can point at either.
+//
+typedef struct FixedPrecColumn FixedPrecColumn;
+
+struct FixedPrecColumn {
+    uint64_t *wholePart;
+    uint64_t *decPart;
+};
+
+// Read and write a single element of a column.
+//
+static inline FixedPrec getColumn (FixedPrecColumn col, unsigned int ix) {
+    return newFixedPrec ((int64_t) col.wholePart[ix], col.decPart[ix]);
+}
+
+static inline void setColumn (FixedPrecColumn col, unsigned int ix, FixedPrec a) {
+    col.wholePart[ix] = (uint64_t) a.wholePart;
+    col.decPart[ix] = a.decPart;
+}
+
+
+// Stable reference to a body in a body system.
+//
+// Removing bodies moves other bodies around in the arrays, so their
+// indices change; their handles don't. The low 24 bits of a handle are
+// its slot, and the top 8 bits its generation. Removing a body frees its
+// slot for a later addition with the next generation, so the removed
+// body's handle stops working instead of finding the new body, until
+// the slot has been reused 256 times.
+//
+typedef uint32_t BodyHandle;
+
+#define INVALID_BODY_HANDLE UINT32_MAX
+
+#define BODY_HANDLE_SLOT_BITS 24
+#define BODY_HANDLE_SLOT_MASK ((1U << BODY_HANDLE_SLOT_BITS) - 1)
+
+// Most slots a body system hands out. The last slot is never used, so
+// no handle is ever 'INVALID_BODY_HANDLE'.
+//
+#define BODY_HANDLE_MAX_SLOTS BODY_HANDLE_SLOT_MASK
+
+static inline unsigned int bodyHandleSlot (BodyHandle handle) {
+    return handle & BODY_HANDLE_SLOT_MASK;
+}
+
+// Timestep level of a body the integrator hasn't seen yet.
+//
+#define UNSET_TIME_LEVEL UINT64_MAX
+
+
+// Which solver 'computeAccelerations' uses for a body system: direct
+// summation over all pairs, or a Barnes-Hut octree.
+//
+typedef enum GravitySolver GravitySolver;
+
+enum GravitySolver {
+    GRAVITY_SOLVER_DIRECT,
+    GRAVITY_SOLVER_TREE
+};
+
+
+// Structure-of-arrays store for Newtonian bodies.
+//
+// Bodies live at indices '0' to 'numBodies - 1' of every column, with no
+// gaps, so bulk kernels just loop over that range.
+//
+typedef struct BodySystem BodySystem;
+
+struct BodySystem {
+    unsigned int numBodies;
+    unsigned int capacity;
+
+    // Intrinsic characteristics
+    FixedPrecColumn mass;
+
+    // Newtonian data
+    FixedPrecColumn posX, posY, posZ;
+    FixedPrecColumn velX, velY, velZ;
+
+    // Derived data, filled in by the gravity solvers
+    FixedPrecColumn accX, accY, accZ;
+
+    // Integrator state: the acceleration at the start of each body's
+    // current timestep, and its timestep level. Levels are kept 64-bit so
+    // that they're just another limb array.
+    FixedPrecColumn prevAccX, prevAccY, prevAccZ;
+    uint64_t *timeLevels;
+
+    // Gravitational softening length. Pairs closer than this feel a
+    // weakened force instead of a singular one.
+    FixedPrec softening;
+
+    // Gravity solver, and the opening angle if it's the octree
+    GravitySolver gravitySolver;
+    double openingAngle;
+
+    // Threads the solvers and integrator share the work out over, or
+    // NULL to do everything on the calling thread. Not owned.
+    ThreadPool *threadPool;
+
+    // Handle bookkeeping: the index of each slot's body, or
+    // 'INVALID_BODY_HANDLE' if it's free, the whole handle of each body,
+    // and the handles free slots will be reused as.
+    uint32_t *handleToIndex;
+    uint32_t *indexToHandle;
+    uint32_t *freeHandles;
+    unsigned int numHandles;
+    unsigned int numFreeHandles;
+
+    // Snapshot file the arrays point into, if the body system was loaded
+    // from one, rather than allocated; see 'Snapshot.h'.
+    void *mapping;
+    size_t mappingSize;
+};
+
+// Number of limb arrays in a body system: two per column, and the
+// timestep levels.
+//
+#define BODY_SYSTEM_LIMB_ARRAYS 27
+
+BodySystem newBodySystem (unsigned int);
+void freeBodySystem (BodySystem);
+
+BodyHandle addBody (BodySystem *, Newtonian);
+void removeBody (BodySystem *, BodyHandle);
+
+unsigned int bodyIndex (const BodySystem *, BodyHandle);
+
+Newtonian gatherBody (const BodySystem *, unsigned int);
+void scatterBody (BodySystem *, unsigned int, Newtonian);
+
+uint64_t hashBodySystem (const BodySystem *);
+
+void listLimbArrays (BodySystem *, uint64_t **[]);
+
+#endif
@@ -0,0 +1,281 @@
+
+// SpaceGame.CameraSpace
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "FixedPrecision.h"
+#include "Newtonian.h"
+#include "BodySystem.h"
+#include "FixedPrecVector.h"
+#include "CameraSpace.h"
+#include "ThreadPool.h"
+
+
+
+// Camera-relative positions for rendering.
+//
+// Absolute positions at solar-system scale need all of a fixed-precision
+// value's bits; a float has 24. So the camera is taken off in fixed
+// precision first, exactly, and only what's left, which is small wherever
+// there's anything on screen worth looking at, is rounded to a float: to
+// the nearest double, scaled, then to the nearest float.
+
+// Convert a float to the nearest IEEE half float, ties to even, as the
+// F16C instructions do. Too large a value becomes an infinity.
+//
+uint16_t floatToHalf (float a) {
+    union { float f; uint32_t u; } pun = { a };
+
+    uint32_t
+        sign    = pun.u & 0x80000000u,
+        bits    = pun.u ^ sign;
+
+    uint16_t half;
+
+    if (bits >= (127 + 16) << 23)
+        // Overflow, infinity or NaN
+        half = bits > 255u << 23 ? 0x7E00 : 0x7C00;
+    else if (bits < (127 - 14) << 23) {
+        // Subnormal or zero: adding 0.5 lines the half's last bit up with
+        // the float's, so the addition does the rounding.
+        union { uint32_t u; float f; } magic = { (127 - 1) << 23 }, value = { bits };
+        value.f += magic.f;
+        half = (uint16_t) (value.u - magic.u);
+    } else {
+        uint32_t odd = (bits >> 13) & 1;
+        bits += ((uint32_t) (15 - 127) << 23) + 0xFFF + odd;
+        half = (uint16_t) (bits >> 13);
+    }
+
+    return half | (uint16_t) (sign >> 16);
+}
+
+typedef struct CameraJob CameraJob;
+
+typedef void CameraChunk (const CameraJob *, unsigned int, unsigned int);
+
+struct CameraJob {
+    const BodySystem *system;
+    Vec3FixedPrec camera;
+    CameraTarget target;
+    CameraChunk *chunk;
+};
+
+static void writeInstance (const CameraTarget *target, unsigned int ix, const float xyz[3]) {
+    char *out = (char *) target->buffer + ix * target->stride;
+
+    if (target->format == VERTEX_FORMAT_FLOAT)
+        memcpy (out, xyz, 3 * sizeof (float));
+    else {
+        uint16_t halves[3] = { floatToHalf (xyz[0]), floatToHalf (xyz[1]), floatToHalf (xyz[2]) };
+        memcpy (out, halves, sizeof (halves));
+    }
+}
+
+// Write the camera-relative positions of bodies 'begin' to 'end - 1'.
+//
+static void cameraChunkScalar (const CameraJob *job, unsigned int begin, unsigned int end) {
+    const BodySystem *system = job->system;
+    double scale = job->target.scale;
+
+    for (unsigned int ix = begin; ix < end; ix++) {
+        float xyz[3] = {
+            (float) (fpToDouble (fpSub (getColumn (system->posX, ix), job->camera.x)) * scale),
+            (float) (fpToDouble (fpSub (getColumn (system->posY, ix), job->camera.y)) * scale),
+            (float) (fpToDouble (fpSub (getColumn (system->posZ, ix), job->camera.z)) * scale)
+        };
+
+        writeInstance (&job->target, ix, xyz);
+    }
+}
+
+#if FIXED_PREC_X86
+
+// Half floats need F16C as well, which every CPU with AVX2 has.
+//
+#define TARGET_AVX2_F16C __attribute__ ((target ("avx2,f16c")))
+#define TARGET_AVX512_F16C __attribute__ ((target ("avx512f,avx512dq,f16c")))
+
+// Write four instances, given their coordinates a lane each.
+//
+// Transposing gives each body its own 'x y z 0' vector, of which the
+// first three floats, or halves, are stored.
+//
+TARGET_AVX2_F16C
+static inline void writeInstances4
+    ( const CameraTarget *target, unsigned int ix
+    , __m128 x, __m128 y, __m128 z )
+{
+    __m128 w = _mm_setzero_ps ();
+    _MM_TRANSPOSE4_PS (x, y, z, w);
+
+    __m128 rows[4] = { x, y, z, w };
+    char *out = (char *) target->buffer + ix * target->stride;
+
+    for (unsigned int lane = 0; lane < 4; lane++, out += target->stride) {
+        if (target->format == VERTEX_FORMAT_FLOAT) {
+            _mm_storel_pi ((__m64 *) out, rows[lane]);
+            _mm_store_ss ((float *) out + 2, _mm_movehl_ps (rows[lane], rows[lane]));
+        } else {
+            uint64_t halves = (uint64_t) _mm_cvtsi128_si64
+                (_mm_cvtps_ph (rows[lane], _MM_FROUND_TO_NEAREST_INT));
+            memcpy (out, &halves, 3 * sizeof (uint16_t));
+        }
+    }
+}
+
+TARGET_AVX2_F16C
+static inline __m128 relativeFloats4 (FixedPrecColumn col, unsigned int ix, FixedPrec4 camera, __m256d scale) {
+    return _mm256_cvtpd_ps (_mm256_mul_pd (fp4ToDouble (fp4Sub (fp4Load (col, ix), camera)), scale));
+}
+
+TARGET_AVX2_F16C
+static void cameraChunkAVX2 (const CameraJob *job, unsigned int begin, unsigned int end) {
+    const BodySystem *system = job->system;
+
+    FixedPrec4
+        cameraX = fp4Broadcast (job->camera.x),
+        cameraY = fp4Broadcast (job->camera.y),
+        cameraZ = fp4Broadcast (job->camera.z);
+
+    __m256d scale = _mm256_set1_pd (job->target.scale);
+
+    unsigned int ix = begin;
+    for (; ix + 4 <= end; ix += 4)
+        writeInstances4
+            ( &job->target, ix
+            , relativeFloats4 (system->posX, ix, cameraX, scale)
+            , relativeFloats4 (system->posY, ix, cameraY, scale)
+            , relativeFloats4 (system->posZ, ix, cameraZ, scale) );
+
+    cameraChunkScalar (job, ix, end);
+}
+
+TARGET_AVX512_F16C
+static inline __m256 relativeFloats8 (FixedPrecColumn col, unsigned int ix, FixedPrec8 camera, __m512d scale) {
+    return _mm512_cvtpd_ps (_mm512_mul_pd (fp8ToDouble (fp8Sub (fp8Load (col, ix), camera)), scale));
+}
+
+TARGET_AVX512_F16C
+static void cameraChunkAVX512 (const CameraJob *job, unsigned int begin, unsigned int end) {
+    const BodySystem *system = job->system;
+
+    FixedPrec8
+        cameraX = fp8Broadcast (job->camera.x),
+        cameraY = fp8Broadcast (job->camera.y),
+        cameraZ = fp8Broadcast (job->camera.z);
+
+    __m512d scale = _mm512_set1_pd (job->target.scale);
+
+    unsigned int ix = begin;
+    for (; ix + 8 <= end; ix += 8) {
+        __m256
+            x = relativeFloats8 (system->posX, ix, cameraX, scale),
+            y = relativeFloats8 (system->posY, ix, cameraY, scale),
+            z = relativeFloats8 (system->posZ, ix, cameraZ, scale);
+
+        writeInstances4
+            ( &job->target, ix
+            , _mm256_castps256_ps128 (x)
+            , _mm256_castps256_ps128 (y)
+            , _mm256_castps256_ps128 (z) );
+
+        writeInstances4
+            ( &job->target, ix + 4
+            , _mm256_extractf128_ps (x, 1)
+            , _mm256_extractf128_ps (y, 1)
+            , _mm256_extractf128_ps (z, 1) );
+    }
+
+    cameraChunkScalar (job, ix, end);
+}
+
+#endif
+
+// Resolve a kernel choice to one this CPU can actually run.
+//
+CameraKernel bestCameraKernel (CameraKernel kernel) {
+#if FIXED_PREC_X86
+    __builtin_cpu_init ();
+
+    int
+        f16c    = __builtin_cpu_supports ("f16c"),
+        avx512  = f16c && __builtin_cpu_supports ("avx512f") &&
+            __builtin_cpu_supports ("avx512dq"),
+        avx2    = f16c && __builtin_cpu_supports ("avx2");
+
+    if (kernel == CAMERA_KERNEL_AUTO)
+        kernel = CAMERA_KERNEL_AVX512;
+    if (kernel == CAMERA_KERNEL_AVX512 && !avx512)
+        kernel = CAMERA_KERNEL_AVX2;
+    if (kernel == CAMERA_KERNEL_AVX2 && !avx2)
+        kernel = CAMERA_KERNEL_SCALAR;
+
+    return kernel;
+#else
+    (void) kernel;
+    return CAMERA_KERNEL_SCALAR;
+#endif
+}
+
+static CameraChunk *cameraChunk (CameraKernel kernel) {
+#if FIXED_PREC_X86
+    if (kernel == CAMERA_KERNEL_AVX2)
+        return cameraChunkAVX2;
+    if (kernel == CAMERA_KERNEL_AVX512)
+        return cameraChunkAVX512;
+#endif
+
+    return cameraChunkScalar;
+}
+
+static void runCameraChunk (void *context, unsigned int task, unsigned int worker) {
+    const CameraJob *job = context;
+    unsigned int
+        begin   = task * CAMERA_CHUNK_SIZE,
+        end     = begin + CAMERA_CHUNK_SIZE < job->system->numBodies
+            ? begin + CAMERA_CHUNK_SIZE : job->system->numBodies;
+
+    (void) worker;
+
+    job->chunk (job, begin, end);
+}
+
+// Write every body's position relative to 'camera' into a vertex or
+// instance buffer, ready to upload.
+//
+// Nothing is allocated, so this can run every frame. Instances don't
+// overlap, so chunks of them are shared out over the body system's
+// threads.
+//
+void writeCameraPositions (const BodySystem *system, Vec3FixedPrec camera, CameraTarget target) {
+    writeCameraPositionsWith (system, camera, target, CAMERA_KERNEL_AUTO);
+}
+
+void writeCameraPositionsWith
+    ( const BodySystem *system, Vec3FixedPrec camera
+    , CameraTarget target, CameraKernel kernel )
+{
+    size_t size = 3 * (target.format == VERTEX_FORMAT_FLOAT ? sizeof (float) : sizeof (uint16_t));
+
+    if (target.stride < size) {
+        printf
+            ( "error: writeCameraPositions: stride %zu is less than a position's %zu bytes\n"
+            , target.stride, size );
+        return;
+    }
+
+    CameraJob job = {
+        .system     = system,
+        .camera     = camera,
+        .target     = target,
+        .chunk      = cameraChunk (bestCameraKernel (kernel))
+    };
+
+    parallelFor
+        ( system->threadPool
+        , (system->numBodies + CAMERA_CHUNK_SIZE - 1) / CAMERA_CHUNK_SIZE
+        , runCameraChunk, &job );
+}
@@ -0,0 +1,63 @@
+
+#ifndef SPACE_GAME_CAMERA_SPACE_H
+#define SPACE_GAME_CAMERA_SPACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "FixedPrecision.h"
+#include "Newtonian.h"
+#include "BodySystem.h"
+
+// Format of the positions written into a vertex or instance buffer: three
+// 32-bit floats, or three IEEE half floats, per instance.
+//
+typedef enum VertexFormat VertexFormat;
+
+enum VertexFormat {
+    VERTEX_FORMAT_FLOAT,
+    VERTEX_FORMAT_HALF
+};
+
+// Which implementation of the conversion to run.
+//
+// As with the gravity kernels, every kernel gives bit-identical results,
+// and asking for one the CPU can't run falls back to the best one it can.
+//
+typedef enum CameraKernel CameraKernel;
+
+enum CameraKernel {
+    CAMERA_KERNEL_AUTO,
+    CAMERA_KERNEL_SCALAR,
+    CAMERA_KERNEL_AVX2,
+    CAMERA_KERNEL_AVX512
+};
+
+// Bodies per task when the conversion is shared out over threads.
+//
+#define CAMERA_CHUNK_SIZE 8192
+
+// Where to write camera-relative positions, and how.
+//
+// Instance 'ix' gets the position of body 'ix' at 'buffer + ix * stride',
+// as three values of 'format', with everything else in the buffer left
+// alone. Positions are multiplied by 'scale' on the way, to get them into
+// whatever units the renderer wants.
+//
+typedef struct CameraTarget CameraTarget;
+
+struct CameraTarget {
+    void *buffer;
+    size_t stride;
+    VertexFormat format;
+    double scale;
+};
+
+CameraKernel bestCameraKernel (CameraKernel);
+
+uint16_t floatToHalf (float);
+
+void writeCameraPositions (const BodySystem *, Vec3FixedPrec, CameraTarget);
+void writeCameraPositionsWith (const BodySystem *, Vec3FixedPrec, CameraTarget, CameraKernel);
+
+#endif
@@ -0,0 +1,480 @@
+
+#ifndef SPACE_GAME_FIXED_FORMATS_H
+#define SPACE_GAME_FIXED_FORMATS_H
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "WideInt.h"
+#include "FixedPrecision.h"
+
+
+
+// Family of narrower fixed-point formats, for the simulations that don't
+// need all of 'FixedPrec''s 128 bits: ship-local physics, particles, UI.
+//
+// Every format is generated by one of two macros, and has the same
+// operations as 'FixedPrec' under its own prefix, rounding the same way:
+// products round towards negative infinity, quotients and square roots
+// truncate, and quotients that don't fit saturate. Formats that fit in 64
+// bits do everything in native 64-bit arithmetic, with a single widening
+// multiply or divide where a product or quotient needs 128 bits.
+//
+// Conversions between formats are explicit and checked; see
+// 'FIXED_FORMAT_CONVERSION'. The idea is to keep global coordinates in
+// 'FixedPrec', and only convert into a narrow format once positions are
+// relative to something nearby.
+
+
+
+// Shared helpers.
+
+// Integer square root of a 128-bit integer, rounded down.
+//
+// The double precision estimate is off by at most a few thousand, one
+// Newton step gets it to within one, and comparing squares finishes the
+// job.
+//
+static inline uint64_t fixedIsqrt128 (UInt128 n) {
+    if (n.hi == 0 && n.lo == 0)
+        return 0;
+
+    double estimate = sqrt (fpUInt64ToDouble (n.hi) * 0x1p64 + fpUInt64ToDouble (n.lo));
+    uint64_t root =
+        estimate >= 0x1p64 ? UINT64_MAX :
+        estimate < 1 ? 1 : (uint64_t) estimate;
+
+    // The quotient is close to the root, so it fits in 64 bits unless 'n'
+    // is right at the top of the range.
+    if (n.hi < root) {
+        uint64_t rem, quot = div128by64u (n.hi, n.lo, root, &rem);
+        UInt128 next = shr128u (adc64u (quot, root), 1);
+        root = next.lo;
+    }
+
+    while (lt128u (n, mul64u (root, root)))
+        root--;
+    while (root < UINT64_MAX && !lt128u (n, mul64u (root + 1, root + 1)))
+        root++;
+
+    return root;
+}
+
+// Square root of 'n * 2^fracBits', rounded down, for 'n' below '2^127'
+// and even 'fracBits' up to 64.
+//
+// If 'n * 2^fracBits' fits in 128 bits, that's just an integer square
+// root. Otherwise, after the integer square root of 'n', the rest of the
+// root's bits are found one at a time, from two more bits of input each,
+// as in long-hand square roots. The remainder never gets past twice the
+// root, so nothing overflows.
+//
+static inline UInt128 fixedSqrt128 (UInt128 n, uint32_t fracBits) {
+    UInt128 top = shr128u (n, 128 - fracBits);
+    if (top.hi == 0 && top.lo == 0)
+        return newUInt128 (0, fixedIsqrt128 (shl128u (n, fracBits)));
+
+    uint64_t intRoot = fixedIsqrt128 (n);
+
+    UInt128
+        root        = newUInt128 (0, intRoot),
+        remainder   = wrapSub128u (n, mul64u (intRoot, intRoot));
+
+    for (uint32_t ix = 0; ix < fracBits / 2; ix++) {
+        UInt128 trial = add128u (shl128u (root, 2), newUInt128 (0, 1));
+
+        remainder = shl128u (remainder, 2);
+        root = shl128u (root, 1);
+
+        if (!lt128u (remainder, trial)) {
+            remainder = wrapSub128u (remainder, trial);
+            root.lo |= 1;
+        }
+    }
+
+    return root;
+}
+
+// Rescale a two's complement value held in 128 bits from 'fromBits'
+// fraction bits to 'toBits', checking that it fits in 'width' bits.
+// Dropped fraction bits round towards negative infinity.
+//
+// Returns 1 if it fits. If it doesn't, 'out' is saturated to the largest
+// or smallest 'width'-bit value, and 0 is returned.
+//
+static inline int fixedRescale
+    ( UInt128 a, uint32_t fromBits, uint32_t toBits, uint32_t width
+    , UInt128 *out )
+{
+    UInt128 scaled;
+    int fits = 1;
+
+    if (toBits >= fromBits) {
+        scaled = shl128u (a, toBits - fromBits);
+        UInt128 back = sar128 (scaled, toBits - fromBits);
+        fits = back.hi == a.hi && back.lo == a.lo;
+    } else
+        scaled = sar128 (a, fromBits - toBits);
+
+    if (width < 128) {
+        UInt128 back = sar128 (shl128u (scaled, 128 - width), 128 - width);
+        fits &= back.hi == scaled.hi && back.lo == scaled.lo;
+    }
+
+    if (!fits) {
+        UInt128 largest = shr128u (newUInt128 (UINT64_MAX, UINT64_MAX), 129 - width);
+        *out = MSB64(a.hi) ? newUInt128 (~largest.hi, ~largest.lo) : largest;
+        return 0;
+    }
+
+    *out = scaled;
+    return 1;
+}
+
+
+
+// Fixed-point format held in a single 64-bit integer, 'bits', scaled by
+// '2^FRAC_BITS'.
+//
+// The signed product's high half is the unsigned one's, less each
+// operand wherever the other is negative, as in 'fpMul'. Quotients are a
+// single 128-by-64 division, and square roots a 128-bit integer square
+// root, whose result always fits in 64 bits.
+//
+#define FIXED_FORMAT_64(Type, prefix, FRAC_BITS)                        \
+                                                                        \
+typedef struct Type Type;                                               \
+                                                                        \
+struct Type {                                                           \
+    int64_t bits;                                                       \
+};                                                                      \
+                                                                        \
+_Static_assert ((FRAC_BITS) > 0 && (FRAC_BITS) < 64                     \
+    , #Type " needs between 1 and 63 fraction bits");                   \
+                                                                        \
+enum { prefix##FracBits = (FRAC_BITS), prefix##Width = 64 };            \
+                                                                        \
+static const Type prefix##Max = { INT64_MAX };                          \
+static const Type prefix##Min = { INT64_MIN };                          \
+                                                                        \
+static inline Type prefix##FromBits (int64_t bits) {                    \
+    return (Type) { bits };                                             \
+}                                                                       \
+                                                                        \
+static inline Type prefix##FromInt (int64_t a) {                        \
+    return prefix##FromBits ((int64_t) ((uint64_t) a << (FRAC_BITS)));  \
+}                                                                       \
+                                                                        \
+static inline int prefix##Equal (Type a, Type b) {                      \
+    return a.bits == b.bits;                                            \
+}                                                                       \
+                                                                        \
+static inline int prefix##LessThan (Type a, Type b) {                   \
+    return a.bits < b.bits;                                             \
+}                                                                       \
+                                                                        \
+static inline Type prefix##Add (Type a, Type b) {                       \
+    return prefix##FromBits ((int64_t) ((uint64_t) a.bits + (uint64_t) b.bits)); \
+}                                                                       \
+                                                                        \
+static inline Type prefix##Sub (Type a, Type b) {                       \
+    return prefix##FromBits ((int64_t) ((uint64_t) a.bits - (uint64_t) b.bits)); \
+}                                                                       \
+                                                                        \
+static inline Type prefix##Neg (Type a) {                               \
+    return prefix##FromBits ((int64_t) (0 - (uint64_t) a.bits));        \
+}                                                                       \
+                                                                        \
+static inline Type prefix##Abs (Type a) {                               \
+    uint64_t mask = (uint64_t) (a.bits >> 63);                          \
+    return prefix##FromBits ((int64_t) (((uint64_t) a.bits ^ mask) - mask)); \
+}                                                                       \
+                                                                        \
+static inline Type prefix##Mul (Type a, Type b) {                       \
+    UInt128 product = mul64u ((uint64_t) a.bits, (uint64_t) b.bits);    \
+    product.hi -=                                                       \
+        ((uint64_t) (a.bits >> 63) & (uint64_t) b.bits) +               \
+        ((uint64_t) (b.bits >> 63) & (uint64_t) a.bits);                \
+                                                                        \
+    return prefix##FromBits ((int64_t)                                  \
+        ((product.hi << (64 - (FRAC_BITS))) | (product.lo >> (FRAC_BITS)))); \
+}                                                                       \
+                                                                        \
+static inline Type prefix##Div (Type a, Type b) {                       \
+    if (b.bits == 0) {                                                  \
+        printf ("error: " #prefix "Div: divide by zero exception\n");   \
+        return prefix##FromInt (0);                                     \
+    }                                                                   \
+                                                                        \
+    int negative = (a.bits ^ b.bits) < 0;                               \
+    uint64_t                                                            \
+        num = (uint64_t) prefix##Abs (a).bits,                          \
+        den = (uint64_t) prefix##Abs (b).bits,                          \
+        hi  = num >> (64 - (FRAC_BITS)),                                \
+        rem;                                                            \
+                                                                        \
+    if (hi >= den)                                                      \
+        return negative ? prefix##Min : prefix##Max;                    \
+                                                                        \
+    uint64_t quot = div128by64u (hi, num << (FRAC_BITS), den, &rem);    \
+    if (quot > (uint64_t) INT64_MAX + negative)                         \
+        return negative ? prefix##Min : prefix##Max;                    \
+                                                                        \
+    return prefix##FromBits ((int64_t) (negative ? 0 - quot : quot));   \
+}                                                                       \
+                                                                        \
+static inline Type prefix##Sqr (Type a) {                               \
+    return prefix##Mul (a, a);                                          \
+}                                                                       \
+                                                                        \
+static inline Type prefix##Sqrt (Type a) {                              \
+    if (a.bits < 0) {                                                   \
+        printf ("error: " #prefix "Sqrt: square root of negative number\n"); \
+        return prefix##FromInt (0);                                     \
+    }                                                                   \
+                                                                        \
+    return prefix##FromBits ((int64_t) fixedIsqrt128                     \
+        (shl128u (newUInt128 (0, (uint64_t) a.bits), (FRAC_BITS))));     \
+}                                                                       \
+                                                                        \
+static inline double prefix##ToDouble (Type a) {                        \
+    return (double) a.bits * (1.0 / (double) (1ULL << (FRAC_BITS)));    \
+}                                                                       \
+                                                                        \
+static inline float prefix##ToFloat (Type a) {                          \
+    return (float) a.bits * (float) (1.0 / (double) (1ULL << (FRAC_BITS))); \
+}                                                                       \
+                                                                        \
+static inline Type prefix##FromDouble (double a) {                      \
+    double scaled = floor (a * (double) (1ULL << (FRAC_BITS)));         \
+                                                                        \
+    if (!(scaled < 0x1p63))                                             \
+        return isnan (scaled) ? prefix##FromInt (0) : prefix##Max;      \
+    if (scaled < -0x1p63)                                               \
+        return prefix##Min;                                             \
+                                                                        \
+    return prefix##FromBits ((int64_t) scaled);                         \
+}                                                                       \
+                                                                        \
+static inline UInt128 prefix##Wide (Type a) {                           \
+    return newUInt128 ((uint64_t) (a.bits >> 63), (uint64_t) a.bits);   \
+}                                                                       \
+                                                                        \
+static inline Type prefix##FromWide (UInt128 a) {                       \
+    return prefix##FromBits ((int64_t) a.lo);                           \
+}
+
+// Fixed-point format held in a 128-bit two's complement integer, split
+// into 'hi' and 'lo' halves like 'FixedPrec', but scaled by
+// '2^FRAC_BITS'. 'FRAC_BITS' has to be even, and below 64.
+//
+// Products are the middle of the 256-bit product, corrected for signs as
+// in 'fpMul'. Quotients are the 128-bit integer quotient of the
+// magnitudes, then the fraction bits from the remainder: in one more
+// division if the divisor is small enough that the shifted remainder
+// fits, or one bit at a time if not.
+//
+#define FIXED_FORMAT_128(Type, prefix, FRAC_BITS)                       \
+                                                                        \
+typedef struct Type Type;                                               \
+                                                                        \
+struct Type {                                                           \
+    int64_t hi;                                                         \
+    uint64_t lo;                                                        \
+};                                                                      \
+                                                                        \
+_Static_assert ((FRAC_BITS) > 0 && (FRAC_BITS) < 64 && (FRAC_BITS) % 2 == 0 \
+    , #Type " needs an even number of fraction bits below 64");         \
+                                                                        \
+enum { prefix##FracBits = (FRAC_BITS), prefix##Width = 128 };           \
+                                                                        \
+static const Type prefix##Max = { INT64_MAX, UINT64_MAX };              \
+static const Type prefix##Min = { INT64_MIN, 0 };                       \
+                                                                        \
+static inline Type prefix##FromWide (UInt128 a) {                       \
+    return (Type) { (int64_t) a.hi, a.lo };                             \
+}                                                                       \
+                                                                        \
+static inline UInt128 prefix##Wide (Type a) {                           \
+    return newUInt128 ((uint64_t) a.hi, a.lo);                          \
+}                                                                       \
+                                                                        \
+static inline Type prefix##FromInt (int64_t a) {                        \
+    return prefix##FromWide (shl128u                                    \
+        (newUInt128 ((uint64_t) (a >> 63), (uint64_t) a), (FRAC_BITS))); \
+}                                                                       \
+                                                                        \
+static inline int prefix##Equal (Type a, Type b) {                      \
+    return ((uint64_t) (a.hi ^ b.hi) | (a.lo ^ b.lo)) == 0;             \
+}                                                                       \
+                                                                        \
+static inline int prefix##LessThan (Type a, Type b) {                   \
+    return (a.hi < b.hi) | ((a.hi == b.hi) & (a.lo < b.lo));            \
+}                                                                       \
+                                                                        \
+static inline Type prefix##Add (Type a, Type b) {                       \
+    return prefix##FromWide (add128u (prefix##Wide (a), prefix##Wide (b))); \
+}                                                                       \
+                                                                        \
+static inline Type prefix##Sub (Type a, Type b) {                       \
+    return prefix##FromWide (wrapSub128u (prefix##Wide (a), prefix##Wide (b))); \
+}                                                                       \
+                                                                        \
+static inline Type prefix##Neg (Type a) {                               \
+    return prefix##FromWide (wrapSub128u (newUInt128 (0, 0), prefix##Wide (a))); \
+}                                                                       \
+                                                                        \
+static inline Type prefix##Abs (Type a) {                               \
+    uint64_t mask = (uint64_t) (a.hi >> 63);                            \
+    return prefix##FromWide (wrapSub128u                                \
+        ( newUInt128 ((uint64_t) a.hi ^ mask, a.lo ^ mask)              \
+        , newUInt128 (mask, mask) ));                                   \
+}                                                                       \
+                                                                        \
+static inline Type prefix##Mul (Type a, Type b) {                       \
+    uint64_t                                                            \
+        maskA   = (uint64_t) (a.hi >> 63),                              \
+        maskB   = (uint64_t) (b.hi >> 63);                              \
+                                                                        \
+    UInt256 product = mul128u (prefix##Wide (a), prefix##Wide (b));     \
+    product.hi = wrapSub128u (product.hi, newUInt128                    \
+        ((uint64_t) b.hi & maskA, b.lo & maskA));                       \
+    product.hi = wrapSub128u (product.hi, newUInt128                    \
+        ((uint64_t) a.hi & maskB, a.lo & maskB));                       \
+                                                                        \
+    return prefix##FromWide (shr256u (product, (FRAC_BITS)).lo);        \
+}                                                                       \
+                                                                        \
+static inline Type prefix##Div (Type a, Type b) {                       \
+    if (b.hi == 0 && b.lo == 0) {                                       \
+        printf ("error: " #prefix "Div: divide by zero exception\n");   \
+        return prefix##FromInt (0);                                     \
+    }                                                                   \
+                                                                        \
+    uint64_t negative = (uint64_t) ((a.hi ^ b.hi) >> 63);               \
+    UInt128 den = prefix##Wide (prefix##Abs (b));                       \
+    Quotient128 qr = div128u (prefix##Wide (prefix##Abs (a)), den);     \
+                                                                         \
+    if (shr128u (qr.quotient, 127 - (FRAC_BITS)).lo)                     \
+        return negative ? prefix##Min : prefix##Max;                     \
+                                                                         \
+    UInt128 quot = shl128u (qr.quotient, (FRAC_BITS));                  \
+                                                                         \
+    if (shr128u (den, 128 - (FRAC_BITS)).lo == 0)                        \
+        quot.lo |= div128u (shl128u (qr.remainder, (FRAC_BITS)), den).quotient.lo;  \
+    else                                                                 \
+        for (uint32_t bit = (FRAC_BITS); bit-- > 0;) {                   \
+            uint64_t over = MSB64(qr.remainder.hi);                      \
+            qr.remainder = shl128u (qr.remainder, 1);                    \
+                                                                         \
+            if (over || !lt128u (qr.remainder, den)) {                   \
+                qr.remainder = wrapSub128u (qr.remainder, den);          \
+                quot.lo |= 1ULL << bit;                                  \
+            }                                                            \
+        }                                                                \
+                                                                         \
+    return prefix##FromWide (fpApplyCorrection128                       \
+        (newUInt128 (0, 0), quot, negative));                           \
+}                                                                       \
+                                                                        \
+static inline Type prefix##Sqr (Type a) {                               \
+    return prefix##Mul (a, a);                                          \
+}                                                                       \
+                                                                        \
+static inline Type prefix##Sqrt (Type a) {                              \
+    if (a.hi < 0) {                                                     \
+        printf ("error: " #prefix "Sqrt: square root of negative number\n"); \
+        return prefix##FromInt (0);                                     \
+    }                                                                   \
+                                                                        \
+    return prefix##FromWide (fixedSqrt128 (prefix##Wide (a), (FRAC_BITS))); \
+}                                                                       \
+                                                                        \
+static inline double prefix##ToDouble (Type a) {                        \
+    UInt128 magnitude = prefix##Wide (prefix##Abs (a));                 \
+    double abs = (fpUInt64ToDouble (magnitude.hi) * 0x1p64 +            \
+        fpUInt64ToDouble (magnitude.lo)) * (1.0 / (double) (1ULL << (FRAC_BITS))); \
+                                                                        \
+    return a.hi < 0 ? -abs : abs;                                       \
+}                                                                       \
+                                                                        \
+static inline float prefix##ToFloat (Type a) {                          \
+    return (float) prefix##ToDouble (a);                                \
+}                                                                       \
+                                                                        \
+static inline Type prefix##FromDouble (double a) {                      \
+    double scaled = floor (a * (double) (1ULL << (FRAC_BITS)));         \
+                                                                        \
+    if (!(scaled < 0x1p127))                                            \
+        return isnan (scaled) ? prefix##FromInt (0) : prefix##Max;      \
+    if (scaled < -0x1p127)                                              \
+        return prefix##Min;                                             \
+                                                                        \
+    double hi = floor (scaled * 0x1p-64);                               \
+    return (Type) { (int64_t) hi, (uint64_t) (scaled - hi * 0x1p64) };  \
+}
+
+// Checked conversion from one format to another, named after both, as
+// in 'q32x32ToQ16x48'. 'FixedPrec' takes part under the prefix 'fp'.
+//
+// Returns 1 if the value fits in the new format, to within its fraction
+// bits, which round towards negative infinity. Otherwise the result
+// saturates and 0 is returned.
+//
+#define FIXED_FORMAT_CONVERSION(FromType, fromPrefix, ToType, toPrefix) \
+                                                                        \
+static inline int fromPrefix##To##ToType (FromType a, ToType *out) {    \
+    UInt128 bits;                                                       \
+    int fits = fixedRescale                                             \
+        ( fromPrefix##Wide (a), fromPrefix##FracBits, toPrefix##FracBits \
+        , toPrefix##Width, &bits );                                     \
+                                                                        \
+    *out = toPrefix##FromWide (bits);                                   \
+    return fits;                                                        \
+}
+
+
+
+// The formats.
+
+// 'FixedPrec' itself, so it can take part in conversions.
+//
+enum { fpFracBits = 64, fpWidth = 128 };
+
+static inline UInt128 fpWide (FixedPrec a) {
+    return fpBits (a);
+}
+
+static inline FixedPrec fpFromWide (UInt128 a) {
+    return fpFromBits (a);
+}
+
+// Q32.32: metre-scale local space, a couple of billion either way, to a
+// quarter of a nanometre.
+//
+FIXED_FORMAT_64 (Q32x32, q32x32, 32)
+
+// Q16.48: small values needing more precision, such as directions,
+// rates and particle offsets.
+//
+FIXED_FORMAT_64 (Q16x48, q16x48, 48)
+
+// Q96.32: enormous distances, at no more precision than Q32.32 has.
+//
+FIXED_FORMAT_128 (Q96x32, q96x32, 32)
+
+FIXED_FORMAT_CONVERSION (FixedPrec, fp, Q32x32, q32x32)
+FIXED_FORMAT_CONVERSION (FixedPrec, fp, Q16x48, q16x48)
+FIXED_FORMAT_CONVERSION (FixedPrec, fp, Q96x32, q96x32)
+FIXED_FORMAT_CONVERSION (Q32x32, q32x32, FixedPrec, fp)
+FIXED_FORMAT_CONVERSION (Q32x32, q32x32, Q16x48, q16x48)
+FIXED_FORMAT_CONVERSION (Q32x32, q32x32, Q96x32, q96x32)
+FIXED_FORMAT_CONVERSION (Q16x48, q16x48, FixedPrec, fp)
+FIXED_FORMAT_CONVERSION (Q16x48, q16x48, Q32x32, q32x32)
+FIXED_FORMAT_CONVERSION (Q16x48, q16x48, Q96x32, q96x32)
+FIXED_FORMAT_CONVERSION (Q96x32, q96x32, FixedPrec, fp)
+FIXED_FORMAT_CONVERSION (Q96x32, q96x32, Q32x32, q32x32)
+FIXED_FORMAT_CONVERSION (Q96x32, q96x32, Q16x48, q16x48)
+
+#endif
@@ -0,0 +1,630 @@
+
+// SpaceGame.FixedMath
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "WideInt.h"
+#include "FixedPrecision.h"
+#include "FixedMath.h"
+
+
+
+// Everything here works on 'wide' values: signed 128-bit two's complement
+// integers scaled by 2^120 (Q8.120). That's 56 bits more than the result
+// needs, so the rounding errors of a dozen polynomial steps, each under
+// 2^-120, come nowhere near the final rounding to Q64.64.
+//
+// The constants are the nearest wide values to the exact ones.
+
+#define WIDE_ONE newUInt128 (1ULL << 56, 0)
+
+static const UInt128
+    wideLn2     = { 0x00B17217F7D1CF79, 0xABC9E3B39803F2F7 },
+    widePi      = { 0x03243F6A8885A308, 0xD313198A2E037073 },
+    wideHalfPi  = { 0x01921FB54442D184, 0x69898CC51701B83A };
+
+// ln 2 scaled by 2^126 for the exponential, and how much that overshoots
+// ln 2 by, scaled by 2^254.
+//
+static const UInt128
+    expLn2      = { 0x2C5C85FDF473DE6A, 0xF278ECE600FCBDAC },
+    expLn2Tail  = { 0x2FC32F366359D274, 0x9D7CBA291D154175 };
+
+// 4 / pi, scaled by 2^254, rounded down, in two 128-bit halves; and pi / 4
+// scaled by 2^128.
+//
+static const UInt128
+    fourOverPiHi    = { 0x517CC1B727220A94, 0xFE13ABE8FA9A6EE0 },
+    fourOverPiLo    = { 0x6DB14ACC9E21C820, 0xFF28B1D5EF5DE2B0 },
+    piOverFour      = { 0xC90FDAA22168C234, 0xC4C6628B80DC1CD1 };
+
+// 1 / n!, for the Taylor series of sine, cosine and the exponential.
+//
+static const UInt128 inverseFactorials[24] = {
+    { 0x0100000000000000, 0x0000000000000000 },
+    { 0x0100000000000000, 0x0000000000000000 },
+    { 0x0080000000000000, 0x0000000000000000 },
+    { 0x002AAAAAAAAAAAAA, 0xAAAAAAAAAAAAAAAB },
+    { 0x000AAAAAAAAAAAAA, 0xAAAAAAAAAAAAAAAB },
+    { 0x0002222222222222, 0x2222222222222222 },
+    { 0x00005B05B05B05B0, 0x5B05B05B05B05B06 },
+    { 0x00000D00D00D00D0, 0x0D00D00D00D00D01 },
+    { 0x000001A01A01A01A, 0x01A01A01A01A01A0 },
+    { 0x0000002E3BC74AAD, 0x8E671F5583911CA0 },
+    { 0x000000049F93EDDE, 0x27D71CBBC05B4FAA },
+    { 0x000000006B99159F, 0xD5138E3F9D1F92E1 },
+    { 0x0000000008F76C77, 0xFC6C4BDAA26D4C3D },
+    { 0x0000000000B09230, 0x9D43684BE51C198F },
+    { 0x00000000000C9CBA, 0x54603E4E905D6F8A },
+    { 0x000000000000D73F, 0x9F399DC0F88EC32B },
+    { 0x0000000000000D73, 0xF9F399DC0F88EC33 },
+    { 0x00000000000000CA, 0x963B81856A535930 },
+    { 0x000000000000000B, 0x413C31DCBECBBDD8 },
+    { 0x0000000000000000, 0x97A4DA340A0AB926 },
+    { 0x0000000000000000, 0x07950AE900808942 },
+    { 0x0000000000000000, 0x005C6E3BDB73D5C6 },
+    { 0x0000000000000000, 0x0004338E5B6DFE15 },
+    { 0x0000000000000000, 0x00002EC368262C70 }
+};
+
+// 1 / n, for the series of the logarithm.
+//
+static const UInt128 inverses[13] = {
+    { 0x0000000000000000, 0x0000000000000000 },
+    { 0x0100000000000000, 0x0000000000000000 },
+    { 0x0080000000000000, 0x0000000000000000 },
+    { 0x0055555555555555, 0x5555555555555555 },
+    { 0x0040000000000000, 0x0000000000000000 },
+    { 0x0033333333333333, 0x3333333333333333 },
+    { 0x002AAAAAAAAAAAAA, 0xAAAAAAAAAAAAAAAB },
+    { 0x0024924924924924, 0x9249249249249249 },
+    { 0x0020000000000000, 0x0000000000000000 },
+    { 0x001C71C71C71C71C, 0x71C71C71C71C71C7 },
+    { 0x0019999999999999, 0x999999999999999A },
+    { 0x001745D1745D1745, 0xD1745D1745D1745D },
+    { 0x0015555555555555, 0x5555555555555555 }
+};
+
+#define ATAN_ITERATIONS 26
+
+// atan (2^-i), the angles CORDIC rotates through.
+//
+static const UInt128 atanTable[ATAN_ITERATIONS] = {
+    { 0x00C90FDAA22168C2, 0x34C4C6628B80DC1D },
+    { 0x0076B19C1586ED3D, 0xA2B7F222F65E1D47 },
+    { 0x003EB6EBF25901BA, 0xC55B71E7BD7DE886 },
+    { 0x001FD5BA9AAC2F6D, 0xC65912F313E7D112 },
+    { 0x000FFAADDB967EF4, 0xE36CB2792DC0E2E1 },
+    { 0x0007FF556EEA5D89, 0x2A13BCEBBB6ED463 },
+    { 0x0003FFEAAB776E53, 0x56EF9E31590057DE },
+    { 0x0001FFFD555BBBA9, 0x72D00C46A3F77CC1 },
+    { 0x0000FFFFAAAADDDD, 0xB94BB12AFB6B6D4F },
+    { 0x00007FFFF55556EE, 0xEEA5CA6ADEAB0225 },
+    { 0x00003FFFFEAAAAB7, 0x7776E52E5A019FBD },
+    { 0x00001FFFFFD55555, 0xBBBBBA9729762562 },
+    { 0x00000FFFFFFAAAAA, 0xADDDDDDB94B94D5C },
+    { 0x000007FFFFFF5555, 0x556EEEEEEA5CA5CB },
+    { 0x000003FFFFFFEAAA, 0xAAAB7777776E52E5 },
+    { 0x000001FFFFFFFD55, 0x55555BBBBBBBA973 },
+    { 0x000000FFFFFFFFAA, 0xAAAAAADDDDDDDDB9 },
+    { 0x0000007FFFFFFFF5, 0x55555556EEEEEEEF },
+    { 0x0000003FFFFFFFFE, 0xAAAAAAAAB7777777 },
+    { 0x0000001FFFFFFFFF, 0xD555555555BBBBBC },
+    { 0x0000000FFFFFFFFF, 0xFAAAAAAAAAADDDDE },
+    { 0x00000007FFFFFFFF, 0xFF55555555556EEF },
+    { 0x00000003FFFFFFFF, 0xFFEAAAAAAAAAAB77 },
+    { 0x00000001FFFFFFFF, 0xFFFD55555555555C },
+    { 0x00000000FFFFFFFF, 0xFFFFAAAAAAAAAAAB },
+    { 0x000000007FFFFFFF, 0xFFFFF55555555555 }
+};
+
+// e^(j / 64), for 0 <= j <= 44, covering 0 to ln 2. These are scaled by
+// 2^126, as the exponential works in, not 2^120.
+//
+static const UInt128 expTable[45] = {
+    { 0x4000000000000000, 0x0000000000000000 },
+    { 0x410202AD5778E45E, 0xAE192CFA41139AD1 },
+    { 0x42081580449FB263, 0x82F420EAEA0325EA },
+    { 0x431248DA0A7A2F0A, 0x4B3F98F592CA57A8 },
+    { 0x4420AD5DF4D3B5F5, 0x6C68067889726A54 },
+    { 0x453353F262735915, 0x57A8671B89E71783 },
+    { 0x464A4DC1D38335A2, 0x4F46336EA03AAF0A },
+    { 0x4765AC3BFC39E4F4, 0x563D2699036180B0 },
+    { 0x48858116DBD733E7, 0x3B5A20E1381AE351 },
+    { 0x49A9DE4FD80590AD, 0x75CC3002268382C9 },
+    { 0x4AD2D62CDCB1E540, 0x4DD9F031675F64D3 },
+    { 0x4C007B3D806BDC02, 0xF572258D3FFD55F2 },
+    { 0x4D32E05C2D60D4B5, 0x3831232DF19924D1 },
+    { 0x4E6A18AF4F04197D, 0xD1A79CBD0FC1DD54 },
+    { 0x4FA637AA84772EA8, 0xDDEF7010301455B6 },
+    { 0x50E7510FD7C563B8, 0xE9345E3296F4FA04 },
+    { 0x522D78F0FA06199D, 0x9EF0EDA6EAAF94D4 },
+    { 0x5378C3B08479804E, 0xD488FB285C49A80E },
+    { 0x54C946033EB3DDB2, 0x8B660A648DA7ED94 },
+    { 0x561F14F169EBC09D, 0x8749E00BC9B797D0 },
+    { 0x577A45D8117FD4ED, 0x44C9194C5D5100F1 },
+    { 0x58DAEE6A60C96134, 0x9CC31F7248CF0989 },
+    { 0x5A4124B2FE50CB3F, 0x6BE604148DE9D2CC },
+    { 0x5BACFF156C79D6D2, 0x759337772FCC40E0 },
+    { 0x5D1E944F6FBDA988, 0xD1E2D966C2490171 },
+    { 0x5E95FB7A7A88F78C, 0xFED76DB84BD6403A },
+    { 0x60134C0D1ED5172E, 0xB2E6EDC62252F675 },
+    { 0x61969DDC85931505, 0x77086E85295689CA },
+    { 0x6320091DEC003F70, 0x936D03B614C442FC },
+    { 0x64AFA66826FBFEDC, 0xCDFF3E74FCF27D43 },
+    { 0x66458EB52C77304D, 0xC63DC14D3A280A4C },
+    { 0x67E1DB63A3159941, 0x605FAF5C86607A74 },
+    { 0x6984A638781A6F25, 0xCB7FBEADB7CCFE6C },
+    { 0x6B2E09607BB9514C, 0x6DF64F8511F9DA72 },
+    { 0x6CDE1F7203E57A8B, 0xB33875C18AA0D5B0 },
+    { 0x6E95036E95B957A5, 0xBC04E78E0D70133E },
+    { 0x7052D0C495911910, 0xCAA944EE9088017B },
+    { 0x7217A350FDF341EE, 0x8A30819820013CC2 },
+    { 0x73E397611D62A2DF, 0xB363A513766625D9 },
+    { 0x75B6C9B45B359DF8, 0xE3BFE8A5C48A9F5C },
+    { 0x7791577E038F0172, 0xA25EC1CBDB6A96F1 },
+    { 0x79735E671A9538C8, 0x92A17D446EA3EE32 },
+    { 0x7B5CFC90370507E1, 0xD5EC7137FF693323 },
+    { 0x7D4E5093643D7995, 0xDB473D2B9DC260B4 },
+    { 0x7F4779860BE32274, 0xB0EDB4231965C891 }
+};
+
+// Reciprocals of the midpoints of 1 + j / 64 to 1 + (j + 1) / 64, rounded
+// to 20 bits, and minus their logarithms.
+//
+static const UInt128 logRecips[64] = {
+    { 0x00FE040000000000, 0x0000000000000000 },
+    { 0x00FA233000000000, 0x0000000000000000 },
+    { 0x00F6604000000000, 0x0000000000000000 },
+    { 0x00F2B9D000000000, 0x0000000000000000 },
+    { 0x00EF2EB000000000, 0x0000000000000000 },
+    { 0x00EBBDB000000000, 0x0000000000000000 },
+    { 0x00E865B000000000, 0x0000000000000000 },
+    { 0x00E525A000000000, 0x0000000000000000 },
+    { 0x00E1FC8000000000, 0x0000000000000000 },
+    { 0x00DEE96000000000, 0x0000000000000000 },
+    { 0x00DBEB6000000000, 0x0000000000000000 },
+    { 0x00D901B000000000, 0x0000000000000000 },
+    { 0x00D62B8000000000, 0x0000000000000000 },
+    { 0x00D3681000000000, 0x0000000000000000 },
+    { 0x00D0B6A000000000, 0x0000000000000000 },
+    { 0x00CE169000000000, 0x0000000000000000 },
+    { 0x00CB872000000000, 0x0000000000000000 },
+    { 0x00C907E000000000, 0x0000000000000000 },
+    { 0x00C6981000000000, 0x0000000000000000 },
+    { 0x00C4373000000000, 0x0000000000000000 },
+    { 0x00C1E4C000000000, 0x0000000000000000 },
+    { 0x00BFA03000000000, 0x0000000000000000 },
+    { 0x00BD691000000000, 0x0000000000000000 },
+    { 0x00BB3EE000000000, 0x0000000000000000 },
+    { 0x00B9214000000000, 0x0000000000000000 },
+    { 0x00B70FC000000000, 0x0000000000000000 },
+    { 0x00B509E000000000, 0x0000000000000000 },
+    { 0x00B30F6000000000, 0x0000000000000000 },
+    { 0x00B11FD000000000, 0x0000000000000000 },
+    { 0x00AF3AE000000000, 0x0000000000000000 },
+    { 0x00AD603000000000, 0x0000000000000000 },
+    { 0x00AB8F7000000000, 0x0000000000000000 },
+    { 0x00A9C85000000000, 0x0000000000000000 },
+    { 0x00A80A8000000000, 0x0000000000000000 },
+    { 0x00A655C000000000, 0x0000000000000000 },
+    { 0x00A4A9D000000000, 0x0000000000000000 },
+    { 0x00A3066000000000, 0x0000000000000000 },
+    { 0x00A16B3000000000, 0x0000000000000000 },
+    { 0x009FD81000000000, 0x0000000000000000 },
+    { 0x009E4CB000000000, 0x0000000000000000 },
+    { 0x009CC8E000000000, 0x0000000000000000 },
+    { 0x009B4C7000000000, 0x0000000000000000 },
+    { 0x0099D72000000000, 0x0000000000000000 },
+    { 0x009868D000000000, 0x0000000000000000 },
+    { 0x0097013000000000, 0x0000000000000000 },
+    { 0x0095A02000000000, 0x0000000000000000 },
+    { 0x0094458000000000, 0x0000000000000000 },
+    { 0x0092F11000000000, 0x0000000000000000 },
+    { 0x0091A2B000000000, 0x0000000000000000 },
+    { 0x00905A4000000000, 0x0000000000000000 },
+    { 0x008F178000000000, 0x0000000000000000 },
+    { 0x008DDA5000000000, 0x0000000000000000 },
+    { 0x008CA2A000000000, 0x0000000000000000 },
+    { 0x008B703000000000, 0x0000000000000000 },
+    { 0x008A430000000000, 0x0000000000000000 },
+    { 0x00891AC000000000, 0x0000000000000000 },
+    { 0x0087F78000000000, 0x0000000000000000 },
+    { 0x0086D90000000000, 0x0000000000000000 },
+    { 0x0085BF3000000000, 0x0000000000000000 },
+    { 0x0084AA0000000000, 0x0000000000000000 },
+    { 0x0083993000000000, 0x0000000000000000 },
+    { 0x00828CC000000000, 0x0000000000000000 },
+    { 0x0081849000000000, 0x0000000000000000 },
+    { 0x0080808000000000, 0x0000000000000000 }
+};
+
+static const UInt128 logTable[64] = {
+    { 0x0001FDFAA6B12678, 0x8F18CBE98E72FE3F },
+    { 0x0005EE43A1F57128, 0xAA3FD1288987C921 },
+    { 0x0009CF415CFF61CF, 0xD47B783AC9CB3509 },
+    { 0x000DA175588CCED1, 0x61A7773B23E98A37 },
+    { 0x0011653E8EA397F2, 0xE8F62245359328B2 },
+    { 0x00151B0A1F061C61, 0x692F7A3DD0996AD5 },
+    { 0x0018C341F631A2A2, 0xF5994EFFF3A103EA },
+    { 0x001C5E4BCF5BED8B, 0x14F6C94A902B1EBA },
+    { 0x001FEC8831DC133A, 0xA93B51A06172201A },
+    { 0x00236E516A5ED848, 0x51F27227721B62BE },
+    { 0x0026E3FA803D2170, 0x779EF98AC2CABF3A },
+    { 0x002A4DCE27436B41, 0x45CC7AD87A352207 },
+    { 0x002DAC20CE33A4B9, 0x1AA9420DEF098CE3 },
+    { 0x0030FF3D6A4197D3, 0x203341831C02F29E },
+    { 0x00344777FFC56ACE, 0x326E220B9FDE02FA },
+    { 0x00378506085B314E, 0x53874BE9A0152119 },
+    { 0x003AB84C969FA6AA, 0xB8570ED4C5A285B8 },
+    { 0x003DE15457B8CCB4, 0xA3B2B6007619E9D9 },
+    { 0x00410091B2D34BB5, 0x6B68F5189FA7AD92 },
+    { 0x0044162F46B92B86, 0x627E6DD7DD80E28C },
+    { 0x0047225D85A6770B, 0xEEE2C4809052627F },
+    { 0x004A25682F7A1A8F, 0x7AD24BE945963EE1 },
+    { 0x004D1F76CA61F565, 0x5915A1BFB73187DD },
+    { 0x005010CBDA1ACF16, 0xF5653E00A651AE5B },
+    { 0x0052F983D5DDF1A3, 0x6D69DA7E160F7263 },
+    { 0x0055D9D5DD157ED1, 0x520F507F49FA0946 },
+    { 0x0058B2150AE7491C, 0xBEC54DE71398F2F7 },
+    { 0x005B823F68AE92D6, 0x307205B930F8A2FA },
+    { 0x005E4A9ADF752CFB, 0xF08B2C4B6542DA42 },
+    { 0x00610B44287A31A5, 0x24E0E0424AF650EB },
+    { 0x0063C4733CD9A2BF, 0xF7F1562D29F1F6ED },
+    { 0x0066764CE45FABCD, 0x2DA7778D38AC17C5 },
+    { 0x006920F9A397115A, 0xAF1CBB61A2514368 },
+    { 0x006BC4A5C91DE22C, 0x44CE667DAD05F586 },
+    { 0x006E6168DA4C590D, 0x669A4FEA8CAAEDAA },
+    { 0x0070F75D3F36B627, 0xCECE275895F924B5 },
+    { 0x007386B96E17D375, 0xEDEDC08017C809D2 },
+    { 0x00760F9E7628BEBB, 0x4147A10BB56814EF },
+    { 0x00789216C9F1DEEA, 0x71CD04496165C6FA },
+    { 0x007B0E62A91A3DB2, 0x5D52BF25950773A9 },
+    { 0x007D849229C0A539, 0x85197CF2E19C5492 },
+    { 0x007FF4B7815FD293, 0x565F2C03DCCF60F2 },
+    { 0x00825F01AD4941DB, 0x3009C15A2DD58487 },
+    { 0x0084C36D1ABA0277, 0xC5E146F1E540007E },
+    { 0x00872248CE8E6A11, 0xB74A5E74D521B54C },
+    { 0x00897B95EC9FA8AA, 0x9910EA2ABA186FDF },
+    { 0x008BCF56DEC4CD85, 0xFE30C8D2597EC62B },
+    { 0x008E1DC71B89F3E7, 0xE4F45F930868A52E },
+    { 0x009066ED2C95715E, 0x9AE2D552E4EBA7EC },
+    { 0x0092AAD0F4C81979, 0xDCEDB6F6F7E112B8 },
+    { 0x0094E9B4F615C0D6, 0x412B0BC0CFFCB2E0 },
+    { 0x009723A5572019D4, 0x02B0ED0A118DF265 },
+    { 0x00995892889105D1, 0x8FABAF0BE1203616 },
+    { 0x009B88C58A3A5CB0, 0x2F8ADCC5E86BE4A2 },
+    { 0x009DB41450004315, 0x78E44B8705EEE546 },
+    { 0x009FDAE9A68BD532, 0xDDA90AA355233CBD },
+    { 0x00A1FD0017CE73BB, 0xD39432305D0620C2 },
+    { 0x00A41AA88F5478FB, 0x9FFC9B389A542826 },
+    { 0x00A633DB9E67D58F, 0x8EF2C9E5C12DFCCE },
+    { 0x00A84892600B8B5A, 0x5C19D2EC9AB55C6D },
+    { 0x00AA5923DCCCA4EF, 0x48AA292F742092BE },
+    { 0x00AC656D2E6BCC69, 0x84978841ED9EDAA7 },
+    { 0x00AE6D8A4360C5D6, 0x679624047FFAA2A4 },
+    { 0x00B07198A23C4746, 0x53E4A025B00BAA99 }
+};
+
+// Wide arithmetic.
+
+// Multiply wide values, rounding down. The unsigned product is corrected
+// for negative operands just as in 'fpMul'.
+//
+static inline UInt128 wideMul (UInt128 a, UInt128 b) {
+    uint64_t
+        maskA   = (uint64_t) ((int64_t) a.hi >> 63),
+        maskB   = (uint64_t) ((int64_t) b.hi >> 63);
+
+    UInt256 product = mul128u (a, b);
+    product.hi = wrapSub128u (product.hi, newUInt128 (b.hi & maskA, b.lo & maskA));
+    product.hi = wrapSub128u (product.hi, newUInt128 (a.hi & maskB, a.lo & maskB));
+
+    return shr256u (product, 120).lo;
+}
+
+// Multiply a wide value by a small integer.
+//
+static inline UInt128 wideScale (UInt128 a, int64_t n) {
+    UInt128 product = mul128u (a, newUInt128 (0, (uint64_t) (n < 0 ? -n : n))).lo;
+    return n < 0 ? wrapSub128u (newUInt128 (0, 0), product) : product;
+}
+
+static inline int wideNegative (UInt128 a) {
+    return MSB64(a.hi) != 0;
+}
+
+// Round a wide value to the nearest fixed-precision value.
+//
+static inline FixedPrec fpFromWide (UInt128 a) {
+    return fpFromBits (sar128 (add128u (a, newUInt128 (0, 1ULL << 55)), 56));
+}
+
+
+// Sine and cosine.
+
+// Reduce the magnitude of a fixed-precision value modulo pi / 4, giving
+// the octant it's in, modulo 8, and how far into it it is as a fraction
+// of pi / 4, scaled by 2^128.
+//
+// This is the Payne-Hanek method: multiplying by 4 / pi to 256 bits gives
+// the octant and the fraction straight off, exact to about 2^-190 for
+// any input, where subtracting multiples of a rounded pi would lose
+// everything for large ones. The product is scaled by 2^318, and only
+// its bits 190 to 320 are needed.
+//
+static unsigned int reduceOctant (UInt128 magnitude, UInt128 *fraction) {
+    UInt256
+        lo  = mul128u (magnitude, fourOverPiLo),
+        hi  = mul128u (magnitude, fourOverPiHi);
+
+    UInt128
+        mid = add128u (lo.hi, hi.lo),
+        top = add128u (hi.hi, newUInt128 (0, lt128u (mid, lo.hi)));
+
+    UInt128 low = shr128u (mid, 62), high = shl128u (top, 66);
+    *fraction = newUInt128 (low.hi | high.hi, low.lo | high.lo);
+
+    return (unsigned int) ((top.lo >> 62) | (top.hi << 2)) & 7;
+}
+
+// Compute the sine and cosine of a fixed-precision value together.
+//
+// After reducing the argument to an octant, odd octants are reflected,
+// so that the Taylor series only ever see '0 <= r < pi / 4'. There, 12
+// terms of each are good to 2^-77. The octant then decides which of
+// them is the sine, and the signs.
+//
+void fpSinCos (FixedPrec a, FixedPrec *sine, FixedPrec *cosine) {
+    UInt128 fraction;
+    unsigned int octant = reduceOctant (fpBits (fpAbs (a)), &fraction);
+
+    if (octant & 1)
+        fraction = newUInt128 (~fraction.hi, ~fraction.lo);
+
+    UInt128
+        r   = shr128u (mul128u (fraction, piOverFour).hi, 8),
+        u   = wideMul (r, r),
+        s   = inverseFactorials[23],
+        c   = inverseFactorials[22];
+
+    for (int n = 21; n >= 1; n -= 2) {
+        s = wrapSub128u (inverseFactorials[n], wideMul (u, s));
+        c = wrapSub128u (inverseFactorials[n - 1], wideMul (u, c));
+    }
+
+    s = wideMul (r, s);
+
+    int swap = (octant + 1) & 2;
+    FixedPrec
+        sin = fpFromWide (swap ? c : s),
+        cos = fpFromWide (swap ? s : c);
+
+    if ((octant & 4) != (a.wholePart < 0 ? 4u : 0u))
+        sin = fpNeg (sin);
+    if ((octant + 2) & 4)
+        cos = fpNeg (cos);
+
+    *sine = sin;
+    *cosine = cos;
+}
+
+FixedPrec fpSin (FixedPrec a) {
+    FixedPrec sine, cosine;
+    fpSinCos (a, &sine, &cosine);
+    return sine;
+}
+
+FixedPrec fpCos (FixedPrec a) {
+    FixedPrec sine, cosine;
+    fpSinCos (a, &sine, &cosine);
+    return cosine;
+}
+
+
+// Arctangent.
+
+// Compute the angle of the point '(x, y)' from the positive x axis, in
+// '[-pi, pi]', as 'atan2' does. The angle of the origin is 0.
+//
+// The point is reflected into the first octant and scaled up to 125
+// bits, then CORDIC rotates it onto the x axis, adding up the angles
+// rotated through. That takes only shifts and adds, but gives a bit per
+// iteration; after 26, though, what's left of the angle is below 2^-25,
+// so it's 'y / x' to within 2^-76, and one division finishes the job.
+//
+FixedPrec fpAtan2 (FixedPrec y, FixedPrec x) {
+    UInt128
+        ax  = fpBits (fpAbs (x)),
+        ay  = fpBits (fpAbs (y));
+
+    if ((ax.hi | ax.lo | ay.hi | ay.lo) == 0)
+        return fpFromInt (0);
+
+    int swapped = lt128u (ax, ay);
+    if (swapped) {
+        UInt128 t = ax;
+        ax = ay;
+        ay = t;
+    }
+
+    uint32_t lead = clz128u (ax);
+    UInt128
+        cx      = lead >= 3 ? shl128u (ax, lead - 3) : shr128u (ax, 3 - lead),
+        cy      = lead >= 3 ? shl128u (ay, lead - 3) : shr128u (ay, 3 - lead),
+        angle   = newUInt128 (0, 0);
+
+    for (uint32_t ix = 0; ix < ATAN_ITERATIONS; ix++) {
+        UInt128 dx = sar128 (cy, ix), dy = shr128u (cx, ix);
+
+        if (wideNegative (cy)) {
+            cx = wrapSub128u (cx, dx);
+            cy = add128u (cy, dy);
+            angle = wrapSub128u (angle, atanTable[ix]);
+        } else {
+            cx = add128u (cx, dx);
+            cy = wrapSub128u (cy, dy);
+            angle = add128u (angle, atanTable[ix]);
+        }
+    }
+
+    // 'cx' has grown to between 2^124 and 2^127, and '|cy|' is below 2^102,
+    // so the top 64 bits of 'cx' are plenty for a quotient below 2^-24.
+    // That's '|cy| 2^56 / d', two digits of long division.
+    int negative = wideNegative (cy);
+    UInt128 magnitude = negative ? wrapSub128u (newUInt128 (0, 0), cy) : cy;
+
+    uint64_t
+        d       = cx.hi,
+        top     = magnitude.hi >> 8,
+        mid     = (magnitude.hi << 56) | (magnitude.lo >> 8),
+        bottom  = magnitude.lo << 56,
+        rem;
+
+    UInt128 rest;
+    rest.hi = div128by64u (top, mid, d, &rem);
+    rest.lo = div128by64u (rem, bottom, d, &rem);
+
+    angle = negative ? wrapSub128u (angle, rest) : add128u (angle, rest);
+
+    if (swapped)
+        angle = wrapSub128u (wideHalfPi, angle);
+    if (x.wholePart < 0)
+        angle = wrapSub128u (widePi, angle);
+
+    FixedPrec result = fpFromWide (angle);
+    return y.wholePart < 0 ? fpNeg (result) : result;
+}
+
+
+// Exponential and logarithm.
+
+#define EXP_TERMS 16
+
+// Multiply unsigned values scaled by 2^126, rounding down.
+//
+static inline UInt128 expMul (UInt128 a, UInt128 b) {
+    return shr256u (mul128u (a, b), 126).lo;
+}
+
+// Compute 'e^a'. Results too large for Q64.64 saturate.
+//
+// With 'a = k ln 2 + r' and '0 <= r < ln 2', 'e^a = 2^k e^r'. The top six
+// bits of 'r / 64' pick 'e^(j / 64)' from a table, and the Taylor series
+// for the rest, below 1 / 64, is good to 2^-140 after 16 terms.
+//
+// Scaling by 2^k scales the error of 'e^r' too, so for 'k' near 56, where
+// a unit in the last place of the result is 2^-120 of 'e^r', the wide
+// format's 2^-120 isn't enough. Instead 'r' and 'e^r' are unsigned and
+// scaled by 2^126 (Q2.126), keeping six more bits.
+//
+FixedPrec fpExp (FixedPrec a) {
+    // e^44 > 2^63, and e^-45 < 2^-65.
+    if (a.wholePart >= 44)
+        return fpMax;
+    if (a.wholePart < -45)
+        return fpFromInt (0);
+
+    // About 'a / ln 2', then corrected. 'a' itself doesn't fit in Q2.126,
+    // but 'r' does, and the arithmetic wraps, so only 'r' needs to.
+    int64_t k = a.wholePart * 94548 / 65536;
+    UInt128 r = wrapSub128u (shl128u (fpBits (a), 62), wideScale (expLn2, k));
+
+    // Putting back what 'k' times the rounding of ln 2 took away keeps 'r'
+    // exact to 2^-126, however large 'k' is.
+    UInt128 tail = mul128u (expLn2Tail, newUInt128 (0, (uint64_t) (k < 0 ? -k : k))).hi;
+    r = k < 0 ? wrapSub128u (r, tail) : add128u (r, tail);
+
+    for (; wideNegative (r); k--)
+        r = add128u (r, expLn2);
+    for (; !lt128u (r, expLn2); k++)
+        r = wrapSub128u (r, expLn2);
+
+    // The factorials lose their last six bits to the shift, but only from
+    // 1 / 3! on, where 'h^n' is below 2^-18.
+    unsigned int j = (unsigned int) shr128u (r, 120).lo;
+    UInt128
+        h   = wrapSub128u (r, shl128u (newUInt128 (0, j), 120)),
+        p   = shl128u (inverseFactorials[EXP_TERMS - 1], 6);
+
+    for (int n = EXP_TERMS - 2; n >= 0; n--)
+        p = add128u (shl128u (inverseFactorials[n], 6), expMul (h, p));
+
+    // 'e^r', between 1 and 2, shifted into place as Q64.64.
+    UInt128 e = expMul (expTable[j], p);
+
+    if (k >= 63)
+        return fpMax;
+    if (k == 62)
+        return fpFromBits (e);
+
+    return fpFromBits (shr128u
+        ( add128u (e, shl128u (newUInt128 (0, 1), (uint32_t) (61 - k)))
+        , (uint32_t) (62 - k) ));
+}
+
+// Compute the natural logarithm of a positive fixed-precision value.
+//
+// With 'a = 2^k m' and '1 <= m < 2', 'log a = k ln 2 + log m'. The top six
+// bits of 'm''s fraction pick a reciprocal 'c' from a table, short enough
+// that 'm c' is exact, with 'm c = 1 + d' and '|d| < 2^-7'. Then
+// 'log m = log (1 + d) - log c', where the series for 'log (1 + d)' is
+// good to 2^-80 after 11 terms, and '-log c' comes from another table.
+//
+// Logarithms of zero or negative numbers are an error, and return the
+// most negative fixed-precision value.
+//
+FixedPrec fpLog (FixedPrec a) {
+    // Exceptional case
+    if (a.wholePart < 0 || (a.wholePart == 0 && a.decPart == 0)) {
+        printf ("error: fpLog: logarithm of non-positive number\n");
+        return fpMin;
+    }
+
+    UInt128 n = fpBits (a);
+    uint32_t lead = clz128u (n);
+    UInt128 m = shl128u (n, lead);
+
+    unsigned int j = (unsigned int) (m.hi >> 57) & 63;
+    UInt128
+        d   = wrapSub128u (wideMul (shr128u (m, 7), logRecips[j]), WIDE_ONE),
+        q   = inverses[11];
+
+    for (int ix = 10; ix >= 1; ix--)
+        q = wrapSub128u (inverses[ix], wideMul (d, q));
+
+    UInt128 result = add128u
+        ( add128u (wideScale (wideLn2, 63 - (int64_t) lead), logTable[j])
+        , wideMul (d, q) );
+
+    return fpFromWide (result);
+}
+
+
+// Batched versions.
+
+void fpSinCosArray (const FixedPrec *as, FixedPrec *sines, FixedPrec *cosines, unsigned int n) {
+    for (unsigned int ix = 0; ix < n; ix++) {
+        FixedPrec sine, cosine;
+        fpSinCos (as[ix], &sine, &cosine);
+
+        sines[ix] = sine;
+        cosines[ix] = cosine;
+    }
+}
+
+void fpAtan2Array (const FixedPrec *ys, const FixedPrec *xs, FixedPrec *angles, unsigned int n) {
+    for (unsigned int ix = 0; ix < n; ix++)
+        angles[ix] = fpAtan2 (ys[ix], xs[ix]);
+}
+
+void fpExpArray (const FixedPrec *as, FixedPrec *results, unsigned int n) {
+    for (unsigned int ix = 0; ix < n; ix++)
+        results[ix] = fpExp (as[ix]);
+}
+
+void fpLogArray (const FixedPrec *as, FixedPrec *results, unsigned int n) {
+    for (unsigned int ix = 0; ix < n; ix++)
+        results[ix] = fpLog (as[ix]);
+}
@@ -0,0 +1,40 @@
+
+#ifndef SPACE_GAME_FIXED_MATH_H
+#define SPACE_GAME_FIXED_MATH_H
+
+#include "FixedPrecision.h"
+
+// Transcendental functions of fixed-precision values.
+//
+// Everything is computed in 128-bit integer arithmetic, with no floating
+// point anywhere, so results are bit-identical on every platform and
+// compiler. Results are within one unit in the last place (2^-64) of the
+// exact value, for every input, except for exponentials above 2^56, which
+// are within four units, and so good to 120 significant bits.
+//
+// Nearest fixed-precision values to some constants.
+//
+static const FixedPrec fpPi       = { 3, 0x243F6A8885A308D3 };
+static const FixedPrec fpHalfPi   = { 1, 0x921FB54442D1846A };
+static const FixedPrec fpTwoPi    = { 6, 0x487ED5110B4611A6 };
+static const FixedPrec fpE        = { 2, 0xB7E151628AED2A6B };
+static const FixedPrec fpLn2      = { 0, 0xB17217F7D1CF79AC };
+
+FixedPrec fpSin (FixedPrec);
+FixedPrec fpCos (FixedPrec);
+void fpSinCos (FixedPrec, FixedPrec *, FixedPrec *);
+
+FixedPrec fpAtan2 (FixedPrec, FixedPrec);
+
+FixedPrec fpExp (FixedPrec);
+FixedPrec fpLog (FixedPrec);
+
+// Batched versions, over arrays of 'n' values. Outputs may alias the
+// inputs.
+//
+void fpSinCosArray (const FixedPrec *, FixedPrec *, FixedPrec *, unsigned int);
+void fpAtan2Array (const FixedPrec *, const FixedPrec *, FixedPrec *, unsigned int);
+void fpExpArray (const FixedPrec *, FixedPrec *, unsigned int);
+void fpLogArray (const FixedPrec *, FixedPrec *, unsigned int);
+
+#endif
@@ -0,0 +1,335 @@
+
+#ifndef SPACE_GAME_FIXED_PREC_VECTOR_H
+#define SPACE_GAME_FIXED_PREC_VECTOR_H
+
+#include <stdint.h>
+
+#include "FixedPrecision.h"
+#include "BodySystem.h"
+
+// Vectors of fixed-precision values, one per 64-bit lane, for the AVX2
+// and AVX-512 kernels.
+//
+// Every operation here is exact, or rounds exactly as its scalar
+// counterpart in 'FixedPrecision.h' does, so vector kernels built on them
+// can give bit-identical results to scalar ones. The functions are
+// compiled for their instruction sets with target attributes, so callers
+// need no special flags, only a runtime check that the CPU has them.
+//
+#if defined (__x86_64__) && (defined (__GNUC__) || defined (__clang__))
+#define FIXED_PREC_X86 1
+#include <immintrin.h>
+#else
+#define FIXED_PREC_X86 0
+#endif
+
+// Sum the lanes of a vector of fixed-precision values.
+//
+static inline FixedPrec fpSumLanes (const int64_t *wholePart, const uint64_t *decPart, unsigned int n) {
+    FixedPrec sum = fpFromInt (0);
+    for (unsigned int lane = 0; lane < n; lane++)
+        sum = fpAdd (sum, newFixedPrec (wholePart[lane], decPart[lane]));
+
+    return sum;
+}
+
+#if FIXED_PREC_X86
+
+
+// type FixedPrec4
+
+// Four fixed-precision values, one per 64-bit lane.
+//
+typedef struct FixedPrec4 FixedPrec4;
+
+struct FixedPrec4 {
+    __m256i wholePart;
+    __m256i decPart;
+};
+
+#define TARGET_AVX2 __attribute__ ((target ("avx2")))
+
+TARGET_AVX2
+static inline FixedPrec4 fp4Load (FixedPrecColumn col, unsigned int ix) {
+    return (FixedPrec4) {
+        _mm256_loadu_si256 ((const __m256i *) (col.wholePart + ix)),
+        _mm256_loadu_si256 ((const __m256i *) (col.decPart + ix))
+    };
+}
+
+TARGET_AVX2
+static inline void fp4Store (FixedPrecColumn col, unsigned int ix, FixedPrec4 a) {
+    _mm256_storeu_si256 ((__m256i *) (col.wholePart + ix), a.wholePart);
+    _mm256_storeu_si256 ((__m256i *) (col.decPart + ix), a.decPart);
+}
+
+TARGET_AVX2
+static inline FixedPrec4 fp4Broadcast (FixedPrec a) {
+    return (FixedPrec4) {
+        _mm256_set1_epi64x (a.wholePart),
+        _mm256_set1_epi64x ((int64_t) a.decPart)
+    };
+}
+
+// AVX2 only has signed 64-bit comparisons, so flip the sign bits first.
+//
+TARGET_AVX2
+static inline __m256i fp4LessThanU (__m256i a, __m256i b) {
+    __m256i bias = _mm256_set1_epi64x (INT64_MIN);
+    return _mm256_cmpgt_epi64
+        (_mm256_xor_si256 (b, bias), _mm256_xor_si256 (a, bias));
+}
+
+TARGET_AVX2
+static inline FixedPrec4 fp4Add (FixedPrec4 a, FixedPrec4 b) {
+    __m256i
+        decPart = _mm256_add_epi64 (a.decPart, b.decPart),
+        carry   = fp4LessThanU (decPart, b.decPart);
+
+    return (FixedPrec4) {
+        _mm256_sub_epi64 (_mm256_add_epi64 (a.wholePart, b.wholePart), carry),
+        decPart
+    };
+}
+
+TARGET_AVX2
+static inline FixedPrec4 fp4Sub (FixedPrec4 a, FixedPrec4 b) {
+    __m256i borrow = fp4LessThanU (a.decPart, b.decPart);
+
+    return (FixedPrec4) {
+        _mm256_add_epi64 (_mm256_sub_epi64 (a.wholePart, b.wholePart), borrow),
+        _mm256_sub_epi64 (a.decPart, b.decPart)
+    };
+}
+
+// Vector 'fpUInt64ToDouble', which AVX2 has no instruction for.
+//
+TARGET_AVX2
+static inline __m256d fp4UInt64ToDouble (__m256i a) {
+    __m256i
+        high = _mm256_or_si256
+            (_mm256_srli_epi64 (a, 32), _mm256_castpd_si256 (_mm256_set1_pd (0x1p84))),
+        low = _mm256_blend_epi32
+            (a, _mm256_castpd_si256 (_mm256_set1_pd (0x1p52)), 0xAA);
+
+    __m256d highD = _mm256_sub_pd
+        (_mm256_castsi256_pd (high), _mm256_set1_pd (0x1p84 + 0x1p52));
+
+    return _mm256_add_pd (highD, _mm256_castsi256_pd (low));
+}
+
+// Vector 'fpToDouble'.
+//
+TARGET_AVX2
+static inline __m256d fp4ToDouble (FixedPrec4 a) {
+    __m256i
+        zero        = _mm256_setzero_si256 (),
+        negative    = _mm256_cmpgt_epi64 (zero, a.wholePart);
+
+    // Negate where negative, as in 'fp4FromDouble'.
+    __m256i
+        decPart = _mm256_sub_epi64 (_mm256_xor_si256 (a.decPart, negative), negative),
+        carry   = _mm256_and_si256 (negative, _mm256_cmpeq_epi64 (decPart, zero)),
+        wholePart = _mm256_sub_epi64 (_mm256_xor_si256 (a.wholePart, negative), carry);
+
+    __m256d abs = _mm256_add_pd
+        ( fp4UInt64ToDouble (wholePart)
+        , _mm256_mul_pd (fp4UInt64ToDouble (decPart), _mm256_set1_pd (0x1p-64)) );
+
+    return _mm256_xor_pd (abs, _mm256_castsi256_pd
+        (_mm256_and_si256 (negative, _mm256_set1_epi64x (INT64_MIN))));
+}
+
+// Vector 'fpFromDouble'.
+//
+TARGET_AVX2
+static inline FixedPrec4 fp4FromDouble (__m256d a) {
+    __m256i
+        bits        = _mm256_castpd_si256 (a),
+        zero        = _mm256_setzero_si256 (),
+        negative    = _mm256_cmpgt_epi64 (zero, bits),
+        exponent    = _mm256_and_si256
+            (_mm256_srli_epi64 (bits, 52), _mm256_set1_epi64x (0x7FF)),
+        significand = _mm256_or_si256
+            ( _mm256_and_si256 (bits, _mm256_set1_epi64x (0xFFFFFFFFFFFFF))
+            , _mm256_set1_epi64x (1LL << 52) ),
+        shift       = _mm256_sub_epi64 (exponent, _mm256_set1_epi64x (1011)),
+        overflow    = _mm256_cmpgt_epi64 (shift, _mm256_set1_epi64x (74));
+
+    __m256i
+        decPart = _mm256_or_si256
+            ( _mm256_sllv_epi64 (significand, shift)
+            , _mm256_srlv_epi64 (significand, _mm256_sub_epi64 (zero, shift)) ),
+        wholePart = _mm256_or_si256
+            ( _mm256_srlv_epi64
+                (significand, _mm256_sub_epi64 (_mm256_set1_epi64x (64), shift))
+            , _mm256_sllv_epi64
+                (significand, _mm256_sub_epi64 (shift, _mm256_set1_epi64x (64))) );
+
+    decPart = _mm256_or_si256 (decPart, overflow);
+    wholePart = _mm256_blendv_epi8
+        (wholePart, _mm256_set1_epi64x (INT64_MAX), overflow);
+
+    // Two's complement negation where the sign bit was set.
+    __m256i carry = _mm256_and_si256
+        (negative, _mm256_cmpeq_epi64 (decPart, zero));
+
+    return (FixedPrec4) {
+        _mm256_sub_epi64 (_mm256_xor_si256 (wholePart, negative), carry),
+        _mm256_sub_epi64 (_mm256_xor_si256 (decPart, negative), negative)
+    };
+}
+
+TARGET_AVX2
+static inline FixedPrec fp4Sum (FixedPrec4 a) {
+    int64_t wholePart[4];
+    uint64_t decPart[4];
+
+    _mm256_storeu_si256 ((__m256i *) wholePart, a.wholePart);
+    _mm256_storeu_si256 ((__m256i *) decPart, a.decPart);
+
+    return fpSumLanes (wholePart, decPart, 4);
+}
+
+
+// type FixedPrec8
+
+// Eight fixed-precision values, one per 64-bit lane.
+//
+typedef struct FixedPrec8 FixedPrec8;
+
+struct FixedPrec8 {
+    __m512i wholePart;
+    __m512i decPart;
+};
+
+#define TARGET_AVX512 __attribute__ ((target ("avx512f,avx512dq")))
+
+TARGET_AVX512
+static inline FixedPrec8 fp8Load (FixedPrecColumn col, unsigned int ix) {
+    return (FixedPrec8) {
+        _mm512_loadu_si512 (col.wholePart + ix),
+        _mm512_loadu_si512 (col.decPart + ix)
+    };
+}
+
+TARGET_AVX512
+static inline void fp8Store (FixedPrecColumn col, unsigned int ix, FixedPrec8 a) {
+    _mm512_storeu_si512 (col.wholePart + ix, a.wholePart);
+    _mm512_storeu_si512 (col.decPart + ix, a.decPart);
+}
+
+TARGET_AVX512
+static inline FixedPrec8 fp8Broadcast (FixedPrec a) {
+    return (FixedPrec8) {
+        _mm512_set1_epi64 (a.wholePart),
+        _mm512_set1_epi64 ((int64_t) a.decPart)
+    };
+}
+
+TARGET_AVX512
+static inline FixedPrec8 fp8Add (FixedPrec8 a, FixedPrec8 b) {
+    __m512i
+        decPart     = _mm512_add_epi64 (a.decPart, b.decPart),
+        wholePart   = _mm512_add_epi64 (a.wholePart, b.wholePart);
+
+    __mmask8 carry = _mm512_cmplt_epu64_mask (decPart, b.decPart);
+
+    return (FixedPrec8) {
+        _mm512_mask_add_epi64
+            (wholePart, carry, wholePart, _mm512_set1_epi64 (1)),
+        decPart
+    };
+}
+
+TARGET_AVX512
+static inline FixedPrec8 fp8Sub (FixedPrec8 a, FixedPrec8 b) {
+    __m512i wholePart = _mm512_sub_epi64 (a.wholePart, b.wholePart);
+    __mmask8 borrow = _mm512_cmplt_epu64_mask (a.decPart, b.decPart);
+
+    return (FixedPrec8) {
+        _mm512_mask_sub_epi64
+            (wholePart, borrow, wholePart, _mm512_set1_epi64 (1)),
+        _mm512_sub_epi64 (a.decPart, b.decPart)
+    };
+}
+
+// Vector 'fpToDouble'.
+//
+TARGET_AVX512
+static inline __m512d fp8ToDouble (FixedPrec8 a) {
+    __m512i
+        zero        = _mm512_setzero_si512 (),
+        negative    = _mm512_srai_epi64 (a.wholePart, 63);
+
+    // Negate where negative, as in 'fp8FromDouble'.
+    __m512i decPart = _mm512_sub_epi64 (_mm512_xor_si512 (a.decPart, negative), negative);
+    __m512i carry = _mm512_maskz_mov_epi64
+        (_mm512_cmpeq_epi64_mask (decPart, zero), negative);
+    __m512i wholePart = _mm512_sub_epi64 (_mm512_xor_si512 (a.wholePart, negative), carry);
+
+    __m512d abs = _mm512_add_pd
+        ( _mm512_cvtepu64_pd (wholePart)
+        , _mm512_mul_pd (_mm512_cvtepu64_pd (decPart), _mm512_set1_pd (0x1p-64)) );
+
+    return _mm512_castsi512_pd (_mm512_xor_si512
+        ( _mm512_castpd_si512 (abs)
+        , _mm512_and_si512 (negative, _mm512_set1_epi64 (INT64_MIN)) ));
+}
+
+// Vector 'fpFromDouble'.
+//
+TARGET_AVX512
+static inline FixedPrec8 fp8FromDouble (__m512d a) {
+    __m512i
+        bits        = _mm512_castpd_si512 (a),
+        zero        = _mm512_setzero_si512 (),
+        negative    = _mm512_srai_epi64 (bits, 63),
+        exponent    = _mm512_and_si512
+            (_mm512_srli_epi64 (bits, 52), _mm512_set1_epi64 (0x7FF)),
+        significand = _mm512_or_si512
+            ( _mm512_and_si512 (bits, _mm512_set1_epi64 (0xFFFFFFFFFFFFF))
+            , _mm512_set1_epi64 (1LL << 52) ),
+        shift       = _mm512_sub_epi64 (exponent, _mm512_set1_epi64 (1011));
+
+    __mmask8 overflow = _mm512_cmpgt_epi64_mask (shift, _mm512_set1_epi64 (74));
+
+    __m512i
+        decPart = _mm512_or_si512
+            ( _mm512_sllv_epi64 (significand, shift)
+            , _mm512_srlv_epi64 (significand, _mm512_sub_epi64 (zero, shift)) ),
+        wholePart = _mm512_or_si512
+            ( _mm512_srlv_epi64
+                (significand, _mm512_sub_epi64 (_mm512_set1_epi64 (64), shift))
+            , _mm512_sllv_epi64
+                (significand, _mm512_sub_epi64 (shift, _mm512_set1_epi64 (64))) );
+
+    decPart = _mm512_mask_mov_epi64
+        (decPart, overflow, _mm512_set1_epi64 (-1));
+    wholePart = _mm512_mask_mov_epi64
+        (wholePart, overflow, _mm512_set1_epi64 (INT64_MAX));
+
+    // Two's complement negation where the sign bit was set.
+    __m512i carry = _mm512_maskz_mov_epi64
+        (_mm512_cmpeq_epi64_mask (decPart, zero), negative);
+
+    return (FixedPrec8) {
+        _mm512_sub_epi64 (_mm512_xor_si512 (wholePart, negative), carry),
+        _mm512_sub_epi64 (_mm512_xor_si512 (decPart, negative), negative)
+    };
+}
+
+TARGET_AVX512
+static inline FixedPrec fp8Sum (FixedPrec8 a) {
+    int64_t wholePart[8];
+    uint64_t decPart[8];
+
+    _mm512_storeu_si512 (wholePart, a.wholePart);
+    _mm512_storeu_si512 (decPart, a.decPart);
+
+    return fpSumLanes (wholePart, decPart, 8);
+}
+
+#endif
+
+#endif
@@ -11,135 +11,381 @@
 
 
 
-// Store a fixed-precision decimal value as a pair of 64-bit unsigned
-// integers, along with the sign.
+// Store a fixed-precision decimal value as a signed 128-bit two's
+// complement integer, scaled by 2^64 (Q64.64).
+//
+// 'wholePart' is the top half, so it holds the integer part rounded
+// towards negative infinity, and 'decPart' holds the fraction on top of
+// it. For example, -16.5 is stored as
+//
+//  wholePart == -17, decPart == 0x8000000000000000
+//
+// The upshot of two's complement is that addition, subtraction and
+// comparison are just the 128-bit integer operations, with no sign
+// handling and no branches.
 //
 typedef struct FixedPrec FixedPrec;
 
 struct FixedPrec {
-    int sign;
-    uint64_t wholePart;
+    int64_t wholePart;
     uint64_t decPart;
 };
 
+_Static_assert (sizeof (FixedPrec) == 16, "FixedPrec should be 128 bits");
+
+// Create a new fixed-precision value from its two halves.
+//
+static inline FixedPrec newFixedPrec (int64_t wholePart, uint64_t decPart) {
+    return (FixedPrec) { wholePart, decPart };
+}
+
+// Create a fixed-precision value from an integer.
+//
+static inline FixedPrec fpFromInt (int64_t a) {
+    return newFixedPrec (a, 0);
+}
+
+// Reinterpret a fixed-precision value as a 128-bit integer, and back.
+//
+static inline UInt128 fpBits (FixedPrec a) {
+    return newUInt128 ((uint64_t) a.wholePart, a.decPart);
+}
+
+static inline FixedPrec fpFromBits (UInt128 a) {
+    return newFixedPrec ((int64_t) a.hi, a.lo);
+}
+
 // Are two fixed-precision values equal?
 //
 static inline int fpEqual (FixedPrec a, FixedPrec b) {
     return
-        a.sign      == b.sign       &&
-        a.wholePart == b.wholePart  &&
-        a.decPart   == b.decPart;
+        ((uint64_t) (a.wholePart ^ b.wholePart) |
+            (a.decPart ^ b.decPart)) == 0;
 }
 
 // Compare two fixed-precision values.
 //
+// The whole parts are compared signed, and the fraction parts unsigned.
+// Bitwise operators keep the compiler from introducing branches.
+//
 static inline int fpLessThan (FixedPrec a, FixedPrec b) {
-    if (fpEqual (a, b))
-        return 1;
-    if (a.sign < b.sign)
-        return 1;
-    else if (a.wholePart < b.wholePart)
-        return 1;
-    else if (a.decPart < b.decPart)
-        return 1;
-    else
-        return 0;
+    return
+        (a.wholePart < b.wholePart) |
+        ((a.wholePart == b.wholePart) & (a.decPart < b.decPart));
+}
+
+// Add fixed-precision values together.
+//
+static inline FixedPrec fpAdd (FixedPrec a, FixedPrec b) {
+    return fpFromBits (add128u (fpBits (a), fpBits (b)));
+}
+
+// Subtract fixed-precision values.
+//
+static inline FixedPrec fpSub (FixedPrec a, FixedPrec b) {
+    return fpFromBits (wrapSub128u (fpBits (a), fpBits (b)));
+}
+
+// Negate a fixed-precision value.
+//
+static inline FixedPrec fpNeg (FixedPrec a) {
+    return fpFromBits (wrapSub128u (newUInt128 (0, 0), fpBits (a)));
 }
 
 // Compute the absolute value of a fixed-precision number.
 //
-// (Fancy way of saying set the sign field to 1).
+// 'mask' is all ones for negative numbers and zero otherwise, so this
+// is '~a + 1' (negation) or 'a' respectively, without branching.
 //
 static inline FixedPrec fpAbs (FixedPrec a) {
-    a.sign = 1;
-    return a;
+    uint64_t mask = (uint64_t) (a.wholePart >> 63);
+
+    return fpFromBits (wrapSub128u
+        ( newUInt128 ((uint64_t) a.wholePart ^ mask, a.decPart ^ mask)
+        , newUInt128 (mask, mask) ));
 }
 
-// Add fixed-precision values together.
+// Multiply fixed-precision values together.
 //
-// This is surprisingly not straightforward.
+// Fixed-precision multiplication follows the exact same algebra as
+// wide integer multiplication. See [WideInt.h:mul128u] for details.
 //
-// As usual, the first step is computing the lowest significant part
-// and its carry-out. What's tricky here is that the carry might
-// represent an ordinary carry, or it might be a borrow.
+// Because of how our representation is structured, we know the scaling
+// factor should always be 64, so we can just take the middle 128 bits
+// of the 256-bit product. That rounds towards negative infinity.
 //
-// In the case of a borrow, we need to subtract from the whole part
-// instead of adding to it. That can be implemented by computing the
-// sign of the decimal addition separately and multiplying it with the
-// carry.
+// 'mul128u' treats both operands as unsigned, which overcounts by
+// '2^128 * b' when 'a' is negative (and vice versa). Only the low half
+// of that correction lands inside the middle 128 bits, so we subtract it
+// from the whole part with a mask rather than a branch.
 //
-static FixedPrec fpAdd (FixedPrec a, FixedPrec b) {
-    int decSign = a.decPart < b.decPart ? b.sign : a.sign;
+static inline FixedPrec fpMul (FixedPrec a, FixedPrec b) {
+    UInt256 intProd = mul128u (fpBits (a), fpBits (b));
 
-    Int128 sum1 = adc64i
-        ( a.sign * (int64_t) a.decPart
-        , b.sign * (int64_t) b.decPart );
-
-    Int128 sum2 = adc64i
-        ( a.sign * (int64_t) a.wholePart
-        , b.sign * (int64_t) b.wholePart +
-            decSign * sum1.hi );
-
-    int sign =
-          a.wholePart < b.wholePart ? b.sign :
-        ( a.decPart < b.decPart     ? b.sign : a.sign );
+    uint64_t
+        aMask = (uint64_t) (a.wholePart >> 63),
+        bMask = (uint64_t) (b.wholePart >> 63),
+        correction = (aMask & b.decPart) + (bMask & a.decPart);
 
     return (FixedPrec) {
-        .sign       = sign,
-        .wholePart  = sign * sum2.lo,
-        .decPart    = sign * sum1.lo
+        .wholePart  = (int64_t) (intProd.hi.lo - correction),
+        .decPart    = intProd.lo.hi
     };
 }
 
-// Subtract fixed-precision values.
+// Seeds for Newton-Raphson iteration.
 //
-// Just take advantage of
+// 'fpRecipSeeds[i]' is '1 / d' in UQ1.15, for 'd' at the midpoint of
+// '[1/2 + i/512, 1/2 + (i+1)/512)'. 'fpRsqrtSeeds[i]' is '1 / sqrt (m)'
+// in UQ1.15, for 'm' at the midpoint of '[(i+64)/256, (i+65)/256)'. Both
+// are good to about 8 bits, so each Newton step after that roughly
+// doubles the number of correct bits.
 //
-//  a - b == a + -b
+static const uint16_t fpRecipSeeds[256] = {
+    0xFF80, 0xFE82, 0xFD86, 0xFC8C, 0xFB94, 0xFA9E, 0xF9A9, 0xF8B7,
+    0xF7C6, 0xF6D7, 0xF5EA, 0xF4FF, 0xF415, 0xF32D, 0xF247, 0xF163,
+    0xF080, 0xEF9F, 0xEEBF, 0xEDE1, 0xED05, 0xEC2A, 0xEB51, 0xEA7A,
+    0xE9A4, 0xE8CF, 0xE7FC, 0xE72B, 0xE65B, 0xE58C, 0xE4BF, 0xE3F4,
+    0xE329, 0xE260, 0xE199, 0xE0D3, 0xE00E, 0xDF4B, 0xDE88, 0xDDC8,
+    0xDD08, 0xDC4A, 0xDB8D, 0xDAD1, 0xDA17, 0xD95E, 0xD8A6, 0xD7EF,
+    0xD73A, 0xD685, 0xD5D2, 0xD520, 0xD46F, 0xD3BF, 0xD311, 0xD263,
+    0xD1B7, 0xD10C, 0xD062, 0xCFB9, 0xCF11, 0xCE6A, 0xCDC4, 0xCD1F,
+    0xCC7B, 0xCBD8, 0xCB36, 0xCA96, 0xC9F6, 0xC957, 0xC8B9, 0xC81C,
+    0xC780, 0xC6E5, 0xC64B, 0xC5B2, 0xC51A, 0xC482, 0xC3EC, 0xC357,
+    0xC2C2, 0xC22E, 0xC19B, 0xC109, 0xC078, 0xBFE8, 0xBF59, 0xBECA,
+    0xBE3C, 0xBDAF, 0xBD23, 0xBC98, 0xBC0D, 0xBB83, 0xBAFB, 0xBA72,
+    0xB9EB, 0xB964, 0xB8DE, 0xB859, 0xB7D5, 0xB751, 0xB6CE, 0xB64C,
+    0xB5CB, 0xB54A, 0xB4CA, 0xB44B, 0xB3CC, 0xB34E, 0xB2D1, 0xB254,
+    0xB1D8, 0xB15D, 0xB0E3, 0xB069, 0xAFF0, 0xAF77, 0xAEFF, 0xAE88,
+    0xAE11, 0xAD9B, 0xAD26, 0xACB1, 0xAC3D, 0xABC9, 0xAB56, 0xAAE4,
+    0xAA72, 0xAA01, 0xA990, 0xA920, 0xA8B1, 0xA842, 0xA7D3, 0xA766,
+    0xA6F8, 0xA68C, 0xA620, 0xA5B4, 0xA549, 0xA4DF, 0xA475, 0xA40C,
+    0xA3A3, 0xA33A, 0xA2D3, 0xA26B, 0xA204, 0xA19E, 0xA138, 0xA0D3,
+    0xA06E, 0xA00A, 0x9FA6, 0x9F43, 0x9EE0, 0x9E7E, 0x9E1C, 0x9DBA,
+    0x9D59, 0x9CF9, 0x9C99, 0x9C39, 0x9BDA, 0x9B7C, 0x9B1D, 0x9AC0,
+    0x9A62, 0x9A05, 0x99A9, 0x994D, 0x98F1, 0x9896, 0x983B, 0x97E1,
+    0x9787, 0x972E, 0x96D5, 0x967C, 0x9624, 0x95CC, 0x9574, 0x951D,
+    0x94C7, 0x9470, 0x941B, 0x93C5, 0x9370, 0x931B, 0x92C7, 0x9273,
+    0x921F, 0x91CC, 0x9179, 0x9127, 0x90D5, 0x9083, 0x9032, 0x8FE1,
+    0x8F90, 0x8F40, 0x8EF0, 0x8EA0, 0x8E51, 0x8E02, 0x8DB3, 0x8D65,
+    0x8D17, 0x8CC9, 0x8C7C, 0x8C2F, 0x8BE2, 0x8B96, 0x8B4A, 0x8AFF,
+    0x8AB3, 0x8A68, 0x8A1E, 0x89D3, 0x8989, 0x8940, 0x88F6, 0x88AD,
+    0x8864, 0x881C, 0x87D3, 0x878C, 0x8744, 0x86FD, 0x86B6, 0x866F,
+    0x8628, 0x85E2, 0x859C, 0x8557, 0x8511, 0x84CC, 0x8488, 0x8443,
+    0x83FF, 0x83BB, 0x8377, 0x8334, 0x82F1, 0x82AE, 0x826B, 0x8229,
+    0x81E7, 0x81A5, 0x8164, 0x8123, 0x80E2, 0x80A1, 0x8060, 0x8020
+};
+
+static const uint16_t fpRsqrtSeeds[192] = {
+    0xFF01, 0xFD0D, 0xFB24, 0xF946, 0xF773, 0xF5A9, 0xF3EA, 0xF234,
+    0xF087, 0xEEE2, 0xED46, 0xEBB3, 0xEA27, 0xE8A3, 0xE727, 0xE5B1,
+    0xE443, 0xE2DB, 0xE17A, 0xE020, 0xDECB, 0xDD7C, 0xDC34, 0xDAF1,
+    0xD9B3, 0xD87B, 0xD748, 0xD61A, 0xD4F1, 0xD3CD, 0xD2AD, 0xD192,
+    0xD07B, 0xCF69, 0xCE5A, 0xCD50, 0xCC4A, 0xCB48, 0xCA49, 0xC94F,
+    0xC858, 0xC764, 0xC674, 0xC587, 0xC49D, 0xC3B7, 0xC2D4, 0xC1F4,
+    0xC116, 0xC03C, 0xBF65, 0xBE90, 0xBDBE, 0xBCEF, 0xBC23, 0xBB59,
+    0xBA91, 0xB9CC, 0xB90A, 0xB84A, 0xB78C, 0xB6D0, 0xB617, 0xB560,
+    0xB4AB, 0xB3F8, 0xB347, 0xB298, 0xB1EB, 0xB140, 0xB097, 0xAFF0,
+    0xAF4B, 0xAEA7, 0xAE06, 0xAD66, 0xACC8, 0xAC2B, 0xAB90, 0xAAF7,
+    0xAA5F, 0xA9C9, 0xA934, 0xA8A1, 0xA810, 0xA77F, 0xA6F1, 0xA663,
+    0xA5D8, 0xA54D, 0xA4C4, 0xA43C, 0xA3B6, 0xA330, 0xA2AC, 0xA22A,
+    0xA1A8, 0xA128, 0xA0A9, 0xA02B, 0x9FAE, 0x9F32, 0x9EB7, 0x9E3E,
+    0x9DC6, 0x9D4E, 0x9CD8, 0x9C63, 0x9BEF, 0x9B7B, 0x9B09, 0x9A98,
+    0x9A28, 0x99B8, 0x994A, 0x98DD, 0x9870, 0x9804, 0x979A, 0x9730,
+    0x96C7, 0x965E, 0x95F7, 0x9591, 0x952B, 0x94C6, 0x9462, 0x93FF,
+    0x939C, 0x933A, 0x92D9, 0x9279, 0x9219, 0x91BB, 0x915D, 0x90FF,
+    0x90A3, 0x9047, 0x8FEB, 0x8F91, 0x8F37, 0x8EDD, 0x8E85, 0x8E2D,
+    0x8DD5, 0x8D7E, 0x8D28, 0x8CD3, 0x8C7E, 0x8C2A, 0x8BD6, 0x8B83,
+    0x8B30, 0x8ADE, 0x8A8D, 0x8A3C, 0x89EB, 0x899C, 0x894C, 0x88FE,
+    0x88AF, 0x8862, 0x8815, 0x87C8, 0x877C, 0x8730, 0x86E5, 0x869A,
+    0x8650, 0x8606, 0x85BD, 0x8574, 0x852C, 0x84E4, 0x849D, 0x8456,
+    0x840F, 0x83C9, 0x8384, 0x833F, 0x82FA, 0x82B5, 0x8271, 0x822E,
+    0x81EB, 0x81A8, 0x8166, 0x8124, 0x80E2, 0x80A1, 0x8060, 0x8020
+};
+
+// Helper for the Newton steps below: add or subtract 'corr' from 'a'
+// depending on whether 'mask' is zero or all ones.
 //
-static inline FixedPrec fpSub (FixedPrec a, FixedPrec b) {
-    b.sign = -b.sign;
-    return fpAdd (a, b);
+static inline uint64_t fpApplyCorrection64 (uint64_t a, uint64_t corr, uint64_t mask) {
+    return a + ((corr ^ mask) - mask);
 }
 
-// Multiply fixed-precision values together.
+static inline UInt128 fpApplyCorrection128 (UInt128 a, UInt128 corr, uint64_t mask) {
+    return wrapSub128u
+        ( add128u (a, newUInt128 (corr.hi ^ mask, corr.lo ^ mask))
+        , newUInt128 (mask, mask) );
+}
+
+// Helper for the Newton steps below: given a 256-bit error term 'err'
+// that should be close to zero, return its magnitude shifted right by
+// 'n' bits, and set 'mask' to all ones if it was negative.
 //
-// Fixed-precision multiplication follows the exact same algebra as
-// wide integer multiplication. See [WideInt.h:mul128] for details.
+static inline UInt128 fpErrorMagnitude (UInt256 err, uint32_t n, uint64_t *mask) {
+    *mask = (uint64_t) ((int64_t) err.hi.hi >> 63);
+
+    UInt256 ones = { newUInt128 (*mask, *mask), newUInt128 (*mask, *mask) };
+    UInt256 magnitude = wrapSub256u
+        ( (UInt256) {
+            newUInt128 (err.hi.hi ^ *mask, err.hi.lo ^ *mask),
+            newUInt128 (err.lo.hi ^ *mask, err.lo.lo ^ *mask) }
+        , ones );
+
+    return shr256u (magnitude, n).lo;
+}
+
+// Estimate the reciprocal of a normalised 128-bit integer 'd' (top bit
+// set), returning roughly '2^255 / d'. In other words, if 'd' is read as
+// a fraction in '[1/2, 1)', the result is '1 / d' in UQ1.127.
 //
-// Because of how our representation is structured, we know the scaling
-// factor should always be 64, so we can just take the hi and lo bits
-// of our 128-bit representation respectively.
+// Each step computes the error 'e = 1 - d * y' and refines
+//
+//  y' == y + y * e
 //
-static FixedPrec fpMul (FixedPrec a, FixedPrec b) {
-    /*
-    uint64_t    prod1 = a.wholePart * b.wholePart;
-    UInt128     prod2 = mul64u (a.wholePart, b.decPart);
-    UInt128     prod3 = mul64u (a.decPart, b.wholePart);
-    UInt128     prod4 = mul64u (a.decPart, b.decPart);
+// which needs no division at all. Three steps run in 64 bits on the top
+// half of 'd', which gets us about 60 bits. Two more run in 128 bits. The
+// estimate ends up within a few units of the true value; callers that
+// need an exact answer correct for that themselves.
+//
+static inline UInt128 fpRecipEstimate (UInt128 d) {
+    uint64_t
+        y = (uint64_t) fpRecipSeeds[(d.hi >> 55) & 0xFF] << 48,
+        mask;
 
-    return (FixedPrec) {
-        .sign       = a.sign * b.sign,
-        .wholePart  = prod1 + prod2.hi + prod3.hi,
-        .decPart    = prod2.lo + prod3.lo + prod4.hi
-    };
-    */
+    for (unsigned int step = 0; step < 3; step++) {
+        UInt128 err = wrapSub128u
+            ( newUInt128 (0x8000000000000000ULL, 0)
+            , mul64u (d.hi, y) );
 
-    UInt128 intProd = mul64u
-        ( newUInt128 (a.wholePart, a.decPart)
-        , newUInt128 (b.wholePart, b.decPart) );
+        mask = (uint64_t) ((int64_t) err.hi >> 63);
+        err = shr128u (fpApplyCorrection128 (newUInt128 (0, 0), err, mask), 63);
 
-    return (FixedPrec) {
-        .sign       = a.sign * b.sign,
-        .wholePart  = intProd.hi,
-        .decPart    = intProd.lo
-    };
+        y = fpApplyCorrection64 (y, mul64u (y, err.lo).hi, mask);
+    }
+
+    UInt128 yWide = newUInt128 (y, 0);
+
+    for (unsigned int step = 0; step < 2; step++) {
+        UInt256 err = wrapSub256u
+            ( (UInt256) { newUInt128 (0x8000000000000000ULL, 0), newUInt128 (0, 0) }
+            , mul128u (d, yWide) );
+
+        UInt128 magnitude = fpErrorMagnitude (err, 127, &mask);
+
+        yWide = fpApplyCorrection128
+            (yWide, mul128u (yWide, magnitude).hi, mask);
+    }
+
+    return yWide;
 }
 
-// Divide two fixed-precision values.
+// Estimate the reciprocal square root of a normalised 128-bit integer
+// 'm' (one of its top two bits set), returning roughly '2^255 / sqrt (m)'.
+// In other words, if 'm' is read as a fraction in '[1/4, 1)', the result
+// is '1 / sqrt (m)' in UQ1.127.
+//
+// Each step computes the error 'e = 1 - m * z^2' and refines
+//
+//  z' == z + z * e / 2
+//
+// Again three steps run in 64 bits and get us nearly 60 bits, and then a
+// single step in 128 bits squares the error to well under '2^-110'.
 //
-static FixedPrec fpDiv (FixedPrec a, FixedPrec b) {
+// Starting from the second step, 'z' always approaches '1 / sqrt (m)'
+// from below, so it can't overflow even when the answer is exactly 2.
+//
+static inline UInt128 fpRsqrtEstimate (UInt128 m) {
+    uint64_t
+        z = (uint64_t) fpRsqrtSeeds[(m.hi >> 56) - 64] << 48,
+        mask;
+
+    for (unsigned int step = 0; step < 3; step++) {
+        // 'm * z^2' in UQ2.126, where 'z^2' is first taken in UQ2.62.
+        UInt128 err = wrapSub128u
+            ( newUInt128 (0x4000000000000000ULL, 0)
+            , mul64u (m.hi, mul64u (z, z).hi) );
+
+        mask = (uint64_t) ((int64_t) err.hi >> 63);
+        err = shr128u (fpApplyCorrection128 (newUInt128 (0, 0), err, mask), 62);
+
+        z = fpApplyCorrection64 (z, mul64u (z, err.lo).hi >> 1, mask);
+    }
 
+    UInt128 zWide = newUInt128 (z, 0);
+
+    // 'm * z^2' in UQ2.254, where 'z^2' is first taken in UQ2.126.
+    UInt256 zSqr = mul128u (zWide, zWide);
+    UInt256 prod = mul128u (m, newUInt128 (zSqr.hi.hi, zSqr.hi.lo));
+    UInt256 err = wrapSub256u
+        ( (UInt256) { newUInt128 (0x4000000000000000ULL, 0), newUInt128 (0, 0) }
+        , prod );
+
+    UInt128 magnitude = fpErrorMagnitude (err, 126, &mask);
+
+    return fpApplyCorrection128
+        (zWide, shr128u (mul128u (zWide, magnitude).hi, 1), mask);
+}
+
+// Saturated results for operations that overflow.
+//
+static const FixedPrec fpMax = { INT64_MAX, UINT64_MAX };
+static const FixedPrec fpMin = { INT64_MIN, 0 };
+
+// Divide two fixed-precision values.
+//
+// We work on magnitudes. Scaling the divisor so its top bit is set and
+// taking the Newton reciprocal estimate gives a quotient that's off by a
+// few units at most. The remainder 'a * 2^64 - q * b' is then computed
+// exactly in 256 bits and used to step the quotient onto the right
+// value. So the result is exact, truncated towards zero (0 ULP error).
+//
+// Quotients that don't fit in Q64.64 saturate.
+//
+static inline FixedPrec fpDiv (FixedPrec a, FixedPrec b) {
+    // Exceptional case
+    if (b.wholePart == 0 && b.decPart == 0) {
+        printf ("error: fpDiv: divide by zero exception\n");
+        return fpFromInt (0);
+    }
+
+    uint64_t negative = (uint64_t) ((a.wholePart ^ b.wholePart) >> 63);
+
+    UInt128
+        num = fpBits (fpAbs (a)),
+        den = fpBits (fpAbs (b));
+
+    uint32_t shift = clz128u (den);
+
+    UInt256 estimate = shr256u
+        ( mul128u (num, fpRecipEstimate (shl128u (den, shift)))
+        , 191 - shift );
+
+    // Clamp the estimate to '2^127' (just out of range), so that the
+    // corrections below can't wrap around.
+    UInt128 limit = newUInt128 (0x8000000000000000ULL, 0);
+    UInt128 quot =
+        estimate.hi.hi || estimate.hi.lo || !lt128u (estimate.lo, limit)
+            ? limit
+            : estimate.lo;
+
+    UInt256
+        target  = { newUInt128 (0, num.hi), newUInt128 (num.lo, 0) },
+        divisor = { newUInt128 (0, 0), den },
+        product = mul128u (quot, den);
+
+    while (lt256u (target, product)) {
+        quot = wrapSub128u (quot, newUInt128 (0, 1));
+        product = wrapSub256u (product, divisor);
+    }
+
+    for (product = add256u (product, divisor);
+         lt128u (quot, limit) && !lt256u (target, product);
+         product = add256u (product, divisor))
+        quot = add128u (quot, newUInt128 (0, 1));
+
+    if (MSB64(quot.hi))
+        return negative ? fpMin : fpMax;
+
+    return fpFromBits (fpApplyCorrection128 (newUInt128 (0, 0), quot, negative));
 }
 
 // Square a fixed-precision value.
@@ -150,8 +396,68 @@ static inline FixedPrec fpSqr (FixedPrec a) {
 
 // Compute the square root of a fixed-precision value.
 //
-static FixedPrec fpSqrt (FixedPrec a) {
+// Scale the input by an even power of two so that one of its top two
+// bits is set, take the Newton reciprocal square root estimate 'z', and
+// use 'sqrt (m) == m * z'. As with division, the estimate is then
+// stepped onto the exact answer by comparing its square with the input
+// in 256 bits, so the result is exact, truncated (0 ULP error).
+//
+// Square roots of negative numbers are an error, and return 0.
+//
+static inline FixedPrec fpSqrt (FixedPrec a) {
+    // Exceptional case
+    if (a.wholePart < 0) {
+        printf ("error: fpSqrt: square root of negative number\n");
+        return fpFromInt (0);
+    }
+    if (a.wholePart == 0 && a.decPart == 0)
+        return a;
+
+    UInt128 n = fpBits (a);
+    uint32_t shift = clz128u (n) & ~1u;
+    UInt128 m = shl128u (n, shift);
+
+    UInt128 root = shr256u
+        ( mul128u (m, fpRsqrtEstimate (m))
+        , 159 + shift / 2 ).lo;
+
+    UInt256 target = { newUInt128 (0, n.hi), newUInt128 (n.lo, 0) };
+
+    while (lt256u (target, mul128u (root, root)))
+        root = wrapSub128u (root, newUInt128 (0, 1));
+
+    for (UInt128 next = add128u (root, newUInt128 (0, 1));
+         !lt256u (target, mul128u (next, next));
+         next = add128u (next, newUInt128 (0, 1)))
+        root = next;
+
+    return fpFromBits (root);
+}
 
+// Compute the reciprocal square root of a fixed-precision value.
+//
+// This is just the Newton estimate from 'fpSqrt', shifted into place, so
+// it involves no division and no correction step. The estimate is
+// accurate to well under '2^-110', and results are at most '2^96', so
+// the only error left is from truncation: the result is within 1 ULP
+// below the exact value.
+//
+// Reciprocal square roots of zero or negative numbers are an error,
+// and return 0.
+//
+static inline FixedPrec fpRsqrt (FixedPrec a) {
+    // Exceptional case
+    if (a.wholePart < 0 || (a.wholePart == 0 && a.decPart == 0)) {
+        printf ("error: fpRsqrt: reciprocal square root of non-positive number\n");
+        return fpFromInt (0);
+    }
+
+    UInt128 n = fpBits (a);
+    uint32_t shift = clz128u (n) & ~1u;
+
+    return fpFromBits (shr128u
+        ( fpRsqrtEstimate (shl128u (n, shift))
+        , 95 - shift / 2 ));
 }
 
 
@@ -167,7 +473,7 @@ struct Vec3FixedPrec {
 
 // Compute the distance between two fixed-precision 'Vec3's.
 //
-static FixedPrec fp3Distance (Vec3FixedPrec a, Vec3FixedPrec b) {
+static inline FixedPrec fp3Distance (Vec3FixedPrec a, Vec3FixedPrec b) {
     FixedPrec
         x2 = fpSqr (fpSub (a.x, b.x)),
         y2 = fpSqr (fpSub (a.y, b.y)),
@@ -176,13 +482,153 @@ static FixedPrec fp3Distance (Vec3FixedPrec a, Vec3FixedPrec b) {
     return fpSqrt (fpAdd (fpAdd (x2, y2), z2));
 }
 
+// Compute '1 / r^3' for the distance 'r' between two fixed-precision
+// 'Vec3's, which is what the inverse square law needs once the force is
+// pointed along the separation vector.
+//
+// This goes through 'fpRsqrt' rather than 'fpSqrt' and 'fpDiv', so no
+// division happens anywhere.
+//
+static inline FixedPrec fp3InvDistanceCubed (Vec3FixedPrec a, Vec3FixedPrec b) {
+    FixedPrec
+        x2 = fpSqr (fpSub (a.x, b.x)),
+        y2 = fpSqr (fpSub (a.y, b.y)),
+        z2 = fpSqr (fpSub (a.z, b.z));
+
+    FixedPrec invR = fpRsqrt (fpAdd (fpAdd (x2, y2), z2));
+    return fpMul (invR, fpSqr (invR));
+}
+
+
+// Reinterpret the bits of a double as an integer, and back.
+//
+static inline uint64_t fpDoubleBits (double a) {
+    union { double d; uint64_t u; } pun = { a };
+    return pun.u;
+}
+
+static inline double fpBitsDouble (uint64_t a) {
+    union { uint64_t u; double d; } pun = { a };
+    return pun.d;
+}
+
+// Convert an unsigned 64-bit integer to a double, correctly rounded.
+//
+// The top and bottom 32 bits become doubles exactly by being dropped into
+// the mantissas of 2^84 and 2^52, and adding them rounds once. Compilers
+// branch on the top bit instead, which mispredicts on random data.
+//
+static inline double fpUInt64ToDouble (uint64_t a) {
+    double
+        high    = fpBitsDouble ((a >> 32) | 0x4530000000000000ULL) - (0x1p84 + 0x1p52),
+        low     = fpBitsDouble ((a & 0xFFFFFFFFULL) | 0x4330000000000000ULL);
+
+    return high + low;
+}
+
+// Convert a fixed-precision value to a double.
+//
+// This goes through the magnitude, so that 'fpToDouble (fpNeg (a))' is
+// exactly '-fpToDouble (a)', and small values keep all their precision.
+// Each half converts with one rounding and the sum rounds again, which
+// vectorised kernels reproduce bit for bit.
+//
+static inline double fpToDouble (FixedPrec a) {
+    UInt128 magnitude = fpBits (fpAbs (a));
+    double abs = fpUInt64ToDouble (magnitude.hi) +
+        fpUInt64ToDouble (magnitude.lo) * 0x1p-64;
+
+    return fpBitsDouble (fpDoubleBits (abs) | ((uint64_t) a.wholePart & (1ULL << 63)));
+}
+
+// Shift a 64-bit integer by a signed amount, giving zero whenever the
+// amount is out of range. That's how the x86 variable vector shifts
+// behave, which is what lets 'fpFromDouble' be vectorised exactly.
+//
+static inline uint64_t fpShiftLeft (uint64_t a, int64_t n) {
+    return n >= 0 && n < 64 ? a << n : 0;
+}
+
+static inline uint64_t fpShiftRight (uint64_t a, int64_t n) {
+    return n >= 0 && n < 64 ? a >> n : 0;
+}
+
+// Convert a double to a fixed-precision value, truncating towards zero.
+//
+// A double is '(2^52 + mantissa) * 2^(exponent - 1075)', so its fixed
+// representation is the 53-bit significand shifted left by
+// 'exponent - 1011' bits, which we spread over the two halves. Anything
+// too big to represent saturates, and anything too small becomes zero.
+//
+static inline FixedPrec fpFromDouble (double a) {
+    uint64_t
+        bits        = fpDoubleBits (a),
+        exponent    = (bits >> 52) & 0x7FF,
+        significand = (bits & 0xFFFFFFFFFFFFFULL) | (1ULL << 52),
+        negative    = -(bits >> 63);
+
+    int64_t shift = (int64_t) exponent - 1011;
+
+    FixedPrec magnitude = shift > 74 ? fpMax : newFixedPrec
+        ( (int64_t) (fpShiftRight (significand, 64 - shift) |
+            fpShiftLeft (significand, shift - 64))
+        , fpShiftLeft (significand, shift) |
+            fpShiftRight (significand, -shift) );
+
+    return fpFromBits (wrapSub128u
+        ( newUInt128
+            ( (uint64_t) magnitude.wholePart ^ negative
+            , magnitude.decPart ^ negative )
+        , newUInt128 (negative, negative) ));
+}
+
 
 // Convert a fixed-precision value to a float.
 //
-static float fpToFloat (FixedPrec a) {
-    float decPart = (float) a.decPart / 0xFFFFFFFFFFFFFFFF;
-    return a.sign * (a.wholePart + decPart);
+// This goes through 'fpToDouble', whose result has far more bits than a
+// float needs. Summing the parts as floats would round the whole part
+// before the fraction was even added on. For positions, take an origin off
+// in fixed precision first; see 'CameraSpace.h'.
+//
+static inline float fpToFloat (FixedPrec a) {
+    return (float) fpToDouble (a);
 }
 
-#endif
 
+// Sign-magnitude representation of fixed-precision values, as they
+// were stored before 'FixedPrec' switched to two's complement.
+//
+// These shims let code written against the old layout keep working.
+//
+typedef struct SignMagFixedPrec SignMagFixedPrec;
+
+struct SignMagFixedPrec {
+    int sign;
+    uint64_t wholePart;
+    uint64_t decPart;
+};
+
+// Convert from sign-magnitude to two's complement.
+//
+static inline FixedPrec fpFromSignMag (SignMagFixedPrec a) {
+    FixedPrec magnitude = newFixedPrec ((int64_t) a.wholePart, a.decPart);
+    uint64_t mask = -(uint64_t) (a.sign < 0);
+
+    return fpFromBits (wrapSub128u
+        ( newUInt128 ((uint64_t) magnitude.wholePart ^ mask, a.decPart ^ mask)
+        , newUInt128 (mask, mask) ));
+}
+
+// Convert from two's complement to sign-magnitude.
+//
+static inline SignMagFixedPrec fpToSignMag (FixedPrec a) {
+    FixedPrec magnitude = fpAbs (a);
+
+    return (SignMagFixedPrec) {
+        .sign       = a.wholePart < 0 ? -1 : 1,
+        .wholePart  = (uint64_t) magnitude.wholePart,
+        .decPart    = magnitude.decPart
+    };
+}
+
+#endif
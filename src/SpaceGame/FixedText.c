@@ -0,0 +1,486 @@
+
+// SpaceGame.FixedText
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "WideInt.h"
+#include "FixedPrecision.h"
+#include "Text.h"
+#include "FixedText.h"
+
+
+
+// "00" to "99", so that digits are written two at a time.
+//
+static const char digitPairs[201] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static const uint64_t powersOfTen[20] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL,
+    10000000ULL, 100000000ULL, 1000000000ULL, 10000000000ULL,
+    100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+    100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+    100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL
+};
+
+// '10^digits' for fractions of 1 to 38 digits, with its reciprocal
+// '2^(shift + 64) / 10^digits', rounded up, so that the fraction in units
+// of 2^-64 is 'n * reciprocal >> shift' for a fraction 'n / 10^digits'.
+// See 'readFraction'.
+//
+typedef struct DecimalScale DecimalScale;
+
+struct DecimalScale {
+    UInt128 power;
+    UInt128 reciprocal;
+    uint32_t shift;
+};
+
+static const DecimalScale decimalScales[38] = {
+    { { 0x0000000000000000, 0x000000000000000A }, { 0xCCCCCCCCCCCCCCCC, 0xCCCCCCCCCCCCCCCD }, 67 },
+    { { 0x0000000000000000, 0x0000000000000064 }, { 0xA3D70A3D70A3D70A, 0x3D70A3D70A3D70A4 }, 70 },
+    { { 0x0000000000000000, 0x00000000000003E8 }, { 0x83126E978D4FDF3B, 0x645A1CAC083126EA }, 73 },
+    { { 0x0000000000000000, 0x0000000000002710 }, { 0xD1B71758E219652B, 0xD3C36113404EA4A9 }, 77 },
+    { { 0x0000000000000000, 0x00000000000186A0 }, { 0xA7C5AC471B478423, 0x0FCF80DC33721D54 }, 80 },
+    { { 0x0000000000000000, 0x00000000000F4240 }, { 0x8637BD05AF6C69B5, 0xA63F9A49C2C1B110 }, 83 },
+    { { 0x0000000000000000, 0x0000000000989680 }, { 0xD6BF94D5E57A42BC, 0x3D32907604691B4D }, 87 },
+    { { 0x0000000000000000, 0x0000000005F5E100 }, { 0xABCC77118461CEFC, 0xFDC20D2B36BA7C3E }, 90 },
+    { { 0x0000000000000000, 0x000000003B9ACA00 }, { 0x89705F4136B4A597, 0x31680A88F8953031 }, 93 },
+    { { 0x0000000000000000, 0x00000002540BE400 }, { 0xDBE6FECEBDEDD5BE, 0xB573440E5A884D1C }, 97 },
+    { { 0x0000000000000000, 0x000000174876E800 }, { 0xAFEBFF0BCB24AAFE, 0xF78F69A51539D749 }, 100 },
+    { { 0x0000000000000000, 0x000000E8D4A51000 }, { 0x8CBCCC096F5088CB, 0xF93F87B7442E45D4 }, 103 },
+    { { 0x0000000000000000, 0x000009184E72A000 }, { 0xE12E13424BB40E13, 0x2865A5F206B06FBA }, 107 },
+    { { 0x0000000000000000, 0x00005AF3107A4000 }, { 0xB424DC35095CD80F, 0x538484C19EF38C95 }, 110 },
+    { { 0x0000000000000000, 0x00038D7EA4C68000 }, { 0x901D7CF73AB0ACD9, 0x0F9D37014BF60A11 }, 113 },
+    { { 0x0000000000000000, 0x002386F26FC10000 }, { 0xE69594BEC44DE15B, 0x4C2EBE687989A9B4 }, 117 },
+    { { 0x0000000000000000, 0x016345785D8A0000 }, { 0xB877AA3236A4B449, 0x09BEFEB9FAD487C3 }, 120 },
+    { { 0x0000000000000000, 0x0DE0B6B3A7640000 }, { 0x9392EE8E921D5D07, 0x3AFF322E62439FD0 }, 123 },
+    { { 0x0000000000000000, 0x8AC7230489E80000 }, { 0xEC1E4A7DB69561A5, 0x2B31E9E3D06C32E6 }, 127 },
+    { { 0x0000000000000005, 0x6BC75E2D63100000 }, { 0xBCE5086492111AEA, 0x88F4BB1CA6BCF585 }, 130 },
+    { { 0x0000000000000036, 0x35C9ADC5DEA00000 }, { 0x971DA05074DA7BEE, 0xD3F6FC16EBCA5E04 }, 133 },
+    { { 0x000000000000021E, 0x19E0C9BAB2400000 }, { 0xF1C90080BAF72CB1, 0x5324C68B12DD6339 }, 137 },
+    { { 0x000000000000152D, 0x02C7E14AF6800000 }, { 0xC16D9A0095928A27, 0x75B7053C0F178294 }, 140 },
+    { { 0x000000000000D3C2, 0x1BCECCEDA1000000 }, { 0x9ABE14CD44753B52, 0xC4926A9672793543 }, 143 },
+    { { 0x0000000000084595, 0x161401484A000000 }, { 0xF79687AED3EEC551, 0x3A83DDBD83F52205 }, 147 },
+    { { 0x000000000052B7D2, 0xDCC80CD2E4000000 }, { 0xC612062576589DDA, 0x95364AFE032A819E }, 150 },
+    { { 0x00000000033B2E3C, 0x9FD0803CE8000000 }, { 0x9E74D1B791E07E48, 0x775EA264CF55347E }, 153 },
+    { { 0x00000000204FCE5E, 0x3E25026110000000 }, { 0xFD87B5F28300CA0D, 0x8BCA9D6E188853FD }, 157 },
+    { { 0x00000001431E0FAE, 0x6D7217CAA0000000 }, { 0xCAD2F7F5359A3B3E, 0x096EE45813A04331 }, 160 },
+    { { 0x0000000C9F2C9CD0, 0x4674EDEA40000000 }, { 0xA2425FF75E14FC31, 0xA1258379A94D028E }, 163 },
+    { { 0x0000007E37BE2022, 0xC0914B2680000000 }, { 0x81CEB32C4B43FCF4, 0x80EACF948770CED8 }, 166 },
+    { { 0x000004EE2D6D415B, 0x85ACEF8100000000 }, { 0xCFB11EAD453994BA, 0x67DE18EDA5814AF3 }, 170 },
+    { { 0x0000314DC6448D93, 0x38C15B0A00000000 }, { 0xA6274BBDD0FADD61, 0xECB1AD8AEACDD58F }, 173 },
+    { { 0x0001ED09BEAD87C0, 0x378D8E6400000000 }, { 0x84EC3C97DA624AB4, 0xBD5AF13BEF0B113F }, 176 },
+    { { 0x0013426172C74D82, 0x2B878FE800000000 }, { 0xD4AD2DBFC3D07787, 0x955E4EC64B44E865 }, 180 },
+    { { 0x00C097CE7BC90715, 0xB34B9F1000000000 }, { 0xAA242499697392D2, 0xDDE50BD1D5D0B9EA }, 183 },
+    { { 0x0785EE10D5DA46D9, 0x00F436A000000000 }, { 0x881CEA14545C7575, 0x7E50D64177DA2E55 }, 186 },
+    { { 0x4B3B4CA85A86C47A, 0x098A224000000000 }, { 0xD9C7DCED53C72255, 0x96E7BD358C904A22 }, 190 }
+};
+
+// 5^65, and 5^65 * 2^64, for fractions of more than 38 digits.
+//
+static const UInt256
+    fiveTo65        = { { 0x0000000000000000, 0x0000000000798B13 }, { 0x8E3FE1C84545F7A3, 0x271CA2F7BD129B05 } },
+    fiveTo65Shifted = { { 0x0000000000798B13, 0x8E3FE1C84545F7A3 }, { 0x271CA2F7BD129B05, 0x0000000000000000 } };
+
+
+// Formatting
+
+// Write 'a', below 10^8, as eight digits with leading zeros, two at a
+// time.
+//
+static inline void writeEightDigits (char out[], uint32_t a) {
+    for (unsigned int ix = 8; ix; ix -= 2) {
+        memcpy (out + ix - 2, digitPairs + 2 * (a % 100), 2);
+        a /= 100;
+    }
+}
+
+// Write 'a' as twenty digits with leading zeros. Splitting it into three
+// chunks first keeps most of the divisions 32-bit and independent of
+// each other, and the compiler turns each one into a multiplication by
+// the reciprocal.
+//
+static inline void writeTwentyDigits (char out[20], uint64_t a) {
+    uint64_t rest = a % 10000000000000000ULL;
+    uint32_t top = (uint32_t) (a / 10000000000000000ULL);
+
+    memcpy (out, digitPairs + 2 * (top / 100), 2);
+    memcpy (out + 2, digitPairs + 2 * (top % 100), 2);
+    writeEightDigits (out + 4, (uint32_t) (rest / 100000000));
+    writeEightDigits (out + 12, (uint32_t) (rest % 100000000));
+}
+
+// Count the decimal digits of 'a', from its bit length. 1233 / 4096 is
+// just over log10 (2), so 'guess' is either right or one short.
+//
+static inline unsigned int countDigits (uint64_t a) {
+    if (a == 0)
+        return 1;
+
+    unsigned int guess = (64 - clz64 (a)) * 1233 >> 12;
+    return guess + (a >= powersOfTen[guess]);
+}
+
+// Is there a fraction of 'digits' decimal digits that reads back as
+// 'f / 2^64'? If there is, set 'decimal' to it, scaled by '10^digits'.
+//
+// Whatever is within half a unit (2^-65) of 'f / 2^64' reads back as it,
+// and so does exactly half a unit away when 'f' is even. 'f * 10^digits'
+// splits into the nearest decimal below, 'scaled.hi', and how far above
+// that 'f' is, 'scaled.lo', in units of '2^-64 / 10^digits'. Half a unit
+// of 'f' is '10^digits / 2' of those.
+//
+static inline int shortFraction (uint64_t f, unsigned int digits, uint64_t *decimal) {
+    UInt128 scaled = mul64u (f, powersOfTen[digits]);
+
+    uint64_t
+        half    = powersOfTen[digits] / 2,
+        below   = scaled.lo,
+        above   = -scaled.lo;
+
+    int even = !(f & 1);
+
+    if (below < half || (below == half && even)) {
+        *decimal = scaled.hi;
+        return 1;
+    }
+    if (above < half || (above == half && even)) {
+        *decimal = scaled.hi + 1;
+        return 1;
+    }
+
+    return 0;
+}
+
+// Write a fixed-precision value as the shortest decimal that reads back
+// as the same value, returning the number of characters written, up to
+// 'FP_TEXT_MAX'. Nothing terminates the characters.
+//
+// The whole part is just an integer. For the fraction, any decimal that
+// works with some number of digits also works, with a zero on the end,
+// with one more; so we binary search for the fewest digits that work.
+// Twenty always do, because then the nearest decimal is within '10^-20 / 2'
+// of the fraction, well inside half a unit. Random fractions need 19 or
+// 20 digits, which takes five multiplications to find.
+//
+unsigned int fpFormatChars (FixedPrec a, char out[]) {
+    UInt128 magnitude = fpBits (fpAbs (a));
+    char *p = out;
+
+    if (a.wholePart < 0)
+        *p++ = '-';
+
+    // Digits are written at full width and the ones wanted copied out,
+    // which keeps every loop a fixed length.
+    char digits[20];
+    unsigned int wholeDigits = countDigits (magnitude.hi);
+
+    writeTwentyDigits (digits, magnitude.hi);
+    memcpy (p, digits + 20 - wholeDigits, wholeDigits);
+    p += wholeDigits;
+
+    uint64_t f = magnitude.lo;
+    if (f == 0)
+        return (unsigned int) (p - out);
+
+    *p++ = '.';
+
+    uint64_t decimal = 0, candidate;
+    unsigned int low = 1, high = 20;
+
+    while (low < high) {
+        unsigned int mid = (low + high) / 2;
+
+        if (shortFraction (f, mid, &candidate)) {
+            high = mid;
+            decimal = candidate;
+        } else
+            low = mid + 1;
+    }
+
+    // Shorter fractions are padded out to 19 digits with zeros on the end.
+    if (low < 20) {
+        writeTwentyDigits (digits, decimal * powersOfTen[19 - low]);
+        memcpy (p, digits + 1, low);
+        return (unsigned int) (p + low - out);
+    }
+
+    // Twenty digits don't fit in 64 bits, so the last one is worked out
+    // on its own, rounding to nearest. It can't round up to 10, since
+    // then 19 digits would have done.
+    UInt128
+        scaled  = mul64u (f, powersOfTen[19]),
+        last    = mul64u (scaled.lo, 10);
+
+    uint64_t digit = last.hi +
+        (last.lo > 0x8000000000000000ULL ||
+            (last.lo == 0x8000000000000000ULL && (last.hi & 1)));
+
+    writeTwentyDigits (digits, scaled.hi);
+    memcpy (p, digits + 1, 19);
+    p[19] = (char) ('0' + digit);
+
+    return (unsigned int) (p + 20 - out);
+}
+
+
+// Parsing
+
+static inline int isDigit (char c) {
+    return c >= '0' && c <= '9';
+}
+
+// Read eight digits at once, as a little-endian 64-bit word: combine
+// neighbouring digits into pairs, then pairs into fours, then fours into
+// the whole number, each step a multiply and a shift.
+//
+static inline uint64_t readEightDigits (const char digits[]) {
+    uint64_t word;
+    memcpy (&word, digits, 8);
+
+    word -= 0x3030303030303030ULL;
+    word = word * 10 + (word >> 8);
+    word =
+        ((word & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32)) +
+            ((word >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32))) >> 32;
+
+    return word & 0xFFFFFFFFULL;
+}
+
+// Read 'count' digits, up to 19, as an integer.
+//
+static inline uint64_t readDigits (const char digits[], unsigned int count) {
+    uint64_t a = 0;
+    unsigned int ix = 0;
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    for (; ix + 8 <= count; ix += 8)
+        a = a * 100000000 + readEightDigits (digits + ix);
+#endif
+
+    for (; ix < count; ix++)
+        a = a * 10 + (uint64_t) (digits[ix] - '0');
+
+    return a;
+}
+
+// 'a * m + c' for a 256-bit 'a' that doesn't overflow.
+//
+static inline UInt256 mulAdd256u (UInt256 a, uint64_t m, uint64_t c) {
+    UInt256
+        lo = mul128u (a.lo, newUInt128 (0, m)),
+        hi = mul128u (a.hi, newUInt128 (0, m));
+
+    return add256u
+        ( (UInt256) { add128u (hi.lo, lo.hi), lo.lo }
+        , (UInt256) { newUInt128 (0, 0), newUInt128 (0, c) } );
+}
+
+static inline int eq256u (UInt256 a, UInt256 b) {
+    return !lt256u (a, b) && !lt256u (b, a);
+}
+
+// Read a fraction of more than 38 digits, rounded to the nearest unit
+// of 2^-64, ties to even. The result is at most 2^64, when it rounds up
+// to a whole one.
+//
+// Each halfway point between fixed-precision values, '(2q + 1) / 2^65',
+// is exactly '(2q + 1) * 5^65 / 10^65', so has at most 65 digits, and the
+// first 65 digits of a fraction say which side of every halfway point it
+// is on. The rest only matter for breaking ties. Read as a 65-digit
+// integer 'n', the fraction in units of 2^-64 is 'n / (2 * 5^65)'; the
+// quotient has 64 bits, which long division finds one at a time. This
+// is slow, but nothing we print has more than 20 digits.
+//
+static UInt128 readLongFraction (const char digits[], unsigned int count) {
+    unsigned int used = count < 65 ? count : 65;
+    UInt256 n = { newUInt128 (0, 0), newUInt128 (0, 0) };
+
+    for (unsigned int ix = 0; ix < used; ix += 19) {
+        unsigned int chunk = used - ix < 19 ? used - ix : 19;
+        n = mulAdd256u (n, powersOfTen[chunk], readDigits (digits + ix, chunk));
+    }
+
+    for (unsigned int padding = 65 - used; padding; ) {
+        unsigned int chunk = padding < 19 ? padding : 19;
+        n = mulAdd256u (n, powersOfTen[chunk], 0);
+        padding -= chunk;
+    }
+
+    int sticky = 0;
+    for (unsigned int ix = used; ix < count; ix++)
+        sticky |= digits[ix] != '0';
+
+    uint64_t q = 0;
+    UInt256 divisor = fiveTo65Shifted;
+
+    for (unsigned int bit = 0; bit < 64; bit++) {
+        q <<= 1;
+        if (!lt256u (n, divisor)) {
+            n = wrapSub256u (n, divisor);
+            q |= 1;
+        }
+        divisor = shr256u (divisor, 1);
+    }
+
+    uint64_t up =
+        lt256u (fiveTo65, n) ||
+        (eq256u (n, fiveTo65) && (sticky || (q & 1)));
+
+    return add128u (newUInt128 (0, q), newUInt128 (0, up));
+}
+
+// Read a fraction of 'count' digits, rounded to the nearest unit of
+// 2^-64, ties to even. The result is at most 2^64, when it rounds up to
+// a whole one.
+//
+// A fraction 'n / 10^count' is 'n * 2^64 / 10^count' units. Multiplying
+// by the rounded up reciprocal gives that or one more, since the error
+// is under 2^-63; the exact product with '10^count' then says which, and
+// what's left over says which way to round.
+//
+static inline UInt128 readFraction (const char digits[], unsigned int count) {
+    if (count > 38)
+        return readLongFraction (digits, count);
+
+    UInt128 n = newUInt128 (0, readDigits (digits, count < 19 ? count : 19));
+
+    if (count > 19)
+        n = add128u
+            ( mul64u (n.lo, powersOfTen[count - 19])
+            , newUInt128 (0, readDigits (digits + 19, count - 19)) );
+
+    const DecimalScale *scale = &decimalScales[count - 1];
+
+    UInt128 q = shr256u (mul128u (n, scale->reciprocal), scale->shift).lo;
+
+    UInt256
+        target  = { newUInt128 (0, n.hi), newUInt128 (n.lo, 0) },
+        product = mul128u (q, scale->power);
+
+    if (lt256u (target, product)) {
+        q = wrapSub128u (q, newUInt128 (0, 1));
+        product = wrapSub256u
+            (product, (UInt256) { newUInt128 (0, 0), scale->power });
+    }
+
+    UInt128
+        below   = wrapSub256u (target, product).lo,
+        above   = wrapSub128u (scale->power, below);
+
+    uint64_t up =
+        lt128u (above, below) ||
+        (!lt128u (below, above) && (q.lo & 1));
+
+    return add128u (q, newUInt128 (0, up));
+}
+
+// Read a fixed-precision value from the start of 'length' characters,
+// returning how many characters it took up, or 0 if they don't start
+// with a value in range. A point with no digits after it isn't part of
+// the value.
+//
+unsigned int fpParseChars (const char chars[], unsigned int length, FixedPrec *result) {
+    unsigned int ix = 0;
+    int negative = 0;
+
+    if (length && (chars[0] == '-' || chars[0] == '+'))
+        negative = chars[ix++] == '-';
+
+    unsigned int start = ix;
+    uint64_t whole = 0;
+    int overflow = 0;
+
+    for (; ix < length && isDigit (chars[ix]); ix++) {
+        uint64_t digit = (uint64_t) (chars[ix] - '0');
+        overflow |= whole > (UINT64_MAX - digit) / 10;
+        whole = whole * 10 + digit;
+    }
+
+    if (ix == start)
+        return 0;
+
+    UInt128 fraction = newUInt128 (0, 0);
+
+    if (ix + 1 < length && chars[ix] == '.' && isDigit (chars[ix + 1])) {
+        start = ++ix;
+        while (ix < length && isDigit (chars[ix]))
+            ix++;
+
+        fraction = readFraction (chars + start, ix - start);
+    }
+
+    // The magnitude can be at most 2^127 if negative, and under it if not.
+    overflow |= whole == UINT64_MAX && fraction.hi;
+    UInt128 magnitude = add128u (newUInt128 (whole, 0), fraction);
+
+    if (overflow || magnitude.hi > 0x8000000000000000ULL ||
+        (magnitude.hi == 0x8000000000000000ULL && (!negative || magnitude.lo)))
+        return 0;
+
+    *result = fpFromBits (fpApplyCorrection128
+        (newUInt128 (0, 0), magnitude, negative ? UINT64_MAX : 0));
+
+    return ix;
+}
+
+
+// Text
+
+// Print a fixed-precision value to a new text object.
+//
+Text fpToText (FixedPrec a) {
+    MutText mutText = newMutText (FP_TEXT_MAX + 1);
+    if (!mutText.array)
+        return (Text) {0, 0};
+
+    mutText.length = fpFormatChars (a, mutText.array);
+    mutText.array[mutText.length] = '\0';
+
+    return solidifyText (mutText);
+}
+
+// Read a text object that holds a fixed-precision value and nothing
+// else, up to a terminating '\0' if it has one.
+//
+int fpFromText (Text text, FixedPrec *result) {
+    unsigned int length = (unsigned int) strnlen (text.array, text.length);
+
+    if (length == 0 || fpParseChars (text.array, length, result) != length) {
+        printf
+            ( "error: fpFromText: not a fixed-precision value: \"%.*s\"\n"
+            , (int) length, text.array );
+        *result = fpFromInt (0);
+        return 0;
+    }
+
+    return 1;
+}
+
+// The builder starts with room for values of about 24 characters, which
+// is what coordinates tend to be, and grows from there.
+//
+Text fpArrayToText (const FixedPrec values[], unsigned int n, char separator) {
+    TextBuilder builder = newTextBuilder (24 * n);
+
+    for (unsigned int ix = 0; ix < n; ix++) {
+        if (!reserveBuilder (&builder, FP_TEXT_MAX + 1)) {
+            freeTextBuilder (builder);
+            return (Text) {0, 0};
+        }
+
+        builder.length += fpFormatChars (values[ix], builder.array + builder.length);
+        builder.array[builder.length++] = separator;
+    }
+
+    builder.array[builder.length] = '\0';
+
+    return buildText (builder);
+}
@@ -0,0 +1,35 @@
+
+#ifndef SPACE_GAME_FIXED_TEXT_H
+#define SPACE_GAME_FIXED_TEXT_H
+
+#include "FixedPrecision.h"
+#include "Text.h"
+
+// Decimal text for fixed-precision values.
+//
+// Values print as the shortest decimal that reads back as exactly the
+// same value, so that a value printed and read back is unchanged, and
+// the nearest one when there's a choice.
+// One and a half prints as "1.5", and no fraction needs more than 20
+// digits. There's no exponent, and whole numbers have no point.
+//
+// Reading accepts an optional sign, digits, and optionally a point and
+// more digits, as many as you like. The value is rounded to the nearest
+// fixed-precision value, exactly, with ties going to the even one.
+//
+// The most characters a value can print as: a sign, 19 digits, a point
+// and 20 more digits.
+//
+#define FP_TEXT_MAX 41
+
+unsigned int fpFormatChars (FixedPrec, char[]);
+unsigned int fpParseChars (const char[], unsigned int, FixedPrec *);
+
+Text fpToText (FixedPrec);
+int fpFromText (Text, FixedPrec *);
+
+// Print 'n' values into one text, each followed by 'separator'.
+//
+Text fpArrayToText (const FixedPrec *, unsigned int, char);
+
+#endif
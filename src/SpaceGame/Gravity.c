@@ -0,0 +1,651 @@
+
+// SpaceGame.Gravity
+
+// The vector kernels have to round exactly like the scalar one, so no
+// multiply and add may be fused into a single FMA anywhere in this file.
+#if defined (__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined (__GNUC__)
+#pragma GCC optimize ("fp-contract=off")
+#endif
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "FixedPrecision.h"
+#include "Newtonian.h"
+#include "BodySystem.h"
+#include "FixedPrecVector.h"
+#include "Gravity.h"
+#include "Octree.h"
+#include "ThreadPool.h"
+
+
+
+// All-pairs gravity.
+//
+// Positions and accelerations are fixed precision, but the force law
+// itself is evaluated in double precision: a 128-bit fixed-point
+// multiply has no vector equivalent, and the 'fpRsqrt' route costs tens
+// of nanoseconds per pair. So each pair
+//
+//  1. subtracts the positions exactly, in fixed precision,
+//  2. converts the separation to a double, with 'fpToDouble',
+//  3. computes 'G m / (r^2 + eps^2)^(3/2)' times the separation using
+//     only IEEE operations, which are correctly rounded everywhere,
+//  4. converts the result back with 'fpFromDouble', which truncates, and
+//  5. adds it into the fixed-precision accelerations.
+//
+// Every step is either exact or correctly rounded, and the final sums are
+// integer additions, which don't care about order. That makes the scalar
+// and vector kernels, and any tiling or split across threads, produce
+// bit-identical accelerations.
+//
+// Each pair is visited once, and Newton's third law gives the reaction on
+// the other body: 'a_i += G m_j c' and 'a_j -= G m_i c' for the same 'c'.
+
+typedef void (*GravityRow)
+    (const GravityPass *, unsigned int, unsigned int, unsigned int, int);
+
+static inline void addToColumn (FixedPrecColumn col, unsigned int ix, FixedPrec a) {
+    setColumn (col, ix, fpAdd (getColumn (col, ix), a));
+}
+
+static inline void subFromColumn (FixedPrecColumn col, unsigned int ix, FixedPrec a) {
+    setColumn (col, ix, fpSub (getColumn (col, ix), a));
+}
+
+
+// type GravityRow, scalar
+
+// Interact body 'i' with bodies 'j0' to 'j1 - 1'. The bodies 'j' only
+// feel the reaction if 'reaction' is set.
+//
+// This is the reference the vector kernels have to match, and also
+// mops up the bodies left over at the end of their rows.
+//
+static void gravityRowScalar
+    ( const GravityPass *pass
+    , unsigned int i, unsigned int j0, unsigned int j1, int reaction )
+{
+    const BodySystem *system = pass->system;
+
+    FixedPrec
+        xI = getColumn (system->posX, i),
+        yI = getColumn (system->posY, i),
+        zI = getColumn (system->posZ, i),
+        accX = fpFromInt (0),
+        accY = fpFromInt (0),
+        accZ = fpFromInt (0);
+
+    double gmI = pass->gravMass[i];
+
+    for (unsigned int j = j0; j < j1; j++) {
+        double
+            dx      = fpToDouble (fpSub (getColumn (system->posX, j), xI)),
+            dy      = fpToDouble (fpSub (getColumn (system->posY, j), yI)),
+            dz      = fpToDouble (fpSub (getColumn (system->posZ, j), zI)),
+            r2      = dx * dx + dy * dy + dz * dz + pass->softening2,
+            invR3   = 1.0 / (r2 * sqrt (r2)),
+            sJ      = pass->gravMass[j] * invR3,
+            sI      = gmI * invR3;
+
+        accX = fpAdd (accX, fpFromDouble (sJ * dx));
+        accY = fpAdd (accY, fpFromDouble (sJ * dy));
+        accZ = fpAdd (accZ, fpFromDouble (sJ * dz));
+
+        if (reaction) {
+            subFromColumn (pass->accX, j, fpFromDouble (sI * dx));
+            subFromColumn (pass->accY, j, fpFromDouble (sI * dy));
+            subFromColumn (pass->accZ, j, fpFromDouble (sI * dz));
+        }
+    }
+
+    addToColumn (pass->accX, i, accX);
+    addToColumn (pass->accY, i, accY);
+    addToColumn (pass->accZ, i, accZ);
+}
+
+
+#if FIXED_PREC_X86
+
+// type GravityRow, AVX2
+
+// Interact body 'i' with bodies 'j0' to 'j1 - 1', four at a time.
+//
+TARGET_AVX2
+static void gravityRowAVX2
+    ( const GravityPass *pass
+    , unsigned int i, unsigned int j0, unsigned int j1, int reaction )
+{
+    const BodySystem *system = pass->system;
+
+    FixedPrec4
+        xI = fp4Broadcast (getColumn (system->posX, i)),
+        yI = fp4Broadcast (getColumn (system->posY, i)),
+        zI = fp4Broadcast (getColumn (system->posZ, i)),
+        accX = fp4Broadcast (fpFromInt (0)),
+        accY = fp4Broadcast (fpFromInt (0)),
+        accZ = fp4Broadcast (fpFromInt (0));
+
+    __m256d
+        gmI         = _mm256_set1_pd (pass->gravMass[i]),
+        softening2  = _mm256_set1_pd (pass->softening2),
+        one         = _mm256_set1_pd (1.0);
+
+    unsigned int j = j0;
+    for (; j + 4 <= j1; j += 4) {
+        __m256d
+            dx = fp4ToDouble (fp4Sub (fp4Load (system->posX, j), xI)),
+            dy = fp4ToDouble (fp4Sub (fp4Load (system->posY, j), yI)),
+            dz = fp4ToDouble (fp4Sub (fp4Load (system->posZ, j), zI));
+
+        __m256d r2 = _mm256_add_pd
+            ( _mm256_add_pd
+                ( _mm256_add_pd (_mm256_mul_pd (dx, dx), _mm256_mul_pd (dy, dy))
+                , _mm256_mul_pd (dz, dz) )
+            , softening2 );
+
+        __m256d
+            invR3   = _mm256_div_pd (one, _mm256_mul_pd (r2, _mm256_sqrt_pd (r2))),
+            sJ      = _mm256_mul_pd (_mm256_loadu_pd (pass->gravMass + j), invR3),
+            sI      = _mm256_mul_pd (gmI, invR3);
+
+        accX = fp4Add (accX, fp4FromDouble (_mm256_mul_pd (sJ, dx)));
+        accY = fp4Add (accY, fp4FromDouble (_mm256_mul_pd (sJ, dy)));
+        accZ = fp4Add (accZ, fp4FromDouble (_mm256_mul_pd (sJ, dz)));
+
+        if (reaction) {
+            fp4Store (pass->accX, j, fp4Sub
+                (fp4Load (pass->accX, j), fp4FromDouble (_mm256_mul_pd (sI, dx))));
+            fp4Store (pass->accY, j, fp4Sub
+                (fp4Load (pass->accY, j), fp4FromDouble (_mm256_mul_pd (sI, dy))));
+            fp4Store (pass->accZ, j, fp4Sub
+                (fp4Load (pass->accZ, j), fp4FromDouble (_mm256_mul_pd (sI, dz))));
+        }
+    }
+
+    addToColumn (pass->accX, i, fp4Sum (accX));
+    addToColumn (pass->accY, i, fp4Sum (accY));
+    addToColumn (pass->accZ, i, fp4Sum (accZ));
+
+    gravityRowScalar (pass, i, j, j1, reaction);
+}
+
+
+// type GravityRow, AVX-512
+
+// Interact body 'i' with bodies 'j0' to 'j1 - 1', eight at a time.
+//
+TARGET_AVX512
+static void gravityRowAVX512
+    ( const GravityPass *pass
+    , unsigned int i, unsigned int j0, unsigned int j1, int reaction )
+{
+    const BodySystem *system = pass->system;
+
+    FixedPrec8
+        xI = fp8Broadcast (getColumn (system->posX, i)),
+        yI = fp8Broadcast (getColumn (system->posY, i)),
+        zI = fp8Broadcast (getColumn (system->posZ, i)),
+        accX = fp8Broadcast (fpFromInt (0)),
+        accY = fp8Broadcast (fpFromInt (0)),
+        accZ = fp8Broadcast (fpFromInt (0));
+
+    __m512d
+        gmI         = _mm512_set1_pd (pass->gravMass[i]),
+        softening2  = _mm512_set1_pd (pass->softening2),
+        one         = _mm512_set1_pd (1.0);
+
+    unsigned int j = j0;
+    for (; j + 8 <= j1; j += 8) {
+        __m512d
+            dx = fp8ToDouble (fp8Sub (fp8Load (system->posX, j), xI)),
+            dy = fp8ToDouble (fp8Sub (fp8Load (system->posY, j), yI)),
+            dz = fp8ToDouble (fp8Sub (fp8Load (system->posZ, j), zI));
+
+        __m512d r2 = _mm512_add_pd
+            ( _mm512_add_pd
+                ( _mm512_add_pd (_mm512_mul_pd (dx, dx), _mm512_mul_pd (dy, dy))
+                , _mm512_mul_pd (dz, dz) )
+            , softening2 );
+
+        __m512d
+            invR3   = _mm512_div_pd (one, _mm512_mul_pd (r2, _mm512_sqrt_pd (r2))),
+            sJ      = _mm512_mul_pd (_mm512_loadu_pd (pass->gravMass + j), invR3),
+            sI      = _mm512_mul_pd (gmI, invR3);
+
+        accX = fp8Add (accX, fp8FromDouble (_mm512_mul_pd (sJ, dx)));
+        accY = fp8Add (accY, fp8FromDouble (_mm512_mul_pd (sJ, dy)));
+        accZ = fp8Add (accZ, fp8FromDouble (_mm512_mul_pd (sJ, dz)));
+
+        if (reaction) {
+            fp8Store (pass->accX, j, fp8Sub
+                (fp8Load (pass->accX, j), fp8FromDouble (_mm512_mul_pd (sI, dx))));
+            fp8Store (pass->accY, j, fp8Sub
+                (fp8Load (pass->accY, j), fp8FromDouble (_mm512_mul_pd (sI, dy))));
+            fp8Store (pass->accZ, j, fp8Sub
+                (fp8Load (pass->accZ, j), fp8FromDouble (_mm512_mul_pd (sI, dz))));
+        }
+    }
+
+    addToColumn (pass->accX, i, fp8Sum (accX));
+    addToColumn (pass->accY, i, fp8Sum (accY));
+    addToColumn (pass->accZ, i, fp8Sum (accZ));
+
+    gravityRowScalar (pass, i, j, j1, reaction);
+}
+
+#endif
+
+
+// type GravityPass
+
+// Resolve a kernel choice to one this CPU can actually run.
+//
+GravityKernel bestGravityKernel (GravityKernel kernel) {
+#if FIXED_PREC_X86
+    __builtin_cpu_init ();
+
+    int
+        avx512  = __builtin_cpu_supports ("avx512f") &&
+            __builtin_cpu_supports ("avx512dq"),
+        avx2    = __builtin_cpu_supports ("avx2");
+
+    if (kernel == GRAVITY_KERNEL_AUTO)
+        kernel = GRAVITY_KERNEL_AVX512;
+    if (kernel == GRAVITY_KERNEL_AVX512 && !avx512)
+        kernel = GRAVITY_KERNEL_AVX2;
+    if (kernel == GRAVITY_KERNEL_AVX2 && !avx2)
+        kernel = GRAVITY_KERNEL_SCALAR;
+
+    return kernel;
+#else
+    (void) kernel;
+    return GRAVITY_KERNEL_SCALAR;
+#endif
+}
+
+// Set up a pass over a body system, accumulating into the body system's
+// own acceleration columns. Returns 0 if out of memory.
+//
+// The accelerations aren't cleared; callers decide what they start from.
+//
+int newGravityPass (GravityPass *pass, const BodySystem *system, GravityKernel kernel) {
+    double softening = fpToDouble (system->softening);
+
+    *pass = (GravityPass) {
+        .system     = system,
+        .gravMass   = malloc ((system->numBodies + 1) * sizeof (double)),
+        .softening2 = softening * softening,
+        .accX       = system->accX,
+        .accY       = system->accY,
+        .accZ       = system->accZ,
+        .kernel     = bestGravityKernel (kernel)
+    };
+
+    if (!pass->gravMass)
+        return 0;
+
+    for (unsigned int ix = 0; ix < system->numBodies; ix++)
+        pass->gravMass[ix] = NEWTONIAN_G * fpToDouble (getColumn (system->mass, ix));
+
+    return 1;
+}
+
+void freeGravityPass (GravityPass pass) {
+    free (pass.gravMass);
+}
+
+static GravityRow gravityRow (GravityKernel kernel) {
+#if FIXED_PREC_X86
+    if (kernel == GRAVITY_KERNEL_AVX2)
+        return gravityRowAVX2;
+    if (kernel == GRAVITY_KERNEL_AVX512)
+        return gravityRowAVX512;
+#endif
+
+    return gravityRowScalar;
+}
+
+// Interact every body of tile 'tileI' with every body of tile 'tileJ',
+// where 'tileI <= tileJ'. On the diagonal, each pair is done once.
+//
+void gravityTilePair (const GravityPass *pass, unsigned int tileI, unsigned int tileJ) {
+    GravityRow row = gravityRow (pass->kernel);
+
+    unsigned int
+        numBodies   = pass->system->numBodies,
+        iStart      = tileI * GRAVITY_TILE_SIZE,
+        jStart      = tileJ * GRAVITY_TILE_SIZE,
+        iEnd        = iStart + GRAVITY_TILE_SIZE,
+        jEnd        = jStart + GRAVITY_TILE_SIZE;
+
+    if (iEnd > numBodies) iEnd = numBodies;
+    if (jEnd > numBodies) jEnd = numBodies;
+
+    for (unsigned int i = iStart; i < iEnd; i++)
+        row (pass, i, tileI == tileJ ? i + 1 : jStart, jEnd, 1);
+}
+
+// Add the pull of every other body on body 'i' alone, leaving everything
+// else alone.
+//
+// Body 'i' gets exactly what a full pass would give it: the reaction
+// side of a pair rounds just like the action side.
+//
+void gravitySingleBody (const GravityPass *pass, unsigned int i) {
+    GravityRow row = gravityRow (pass->kernel);
+
+    row (pass, i, 0, i, 0);
+    row (pass, i, i + 1, pass->system->numBodies, 0);
+}
+
+
+// Zero the accelerations of every body in a body system.
+//
+void clearAccelerations (BodySystem *system) {
+    unsigned int numBodies = system->numBodies;
+
+    memset (system->accX.wholePart, 0, numBodies * sizeof (uint64_t));
+    memset (system->accX.decPart, 0, numBodies * sizeof (uint64_t));
+    memset (system->accY.wholePart, 0, numBodies * sizeof (uint64_t));
+    memset (system->accY.decPart, 0, numBodies * sizeof (uint64_t));
+    memset (system->accZ.wholePart, 0, numBodies * sizeof (uint64_t));
+    memset (system->accZ.decPart, 0, numBodies * sizeof (uint64_t));
+}
+
+// Compute the gravitational acceleration of every body in a body system
+// due to every other, into 'accX', 'accY' and 'accZ', with whichever
+// solver the body system asks for.
+//
+void computeAccelerations (BodySystem *system) {
+    if (system->gravitySolver == GRAVITY_SOLVER_TREE)
+        computeTreeAccelerations (system, system->openingAngle);
+    else
+        computeAccelerationsWith (system, GRAVITY_KERNEL_AUTO);
+}
+
+// Direct summation across a thread pool.
+//
+// A pair of tiles writes to both tiles' accelerations, so workers can't
+// share columns. Worker 0 accumulates into the body system's own, and the
+// others each into scratch columns of their own, which are then added in
+// worker order. Integer sums don't care about order anyway, so the result
+// is the same as on one thread, but the order is fixed all the same.
+
+typedef struct DirectJob DirectJob;
+
+struct DirectJob {
+    // A pass per worker, all sharing the first one's masses
+    GravityPass *passes;
+    unsigned int numWorkers;
+
+    // Tile pairs in row order, 'tileI' in the top half
+    uint64_t *tilePairs;
+};
+
+static void runTilePair (void *context, unsigned int task, unsigned int worker) {
+    const DirectJob *job = context;
+    uint64_t pair = job->tilePairs[task];
+
+    gravityTilePair (&job->passes[worker], pair >> 32, (uint32_t) pair);
+}
+
+static void addColumns (FixedPrecColumn to, FixedPrecColumn from, unsigned int begin, unsigned int end) {
+    for (unsigned int ix = begin; ix < end; ix++)
+        addToColumn (to, ix, getColumn (from, ix));
+}
+
+static void reduceChunk (void *context, unsigned int task, unsigned int worker) {
+    const DirectJob *job = context;
+    unsigned int
+        numBodies   = job->passes[0].system->numBodies,
+        begin       = task * GRAVITY_CHUNK_SIZE,
+        end         = begin + GRAVITY_CHUNK_SIZE < numBodies ? begin + GRAVITY_CHUNK_SIZE : numBodies;
+
+    (void) worker;
+
+    for (unsigned int from = 1; from < job->numWorkers; from++) {
+        addColumns (job->passes[0].accX, job->passes[from].accX, begin, end);
+        addColumns (job->passes[0].accY, job->passes[from].accY, begin, end);
+        addColumns (job->passes[0].accZ, job->passes[from].accZ, begin, end);
+    }
+}
+
+// Give every worker but the first zeroed acceleration columns of its
+// own, carved out of one allocation. Returns it, or NULL if out of memory.
+//
+static uint64_t *allocScratchColumns (DirectJob *job, unsigned int numBodies) {
+    size_t columnSize = (size_t) numBodies + 1;
+    uint64_t *scratch = calloc (6 * columnSize * (job->numWorkers - 1) + 1, sizeof (uint64_t));
+    if (!scratch)
+        return NULL;
+
+    for (unsigned int worker = 1; worker < job->numWorkers; worker++) {
+        uint64_t *limbs = scratch + 6 * columnSize * (worker - 1);
+        FixedPrecColumn *columns[] = {
+            &job->passes[worker].accX, &job->passes[worker].accY, &job->passes[worker].accZ
+        };
+
+        job->passes[worker] = job->passes[0];
+
+        for (unsigned int colIx = 0; colIx < 3; colIx++) {
+            columns[colIx]->wholePart = limbs + 2 * colIx * columnSize;
+            columns[colIx]->decPart = limbs + (2 * colIx + 1) * columnSize;
+        }
+    }
+
+    return scratch;
+}
+
+// Compute accelerations by direct summation over all pairs, over the body
+// system's thread pool if it has one.
+//
+void computeAccelerationsWith (BodySystem *system, GravityKernel kernel) {
+    clearAccelerations (system);
+
+    unsigned int
+        numBodies   = system->numBodies,
+        numTiles    = (numBodies + GRAVITY_TILE_SIZE - 1) / GRAVITY_TILE_SIZE,
+        numPairs    = numTiles * (numTiles + 1) / 2,
+        numWorkers  = threadPoolWorkers (system->threadPool);
+
+    // Every worker of the pool can be handed a tile pair, whatever its
+    // index, so each needs a pass even when there are fewer pairs.
+    DirectJob job = {
+        .passes     = malloc (numWorkers * sizeof (GravityPass)),
+        .numWorkers = numWorkers,
+        .tilePairs  = malloc ((numPairs + 1) * sizeof (uint64_t))
+    };
+
+    uint64_t *scratch = NULL;
+    int
+        allocated   = job.passes && job.tilePairs,
+        ok          = allocated && newGravityPass (&job.passes[0], system, kernel);
+
+    if (ok && numWorkers > 1)
+        ok = (scratch = allocScratchColumns (&job, numBodies)) != NULL;
+
+    if (ok) {
+        unsigned int pairIx = 0;
+        for (uint64_t tileI = 0; tileI < numTiles; tileI++)
+        for (uint64_t tileJ = tileI; tileJ < numTiles; tileJ++)
+            job.tilePairs[pairIx++] = tileI << 32 | tileJ;
+
+        parallelFor (system->threadPool, numPairs, runTilePair, &job);
+
+        if (numWorkers > 1)
+            parallelFor
+                ( system->threadPool
+                , (numBodies + GRAVITY_CHUNK_SIZE - 1) / GRAVITY_CHUNK_SIZE
+                , reduceChunk, &job );
+    } else
+        printf ("error: computeAccelerationsWith: out of memory\n");
+
+    if (allocated)
+        freeGravityPass (job.passes[0]);
+
+    free (scratch);
+    free (job.passes);
+    free (job.tilePairs);
+}
+
+typedef struct SubsetJob SubsetJob;
+
+struct SubsetJob {
+    const GravityPass *pass;
+    const uint32_t *active;
+    unsigned int numActive;
+};
+
+static void runSubsetChunk (void *context, unsigned int task, unsigned int worker) {
+    const SubsetJob *job = context;
+    unsigned int
+        begin   = task * GRAVITY_ACTIVE_CHUNK_SIZE,
+        end     = begin + GRAVITY_ACTIVE_CHUNK_SIZE < job->numActive
+            ? begin + GRAVITY_ACTIVE_CHUNK_SIZE : job->numActive;
+
+    (void) worker;
+
+    for (unsigned int ix = begin; ix < end; ix++)
+        gravitySingleBody (job->pass, job->active[ix]);
+}
+
+// Compute the accelerations of just the 'numActive' bodies listed in
+// 'active', due to every body, with whichever solver the body system asks
+// for. Everyone else's accelerations are left alone.
+//
+// This is what lets the integrator only pay for the bodies whose
+// timesteps end. Each active body only writes its own accelerations, so
+// they're just shared out between the workers.
+//
+void computeAccelerationsFor
+    ( BodySystem *system
+    , const uint32_t *active, unsigned int numActive )
+{
+    for (unsigned int ix = 0; ix < numActive; ix++) {
+        setColumn (system->accX, active[ix], fpFromInt (0));
+        setColumn (system->accY, active[ix], fpFromInt (0));
+        setColumn (system->accZ, active[ix], fpFromInt (0));
+    }
+
+    if (system->gravitySolver == GRAVITY_SOLVER_TREE) {
+        computeTreeAccelerationsFor (system, system->openingAngle, active, numActive);
+        return;
+    }
+
+    GravityPass pass;
+    if (!newGravityPass (&pass, system, GRAVITY_KERNEL_AUTO)) {
+        printf ("error: computeAccelerationsFor: out of memory\n");
+        return;
+    }
+
+    SubsetJob job = { .pass = &pass, .active = active, .numActive = numActive };
+    parallelFor
+        ( system->threadPool
+        , (numActive + GRAVITY_ACTIVE_CHUNK_SIZE - 1) / GRAVITY_ACTIVE_CHUNK_SIZE
+        , runSubsetChunk, &job );
+
+    freeGravityPass (pass);
+}
+
+
+// Pull of bodies on rails.
+//
+// Rail bodies move on fixed orbits, so they're sources only: they pull on
+// the body system's bodies, but nothing pulls back. The pull is computed
+// just as a pair in the direct kernels is, one-sided.
+
+typedef struct RailJob RailJob;
+
+struct RailJob {
+    BodySystem *system;
+    double softening2;
+
+    const Newtonian *rails;
+    double *gravMass;
+    unsigned int numRails;
+
+    const uint32_t *active;
+    unsigned int numActive;
+};
+
+static void runRailChunk (void *context, unsigned int task, unsigned int worker) {
+    const RailJob *job = context;
+    BodySystem *system = job->system;
+    unsigned int
+        begin   = task * GRAVITY_CHUNK_SIZE,
+        end     = begin + GRAVITY_CHUNK_SIZE < job->numActive
+            ? begin + GRAVITY_CHUNK_SIZE : job->numActive;
+
+    (void) worker;
+
+    for (unsigned int actIx = begin; actIx < end; actIx++) {
+        unsigned int i = job->active ? job->active[actIx] : actIx;
+        FixedPrec
+            accX = fpFromInt (0),
+            accY = fpFromInt (0),
+            accZ = fpFromInt (0);
+
+        for (unsigned int rail = 0; rail < job->numRails; rail++) {
+            const Vec3FixedPrec *pos = &job->rails[rail].position;
+            double
+                dx      = fpToDouble (fpSub (pos->x, getColumn (system->posX, i))),
+                dy      = fpToDouble (fpSub (pos->y, getColumn (system->posY, i))),
+                dz      = fpToDouble (fpSub (pos->z, getColumn (system->posZ, i))),
+                r2      = dx * dx + dy * dy + dz * dz + job->softening2,
+                invR3   = 1.0 / (r2 * sqrt (r2)),
+                s       = job->gravMass[rail] * invR3;
+
+            accX = fpAdd (accX, fpFromDouble (s * dx));
+            accY = fpAdd (accY, fpFromDouble (s * dy));
+            accZ = fpAdd (accZ, fpFromDouble (s * dz));
+        }
+
+        addToColumn (system->accX, i, accX);
+        addToColumn (system->accY, i, accY);
+        addToColumn (system->accZ, i, accZ);
+    }
+}
+
+// Add the pull of the 'numRails' rail bodies in 'rails' to the
+// accelerations of the 'numActive' bodies listed in 'active', or of every
+// body if that's NULL.
+//
+void addRailAccelerations
+    ( BodySystem *system, const Newtonian *rails, unsigned int numRails
+    , const uint32_t *active, unsigned int numActive )
+{
+    if (!numRails)
+        return;
+
+    double softening = fpToDouble (system->softening);
+
+    RailJob job = {
+        .system     = system,
+        .softening2 = softening * softening,
+        .rails      = rails,
+        .gravMass   = malloc (numRails * sizeof (double)),
+        .numRails   = numRails,
+        .active     = active,
+        .numActive  = active ? numActive : system->numBodies
+    };
+
+    if (!job.gravMass) {
+        printf ("error: addRailAccelerations: out of memory\n");
+        return;
+    }
+
+    for (unsigned int rail = 0; rail < numRails; rail++)
+        job.gravMass[rail] = NEWTONIAN_G * fpToDouble (rails[rail].mass);
+
+    parallelFor
+        ( system->threadPool
+        , (job.numActive + GRAVITY_CHUNK_SIZE - 1) / GRAVITY_CHUNK_SIZE
+        , runRailChunk, &job );
+
+    free (job.gravMass);
+}
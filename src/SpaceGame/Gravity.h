@@ -0,0 +1,73 @@
+
+#ifndef SPACE_GAME_GRAVITY_H
+#define SPACE_GAME_GRAVITY_H
+
+#include "FixedPrecision.h"
+#include "Newtonian.h"
+#include "BodySystem.h"
+
+// Which implementation of the all-pairs kernel to run.
+//
+// Every kernel gives bit-identical results, so this only affects speed.
+// Asking for one the CPU can't run falls back to the best one it can.
+//
+typedef enum GravityKernel GravityKernel;
+
+enum GravityKernel {
+    GRAVITY_KERNEL_AUTO,
+    GRAVITY_KERNEL_SCALAR,
+    GRAVITY_KERNEL_AVX2,
+    GRAVITY_KERNEL_AVX512
+};
+
+// Number of bodies per tile of the all-pairs kernel. A tile's positions,
+// masses and accelerations fit comfortably in L1.
+//
+#define GRAVITY_TILE_SIZE 256
+
+// Bodies per task when per-body work is shared out over threads. The
+// forces on a subset are a whole row per body, so they get smaller tasks.
+//
+#define GRAVITY_CHUNK_SIZE 4096
+#define GRAVITY_ACTIVE_CHUNK_SIZE 16
+
+// Everything a tile of the all-pairs kernel reads and writes.
+//
+// Accelerations are accumulated into 'accX', 'accY' and 'accZ' rather
+// than straight into the body system, so that separate workers can each
+// be given their own columns and the results summed afterwards.
+//
+typedef struct GravityPass GravityPass;
+
+struct GravityPass {
+    const BodySystem *system;
+
+    // 'G m' for every body, as a double
+    double *gravMass;
+
+    // Square of the softening length
+    double softening2;
+
+    FixedPrecColumn accX, accY, accZ;
+
+    GravityKernel kernel;
+};
+
+GravityKernel bestGravityKernel (GravityKernel);
+
+int newGravityPass (GravityPass *, const BodySystem *, GravityKernel);
+void freeGravityPass (GravityPass);
+
+void gravityTilePair (const GravityPass *, unsigned int, unsigned int);
+void gravitySingleBody (const GravityPass *, unsigned int);
+
+void clearAccelerations (BodySystem *);
+
+void computeAccelerations (BodySystem *);
+void computeAccelerationsWith (BodySystem *, GravityKernel);
+void computeAccelerationsFor (BodySystem *, const uint32_t *, unsigned int);
+
+void addRailAccelerations
+    (BodySystem *, const Newtonian *, unsigned int, const uint32_t *, unsigned int);
+
+#endif
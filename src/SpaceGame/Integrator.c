@@ -0,0 +1,341 @@
+
+// SpaceGame.Integrator
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "FixedPrecision.h"
+#include "Newtonian.h"
+#include "BodySystem.h"
+#include "Gravity.h"
+#include "Planet.h"
+#include "Integrator.h"
+#include "ThreadPool.h"
+
+
+
+// Hierarchical block timesteps.
+//
+// Time inside a call to 'integrate' is counted in ticks of the finest
+// level, so a level 'k' step is '2^(maxLevel - k)' ticks, and every step
+// starts on a multiple of its own length. At each tick where some step
+// ends:
+//
+//  1. bodies starting a step get the first half kick, 'v += a dt / 2',
+//  2. every body drifts to the tick where the next step ends,
+//  3. the bodies whose steps end there get their forces evaluated, the
+//     second half kick, and a new level.
+//
+// Bodies can move to a finer level whenever their step ends, but only to
+// a coarser one when the current tick is a multiple of its step length,
+// so that steps always stay in sync.
+//
+// Everything is in a fixed order with fixed-precision state, so the
+// result never depends on anything but the initial state. Kicks, drifts
+// and level changes only touch one body each, so they're shared out over
+// the body system's thread pool without changing that.
+
+// Create an integrator that steps by 'maxStep' with up to 'maxLevel'
+// levels of subdivision.
+//
+Integrator newIntegrator (FixedPrec maxStep, unsigned int maxLevel) {
+    if (maxLevel > INTEGRATOR_MAX_LEVEL) {
+        printf ("error: newIntegrator: level %u is too fine\n", maxLevel);
+        maxLevel = INTEGRATOR_MAX_LEVEL;
+    }
+
+    return (Integrator) {
+        .maxStep    = maxStep,
+        .maxLevel   = maxLevel,
+        .accuracy   = 0.02,
+        .time       = fpFromInt (0)
+    };
+}
+
+// Length of a step at a level, in ticks and in time.
+//
+static inline uint64_t levelTicks (const Integrator *integrator, uint64_t level) {
+    return 1ULL << (integrator->maxLevel - level);
+}
+
+static inline FixedPrec levelStep (const Integrator *integrator, uint64_t level) {
+    return fpFromBits (shr128u (fpBits (integrator->maxStep), (uint32_t) level));
+}
+
+// Change a body's velocity by its acceleration times 'dt'.
+//
+static void kick (BodySystem *system, unsigned int ix, FixedPrec dt) {
+    setColumn (system->velX, ix, fpAdd
+        (getColumn (system->velX, ix), fpMul (getColumn (system->accX, ix), dt)));
+    setColumn (system->velY, ix, fpAdd
+        (getColumn (system->velY, ix), fpMul (getColumn (system->accY, ix), dt)));
+    setColumn (system->velZ, ix, fpAdd
+        (getColumn (system->velZ, ix), fpMul (getColumn (system->accZ, ix), dt)));
+}
+
+// Move a body along its velocity for 'dt'.
+//
+static void drift (BodySystem *system, unsigned int ix, FixedPrec dt) {
+    setColumn (system->posX, ix, fpAdd
+        (getColumn (system->posX, ix), fpMul (getColumn (system->velX, ix), dt)));
+    setColumn (system->posY, ix, fpAdd
+        (getColumn (system->posY, ix), fpMul (getColumn (system->velY, ix), dt)));
+    setColumn (system->posZ, ix, fpAdd
+        (getColumn (system->posZ, ix), fpMul (getColumn (system->velZ, ix), dt)));
+}
+
+// Compute the accelerations of the 'numActive' bodies listed in 'active'
+// at 'time': the body system's own pull, plus that of the planets on
+// rails where they are at that time. 'rails' has room for every planet.
+//
+static void computeForces
+    ( Integrator *integrator, BodySystem *system, Newtonian *rails, FixedPrec time
+    , const uint32_t *active, unsigned int numActive )
+{
+    computeAccelerationsFor (system, active, numActive);
+    integrator->forceEvaluations += numActive;
+
+    if (!integrator->numPlanets || !numActive)
+        return;
+
+    for (unsigned int ix = 0; ix < integrator->numPlanets; ix++)
+        rails[ix] = planetAt (&integrator->planets[ix], time);
+
+    addRailAccelerations (system, rails, integrator->numPlanets, active, numActive);
+}
+
+// Remember the acceleration at the start of a body's step, to estimate
+// the jerk from at the end of it.
+//
+static void saveAcceleration (BodySystem *system, unsigned int ix) {
+    setColumn (system->prevAccX, ix, getColumn (system->accX, ix));
+    setColumn (system->prevAccY, ix, getColumn (system->accY, ix));
+    setColumn (system->prevAccZ, ix, getColumn (system->accZ, ix));
+}
+
+// Pick the level a body wants for its next step, from the change in its
+// acceleration over the 'dt' it just took: Aarseth's 'eta |a| / |da/dt|'.
+//
+static uint64_t wantedLevel (const Integrator *integrator, const BodySystem *system, unsigned int ix, double dt) {
+    double
+        ax  = fpToDouble (getColumn (system->accX, ix)),
+        ay  = fpToDouble (getColumn (system->accY, ix)),
+        az  = fpToDouble (getColumn (system->accZ, ix)),
+        dax = ax - fpToDouble (getColumn (system->prevAccX, ix)),
+        day = ay - fpToDouble (getColumn (system->prevAccY, ix)),
+        daz = az - fpToDouble (getColumn (system->prevAccZ, ix)),
+        acc = sqrt (ax * ax + ay * ay + az * az),
+        change = sqrt (dax * dax + day * day + daz * daz);
+
+    if (change == 0)
+        return 0;
+
+    double
+        wanted  = integrator->accuracy * acc * dt / change,
+        step    = fpToDouble (integrator->maxStep);
+
+    uint64_t level = 0;
+    while (level < integrator->maxLevel && step > wanted) {
+        step *= 0.5;
+        level++;
+    }
+
+    return level;
+}
+
+// Evaluate the forces on bodies the integrator hasn't seen yet, and start
+// them off on the finest level. They move up as soon as their jerk says
+// they can.
+//
+static void startNewBodies
+    (Integrator *integrator, BodySystem *system, Newtonian *rails, uint32_t *active)
+{
+    unsigned int numActive = 0;
+
+    for (unsigned int ix = 0; ix < system->numBodies; ix++)
+        if (system->timeLevels[ix] == UNSET_TIME_LEVEL)
+            active[numActive++] = ix;
+
+    if (!numActive)
+        return;
+
+    computeForces (integrator, system, rails, integrator->time, active, numActive);
+
+    for (unsigned int ix = 0; ix < numActive; ix++) {
+        system->timeLevels[active[ix]] = integrator->maxLevel;
+        saveAcceleration (system, active[ix]);
+    }
+}
+
+// One substep, as shared out over threads: the tick it starts from, the
+// finest level in use, and the bodies whose steps end after it.
+//
+typedef struct SubstepJob SubstepJob;
+
+struct SubstepJob {
+    const Integrator *integrator;
+    BodySystem *system;
+
+    uint64_t tick;
+    uint64_t finest;
+
+    const uint32_t *active;
+    unsigned int numActive;
+};
+
+static inline unsigned int chunkEnd (unsigned int task, unsigned int n) {
+    unsigned int end = (task + 1) * INTEGRATOR_CHUNK_SIZE;
+    return end < n ? end : n;
+}
+
+// Opening half kicks of the bodies starting a step, and the drift of
+// every body to the end of the substep.
+//
+static void kickDriftChunk (void *context, unsigned int task, unsigned int worker) {
+    const SubstepJob *job = context;
+    const Integrator *integrator = job->integrator;
+    BodySystem *system = job->system;
+    FixedPrec dt = levelStep (integrator, job->finest);
+
+    (void) worker;
+
+    for (unsigned int ix = task * INTEGRATOR_CHUNK_SIZE; ix < chunkEnd (task, system->numBodies); ix++) {
+        uint64_t level = system->timeLevels[ix];
+
+        if (job->tick % levelTicks (integrator, level) == 0)
+            kick (system, ix, levelStep (integrator, level + 1));
+
+        drift (system, ix, dt);
+    }
+}
+
+// Closing half kicks of the bodies ending a step, and their new levels.
+//
+static void kickChunk (void *context, unsigned int task, unsigned int worker) {
+    const SubstepJob *job = context;
+    const Integrator *integrator = job->integrator;
+    BodySystem *system = job->system;
+
+    (void) worker;
+
+    for (unsigned int actIx = task * INTEGRATOR_CHUNK_SIZE; actIx < chunkEnd (task, job->numActive); actIx++) {
+        unsigned int ix = job->active[actIx];
+        uint64_t level = system->timeLevels[ix];
+
+        kick (system, ix, levelStep (integrator, level + 1));
+
+        uint64_t wanted = wantedLevel
+            (integrator, system, ix, fpToDouble (levelStep (integrator, level)));
+
+        while (wanted < level && job->tick % levelTicks (integrator, wanted))
+            wanted++;
+
+        system->timeLevels[ix] = wanted;
+        saveAcceleration (system, ix);
+    }
+}
+
+static inline unsigned int numChunks (unsigned int n) {
+    return (n + INTEGRATOR_CHUNK_SIZE - 1) / INTEGRATOR_CHUNK_SIZE;
+}
+
+// Advance a body system by one level 0 step.
+//
+void integrate (Integrator *integrator, BodySystem *system) {
+    uint32_t *active = malloc ((system->numBodies + 1) * sizeof (uint32_t));
+    Newtonian *rails = malloc ((integrator->numPlanets + 1) * sizeof (Newtonian));
+    if (!active || !rails) {
+        printf ("error: integrate: out of memory\n");
+        free (active);
+        free (rails);
+        return;
+    }
+
+    startNewBodies (integrator, system, rails, active);
+
+    uint64_t
+        *levels = system->timeLevels,
+        numTicks = levelTicks (integrator, 0);
+
+    SubstepJob job = {
+        .integrator = integrator,
+        .system     = system,
+        .active     = active
+    };
+
+    while (job.tick < numTicks) {
+        job.finest = 0;
+        for (unsigned int ix = 0; ix < system->numBodies; ix++)
+            if (levels[ix] > job.finest)
+                job.finest = levels[ix];
+
+        parallelFor
+            (system->threadPool, numChunks (system->numBodies), kickDriftChunk, &job);
+
+        job.tick += levelTicks (integrator, job.finest);
+        integrator->substeps++;
+
+        job.numActive = 0;
+        for (unsigned int ix = 0; ix < system->numBodies; ix++)
+            if (job.tick % levelTicks (integrator, levels[ix]) == 0)
+                active[job.numActive++] = ix;
+
+        FixedPrec time = fpAdd (integrator->time, fpMul
+            (fpFromInt (job.tick), levelStep (integrator, integrator->maxLevel)));
+
+        computeForces (integrator, system, rails, time, active, job.numActive);
+
+        parallelFor
+            (system->threadPool, numChunks (job.numActive), kickChunk, &job);
+    }
+
+    integrator->time = fpAdd (integrator->time, integrator->maxStep);
+    free (active);
+    free (rails);
+}
+
+// Energy diagnostics.
+//
+// These are in double precision, and the potential is a direct sum over
+// all pairs, so they're for measuring drift, not for every tick. They're
+// only meaningful between calls to 'integrate', when every body's
+// velocity is in sync.
+
+double kineticEnergy (const BodySystem *system) {
+    double energy = 0;
+
+    for (unsigned int ix = 0; ix < system->numBodies; ix++) {
+        double
+            vx = fpToDouble (getColumn (system->velX, ix)),
+            vy = fpToDouble (getColumn (system->velY, ix)),
+            vz = fpToDouble (getColumn (system->velZ, ix));
+
+        energy += 0.5 * fpToDouble (getColumn (system->mass, ix)) *
+            (vx * vx + vy * vy + vz * vz);
+    }
+
+    return energy;
+}
+
+// Potential energy, softened the same way as the forces.
+//
+double potentialEnergy (const BodySystem *system) {
+    double
+        softening   = fpToDouble (system->softening),
+        energy      = 0;
+
+    for (unsigned int i = 0; i < system->numBodies; i++)
+    for (unsigned int j = i + 1; j < system->numBodies; j++) {
+        double
+            dx = fpToDouble (fpSub (getColumn (system->posX, j), getColumn (system->posX, i))),
+            dy = fpToDouble (fpSub (getColumn (system->posY, j), getColumn (system->posY, i))),
+            dz = fpToDouble (fpSub (getColumn (system->posZ, j), getColumn (system->posZ, i))),
+            r = sqrt (dx * dx + dy * dy + dz * dz + softening * softening);
+
+        energy -= NEWTONIAN_G * fpToDouble (getColumn (system->mass, i)) *
+            fpToDouble (getColumn (system->mass, j)) / r;
+    }
+
+    return energy;
+}
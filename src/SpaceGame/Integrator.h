@@ -0,0 +1,58 @@
+
+#ifndef SPACE_GAME_INTEGRATOR_H
+#define SPACE_GAME_INTEGRATOR_H
+
+#include <stdint.h>
+
+#include "FixedPrecision.h"
+#include "BodySystem.h"
+#include "Planet.h"
+
+// Finest timestep level there can be. Level 'k' steps by 'maxStep / 2^k'.
+//
+#define INTEGRATOR_MAX_LEVEL 30
+
+// Bodies per task when kicks and drifts are shared out over threads.
+//
+#define INTEGRATOR_CHUNK_SIZE 1024
+
+// Kick-drift-kick leapfrog with hierarchical block timesteps.
+//
+// Every body steps by a power-of-two fraction of 'maxStep', its level,
+// chosen from how fast its acceleration changes; 'integrate' advances the
+// whole body system by 'maxStep', evaluating each body's forces only at
+// the ends of its own steps.
+//
+typedef struct Integrator Integrator;
+
+struct Integrator {
+    // Length of a level 0 step
+    FixedPrec maxStep;
+
+    // Finest level bodies may use, at most 'INTEGRATOR_MAX_LEVEL'
+    unsigned int maxLevel;
+
+    // Timesteps are 'accuracy * |a| / |da/dt|'
+    double accuracy;
+
+    // Simulation time so far
+    FixedPrec time;
+
+    // Bodies on rails, which pull on the body system's bodies without
+    // being pulled back, or NULL. Not owned.
+    const Planet *planets;
+    unsigned int numPlanets;
+
+    // Force evaluations, one per body per evaluation, and substeps so far
+    uint64_t forceEvaluations;
+    uint64_t substeps;
+};
+
+Integrator newIntegrator (FixedPrec, unsigned int);
+
+void integrate (Integrator *, BodySystem *);
+
+double kineticEnergy (const BodySystem *);
+double potentialEnergy (const BodySystem *);
+
+#endif
@@ -9,9 +9,32 @@
 
 
 
-// Compute the gravitational force between two Newtonian bodies.
+// Compute the gravitational force on 'newt1' due to 'newt2'.
+//
+// That's 'G m1 m2 / r^2' along the unit separation vector, or
+// 'G m1 m2 d / r^3' with 'd' the separation, which needs no square root
+// beyond the one hidden in 'fp3InvDistanceCubed'.
 //
 Vec3FixedPrec gravity (Newtonian newt1, Newtonian newt2) {
-    FixedPrec r = fp3Distance (newt1.position, newt2.position);
-    return G * newt1.mass * newt2.mass / (r * r);
+    FixedPrec
+        masses      = fpMul (newt1.mass, newt2.mass),
+        invR3       = fp3InvDistanceCubed (newt1.position, newt2.position),
+        strength    = fpMul (fpMul (fpFromDouble (NEWTONIAN_G), masses), invR3);
+
+    return (Vec3FixedPrec) {
+        .x = fpMul (strength, fpSub (newt2.position.x, newt1.position.x)),
+        .y = fpMul (strength, fpSub (newt2.position.y, newt1.position.y)),
+        .z = fpMul (strength, fpSub (newt2.position.z, newt1.position.z))
+    };
+}
+
+// Apply a force to a Newtonian body for a time 'dt', changing its
+// velocity by 'F dt / m'. Positions are the integrator's business.
+//
+Newtonian applyForce (Vec3FixedPrec force, FixedPrec dt, Newtonian newt) {
+    newt.velocity.x = fpAdd (newt.velocity.x, fpDiv (fpMul (force.x, dt), newt.mass));
+    newt.velocity.y = fpAdd (newt.velocity.y, fpDiv (fpMul (force.y, dt), newt.mass));
+    newt.velocity.z = fpAdd (newt.velocity.z, fpDiv (fpMul (force.z, dt), newt.mass));
+
+    return newt;
 }
@@ -4,6 +4,12 @@
 
 #include "FixedPrecision.h"
 
+// Gravitational constant, in simulation units.
+//
+#ifndef NEWTONIAN_G
+#define NEWTONIAN_G 1.0
+#endif
+
 // Store physics properties of a Newtonian body.
 //
 typedef struct Newtonian Newtonian;
@@ -19,4 +25,6 @@ struct Newtonian {
 
 Vec3FixedPrec gravity (Newtonian, Newtonian);
 
-Newtonian applyForce (Vec3FixedPrec, Newtonian);
+Newtonian applyForce (Vec3FixedPrec, FixedPrec, Newtonian);
+
+#endif
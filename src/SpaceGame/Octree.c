@@ -0,0 +1,719 @@
+
+// SpaceGame.Octree
+
+// Forces here have to round exactly like the direct kernels', see
+// 'Gravity.c'.
+#if defined (__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined (__GNUC__)
+#pragma GCC optimize ("fp-contract=off")
+#endif
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "FixedPrecision.h"
+#include "BodySystem.h"
+#include "Gravity.h"
+#include "Octree.h"
+#include "ThreadPool.h"
+
+
+
+// Barnes-Hut gravity.
+//
+// Each body's position is turned into 'OCTREE_KEY_BITS' bits per axis,
+// counted from the corner of the bounding cube, and those are interleaved
+// into a Morton code. For anything bigger than a few million units across
+// that's just the top bits of 'wholePart'; tiny systems dip into
+// 'decPart' so that they still get a useful tree.
+//
+// Sorting by Morton code lays the octree out: every cube at every level
+// is a contiguous run of the order, and its children are the sub-runs
+// sharing the next 3 bits. Building is a radix sort plus one pass per
+// level, so O(N log N) at worst.
+//
+// The root's octants are independent, so each one is sorted and built as
+// a task of its own, into its own node buffer, and the buffers are then
+// stitched together in octant order. The tree is the same however many
+// threads built it.
+
+#define OCTREE_RADIX_BITS 10
+#define OCTREE_MAX_DEPTH OCTREE_KEY_BITS
+
+// Spread the bottom 21 bits of a 64-bit integer out to every third bit.
+//
+static uint64_t spreadBits (uint64_t a) {
+    a &= 0x1FFFFF;
+    a = (a | a << 32) & 0x001F00000000FFFFULL;
+    a = (a | a << 16) & 0x001F0000FF0000FFULL;
+    a = (a | a << 8) & 0x100F00F00F00F00FULL;
+    a = (a | a << 4) & 0x10C30C30C30C30C3ULL;
+    a = (a | a << 2) & 0x1249249249249249ULL;
+    return a;
+}
+
+// Octant of a Morton code at a level of the tree, the root being level 0.
+//
+static inline unsigned int octant (uint64_t key, unsigned int level) {
+    return (key >> (3 * (OCTREE_KEY_BITS - 1 - level))) & 7;
+}
+
+// Width of the cubes at a level of the tree, in simulation units.
+//
+static inline double cellSize (const Octree *tree, unsigned int level) {
+    return ldexp (1.0, (int) (tree->shift + OCTREE_KEY_BITS - level) - 64);
+}
+
+static inline Vec3FixedPrec bodyPosition (const BodySystem *system, unsigned int ix) {
+    return (Vec3FixedPrec) {
+        getColumn (system->posX, ix),
+        getColumn (system->posY, ix),
+        getColumn (system->posZ, ix)
+    };
+}
+
+// Find the corner of the bounding cube and the shift that fits its width
+// into 'OCTREE_KEY_BITS', then compute every body's Morton code.
+//
+static void computeKeys (Octree *tree, const BodySystem *system) {
+    Vec3FixedPrec
+        lo = bodyPosition (system, 0),
+        hi = lo;
+
+    for (unsigned int ix = 1; ix < system->numBodies; ix++) {
+        Vec3FixedPrec pos = bodyPosition (system, ix);
+
+        if (fpLessThan (pos.x, lo.x)) lo.x = pos.x;
+        if (fpLessThan (pos.y, lo.y)) lo.y = pos.y;
+        if (fpLessThan (pos.z, lo.z)) lo.z = pos.z;
+        if (fpLessThan (hi.x, pos.x)) hi.x = pos.x;
+        if (fpLessThan (hi.y, pos.y)) hi.y = pos.y;
+        if (fpLessThan (hi.z, pos.z)) hi.z = pos.z;
+    }
+
+    // The differences are non-negative, so they can be read as unsigned.
+    UInt128 span = fpBits (fpSub (hi.x, lo.x));
+    UInt128 spanY = fpBits (fpSub (hi.y, lo.y));
+    UInt128 spanZ = fpBits (fpSub (hi.z, lo.z));
+    if (lt128u (span, spanY)) span = spanY;
+    if (lt128u (span, spanZ)) span = spanZ;
+
+    uint32_t width = span.hi || span.lo ? 128 - clz128u (span) : 0;
+
+    tree->origin = lo;
+    tree->shift = width > OCTREE_KEY_BITS ? width - OCTREE_KEY_BITS : 0;
+
+    for (unsigned int ix = 0; ix < system->numBodies; ix++) {
+        Vec3FixedPrec pos = bodyPosition (system, ix);
+
+        uint64_t
+            x = shr128u (fpBits (fpSub (pos.x, lo.x)), tree->shift).lo,
+            y = shr128u (fpBits (fpSub (pos.y, lo.y)), tree->shift).lo,
+            z = shr128u (fpBits (fpSub (pos.z, lo.z)), tree->shift).lo;
+
+        tree->keys[ix] = spreadBits (x) << 2 | spreadBits (y) << 1 | spreadBits (z);
+        tree->order[ix] = ix;
+    }
+}
+
+
+// type OctantJob
+
+// Sorting and building of the subtree under one octant of the root.
+//
+typedef struct OctantJob OctantJob;
+
+struct OctantJob {
+    const Octree *tree;
+    const GravityPass *pass;
+
+    // Range of the order, and scratch space just as big
+    uint32_t begin, end;
+    uint64_t *scratchKeys;
+    uint32_t *scratchOrder;
+
+    // Nodes of the subtree, its root first
+    OctreeNode *nodes;
+    unsigned int numNodes;
+    unsigned int capacity;
+
+    int ok;
+};
+
+// Radix sort the job's range by Morton code, below the root's octant.
+//
+// The sort is stable and the order starts out by index, so bodies with
+// equal codes end up by index too.
+//
+static void sortOctant (OctantJob *job) {
+    uint64_t *keys = job->tree->keys + job->begin;
+    uint32_t *order = job->tree->order + job->begin;
+    uint32_t n = job->end - job->begin;
+
+    uint64_t *keysOut = job->scratchKeys;
+    uint32_t *orderOut = job->scratchOrder;
+
+    // The root octant's 3 bits are the same over the whole range.
+    for (unsigned int bit = 0; bit < 3 * OCTREE_KEY_BITS - 3; bit += OCTREE_RADIX_BITS) {
+        uint32_t counts[1 << OCTREE_RADIX_BITS] = { 0 };
+        uint64_t mask = (1 << OCTREE_RADIX_BITS) - 1;
+
+        for (uint32_t ix = 0; ix < n; ix++)
+            counts[(keys[ix] >> bit) & mask]++;
+
+        uint32_t total = 0;
+        for (uint32_t digit = 0; digit <= mask; digit++) {
+            uint32_t count = counts[digit];
+            counts[digit] = total;
+            total += count;
+        }
+
+        for (uint32_t ix = 0; ix < n; ix++) {
+            uint32_t dest = counts[(keys[ix] >> bit) & mask]++;
+            keysOut[dest] = keys[ix];
+            orderOut[dest] = order[ix];
+        }
+
+        uint64_t *keysIn = keys;
+        uint32_t *orderIn = order;
+        keys = keysOut;
+        order = orderOut;
+        keysOut = keysIn;
+        orderOut = orderIn;
+    }
+
+    // An odd number of passes leaves the result in the scratch space.
+    if (keys != job->tree->keys + job->begin) {
+        memcpy (job->tree->keys + job->begin, keys, n * sizeof (uint64_t));
+        memcpy (job->tree->order + job->begin, order, n * sizeof (uint32_t));
+    }
+}
+
+// Reserve 'n' consecutive nodes, returning the index of the first.
+//
+static unsigned int allocNodes (OctantJob *job, unsigned int n) {
+    if (job->numNodes + n > job->capacity) {
+        unsigned int capacity = 2 * job->capacity + n;
+        OctreeNode *nodes = realloc (job->nodes, capacity * sizeof (OctreeNode));
+
+        if (!nodes) {
+            job->ok = 0;
+            return 0;
+        }
+
+        job->nodes = nodes;
+        job->capacity = capacity;
+    }
+
+    unsigned int first = job->numNodes;
+    job->numNodes += n;
+    return first;
+}
+
+// Work out a node's mass and centre of mass from its contents.
+//
+// Offsets are taken from the first position, in double precision, so
+// precision only depends on the size of the node and not on where it is.
+//
+static void summariseNode
+    ( OctreeNode *node
+    , const Vec3FixedPrec positions[], const double gravMasses[], unsigned int n )
+{
+    Vec3FixedPrec ref = n ? positions[0] : (Vec3FixedPrec) {
+        fpFromInt (0), fpFromInt (0), fpFromInt (0)
+    };
+
+    double gravMass = 0, sumX = 0, sumY = 0, sumZ = 0;
+
+    for (unsigned int ix = 0; ix < n; ix++) {
+        gravMass += gravMasses[ix];
+        sumX += gravMasses[ix] * fpToDouble (fpSub (positions[ix].x, ref.x));
+        sumY += gravMasses[ix] * fpToDouble (fpSub (positions[ix].y, ref.y));
+        sumZ += gravMasses[ix] * fpToDouble (fpSub (positions[ix].z, ref.z));
+    }
+
+    node->gravMass = gravMass;
+    node->centreOfMass = ref;
+
+    if (gravMass > 0) {
+        node->centreOfMass.x = fpAdd (ref.x, fpFromDouble (sumX / gravMass));
+        node->centreOfMass.y = fpAdd (ref.y, fpFromDouble (sumY / gravMass));
+        node->centreOfMass.z = fpAdd (ref.z, fpFromDouble (sumZ / gravMass));
+    }
+}
+
+// Work out the mass and centre of mass of the bodies in the run 'begin'
+// to 'end - 1' of the order.
+//
+// Leaves at the bottom level can hold any number of bodies, so they're
+// summarised in chunks, which are then combined.
+//
+static void summariseBodies
+    ( OctreeNode *node, const Octree *tree, const GravityPass *pass
+    , uint32_t begin, uint32_t end )
+{
+    Vec3FixedPrec positions[OCTREE_LEAF_SIZE];
+    double gravMasses[OCTREE_LEAF_SIZE];
+
+    Vec3FixedPrec chunkCentres[OCTREE_LEAF_SIZE];
+    double chunkMasses[OCTREE_LEAF_SIZE];
+    unsigned int numChunks = 0;
+
+    for (uint32_t chunk = begin; chunk < end; chunk += OCTREE_LEAF_SIZE) {
+        unsigned int n = end - chunk < OCTREE_LEAF_SIZE ? end - chunk : OCTREE_LEAF_SIZE;
+
+        for (unsigned int ix = 0; ix < n; ix++) {
+            uint32_t body = tree->order[chunk + ix];
+            positions[ix] = bodyPosition (pass->system, body);
+            gravMasses[ix] = pass->gravMass[body];
+        }
+
+        OctreeNode part, folded;
+        summariseNode (&part, positions, gravMasses, n);
+
+        if (numChunks == OCTREE_LEAF_SIZE) {
+            summariseNode (&folded, chunkCentres, chunkMasses, numChunks);
+            chunkCentres[0] = folded.centreOfMass;
+            chunkMasses[0] = folded.gravMass;
+            numChunks = 1;
+        }
+
+        chunkCentres[numChunks] = part.centreOfMass;
+        chunkMasses[numChunks] = part.gravMass;
+        numChunks++;
+    }
+
+    summariseNode (node, chunkCentres, chunkMasses, numChunks);
+}
+
+// Build the node covering the run 'begin' to 'end - 1' of the order, and
+// everything below it.
+//
+static void buildNode
+    ( OctantJob *job, unsigned int nodeIx
+    , uint32_t begin, uint32_t end, unsigned int level )
+{
+    const Octree *tree = job->tree;
+
+    OctreeNode node = {
+        .size   = cellSize (tree, level),
+        .begin  = begin,
+        .end    = end
+    };
+
+    if (end - begin <= OCTREE_LEAF_SIZE || level == OCTREE_MAX_DEPTH) {
+        summariseBodies (&node, tree, job->pass, begin, end);
+        job->nodes[nodeIx] = node;
+        return;
+    }
+
+    uint32_t bounds[9];
+    unsigned int numChildren = 0;
+
+    for (uint32_t ix = begin; ix < end; ix++)
+        if (ix == begin ||
+            octant (tree->keys[ix], level) != octant (tree->keys[ix - 1], level))
+            bounds[numChildren++] = ix;
+
+    bounds[numChildren] = end;
+
+    node.numChildren = numChildren;
+    node.firstChild = allocNodes (job, numChildren);
+    if (!job->ok)
+        return;
+
+    for (unsigned int child = 0; child < numChildren; child++)
+        buildNode
+            ( job, node.firstChild + child
+            , bounds[child], bounds[child + 1], level + 1 );
+
+    if (!job->ok)
+        return;
+
+    Vec3FixedPrec positions[8];
+    double gravMasses[8];
+
+    for (unsigned int child = 0; child < numChildren; child++) {
+        positions[child] = job->nodes[node.firstChild + child].centreOfMass;
+        gravMasses[child] = job->nodes[node.firstChild + child].gravMass;
+    }
+
+    summariseNode (&node, positions, gravMasses, numChildren);
+    job->nodes[nodeIx] = node;
+}
+
+static void runOctantJob (void *context, unsigned int task, unsigned int worker) {
+    OctantJob *job = (OctantJob *) context + task;
+
+    (void) worker;
+
+    if (job->begin == job->end)
+        return;
+
+    sortOctant (job);
+
+    unsigned int root = allocNodes (job, 1);
+    if (job->ok)
+        buildNode (job, root, job->begin, job->end, 1);
+}
+
+
+// type Octree
+
+// Sort the bodies by root octant, keeping them by index within each, and
+// set up a job for each octant.
+//
+static void splitOctants
+    ( Octree *tree, const GravityPass *pass
+    , uint64_t *scratchKeys, uint32_t *scratchOrder, OctantJob jobs[8] )
+{
+    unsigned int numBodies = tree->numBodies;
+    uint32_t bounds[9] = { 0 };
+
+    for (unsigned int ix = 0; ix < numBodies; ix++)
+        bounds[octant (tree->keys[ix], 0) + 1]++;
+    for (unsigned int oct = 0; oct < 8; oct++)
+        bounds[oct + 1] += bounds[oct];
+
+    uint32_t fill[8];
+    memcpy (fill, bounds, sizeof (fill));
+
+    for (unsigned int ix = 0; ix < numBodies; ix++) {
+        uint32_t dest = fill[octant (tree->keys[ix], 0)]++;
+        scratchKeys[dest] = tree->keys[ix];
+        scratchOrder[dest] = ix;
+    }
+
+    memcpy (tree->keys, scratchKeys, numBodies * sizeof (uint64_t));
+    memcpy (tree->order, scratchOrder, numBodies * sizeof (uint32_t));
+
+    for (unsigned int oct = 0; oct < 8; oct++)
+        jobs[oct] = (OctantJob) {
+            .tree           = tree,
+            .pass           = pass,
+            .begin          = bounds[oct],
+            .end            = bounds[oct + 1],
+            .scratchKeys    = scratchKeys + bounds[oct],
+            .scratchOrder   = scratchOrder + bounds[oct],
+            .ok             = 1
+        };
+}
+
+// Put the root and the subtrees of the octant jobs together into the
+// final node array: the root, then the root's children, then the rest of
+// each subtree in turn. Returns 0 if out of memory.
+//
+static int stitchOctree (Octree *tree, const GravityPass *pass, const OctantJob jobs[8]) {
+    unsigned int numChildren = 0, numNodes = 1;
+
+    // Small systems are a single leaf.
+    if (tree->numBodies > OCTREE_LEAF_SIZE)
+        for (unsigned int oct = 0; oct < 8; oct++)
+            if (jobs[oct].numNodes) {
+                numChildren++;
+                numNodes += jobs[oct].numNodes;
+            }
+
+    tree->nodes = malloc (numNodes * sizeof (OctreeNode));
+    tree->numNodes = numNodes;
+    if (!tree->nodes)
+        return 0;
+
+    OctreeNode *root = &tree->nodes[0];
+    *root = (OctreeNode) {
+        .size           = cellSize (tree, 0),
+        .begin          = 0,
+        .end            = tree->numBodies,
+        .firstChild     = numChildren ? 1 : 0,
+        .numChildren    = numChildren
+    };
+
+    if (!numChildren) {
+        summariseBodies (root, tree, pass, 0, tree->numBodies);
+        return 1;
+    }
+
+    Vec3FixedPrec positions[8];
+    double gravMasses[8];
+    unsigned int next = 1 + numChildren, child = 0;
+
+    for (unsigned int oct = 0; oct < 8; oct++) {
+        const OctantJob *job = &jobs[oct];
+        if (!job->numNodes)
+            continue;
+
+        // The subtree's root becomes child 'child' of the root, and its
+        // node 'n > 0' goes to 'next + n - 1'.
+        for (unsigned int nodeIx = 0; nodeIx < job->numNodes; nodeIx++) {
+            OctreeNode node = job->nodes[nodeIx];
+            if (node.numChildren)
+                node.firstChild += next - 1;
+
+            tree->nodes[nodeIx ? next + nodeIx - 1 : 1 + child] = node;
+        }
+
+        positions[child] = job->nodes[0].centreOfMass;
+        gravMasses[child] = job->nodes[0].gravMass;
+
+        next += job->numNodes - 1;
+        child++;
+    }
+
+    summariseNode (root, positions, gravMasses, numChildren);
+    return 1;
+}
+
+// Build the octree of a gravity pass's body system, sharing the octants
+// of the root out over 'pool' if it isn't NULL. Returns 0 if out of
+// memory.
+//
+int buildOctree (Octree *tree, const GravityPass *pass, ThreadPool *pool) {
+    const BodySystem *system = pass->system;
+    unsigned int numBodies = system->numBodies;
+
+    memset (tree, 0, sizeof (*tree));
+    tree->numBodies = numBodies;
+    tree->keys = malloc ((numBodies + 1) * sizeof (uint64_t));
+    tree->order = malloc ((numBodies + 1) * sizeof (uint32_t));
+
+    uint64_t *scratchKeys = malloc ((numBodies + 1) * sizeof (uint64_t));
+    uint32_t *scratchOrder = malloc ((numBodies + 1) * sizeof (uint32_t));
+
+    OctantJob jobs[8];
+    memset (jobs, 0, sizeof (jobs));
+
+    int ok = tree->keys && tree->order && scratchKeys && scratchOrder;
+
+    if (ok && numBodies) {
+        computeKeys (tree, system);
+        splitOctants (tree, pass, scratchKeys, scratchOrder, jobs);
+
+        parallelFor
+            ( numBodies >= OCTREE_PARALLEL_THRESHOLD ? pool : NULL
+            , 8, runOctantJob, jobs );
+
+        for (unsigned int oct = 0; oct < 8; oct++)
+            ok &= jobs[oct].ok;
+    }
+
+    ok = ok && stitchOctree (tree, pass, jobs);
+
+    for (unsigned int oct = 0; oct < 8; oct++)
+        free (jobs[oct].nodes);
+
+    free (scratchKeys);
+    free (scratchOrder);
+
+    if (!ok) {
+        freeOctree (*tree);
+        memset (tree, 0, sizeof (*tree));
+    }
+
+    return ok;
+}
+
+void freeOctree (Octree tree) {
+    free (tree.nodes);
+    free (tree.order);
+    free (tree.keys);
+}
+
+
+// Accumulate the pull of a point mass 'gravMass' at separation 'dx',
+// 'dy', 'dz', computed exactly as the direct kernels do.
+//
+static inline void attract
+    ( FixedPrec acc[3], double gravMass
+    , double dx, double dy, double dz, double softening2 )
+{
+    double
+        r2      = dx * dx + dy * dy + dz * dz + softening2,
+        invR3   = 1.0 / (r2 * sqrt (r2)),
+        s       = gravMass * invR3;
+
+    acc[0] = fpAdd (acc[0], fpFromDouble (s * dx));
+    acc[1] = fpAdd (acc[1], fpFromDouble (s * dy));
+    acc[2] = fpAdd (acc[2], fpFromDouble (s * dz));
+}
+
+// Walk the tree for one body, the 'rank'-th in Morton order.
+//
+// A node is opened if it contains the body, or if it's bigger than the
+// opening angle 'theta' times its distance; otherwise its whole mass
+// acts from its centre of mass. Leaves that get opened interact with
+// each of their bodies directly.
+//
+static void walkOctree
+    ( const Octree *tree, const GravityPass *pass
+    , uint32_t rank, double theta2, FixedPrec acc[3] )
+{
+    const BodySystem *system = pass->system;
+    uint32_t body = tree->order[rank];
+    Vec3FixedPrec pos = bodyPosition (system, body);
+
+    uint32_t stack[8 * (OCTREE_MAX_DEPTH + 1)];
+    unsigned int depth = 0;
+    stack[depth++] = 0;
+
+    while (depth) {
+        const OctreeNode *node = &tree->nodes[stack[--depth]];
+        int contains = node->begin <= rank && rank < node->end;
+
+        double
+            dx = fpToDouble (fpSub (node->centreOfMass.x, pos.x)),
+            dy = fpToDouble (fpSub (node->centreOfMass.y, pos.y)),
+            dz = fpToDouble (fpSub (node->centreOfMass.z, pos.z));
+
+        if (!contains &&
+            node->size * node->size < theta2 * (dx * dx + dy * dy + dz * dz))
+        {
+            attract (acc, node->gravMass, dx, dy, dz, pass->softening2);
+        } else if (node->numChildren) {
+            // Pushed backwards, so that children are visited in order.
+            for (unsigned int child = node->numChildren; child-- > 0;)
+                stack[depth++] = node->firstChild + child;
+        } else {
+            for (uint32_t ix = node->begin; ix < node->end; ix++) {
+                uint32_t other = tree->order[ix];
+                if (other == body)
+                    continue;
+
+                attract
+                    ( acc, pass->gravMass[other]
+                    , fpToDouble (fpSub (getColumn (system->posX, other), pos.x))
+                    , fpToDouble (fpSub (getColumn (system->posY, other), pos.y))
+                    , fpToDouble (fpSub (getColumn (system->posZ, other), pos.z))
+                    , pass->softening2 );
+            }
+        }
+    }
+}
+
+typedef struct WalkJob WalkJob;
+
+struct WalkJob {
+    const Octree *tree;
+    const GravityPass *pass;
+    double theta2;
+
+    // Ranks of the bodies to walk for, or NULL for all of them in order
+    const uint32_t *ranks;
+    unsigned int numRanks;
+};
+
+// Walk for a chunk of the bodies. Each body only writes its own
+// accelerations, so chunks can run on any worker in any order.
+//
+static void runWalkChunk (void *context, unsigned int task, unsigned int worker) {
+    const WalkJob *job = context;
+    const GravityPass *pass = job->pass;
+    unsigned int
+        begin   = task * OCTREE_WALK_CHUNK_SIZE,
+        end     = begin + OCTREE_WALK_CHUNK_SIZE < job->numRanks
+            ? begin + OCTREE_WALK_CHUNK_SIZE : job->numRanks;
+
+    (void) worker;
+
+    for (unsigned int ix = begin; ix < end; ix++) {
+        uint32_t rank = job->ranks ? job->ranks[ix] : ix;
+
+        FixedPrec acc[3] = { fpFromInt (0), fpFromInt (0), fpFromInt (0) };
+        walkOctree (job->tree, pass, rank, job->theta2, acc);
+
+        uint32_t body = job->tree->order[rank];
+        setColumn (pass->accX, body, fpAdd (getColumn (pass->accX, body), acc[0]));
+        setColumn (pass->accY, body, fpAdd (getColumn (pass->accY, body), acc[1]));
+        setColumn (pass->accZ, body, fpAdd (getColumn (pass->accZ, body), acc[2]));
+    }
+}
+
+// Add the accelerations from an octree into a gravity pass's columns,
+// with opening angle 'theta', for the 'numActive' bodies listed in
+// 'active', or for every body if that's 'NULL'. The walks are shared out
+// over the body system's thread pool, if it has one.
+//
+// Bodies are walked in Morton order, so that consecutive walks visit
+// mostly the same nodes.
+//
+void octreeAccelerations
+    ( const Octree *tree, const GravityPass *pass, double theta
+    , const uint32_t *active, unsigned int numActive )
+{
+    WalkJob job = {
+        .tree       = tree,
+        .pass       = pass,
+        .theta2     = theta * theta,
+        .ranks      = NULL,
+        .numRanks   = tree->numBodies
+    };
+
+    uint32_t *ranks = NULL;
+
+    if (active) {
+        ranks = malloc ((tree->numBodies + numActive + 1) * sizeof (uint32_t));
+        if (!ranks) {
+            printf ("error: octreeAccelerations: out of memory\n");
+            return;
+        }
+
+        for (uint32_t rank = 0; rank < tree->numBodies; rank++)
+            ranks[tree->order[rank]] = rank;
+
+        // Just the active bodies' ranks, still in the order given.
+        uint32_t *activeRanks = ranks + tree->numBodies;
+        for (unsigned int ix = 0; ix < numActive; ix++)
+            activeRanks[ix] = ranks[active[ix]];
+
+        job.ranks = activeRanks;
+        job.numRanks = numActive;
+    }
+
+    parallelFor
+        ( pass->system->threadPool
+        , (job.numRanks + OCTREE_WALK_CHUNK_SIZE - 1) / OCTREE_WALK_CHUNK_SIZE
+        , runWalkChunk, &job );
+
+    free (ranks);
+}
+
+
+// Compute the gravitational acceleration of every body in a body system
+// with a Barnes-Hut octree, with opening angle 'theta', into 'accX',
+// 'accY' and 'accZ'.
+//
+// An angle of 0 opens every node, which is direct summation the slow way.
+//
+void computeTreeAccelerations (BodySystem *system, double theta) {
+    clearAccelerations (system);
+    computeTreeAccelerationsFor (system, theta, NULL, 0);
+}
+
+// Add the accelerations of just the bodies listed in 'active', or all of
+// them if that's 'NULL'.
+//
+void computeTreeAccelerationsFor
+    ( BodySystem *system, double theta
+    , const uint32_t *active, unsigned int numActive )
+{
+    GravityPass pass;
+    Octree tree;
+
+    if (!newGravityPass (&pass, system, GRAVITY_KERNEL_SCALAR)) {
+        printf ("error: computeTreeAccelerationsFor: out of memory\n");
+        return;
+    }
+
+    if (!buildOctree (&tree, &pass, system->threadPool)) {
+        printf ("error: computeTreeAccelerationsFor: out of memory\n");
+        freeGravityPass (pass);
+        return;
+    }
+
+    octreeAccelerations (&tree, &pass, theta, active, numActive);
+
+    freeOctree (tree);
+    freeGravityPass (pass);
+}
@@ -0,0 +1,85 @@
+
+#ifndef SPACE_GAME_OCTREE_H
+#define SPACE_GAME_OCTREE_H
+
+#include <stdint.h>
+
+#include "FixedPrecision.h"
+#include "BodySystem.h"
+#include "Gravity.h"
+#include "ThreadPool.h"
+
+// Most bodies in a leaf of the octree. Smaller leaves mean more nodes and
+// deeper walks, bigger ones more direct interactions.
+//
+#define OCTREE_LEAF_SIZE 16
+
+// Bits of Morton code per axis, so that all three fit in 63 bits.
+//
+#define OCTREE_KEY_BITS 21
+
+// Below this many bodies, building in parallel isn't worth the threads.
+//
+#define OCTREE_PARALLEL_THRESHOLD 8192
+
+// Bodies per task when the tree walks are shared out over threads.
+//
+#define OCTREE_WALK_CHUNK_SIZE 256
+
+// Node of a Barnes-Hut octree.
+//
+// A node covers a cube of space, and the bodies in it are the range
+// 'begin' to 'end - 1' of 'Octree.order'. Its children, if any, are
+// 'numChildren' consecutive nodes from 'firstChild'; only the non-empty
+// octants get one.
+//
+typedef struct OctreeNode OctreeNode;
+
+struct OctreeNode {
+    Vec3FixedPrec centreOfMass;
+
+    // 'G' times the total mass
+    double gravMass;
+
+    // Width of the cube
+    double size;
+
+    uint32_t begin, end;
+    uint32_t firstChild;
+    uint32_t numChildren;
+};
+
+// Barnes-Hut octree over the bodies of a body system.
+//
+// Bodies are sorted by the Morton code of their position, which puts
+// every node's bodies next to each other, so the tree is just a
+// partition of that order. The root is 'nodes[0]'.
+//
+typedef struct Octree Octree;
+
+struct Octree {
+    OctreeNode *nodes;
+    unsigned int numNodes;
+
+    // Body indices, in Morton order, and their codes
+    uint32_t *order;
+    uint64_t *keys;
+    unsigned int numBodies;
+
+    // Corner of the root cube, and how far the offsets from it are
+    // shifted right to get 'OCTREE_KEY_BITS' bits per axis
+    Vec3FixedPrec origin;
+    unsigned int shift;
+};
+
+int buildOctree (Octree *, const GravityPass *, ThreadPool *);
+void freeOctree (Octree);
+
+void octreeAccelerations
+    (const Octree *, const GravityPass *, double, const uint32_t *, unsigned int);
+
+void computeTreeAccelerations (BodySystem *, double);
+void computeTreeAccelerationsFor
+    (BodySystem *, double, const uint32_t *, unsigned int);
+
+#endif
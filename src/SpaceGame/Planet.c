@@ -0,0 +1,250 @@
+
+// SpaceGame.Planet
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "FixedPrecision.h"
+#include "FixedMath.h"
+#include "Newtonian.h"
+#include "Planet.h"
+
+
+
+#define KEPLER_MAX_ITERATIONS 8
+#define KEPLER_TWO_PI 6.283185307179586
+
+// Steps smaller than 2^-22 leave an error of the order of 2^-66, below
+// the last place of a fixed-precision value.
+//
+static const FixedPrec keplerTolerance = { 0, 1ULL << 42 };
+
+static const FixedPrec fpHalf = { 0, 1ULL << 63 };
+static const FixedPrec fpThird = { 0, 0x5555555555555555 };
+
+// Eccentricity from which Mikkola's start is used, 0.3, and the 0.078 in
+// its correction, to the nearest fixed-precision values.
+//
+static const FixedPrec mikkolaEccentricity = { 0, 0x4CCCCCCCCCCCCCCD };
+static const FixedPrec mikkolaCorrection = { 0, 0x13F7CED916872B02 };
+
+// Cube root of a positive value, to about six places, which is all a
+// starting estimate needs: Newton's method from the power of two within
+// a factor of two of it.
+//
+static FixedPrec roughCubeRoot (FixedPrec a) {
+    int exponent = 63 - (int) clz128u (fpBits (a));
+    int rootExponent = exponent >= 0 ? exponent / 3 : -((2 - exponent) / 3);
+
+    FixedPrec root = fpFromBits (shl128u (newUInt128 (0, 1), 64 + rootExponent));
+
+    for (unsigned int iteration = 0; iteration < 5; iteration++)
+        root = fpMul (fpAdd (fpAdd (root, root), fpDiv (a, fpSqr (root))), fpThird);
+
+    return root;
+}
+
+// Mikkola's cubic approximation to the eccentric anomaly, good to about
+// 1e-3 everywhere, including small 'M' on nearly parabolic orbits, where
+// 'E' moves like a cube root of 'M' and cruder starts take many
+// iterations to get there.
+//
+static FixedPrec mikkolaStart (FixedPrec m, FixedPrec e) {
+    FixedPrec
+        denom   = fpAdd (fpMul (fpFromInt (4), e), fpHalf),
+        alpha   = fpDiv (fpSub (fpFromInt (1), e), denom),
+        beta    = fpDiv (fpMul (fpHalf, m), denom),
+        root    = fpSqrt (fpAdd (fpSqr (beta), fpMul (fpSqr (alpha), alpha))),
+        sum     = fpAdd (fpAbs (beta), root);
+
+    // Only when 'M' is 0 on a nearly parabolic orbit, where 'E' is too.
+    if (fpEqual (sum, fpFromInt (0)))
+        return m;
+
+    FixedPrec z = roughCubeRoot (sum);
+    if (beta.wholePart < 0)
+        z = fpNeg (z);
+
+    FixedPrec
+        s   = fpSub (z, fpDiv (alpha, z)),
+        s2  = fpSqr (s);
+
+    s = fpSub (s, fpDiv
+        ( fpMul (mikkolaCorrection, fpMul (fpSqr (s2), s))
+        , fpAdd (fpFromInt (1), e) ));
+
+    s2 = fpSqr (s);
+    return fpAdd (m, fpMul (fpMul (e, s), fpSub (fpFromInt (3), fpMul (fpFromInt (4), s2))));
+}
+
+// Solve Kepler's equation 'E - e sin E = M' for the eccentric anomaly
+// 'E', given the mean anomaly 'M' and eccentricity 'e < 1'. The result
+// is in '[-pi, pi]', whatever range 'M' is in.
+//
+// Halley's method converges cubically, so from a decent start it takes
+// two or three iterations. Near-circular orbits start from the first
+// order series 'M + e sin M', eccentric ones from Mikkola's.
+//
+FixedPrec solveKepler (FixedPrec meanAnomaly, FixedPrec eccentricity) {
+    FixedPrec m = meanAnomaly, e = eccentricity;
+
+    if (fpLessThan (fpPi, fpAbs (m))) {
+        int64_t turns = fpAdd (fpDiv (m, fpTwoPi), fpHalf).wholePart;
+        m = fpSub (m, fpMul (fpFromInt (turns), fpTwoPi));
+    }
+
+    FixedPrec ecc =
+        fpLessThan (e, mikkolaEccentricity)
+            ? fpAdd (m, fpMul (e, fpSin (m)))
+            : mikkolaStart (m, e);
+
+    for (unsigned int iteration = 0; iteration < KEPLER_MAX_ITERATIONS; iteration++) {
+        FixedPrec sinE, cosE;
+        fpSinCos (ecc, &sinE, &cosE);
+
+        FixedPrec
+            eSin    = fpMul (e, sinE),
+            eCos    = fpMul (e, cosE),
+            f       = fpSub (fpSub (ecc, eSin), m),
+            df      = fpSub (fpFromInt (1), eCos),
+            step    = fpDiv (f, fpSub (df, fpDiv (fpMul (fpHalf, fpMul (f, eSin)), df)));
+
+        ecc = fpSub (ecc, step);
+
+        // The error after a step is of the order of the step cubed.
+        if (fpLessThan (fpAbs (step), keplerTolerance))
+            break;
+    }
+
+    return ecc;
+}
+
+
+// type Planet
+
+// Set up a planet of mass 'mass' orbiting 'parent', or fixed at the
+// origin if that's NULL.
+//
+Planet newPlanet (FixedPrec mass, const Planet *parent, OrbitalElements elements) {
+    if (elements.eccentricity < 0 || elements.eccentricity >= 1) {
+        printf ("error: newPlanet: eccentricity %g isn't elliptic\n", elements.eccentricity);
+        elements.eccentricity = elements.eccentricity < 0 ? 0 : 0.999999;
+    }
+
+    Planet planet = {
+        .mass       = mass,
+        .parent     = parent,
+        .elements   = elements,
+        .period     = fpFromInt (0)
+    };
+
+    if (!parent || elements.semiMajorAxis <= 0)
+        return planet;
+
+    // 'mu' and 'a^3' can be far out of fixed precision's range, so the
+    // period is the one thing worked out in floating point.
+    double
+        a       = elements.semiMajorAxis,
+        mu      = NEWTONIAN_G * (fpToDouble (parent->mass) + fpToDouble (mass));
+
+    planet.period = fpFromDouble (KEPLER_TWO_PI / sqrt (mu / (a * a * a)));
+    if (fpEqual (planet.period, fpFromInt (0)))
+        return planet;
+
+    planet.meanMotion = fpDiv (fpTwoPi, planet.period);
+    planet.semiMajorAxis = fpFromDouble (a);
+    planet.eccentricity = fpFromDouble (elements.eccentricity);
+    planet.semiMinorAxis = fpMul
+        (planet.semiMajorAxis, fpSqrt (fpSub (fpFromInt (1), fpSqr (planet.eccentricity))));
+    planet.meanAnomaly = fpFromDouble (elements.meanAnomaly);
+
+    FixedPrec sinI, cosI, sinO, cosO, sinW, cosW;
+    fpSinCos (fpFromDouble (elements.inclination), &sinI, &cosI);
+    fpSinCos (fpFromDouble (elements.ascendingNode), &sinO, &cosO);
+    fpSinCos (fpFromDouble (elements.argumentOfPeriapsis), &sinW, &cosW);
+
+    planet.towardsPeriapsis = (Vec3FixedPrec) {
+        fpSub (fpMul (cosO, cosW), fpMul (fpMul (sinO, sinW), cosI)),
+        fpAdd (fpMul (sinO, cosW), fpMul (fpMul (cosO, sinW), cosI)),
+        fpMul (sinW, sinI)
+    };
+
+    planet.alongOrbit = (Vec3FixedPrec) {
+        fpSub (fpNeg (fpMul (cosO, sinW)), fpMul (fpMul (sinO, cosW), cosI)),
+        fpAdd (fpNeg (fpMul (sinO, sinW)), fpMul (fpMul (cosO, cosW), cosI)),
+        fpMul (cosW, sinI)
+    };
+
+    return planet;
+}
+
+// Mean anomaly of a planet at 'time'.
+//
+// Only how far through its current period the planet is matters, and
+// that's the fraction of the time since epoch over the period, which is
+// as precise a billion orbits on as it is on the first.
+//
+static FixedPrec meanAnomalyAt (const Planet *planet, FixedPrec time) {
+    FixedPrec periods = fpDiv (fpSub (time, planet->elements.epoch), planet->period);
+    periods.wholePart = 0;
+
+    return fpAdd (planet->meanAnomaly, fpMul (periods, fpTwoPi));
+}
+
+// Point 'x' along one unit vector and 'y' along another.
+//
+static Vec3FixedPrec inPlane (FixedPrec x, FixedPrec y, Vec3FixedPrec p, Vec3FixedPrec q) {
+    return (Vec3FixedPrec) {
+        fpAdd (fpMul (x, p.x), fpMul (y, q.x)),
+        fpAdd (fpMul (x, p.y), fpMul (y, q.y)),
+        fpAdd (fpMul (x, p.z), fpMul (y, q.z))
+    };
+}
+
+// State of a planet at 'time': its parent's, plus its own motion along
+// its orbit.
+//
+Newtonian planetAt (const Planet *planet, FixedPrec time) {
+    Newtonian newt = { .mass = planet->mass };
+
+    if (!planet->parent)
+        return newt;
+
+    Newtonian parent = planetAt (planet->parent, time);
+    newt.position = parent.position;
+    newt.velocity = parent.velocity;
+
+    if (fpEqual (planet->period, fpFromInt (0)))
+        return newt;
+
+    FixedPrec
+        a       = planet->semiMajorAxis,
+        b       = planet->semiMinorAxis,
+        e       = planet->eccentricity,
+        ecc     = solveKepler (meanAnomalyAt (planet, time), e),
+        sinE, cosE;
+
+    fpSinCos (ecc, &sinE, &cosE);
+
+    FixedPrec eccDot = fpDiv (planet->meanMotion, fpSub (fpFromInt (1), fpMul (e, cosE)));
+
+    // In the orbit's own frame, periapsis along the first axis
+    Vec3FixedPrec
+        position = inPlane
+            ( fpMul (a, fpSub (cosE, e)), fpMul (b, sinE)
+            , planet->towardsPeriapsis, planet->alongOrbit ),
+        velocity = inPlane
+            ( fpNeg (fpMul (fpMul (a, sinE), eccDot)), fpMul (fpMul (b, cosE), eccDot)
+            , planet->towardsPeriapsis, planet->alongOrbit );
+
+    newt.position.x = fpAdd (newt.position.x, position.x);
+    newt.position.y = fpAdd (newt.position.y, position.y);
+    newt.position.z = fpAdd (newt.position.z, position.z);
+
+    newt.velocity.x = fpAdd (newt.velocity.x, velocity.x);
+    newt.velocity.y = fpAdd (newt.velocity.y, velocity.y);
+    newt.velocity.z = fpAdd (newt.velocity.z, velocity.z);
+
+    return newt;
+}
@@ -3,9 +3,65 @@
 #define SPACE_GAME_PLANET_H
 
 #include "FixedPrecision.h"
+#include "Newtonian.h"
 
+// Keplerian elements of an elliptic orbit around a parent body. Angles
+// are in radians.
+//
+typedef struct OrbitalElements OrbitalElements;
 
+struct OrbitalElements {
+    // Size and shape, with '0 <= eccentricity < 1'
+    double semiMajorAxis;
+    double eccentricity;
 
+    // Orientation of the orbit
+    double inclination;
+    double ascendingNode;
+    double argumentOfPeriapsis;
 
+    // Where along it the body is at 'epoch'
+    double meanAnomaly;
+    FixedPrec epoch;
+};
 
+// Body on rails: a planet or moon whose motion is a fixed Kepler orbit
+// around its parent, so that its state at any time is a closed-form
+// O(1) evaluation with no integration error to build up.
+//
+// Everything 'planetAt' does is in fixed precision, with the sines and
+// cosines from 'FixedMath.h', so a planet's state is the same on every
+// platform, and rails can pull on bodies in the deterministic step. Only
+// 'newPlanet' uses floating point: the elements come as doubles, and the
+// period is worked out from them with a single square root, which IEEE
+// arithmetic rounds the same way everywhere.
+//
+// A planet without a parent is fixed at the origin, with its orbital
+// elements ignored; that's the star at the root of a system.
+//
+typedef struct Planet Planet;
 
+struct Planet {
+    FixedPrec mass;
+    const Planet *parent;
+    OrbitalElements elements;
+
+    // Derived from the elements by 'newPlanet': the period and mean
+    // motion, the shape of the ellipse, the mean anomaly at epoch, and
+    // the unit vectors towards periapsis and 90 degrees on from it, in
+    // the parent's frame
+    FixedPrec period;
+    FixedPrec meanMotion;
+    FixedPrec semiMajorAxis, semiMinorAxis, eccentricity;
+    FixedPrec meanAnomaly;
+    Vec3FixedPrec towardsPeriapsis;
+    Vec3FixedPrec alongOrbit;
+};
+
+Planet newPlanet (FixedPrec, const Planet *, OrbitalElements);
+
+FixedPrec solveKepler (FixedPrec, FixedPrec);
+
+Newtonian planetAt (const Planet *, FixedPrec);
+
+#endif
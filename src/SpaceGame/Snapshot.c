@@ -0,0 +1,375 @@
+
+// SpaceGame.Snapshot
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "FixedPrecision.h"
+#include "BodySystem.h"
+#include "Snapshot.h"
+
+
+
+// type Snapshot
+
+// Sections of a snapshot after the header: the limb arrays in
+// 'listLimbArrays' order, then 'handleToIndex', 'indexToHandle' and
+// 'freeHandles'.
+//
+#define NUM_SECTIONS (BODY_SYSTEM_LIMB_ARRAYS + 3)
+
+typedef struct Section Section;
+
+struct Section {
+    const void *data;
+    size_t used;
+    // ^ bytes of 'data' in use; the rest of the section is zeroes.
+    size_t size;
+};
+
+// Capacity a body system is saved with: enough for its bodies and its
+// handles, rounded up so every section is whole pages.
+//
+static uint32_t snapshotCapacity (const BodySystem *system) {
+    size_t
+        step    = SNAPSHOT_CAPACITY_STEP,
+        needed  = system->numBodies > system->numHandles ? system->numBodies : system->numHandles;
+
+    return (uint32_t) ((needed + step) / step * step);
+}
+
+static void listSections (const BodySystem *system, uint32_t capacity, Section sections[]) {
+    BodySystem copy = *system;
+    uint64_t **arrays[BODY_SYSTEM_LIMB_ARRAYS];
+    listLimbArrays (&copy, arrays);
+
+    for (unsigned int arrIx = 0; arrIx < BODY_SYSTEM_LIMB_ARRAYS; arrIx++)
+        sections[arrIx] = (Section) {
+            .data   = *arrays[arrIx],
+            .used   = system->numBodies * sizeof (uint64_t),
+            .size   = capacity * sizeof (uint64_t)
+        };
+
+    const uint32_t *handles[3] = { system->handleToIndex, system->indexToHandle, system->freeHandles };
+    unsigned int counts[3] = { system->numHandles, system->numBodies, system->numFreeHandles };
+
+    for (unsigned int handleIx = 0; handleIx < 3; handleIx++)
+        sections[BODY_SYSTEM_LIMB_ARRAYS + handleIx] = (Section) {
+            .data   = handles[handleIx],
+            .used   = counts[handleIx] * sizeof (uint32_t),
+            .size   = capacity * sizeof (uint32_t)
+        };
+}
+
+static SnapshotHeader newSnapshotHeader (const BodySystem *system, uint32_t capacity) {
+    size_t sectionBytes = (size_t) capacity *
+        (BODY_SYSTEM_LIMB_ARRAYS * sizeof (uint64_t) + 3 * sizeof (uint32_t));
+
+    return (SnapshotHeader) {
+        .magic          = SNAPSHOT_MAGIC,
+        .version        = SNAPSHOT_VERSION,
+        .byteOrder      = SNAPSHOT_BYTE_ORDER,
+        .fileSize       = SNAPSHOT_PAGE_SIZE + sectionBytes,
+        .stateHash      = hashBodySystem (system),
+        .numBodies      = system->numBodies,
+        .capacity       = capacity,
+        .numHandles     = system->numHandles,
+        .numFreeHandles = system->numFreeHandles,
+        .softeningWhole = system->softening.wholePart,
+        .softeningDec   = system->softening.decPart,
+        .gravitySolver  = system->gravitySolver,
+        .openingAngle   = system->openingAngle
+    };
+}
+
+// Fill in page 'pageIx' of a snapshot, counting the header as page 0.
+//
+static void fillPage
+    ( const SnapshotHeader *header, const Section sections[]
+    , uint64_t pageIx, unsigned char page[] )
+{
+    memset (page, 0, SNAPSHOT_PAGE_SIZE);
+
+    if (pageIx == 0) {
+        memcpy (page, header, sizeof (*header));
+        return;
+    }
+
+    size_t offset = (pageIx - 1) * SNAPSHOT_PAGE_SIZE;
+    unsigned int secIx = 0;
+
+    for (; offset >= sections[secIx].size; secIx++)
+        offset -= sections[secIx].size;
+
+    if (offset < sections[secIx].used) {
+        size_t rest = sections[secIx].used - offset;
+        memcpy
+            ( page, (const unsigned char *) sections[secIx].data + offset
+            , rest < SNAPSHOT_PAGE_SIZE ? rest : SNAPSHOT_PAGE_SIZE );
+    }
+}
+
+// Is a header one this build can read, and does it describe a file of
+// 'fileSize' bytes?
+//
+static int validSnapshotHeader (const SnapshotHeader *header, uint64_t fileSize, const char path[]) {
+    if (header->magic != SNAPSHOT_MAGIC) {
+        printf ("error: snapshot: %s is not a snapshot\n", path);
+        return 0;
+    }
+    if (header->byteOrder != SNAPSHOT_BYTE_ORDER) {
+        printf ("error: snapshot: %s was written with the other byte order\n", path);
+        return 0;
+    }
+    if (header->version != SNAPSHOT_VERSION) {
+        printf
+            ( "error: snapshot: %s is version %u, expected %u\n"
+            , path, header->version, SNAPSHOT_VERSION );
+        return 0;
+    }
+
+    uint64_t expected = SNAPSHOT_PAGE_SIZE + (uint64_t) header->capacity *
+        (BODY_SYSTEM_LIMB_ARRAYS * sizeof (uint64_t) + 3 * sizeof (uint32_t));
+
+    if (header->capacity == 0 || header->capacity % SNAPSHOT_CAPACITY_STEP != 0 ||
+        header->numBodies > header->capacity || header->numHandles > header->capacity ||
+        header->numFreeHandles > header->numHandles ||
+        header->fileSize != expected || fileSize != expected)
+    {
+        printf ("error: snapshot: %s is truncated or corrupt\n", path);
+        return 0;
+    }
+
+    return 1;
+}
+
+// Write every page of a snapshot to a file descriptor.
+//
+static int writeAllPages (int fd, const SnapshotHeader *header, const Section sections[]) {
+    unsigned char page[SNAPSHOT_PAGE_SIZE];
+    uint64_t numPages = header->fileSize / SNAPSHOT_PAGE_SIZE;
+
+    for (uint64_t pageIx = 0; pageIx < numPages; pageIx++) {
+        fillPage (header, sections, pageIx, page);
+
+        if (write (fd, page, SNAPSHOT_PAGE_SIZE) != SNAPSHOT_PAGE_SIZE)
+            return 0;
+    }
+
+    return 1;
+}
+
+// Save a body system to a snapshot file, replacing it if it exists.
+//
+// The snapshot is written to a temporary file alongside and renamed into
+// place, so a crash part way through leaves the old one intact. Returns 1
+// on success.
+//
+int saveSnapshot (const BodySystem *system, const char path[]) {
+    uint32_t capacity = snapshotCapacity (system);
+    SnapshotHeader header = newSnapshotHeader (system, capacity);
+
+    Section sections[NUM_SECTIONS];
+    listSections (system, capacity, sections);
+
+    size_t length = strlen (path);
+    char *temp = malloc (length + 5);
+    if (!temp) {
+        printf ("error: saveSnapshot: out of memory\n");
+        return 0;
+    }
+
+    memcpy (temp, path, length);
+    memcpy (temp + length, ".tmp", 5);
+
+    int fd = open (temp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    int ok = fd >= 0 && writeAllPages (fd, &header, sections) && fsync (fd) == 0;
+
+    if (fd >= 0)
+        ok &= close (fd) == 0;
+
+    ok = ok && rename (temp, path) == 0;
+
+    if (!ok) {
+        printf ("error: saveSnapshot: can't write %s\n", path);
+        unlink (temp);
+    }
+
+    free (temp);
+    return ok;
+}
+
+// Bring an existing snapshot file up to date with a body system, writing
+// only the pages that have changed, and the header last. The number of
+// pages written goes in 'pagesWritten', if it isn't NULL.
+//
+// That's only possible while the body system still has the capacity the
+// snapshot was saved with; otherwise, or if there's no snapshot yet,
+// this saves a whole new one.
+//
+// The data pages are flushed before the header is written, so a crash
+// part way through leaves new pages under the old header and its old
+// hash. 'SNAPSHOT_VERIFY' rejects that, unless the 64-bit hash happens to
+// collide; a trusting load doesn't look.
+//
+// Returns 1 on success.
+//
+int updateSnapshot (const BodySystem *system, const char path[], unsigned int *pagesWritten) {
+    uint32_t capacity = snapshotCapacity (system);
+    SnapshotHeader header = newSnapshotHeader (system, capacity), old;
+
+    int fd = open (path, O_RDWR);
+    int matches = fd >= 0 &&
+        pread (fd, &old, sizeof (old), 0) == sizeof (old) &&
+        old.magic == SNAPSHOT_MAGIC && old.version == SNAPSHOT_VERSION &&
+        old.byteOrder == SNAPSHOT_BYTE_ORDER && old.capacity == capacity &&
+        old.fileSize == header.fileSize;
+
+    if (!matches) {
+        if (fd >= 0)
+            close (fd);
+        if (pagesWritten)
+            *pagesWritten = (unsigned int) (header.fileSize / SNAPSHOT_PAGE_SIZE);
+
+        return saveSnapshot (system, path);
+    }
+
+    Section sections[NUM_SECTIONS];
+    listSections (system, capacity, sections);
+
+    unsigned char page[SNAPSHOT_PAGE_SIZE], onDisk[SNAPSHOT_PAGE_SIZE];
+    uint64_t numPages = header.fileSize / SNAPSHOT_PAGE_SIZE;
+    unsigned int written = 0;
+    int ok = 1;
+
+    // Data pages first, then the header, so the hash is never newer than
+    // the data it describes.
+    for (uint64_t pageIx = 1; ok && pageIx <= numPages; pageIx++) {
+        uint64_t target = pageIx % numPages;
+        off_t offset = (off_t) (target * SNAPSHOT_PAGE_SIZE);
+
+        fillPage (&header, sections, target, page);
+
+        if (pread (fd, onDisk, SNAPSHOT_PAGE_SIZE, offset) == SNAPSHOT_PAGE_SIZE &&
+            memcmp (page, onDisk, SNAPSHOT_PAGE_SIZE) == 0)
+            continue;
+
+        if (target == 0)
+            ok = fsync (fd) == 0;
+
+        ok = ok && pwrite (fd, page, SNAPSHOT_PAGE_SIZE, offset) == SNAPSHOT_PAGE_SIZE;
+        written++;
+    }
+
+    ok &= fsync (fd) == 0;
+    ok &= close (fd) == 0;
+
+    if (!ok)
+        printf ("error: updateSnapshot: can't write %s\n", path);
+    if (pagesWritten)
+        *pagesWritten = written;
+
+    return ok;
+}
+
+// Read just the header of a snapshot, say to compare the hashes of two
+// runs. Returns 1 if it's a valid snapshot.
+//
+int readSnapshotHeader (const char path[], SnapshotHeader *header) {
+    int fd = open (path, O_RDONLY);
+    struct stat info;
+
+    if (fd < 0 || fstat (fd, &info) != 0 ||
+        pread (fd, header, sizeof (*header), 0) != sizeof (*header))
+    {
+        printf ("error: readSnapshotHeader: can't read %s\n", path);
+        if (fd >= 0)
+            close (fd);
+        return 0;
+    }
+
+    close (fd);
+    return validSnapshotHeader (header, (uint64_t) info.st_size, path);
+}
+
+// Load a body system from a snapshot file.
+//
+// The file is mapped, not read: every array of the body system points
+// into the mapping, which 'freeBodySystem' unmaps. Pages are only read in
+// as they're touched, and copied the first time they're written to.
+// Adding bodies past the snapshot's capacity moves them all into memory
+// of their own, as usual.
+//
+// With 'SNAPSHOT_VERIFY', every body and handle is hashed and checked
+// against the hash saved with it, which does touch every page. Without
+// it, the handles are trusted as much as the bodies are. The loaded
+// system has no thread pool. Returns 1 on success.
+//
+int loadSnapshot (BodySystem *system, const char path[], SnapshotCheck check) {
+    int fd = open (path, O_RDONLY);
+    struct stat info;
+
+    if (fd < 0 || fstat (fd, &info) != 0 || (size_t) info.st_size < SNAPSHOT_PAGE_SIZE) {
+        printf ("error: loadSnapshot: can't read %s\n", path);
+        if (fd >= 0)
+            close (fd);
+        return 0;
+    }
+
+    size_t size = (size_t) info.st_size;
+    unsigned char *mapping = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close (fd);
+
+    if (mapping == MAP_FAILED) {
+        printf ("error: loadSnapshot: can't map %s\n", path);
+        return 0;
+    }
+
+    const SnapshotHeader *header = (const SnapshotHeader *) mapping;
+    if (!validSnapshotHeader (header, size, path)) {
+        munmap (mapping, size);
+        return 0;
+    }
+
+    BodySystem loaded;
+    memset (&loaded, 0, sizeof (loaded));
+
+    loaded.numBodies        = header->numBodies;
+    loaded.capacity         = header->capacity;
+    loaded.numHandles       = header->numHandles;
+    loaded.numFreeHandles   = header->numFreeHandles;
+    loaded.softening        = newFixedPrec (header->softeningWhole, header->softeningDec);
+    loaded.gravitySolver    = (GravitySolver) header->gravitySolver;
+    loaded.openingAngle     = header->openingAngle;
+    loaded.mapping          = mapping;
+    loaded.mappingSize      = size;
+
+    uint64_t **arrays[BODY_SYSTEM_LIMB_ARRAYS];
+    listLimbArrays (&loaded, arrays);
+
+    unsigned char *next = mapping + SNAPSHOT_PAGE_SIZE;
+    for (unsigned int arrIx = 0; arrIx < BODY_SYSTEM_LIMB_ARRAYS; arrIx++) {
+        *arrays[arrIx] = (uint64_t *) next;
+        next += header->capacity * sizeof (uint64_t);
+    }
+
+    uint32_t **handles[3] = { &loaded.handleToIndex, &loaded.indexToHandle, &loaded.freeHandles };
+    for (unsigned int handleIx = 0; handleIx < 3; handleIx++) {
+        *handles[handleIx] = (uint32_t *) next;
+        next += header->capacity * sizeof (uint32_t);
+    }
+
+    if (check == SNAPSHOT_VERIFY && hashBodySystem (&loaded) != header->stateHash) {
+        printf ("error: loadSnapshot: %s doesn't match its hash\n", path);
+        munmap (mapping, size);
+        return 0;
+    }
+
+    *system = loaded;
+    return 1;
+}
@@ -0,0 +1,74 @@
+
+#ifndef SPACE_GAME_SNAPSHOT_H
+#define SPACE_GAME_SNAPSHOT_H
+
+#include <stdint.h>
+
+#include "BodySystem.h"
+
+// On-disk snapshots of body systems.
+//
+// A snapshot file is laid out exactly like a body system in memory: a
+// header page, then every limb array and handle array, each starting on
+// a page boundary and holding 'capacity' elements. Loading one is a
+// single 'mmap' and a header check, with the body system's arrays then
+// pointing straight into the mapping. The mapping is private, so
+// simulating on from a loaded snapshot never writes back to the file.
+//
+// Snapshots use the machine's own byte order, and loading one written
+// with the other is refused.
+//
+#define SNAPSHOT_MAGIC 0x485350414E534753ULL
+#define SNAPSHOT_VERSION 3
+#define SNAPSHOT_BYTE_ORDER 0x01020304
+
+// Everything in a snapshot is aligned to a page. Capacities are rounded
+// up to a multiple of 'SNAPSHOT_PAGE_SIZE / sizeof (uint32_t)' bodies, so
+// that handle arrays fill whole pages too.
+//
+#define SNAPSHOT_PAGE_SIZE 4096
+#define SNAPSHOT_CAPACITY_STEP (SNAPSHOT_PAGE_SIZE / sizeof (uint32_t))
+
+typedef struct SnapshotHeader SnapshotHeader;
+
+struct SnapshotHeader {
+    uint64_t magic;
+    // ^ "SGSNAPSH", read as a little-endian 64-bit integer.
+    uint32_t version;
+    uint32_t byteOrder;
+    // ^ 'SNAPSHOT_BYTE_ORDER', as the writer stored it.
+
+    uint64_t fileSize;
+
+    // 'hashBodySystem' of the state saved, for checking a load, and for
+    // comparing runs without loading anything.
+    uint64_t stateHash;
+
+    uint32_t numBodies;
+    uint32_t capacity;
+    uint32_t numHandles;
+    uint32_t numFreeHandles;
+
+    int64_t softeningWhole;
+    uint64_t softeningDec;
+    uint32_t gravitySolver;
+    uint32_t reserved;
+    double openingAngle;
+};
+
+// Whether 'loadSnapshot' rehashes every body to check the header's hash.
+//
+typedef enum SnapshotCheck SnapshotCheck;
+
+enum SnapshotCheck {
+    SNAPSHOT_TRUST,
+    SNAPSHOT_VERIFY
+};
+
+int saveSnapshot (const BodySystem *, const char[]);
+int updateSnapshot (const BodySystem *, const char[], unsigned int *);
+int loadSnapshot (BodySystem *, const char[], SnapshotCheck);
+
+int readSnapshotHeader (const char[], SnapshotHeader *);
+
+#endif
@@ -0,0 +1,91 @@
+
+#include <stdio.h>
+#include <string.h>
+
+#include "Bench.h"
+#include "FixedPrecision.h"
+#include "Newtonian.h"
+#include "BodySystem.h"
+
+
+
+// A body whose every field is derived from 'n', so we can tell them apart.
+//
+static Newtonian testBody (int64_t n) {
+    return (Newtonian) {
+        .mass       = fpFromInt (n),
+        .position   = { fpFromInt (n + 1), fpFromInt (n + 2), fpFromInt (n + 3) },
+        .velocity   = { fpFromInt (n + 4), fpFromInt (n + 5), fpFromInt (n + 6) }
+    };
+}
+
+static int sameBody (Newtonian a, Newtonian b) {
+    return
+        fpEqual (a.mass, b.mass) &&
+        fpEqual (a.position.x, b.position.x) &&
+        fpEqual (a.position.y, b.position.y) &&
+        fpEqual (a.position.z, b.position.z) &&
+        fpEqual (a.velocity.x, b.velocity.x) &&
+        fpEqual (a.velocity.y, b.velocity.y) &&
+        fpEqual (a.velocity.z, b.velocity.z);
+}
+
+int main (void) {
+    BodySystem system = newBodySystem (2);
+    BodyHandle handles[100];
+
+    // Adding past the initial capacity grows every array.
+    for (unsigned int ix = 0; ix < 100; ix++)
+        handles[ix] = addBody (&system, testBody (ix * 10));
+
+    CHECK (system.numBodies == 100);
+    CHECK (system.capacity >= 100);
+    CHECK ((uintptr_t) system.posX.decPart % BODY_SYSTEM_ALIGNMENT == 0);
+    CHECK ((uintptr_t) system.velZ.wholePart % BODY_SYSTEM_ALIGNMENT == 0);
+
+    // Remove every third body; the others keep their handles.
+    for (unsigned int ix = 0; ix < 100; ix += 3)
+        removeBody (&system, handles[ix]);
+
+    CHECK (system.numBodies == 66);
+
+    for (unsigned int ix = 0; ix < 100; ix++) {
+        unsigned int bodyIx = bodyIndex (&system, handles[ix]);
+
+        if (ix % 3 == 0)
+            CHECK (bodyIx == INVALID_BODY_HANDLE);
+        else
+            CHECK (bodyIx < system.numBodies &&
+                sameBody (gatherBody (&system, bodyIx), testBody (ix * 10)));
+    }
+
+    // Slots get reused, and scattering overwrites a body in place.
+    BodyHandle reused = addBody (&system, testBody (-7));
+    CHECK (bodyHandleSlot (reused) == bodyHandleSlot (handles[99]) && reused != handles[99]);
+
+    // The old handle to the slot finds nothing, and removes nothing.
+    CHECK (bodyIndex (&system, handles[99]) == INVALID_BODY_HANDLE);
+    removeBody (&system, handles[99]);
+    CHECK (system.numBodies == 67 && bodyIndex (&system, reused) != INVALID_BODY_HANDLE);
+
+    unsigned int reusedIx = bodyIndex (&system, reused);
+    CHECK (sameBody (gatherBody (&system, reusedIx), testBody (-7)));
+
+    scatterBody (&system, reusedIx, testBody (1000));
+    CHECK (sameBody (gatherBody (&system, reusedIx), testBody (1000)));
+
+    freeBodySystem (system);
+
+    // A body system with nothing allocated, as 'newBodySystem' leaves it
+    // when it runs out of memory, still grows when a body is added.
+    BodySystem empty;
+    memset (&empty, 0, sizeof (empty));
+
+    BodyHandle first = addBody (&empty, testBody (3));
+    CHECK (first != INVALID_BODY_HANDLE && empty.capacity >= 1);
+    CHECK (sameBody (gatherBody (&empty, bodyIndex (&empty, first)), testBody (3)));
+
+    freeBodySystem (empty);
+
+    return checkReport ();
+}
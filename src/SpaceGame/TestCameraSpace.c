@@ -0,0 +1,199 @@
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Bench.h"
+#include "FixedPrecision.h"
+#include "Newtonian.h"
+#include "BodySystem.h"
+#include "CameraSpace.h"
+#include "ThreadPool.h"
+
+#if defined (__x86_64__) && (defined (__GNUC__) || defined (__clang__))
+#include <immintrin.h>
+#endif
+
+
+
+// Bodies scattered over a solar system, a few billion units across, with
+// a cluster of them close to 'centre'.
+//
+static BodySystem solarScaleSystem (unsigned int numBodies, Vec3FixedPrec centre) {
+    BodySystem system = newBodySystem (numBodies);
+    uint64_t seed = 21;
+
+    for (unsigned int ix = 0; ix < numBodies; ix++) {
+        Newtonian newt = { .mass = fpFromInt (1) };
+
+        if (ix % 2) {
+            newt.position.x = newFixedPrec ((int64_t) (nextRandom (&seed) % 4000000000) - 2000000000, nextRandom (&seed));
+            newt.position.y = newFixedPrec ((int64_t) (nextRandom (&seed) % 4000000000) - 2000000000, nextRandom (&seed));
+            newt.position.z = newFixedPrec ((int64_t) (nextRandom (&seed) % 4000000) - 2000000, nextRandom (&seed));
+        } else {
+            newt.position.x = fpAdd (centre.x, newFixedPrec ((int64_t) (nextRandom (&seed) % 200) - 100, nextRandom (&seed)));
+            newt.position.y = fpAdd (centre.y, newFixedPrec ((int64_t) (nextRandom (&seed) % 200) - 100, nextRandom (&seed)));
+            newt.position.z = fpAdd (centre.z, newFixedPrec ((int64_t) (nextRandom (&seed) % 200) - 100, nextRandom (&seed)));
+        }
+
+        addBody (&system, newt);
+    }
+
+    return system;
+}
+
+// Number of floats, from a sample of every bit pattern, that F16C
+// converts to a different half than 'floatToHalf' does. NaNs are left out.
+//
+#if defined (__x86_64__) && (defined (__GNUC__) || defined (__clang__))
+__attribute__ ((target ("f16c")))
+static unsigned int hardwareMismatches (void) {
+    unsigned int mismatches = 0;
+
+    for (uint64_t bits = 0; bits < 0x100000000; bits += 0x101) {
+        union { uint32_t u; float f; } pun = { (uint32_t) bits };
+        if (!isnan (pun.f) && floatToHalf (pun.f) != _cvtss_sh (pun.f, _MM_FROUND_TO_NEAREST_INT))
+            mismatches++;
+    }
+
+    return mismatches;
+}
+#else
+static unsigned int hardwareMismatches (void) {
+    return 0;
+}
+#endif
+
+// Rounding to half floats matches the hardware's, ties to even, across
+// normal, subnormal and overflowing values.
+//
+static void checkHalves (void) {
+    CHECK (floatToHalf (0.0f) == 0x0000);
+    CHECK (floatToHalf (-0.0f) == 0x8000);
+    CHECK (floatToHalf (1.0f) == 0x3C00);
+    CHECK (floatToHalf (-2.0f) == 0xC000);
+    CHECK (floatToHalf (65504.0f) == 0x7BFF);
+    CHECK (floatToHalf (65519.0f) == 0x7BFF);
+    CHECK (floatToHalf (65520.0f) == 0x7C00);
+    CHECK (floatToHalf (1e10f) == 0x7C00);
+    CHECK (floatToHalf (INFINITY) == 0x7C00);
+    CHECK (floatToHalf (0x1p-14f) == 0x0400);
+    CHECK (floatToHalf (0x1p-24f) == 0x0001);
+    CHECK (floatToHalf (0x1p-25f) == 0x0000);
+    CHECK (floatToHalf (0x3p-25f) == 0x0002);
+    CHECK (floatToHalf (1.0f + 0x1p-11f) == 0x3C00);
+    CHECK (floatToHalf (1.0f + 0x3p-11f) == 0x3C02);
+
+    // Every float whose half isn't a NaN converts the same way the
+    // vector kernels' instructions do.
+    if (bestCameraKernel (CAMERA_KERNEL_AVX2) == CAMERA_KERNEL_AVX2)
+        CHECK (hardwareMismatches () == 0);
+}
+
+// Every kernel writes the same bytes as the scalar one, and leaves the
+// rest of each instance alone.
+//
+static void checkKernels (ThreadPool *pool) {
+    Vec3FixedPrec camera = {
+        newFixedPrec (1495978707, 0x123456789ABCDEF0),
+        newFixedPrec (-3, 0),
+        newFixedPrec (-7, 0x8000000000000000)
+    };
+
+    // An odd count, so the vector kernels have scalar tails.
+    unsigned int numBodies = 3 * CAMERA_CHUNK_SIZE + 1003;
+    BodySystem system = solarScaleSystem (numBodies, camera);
+    system.threadPool = pool;
+
+    for (VertexFormat format = VERTEX_FORMAT_FLOAT; format <= VERTEX_FORMAT_HALF; format++) {
+        size_t
+            stride  = format == VERTEX_FORMAT_FLOAT ? 20 : 10,
+            size    = numBodies * stride;
+
+        unsigned char
+            *expected   = malloc (size),
+            *actual     = malloc (size);
+
+        memset (expected, 0xAB, size);
+        CameraTarget target = { expected, stride, format, 1e-3 };
+        writeCameraPositionsWith (&system, camera, target, CAMERA_KERNEL_SCALAR);
+
+        // Padding is untouched.
+        size_t position = format == VERTEX_FORMAT_FLOAT ? 12 : 6;
+        for (size_t byte = position; byte < stride; byte++)
+            CHECK (expected[(numBodies - 1) * stride + byte] == 0xAB);
+
+        for (CameraKernel kernel = CAMERA_KERNEL_AVX2; kernel <= CAMERA_KERNEL_AVX512; kernel++) {
+            if (bestCameraKernel (kernel) != kernel)
+                continue;
+
+            memset (actual, 0xAB, size);
+            target.buffer = actual;
+            writeCameraPositionsWith (&system, camera, target, kernel);
+
+            CHECK (memcmp (expected, actual, size) == 0);
+        }
+
+        free (expected);
+        free (actual);
+    }
+
+    freeBodySystem (system);
+}
+
+// Bodies near a camera far from the origin come out as precisely as a
+// float can hold their offset from it, where converting their absolute
+// positions loses everything under a few hundred units.
+//
+static void checkPrecision (void) {
+    Vec3FixedPrec camera = {
+        newFixedPrec (4495000000, 0x5555555555555555),
+        newFixedPrec (-1000000000, 0),
+        newFixedPrec (12345, 0xFFFFFFFFFFFFFFFF)
+    };
+
+    BodySystem system = solarScaleSystem (1000, camera);
+
+    float *positions = malloc (system.numBodies * 3 * sizeof (float));
+    CameraTarget target = { positions, 3 * sizeof (float), VERTEX_FORMAT_FLOAT, 1 };
+    writeCameraPositions (&system, camera, target);
+
+    double worst = 0, absolute = 0;
+
+    for (unsigned int ix = 0; ix < system.numBodies; ix += 2) {
+        FixedPrec offset = fpSub (getColumn (system.posX, ix), camera.x);
+
+        double
+            exact   = fpToDouble (offset),
+            error   = fabs (positions[3 * ix] - exact) / fmax (fabs (exact), 1e-30),
+            naive   = fabs ((double) (fpToFloat (getColumn (system.posX, ix)) - fpToFloat (camera.x)) - exact);
+
+        if (error > worst)
+            worst = error;
+        if (naive > absolute)
+            absolute = naive;
+    }
+
+    CHECK (worst <= 0x1p-24);
+    CHECK (absolute > 1);
+
+    // 'fpToFloat' rounds once, from the double.
+    CHECK (fpToFloat (newFixedPrec (16777217, 0x8000000000000000)) == 16777218.0f);
+    CHECK (fpToFloat (newFixedPrec (-1, 0xFFFFFFFFFFFFFFFF)) == -0x1p-64f);
+
+    free (positions);
+    freeBodySystem (system);
+}
+
+int main (void) {
+    checkHalves ();
+    checkKernels (NULL);
+    checkPrecision ();
+
+    ThreadPool *pool = newThreadPool (4);
+    checkKernels (pool);
+    freeThreadPool (pool);
+
+    return checkReport ();
+}
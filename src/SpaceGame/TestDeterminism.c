@@ -0,0 +1,178 @@
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Bench.h"
+#include "FixedPrecision.h"
+#include "Newtonian.h"
+#include "BodySystem.h"
+#include "Gravity.h"
+#include "Integrator.h"
+#include "ThreadPool.h"
+
+
+
+// Every task of a loop runs exactly once, however unevenly long they are.
+//
+typedef struct CountJob CountJob;
+
+struct CountJob {
+    unsigned int *counts;
+    unsigned int numWorkers;
+    int badWorker;
+};
+
+static void countTask (void *context, unsigned int task, unsigned int worker) {
+    CountJob *job = context;
+
+    // Tasks near the start take far longer, so they get stolen.
+    volatile uint64_t spin = 0;
+    for (unsigned int ix = 0; ix < (task < 64 ? 20000 : 10); ix++)
+        spin += ix;
+
+    __atomic_add_fetch (&job->counts[task], 1, __ATOMIC_RELAXED);
+
+    if (worker >= job->numWorkers)
+        job->badWorker = 1;
+}
+
+static void checkPool (ThreadPool *pool, unsigned int numTasks) {
+    unsigned int counts[1000] = { 0 };
+    CountJob job = { .counts = counts, .numWorkers = threadPoolWorkers (pool) };
+
+    parallelFor (pool, numTasks, countTask, &job);
+
+    unsigned int wrong = 0;
+    for (unsigned int ix = 0; ix < numTasks; ix++)
+        wrong += counts[ix] != 1;
+
+    CHECK (wrong == 0);
+    CHECK (!job.badWorker);
+}
+
+// A star with a few planets and a thick disc of debris.
+//
+static BodySystem scenario (unsigned int numBodies) {
+    BodySystem system = newBodySystem (numBodies);
+    uint64_t seed = 2024;
+
+    Newtonian star = { .mass = fpFromInt (1000) };
+    addBody (&system, star);
+
+    for (unsigned int ix = 1; ix < numBodies; ix++) {
+        double
+            radius  = (ix < 5 ? 50 * ix : 300 + 700 * ((nextRandom (&seed) >> 11) * 0x1p-53)),
+            angle   = 6.283185307179586 * ((nextRandom (&seed) >> 11) * 0x1p-53),
+            height  = ix < 5 ? 0 : 20 * ((nextRandom (&seed) >> 11) * 0x1p-53 - 0.5),
+            speed   = sqrt (1000 / radius);
+
+        Newtonian newt = {
+            .mass = ix < 5 ? fpFromInt (1) : fpFromDouble (1e-4),
+            .position = {
+                fpFromDouble (radius * cos (angle)),
+                fpFromDouble (radius * sin (angle)),
+                fpFromDouble (height)
+            },
+            .velocity = {
+                fpFromDouble (-speed * sin (angle)),
+                fpFromDouble (speed * cos (angle)),
+                fpFromInt (0)
+            }
+        };
+
+        addBody (&system, newt);
+    }
+
+    return system;
+}
+
+// Run the scenario on a given pool, and hash the end state.
+//
+static uint64_t runScenario
+    ( ThreadPool *pool, unsigned int numBodies, GravitySolver solver
+    , unsigned int numSteps )
+{
+    BodySystem system = scenario (numBodies);
+    system.threadPool = pool;
+    system.gravitySolver = solver;
+
+    Integrator integrator = newIntegrator (fpFromInt (4), 6);
+    for (unsigned int step = 0; step < numSteps; step++)
+        integrate (&integrator, &system);
+
+    uint64_t hash = hashBodySystem (&system);
+    freeBodySystem (system);
+    return hash;
+}
+
+// Forces alone on a system big enough to build the tree in parallel.
+//
+static uint64_t forceHash (ThreadPool *pool, unsigned int numBodies, GravitySolver solver) {
+    BodySystem system = scenario (numBodies);
+    system.threadPool = pool;
+    system.gravitySolver = solver;
+
+    computeAccelerations (&system);
+
+    uint64_t hash = hashBodySystem (&system);
+    freeBodySystem (system);
+    return hash;
+}
+
+int main (void) {
+    unsigned int
+        cores       = availableCores (),
+        sizes[]     = { 1, 2, cores > 4 ? cores : 4 };
+
+    ThreadPool *pools[3] = { NULL };
+    for (unsigned int poolIx = 0; poolIx < 3; poolIx++) {
+        pools[poolIx] = newThreadPool (sizes[poolIx]);
+        CHECK (pools[poolIx] != NULL);
+        CHECK (threadPoolWorkers (pools[poolIx]) == sizes[poolIx]);
+
+        checkPool (pools[poolIx], 0);
+        checkPool (pools[poolIx], 1);
+        checkPool (pools[poolIx], 3);
+        checkPool (pools[poolIx], 1000);
+    }
+
+    checkPool (NULL, 100);
+
+    uint64_t
+        directSteps = runScenario (NULL, 1500, GRAVITY_SOLVER_DIRECT, 3),
+        treeSteps   = runScenario (NULL, 1500, GRAVITY_SOLVER_TREE, 3),
+        directForce = forceHash (NULL, 10000, GRAVITY_SOLVER_DIRECT),
+        treeForce   = forceHash (NULL, 10000, GRAVITY_SOLVER_TREE);
+
+    // The scenario actually moves, and the two solvers differ.
+    CHECK (directSteps != hashBodySystem (&(BodySystem) { 0 }));
+    CHECK (directSteps != treeSteps);
+
+    // Same bytes on any number of threads, and on every run.
+    for (unsigned int run = 0; run < 2; run++)
+    for (unsigned int poolIx = 0; poolIx < 3; poolIx++) {
+        ThreadPool *pool = pools[poolIx];
+
+        CHECK (runScenario (pool, 1500, GRAVITY_SOLVER_DIRECT, 3) == directSteps);
+        CHECK (runScenario (pool, 1500, GRAVITY_SOLVER_TREE, 3) == treeSteps);
+        CHECK (forceHash (pool, 10000, GRAVITY_SOLVER_DIRECT) == directForce);
+        CHECK (forceHash (pool, 10000, GRAVITY_SOLVER_TREE) == treeForce);
+    }
+
+    // More workers than tile pairs, so some workers get pairs and some
+    // don't, whichever they are.
+    ThreadPool *widePool = newThreadPool (8);
+    CHECK (widePool != NULL);
+
+    uint64_t fewPairsForce = forceHash (NULL, 300, GRAVITY_SOLVER_DIRECT);
+    for (unsigned int run = 0; run < 4; run++)
+        CHECK (forceHash (widePool, 300, GRAVITY_SOLVER_DIRECT) == fewPairsForce);
+
+    freeThreadPool (widePool);
+
+    for (unsigned int poolIx = 0; poolIx < 3; poolIx++)
+        freeThreadPool (pools[poolIx]);
+
+    return checkReport ();
+}
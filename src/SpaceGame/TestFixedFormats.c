@@ -0,0 +1,206 @@
+
+#include <math.h>
+#include <stdio.h>
+
+#include "Bench.h"
+#include "WideInt.h"
+#include "FixedPrecision.h"
+#include "FixedFormats.h"
+
+
+
+// Random value with a magnitude below '2^magnitudeBits', as raw bits.
+//
+static int64_t randomBits (uint64_t *seed, uint32_t magnitudeBits) {
+    int64_t bits = (int64_t) (nextRandom (seed) >> (64 - magnitudeBits));
+    return nextRandom (seed) & 1 ? -bits : bits;
+}
+
+// Is 'q' the truncated quotient 'a * 2^fracBits / b' of two 64-bit
+// magnitudes, 'q * b <= a * 2^fracBits < (q + 1) * b'? Quotients too big
+// for the format saturate instead.
+//
+static int isQuotient64 (uint64_t q, uint64_t a, uint64_t b, uint32_t fracBits) {
+    UInt128 num = shl128u (newUInt128 (0, a), fracBits);
+
+    if (q >= INT64_MAX && !lt128u (num, mul64u (q, b)))
+        return 1;
+
+    return
+        !lt128u (num, mul64u (q, b)) &&
+        lt128u (num, add128u (mul64u (q, b), newUInt128 (0, b)));
+}
+
+// Is 'r' the truncated square root of 'a * 2^fracBits'?
+//
+static int isSqrt64 (uint64_t r, uint64_t a, uint32_t fracBits) {
+    UInt128 n = shl128u (newUInt128 (0, a), fracBits);
+    return !lt128u (n, mul64u (r, r)) && lt128u (n, mul64u (r + 1, r + 1));
+}
+
+// A 128-bit integer times '2^32', in 256 bits.
+//
+static UInt256 shiftUp32 (UInt128 a) {
+    return (UInt256) { shr128u (a, 96), shl128u (a, 32) };
+}
+
+// The 64-bit formats agree with 'FixedPrec', which holds all their values
+// exactly and rounds the same way.
+//
+#define CHECK_FORMAT_64(Type, prefix, RANGE_BITS)                       \
+    do {                                                                \
+        uint64_t seed = 7;                                              \
+        for (unsigned int trial = 0; trial < 100000; trial++) {         \
+            Type                                                        \
+                a = prefix##FromBits (randomBits (&seed, RANGE_BITS)),  \
+                b = prefix##FromBits (randomBits (&seed, RANGE_BITS)),  \
+                back;                                                   \
+            FixedPrec fa = fpFromInt (0), fb = fa;                      \
+            CHECK (prefix##ToFixedPrec (a, &fa));                       \
+            CHECK (prefix##ToFixedPrec (b, &fb));                       \
+                                                                        \
+            CHECK (fpTo##Type (fpAdd (fa, fb), &back));                 \
+            CHECK (prefix##Equal (back, prefix##Add (a, b)));           \
+            CHECK (fpTo##Type (fpSub (fa, fb), &back));                 \
+            CHECK (prefix##Equal (back, prefix##Sub (a, b)));           \
+            CHECK (fpTo##Type (fpMul (fa, fb), &back));                 \
+            CHECK (prefix##Equal (back, prefix##Mul (a, b)));           \
+            CHECK (prefix##LessThan (a, b) == fpLessThan (fa, fb));     \
+                                                                        \
+            if (b.bits != 0) {                                          \
+                Type q = prefix##Div (a, b);                            \
+                CHECK (isQuotient64                                     \
+                    ( (uint64_t) prefix##Abs (q).bits                   \
+                    , (uint64_t) prefix##Abs (a).bits                   \
+                    , (uint64_t) prefix##Abs (b).bits                   \
+                    , prefix##FracBits ));                              \
+                CHECK (q.bits == 0 || (q.bits < 0) == ((a.bits ^ b.bits) < 0)); \
+            }                                                           \
+                                                                        \
+            Type r = prefix##Sqrt (prefix##Abs (a));                    \
+            CHECK (isSqrt64                                             \
+                ( (uint64_t) r.bits, (uint64_t) prefix##Abs (a).bits    \
+                , prefix##FracBits ));                                  \
+                                                                        \
+            CHECK (prefix##ToDouble (a) == ldexp ((double) a.bits, -prefix##FracBits)); \
+            CHECK (prefix##Equal (prefix##FromDouble (prefix##ToDouble (a)), a)); \
+        }                                                               \
+    } while (0)
+
+static void checkFormats64 (void) {
+    // Small enough that products fit.
+    CHECK_FORMAT_64 (Q32x32, q32x32, 47);
+    CHECK_FORMAT_64 (Q16x48, q16x48, 53);
+
+    CHECK (q32x32Equal (q32x32FromDouble (-1.5), q32x32FromBits (-(3LL << 31))));
+    CHECK (q16x48ToFloat (q16x48FromDouble (0.25)) == 0.25f);
+    CHECK (q32x32Equal (q32x32Sqrt (q32x32FromInt (1 << 30)), q32x32FromInt (1 << 15)));
+    CHECK (q32x32Equal (q32x32Sqrt (q32x32FromInt (0)), q32x32FromInt (0)));
+
+    // Products round down, quotients towards zero.
+    Q32x32 tiny = q32x32FromBits (1), half = q32x32FromDouble (0.5);
+    CHECK (q32x32Equal (q32x32Mul (q32x32Neg (tiny), half), q32x32Neg (tiny)));
+    CHECK (q32x32Equal (q32x32Div (q32x32Neg (tiny), q32x32FromInt (2)), q32x32FromInt (0)));
+
+    // Quotients that don't fit saturate; out-of-range doubles too.
+    CHECK (q32x32Equal (q32x32Div (q32x32FromInt (1 << 30), q32x32FromDouble (0x1p-20)), q32x32Max));
+    CHECK (q32x32Equal (q32x32Div (q32x32FromInt (-(1 << 30)), q32x32FromDouble (0x1p-20)), q32x32Min));
+    CHECK (q32x32Equal (q32x32Div (q32x32Min, q32x32FromInt (1)), q32x32Min));
+    CHECK (q16x48Equal (q16x48FromDouble (1e6), q16x48Max));
+    CHECK (q16x48Equal (q16x48FromDouble (-1e6), q16x48Min));
+    CHECK (q16x48Equal (q16x48FromDouble (NAN), q16x48FromInt (0)));
+}
+
+// Q96.32 agrees with 'FixedPrec' where both can hold the values, and its
+// quotients and square roots are exact at the top of its range too.
+//
+static void checkFormat128 (void) {
+    uint64_t seed = 9;
+
+    for (unsigned int trial = 0; trial < 100000; trial++) {
+        FixedPrec
+            fa = newFixedPrec (randomBits (&seed, 30), nextRandom (&seed) << 32),
+            fb = newFixedPrec (randomBits (&seed, 30), nextRandom (&seed) << 32),
+            reference;
+
+        Q96x32 a, b, back;
+        CHECK (fpToQ96x32 (fa, &a) && fpToQ96x32 (fb, &b));
+
+        CHECK (q96x32ToFixedPrec (q96x32Add (a, b), &reference) && fpEqual (reference, fpAdd (fa, fb)));
+        CHECK (q96x32ToFixedPrec (q96x32Sub (a, b), &reference) && fpEqual (reference, fpSub (fa, fb)));
+        CHECK (fpToQ96x32 (fpMul (fa, fb), &back) && q96x32Equal (back, q96x32Mul (a, b)));
+        CHECK (q96x32LessThan (a, b) == fpLessThan (fa, fb));
+        CHECK (q96x32ToDouble (a) == fpToDouble (fa));
+
+        // Shift up towards the top of the range for the rest.
+        a = q96x32Mul (a, q96x32FromInt (1LL << 62));
+
+        if (!q96x32Equal (b, q96x32FromInt (0))) {
+            Q96x32 q = q96x32Abs (q96x32Div (a, b));
+            UInt256
+                num     = shiftUp32 (q96x32Wide (q96x32Abs (a))),
+                below   = mul128u (q96x32Wide (q), q96x32Wide (q96x32Abs (b))),
+                above   = add256u (below, (UInt256) { newUInt128 (0, 0), q96x32Wide (q96x32Abs (b)) });
+
+            CHECK (!lt256u (num, below) && lt256u (num, above));
+        }
+
+        Q96x32 r = q96x32Sqrt (q96x32Abs (a));
+        Q96x32 next = q96x32Add (r, q96x32FromWide (newUInt128 (0, 1)));
+        UInt256 n = shiftUp32 (q96x32Wide (q96x32Abs (a)));
+
+        CHECK (!lt256u (n, mul128u (q96x32Wide (r), q96x32Wide (r))));
+        CHECK (lt256u (n, mul128u (q96x32Wide (next), q96x32Wide (next))));
+    }
+
+    Q96x32 big = q96x32Mul (q96x32FromInt (1LL << 62), q96x32FromInt (1LL << 30));
+    CHECK (q96x32ToDouble (big) == 0x1p92);
+    CHECK (q96x32ToDouble (q96x32Neg (big)) == -0x1p92);
+    CHECK (q96x32Equal (q96x32Sqrt (big), q96x32FromInt (1LL << 46)));
+    CHECK (q96x32Equal (q96x32FromDouble (-0x1p92), q96x32Neg (big)));
+    CHECK (q96x32Equal (q96x32FromDouble (0x1p200), q96x32Max));
+    CHECK (q96x32Equal (q96x32Div (big, q96x32FromDouble (0x1p-30)), q96x32Max));
+    CHECK (q96x32Equal (q96x32Div (q96x32Neg (big), q96x32FromInt (1 << 30)), q96x32FromInt (-(1LL << 62))));
+}
+
+// Conversions succeed exactly when the value fits, round down, and
+// saturate otherwise.
+//
+static void checkConversions (void) {
+    Q32x32 a32;
+    Q16x48 a16;
+    Q96x32 a96;
+    FixedPrec fp;
+
+    // Round trips through a wider format are exact.
+    Q32x32 x = q32x32FromDouble (-12345.678);
+    CHECK (q32x32ToQ96x32 (x, &a96) && q96x32ToQ32x32 (a96, &a32) && q32x32Equal (a32, x));
+    CHECK (q32x32ToFixedPrec (x, &fp) && fpToQ32x32 (fp, &a32) && q32x32Equal (a32, x));
+    CHECK (fpEqual (fp, fpFromDouble (q32x32ToDouble (x))));
+
+    // Too many integer bits.
+    CHECK (!q32x32ToQ16x48 (q32x32FromInt (40000), &a16));
+    CHECK (q16x48Equal (a16, q16x48Max));
+    CHECK (!q32x32ToQ16x48 (q32x32FromInt (-40000), &a16));
+    CHECK (q16x48Equal (a16, q16x48Min));
+    CHECK (q32x32ToQ16x48 (q32x32FromInt (-32768), &a16));
+    CHECK (q16x48Equal (a16, q16x48FromInt (-32768)));
+
+    CHECK (!fpToQ32x32 (fpFromInt (1LL << 40), &a32) && q32x32Equal (a32, q32x32Max));
+    CHECK (q96x32ToFixedPrec (q96x32FromInt (INT64_MAX), &fp) && fpEqual (fp, fpFromInt (INT64_MAX)));
+    CHECK (!q96x32ToFixedPrec (q96x32Mul (q96x32FromInt (1LL << 62), q96x32FromInt (4)), &fp));
+    CHECK (fpEqual (fp, fpMax));
+
+    // Extra fraction bits round down.
+    CHECK (q16x48ToQ32x32 (q16x48FromBits (-1), &a32) && q32x32Equal (a32, q32x32FromBits (-1)));
+    CHECK (q16x48ToQ32x32 (q16x48FromBits (1), &a32) && q32x32Equal (a32, q32x32FromInt (0)));
+    CHECK (fpToQ16x48 (newFixedPrec (-1, UINT64_MAX), &a16) && q16x48Equal (a16, q16x48FromBits (-1)));
+}
+
+int main (void) {
+    checkFormats64 ();
+    checkFormat128 ();
+    checkConversions ();
+
+    return checkReport ();
+}
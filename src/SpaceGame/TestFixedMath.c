@@ -0,0 +1,221 @@
+
+#include <stdio.h>
+
+#include "Bench.h"
+#include "WideInt.h"
+#include "FixedPrecision.h"
+#include "FixedMath.h"
+
+
+
+// Are 'a' and 'b' within 'ulps' units in the last place of each other?
+//
+static int within (FixedPrec a, FixedPrec b, uint64_t ulps) {
+    UInt128 difference = fpBits (fpAbs (fpSub (a, b)));
+    return difference.hi == 0 && difference.lo <= ulps;
+}
+
+// Exact values, rounded to the nearest fixed-precision value, worked out
+// to 150 digits.
+//
+static const struct { FixedPrec a, sine, cosine; } sinCosCases[] = {
+    { { 0, 0x8000000000000000 }, { 0, 0x7ABBA1D12C17BFA2 }, { 0, 0xE0A94032DBEA7CEE } },
+    { { -1, 0x0000000000000000 }, { -1, 0x28955B87B7988FDF }, { 0, 0x8A51407DA8345C92 } },
+    { { 3, 0x0000000000000000 }, { 0, 0x242070DB6DAAB69E }, { -1, 0x028FDA0BD0D16CF8 } },
+    { { 100, 0x0000000000000000 }, { -1, 0x7E5ED2439D923FC8 }, { 0, 0xDCC0EDFB32FEFB20 } },
+    { { -8, 0xC000000000000000 }, { -1, 0x2D4A924EAEC23B72 }, { 0, 0x91637A86E1FDF307 } },
+    { { 1000000, 0x0000000000000000 }, { -1, 0xA666D36A5C9E62DA }, { 0, 0xEFCEFCC836996357 } },
+    { { 1000000000000, 0x0000000000000000 }, { -1, 0x6385DC433DE56F2C }, { 0, 0xCA9C398EFF911B7D } },
+    { { -9000000000000000000, 0x0000000000000000 }, { 0, 0x7B64DA59930D15A4 }, { 0, 0xE04C7B32FD17BEB5 } },
+};
+
+static const struct { FixedPrec y, x, angle; } atan2Cases[] = {
+    { { 1, 0x0000000000000000 }, { 1, 0x0000000000000000 }, { 0, 0xC90FDAA22168C235 } },
+    { { -2, 0x0000000000000000 }, { 0, 0x8000000000000000 }, { -2, 0xAC9736AE1630365C } },
+    { { 3, 0x0000000000000000 }, { -4, 0x0000000000000000 }, { 2, 0x7F82ED6F50ABFFAF } },
+    { { -1, 0xFFFFFFFBB47D05F6 }, { -1, 0x0000000000000000 }, { -4, 0xDBC0957BC5DFF137 } },
+    { { 1000000000000, 0x0000000000000000 }, { 0, 0x0000000001197998 }, { 1, 0x921FB54442D1846A } },
+    { { 5, 0x0000000000000000 }, { 0, 0x0000000000000000 }, { 1, 0x921FB54442D1846A } },
+};
+
+static const struct { FixedPrec a, result; } expCases[] = {
+    { { 1, 0x0000000000000000 }, { 2, 0xB7E151628AED2A6B } },
+    { { -1, 0x0000000000000000 }, { 0, 0x5E2D58D8B3BCDF1B } },
+    { { 0, 0x004189374BC6A7F0 }, { 1, 0x0041919B7EE33CE8 } },
+    { { 10, 0x8000000000000000 }, { 36315, 0x80AF4269D9BC1C42 } },
+    { { -30, 0x0000000000000000 }, { 0, 0x00000000001A56E1 } },
+}, expTopCases[] = {
+    // Random arguments with results up to 2^56, where the last place is
+    // the smallest fraction of the result, and the last two are ones that
+    // used to be out by more than one unit.
+    { { 33, 0xB513F6156BAA2F31 }, { 435421583309964, 0x83C642F36D01BC62 } },
+    { { 30, 0x35FE3633929E2E50 }, { 13195674640604, 0xD02884A044C737FE } },
+    { { 38, 0x94FE0638EDFE1B1C }, { 57009886969266161, 0xAC18DA5BB4738DB2 } },
+    { { 32, 0xED8B795F07C4B9BC }, { 199714398812655, 0xD0AA329ECFD3891B } },
+    { { 33, 0xE6E4B3F462ABA80C }, { 528956455703161, 0xED586EBB69D673FE } },
+    { { 33, 0x8F049254322B5124 }, { 375268733171106, 0xF1193E99F7132374 } },
+    { { 31, 0xFB9B152CABB40369 }, { 77619137067057, 0x3E7153296590F380 } },
+    { { 38, 0x36EA30CDC7B30418 }, { 39477645329030450, 0xEE3AD322406613C6 } },
+    { { 33, 0x2E332C12ACD6BC95 }, { 257095396664249, 0x6B4AE798F2F6685B } },
+    { { 38, 0x2293C91D2CF93946 }, { 36462747917192561, 0xAF6DBC78F74A30A2 } },
+    { { 30, 0xACAD75DE91634E94 }, { 20978554048965, 0x745BB947526BB443 } },
+    { { 31, 0x8DF0EB4A86B75BCC }, { 50573932111862, 0xF48F735006811D8E } },
+    { { 38, 0xBD8673337EAFDBFB }, { 66790202414740487, 0xBAA25ECC03F85A7E } },
+    { { 38, 0xD010A156251D6588 }, { 71806669529225145, 0x18DF47472E041D17 } },
+}, bigExpCases[] = {
+    // Random arguments with results above 2^56.
+    { { 39, 0x7C5B33A54C98D308 }, { 140750698994076971, 0xDBC050333296E126 } },
+    { { 40, 0xB2ED47B17B7B58BB }, { 473502272201314764, 0x9686C8FC209E2547 } },
+    { { 40, 0x447D87A37F5F4105 }, { 307588865322976556, 0xCBB78960CC72D0D4 } },
+    { { 40, 0xFDB5B786CF43AD31 }, { 634145000022179059, 0x66ABC3D6CD810911 } },
+    { { 41, 0x61FD5F25F0ED869B }, { 938230824225670057, 0xF4BC30E226EC7D22 } },
+    { { 42, 0xD4704D57EE1E1F2E }, { 3988068069412224962, 0x06395C9BB52A7D79 } },
+    { { 38, 0xE3D55D6E4F0F3BB8 }, { 77571341318843444, 0x26E4D0C60DE19B93 } },
+    { { 41, 0xA37D76557E7C4357 }, { 1211793481096978417, 0x87394988DA9551A3 } },
+}, logCases[] = {
+    { { 2, 0x0000000000000000 }, { 0, 0xB17217F7D1CF79AC } },
+    { { 0, 0x199999999999999A }, { -3, 0xB289C889555D4FA8 } },
+    { { 0, 0x000000000000480F }, { -35, 0x7613A8CF1247F818 } },
+    { { 12345, 0xAD916872B020C49C }, { 9, 0x6BCAACBC8F1872ED } },
+    { { 9000000000000000000, 0x0000000000000000 }, { 43, 0xA4CD35AD9FD1B95F } },
+    { { 0, 0x0000000000000001 }, { -45, 0xA37A020B8C21950E } },
+};
+
+#define COUNT(array) (sizeof (array) / sizeof ((array)[0]))
+
+// Every function is within one unit in the last place of the exact
+// value, and the batched versions agree with them.
+//
+static void checkReferences (void) {
+    for (unsigned int ix = 0; ix < COUNT (sinCosCases); ix++) {
+        FixedPrec sine, cosine;
+        fpSinCos (sinCosCases[ix].a, &sine, &cosine);
+
+        CHECK (within (sine, sinCosCases[ix].sine, 1));
+        CHECK (within (cosine, sinCosCases[ix].cosine, 1));
+        CHECK (fpEqual (fpSin (sinCosCases[ix].a), sine));
+        CHECK (fpEqual (fpCos (sinCosCases[ix].a), cosine));
+    }
+
+    for (unsigned int ix = 0; ix < COUNT (atan2Cases); ix++)
+        CHECK (within (fpAtan2 (atan2Cases[ix].y, atan2Cases[ix].x), atan2Cases[ix].angle, 1));
+
+    for (unsigned int ix = 0; ix < COUNT (expCases); ix++)
+        CHECK (within (fpExp (expCases[ix].a), expCases[ix].result, 1));
+
+    for (unsigned int ix = 0; ix < COUNT (logCases); ix++)
+        CHECK (within (fpLog (logCases[ix].a), logCases[ix].result, 1));
+
+    for (unsigned int ix = 0; ix < COUNT (expTopCases); ix++)
+        CHECK (within (fpExp (expTopCases[ix].a), expTopCases[ix].result, 1));
+
+    // Above 2^56, exponentials are within four units.
+    for (unsigned int ix = 0; ix < COUNT (bigExpCases); ix++)
+        CHECK (within (fpExp (bigExpCases[ix].a), bigExpCases[ix].result, 4));
+
+    FixedPrec big = fpExp (newFixedPrec (43, 0x8000000000000000));
+    CHECK (within (big, newFixedPrec (7794889495725306399, 0x97F7B9CDBA011408), 4));
+
+    FixedPrec
+        as[COUNT (logCases)], sines[COUNT (logCases)], cosines[COUNT (logCases)],
+        results[COUNT (logCases)];
+
+    for (unsigned int ix = 0; ix < COUNT (logCases); ix++)
+        as[ix] = logCases[ix].a;
+
+    fpLogArray (as, results, COUNT (logCases));
+    for (unsigned int ix = 0; ix < COUNT (logCases); ix++)
+        CHECK (fpEqual (results[ix], fpLog (as[ix])));
+
+    fpExpArray (as, results, COUNT (logCases));
+    for (unsigned int ix = 0; ix < COUNT (logCases); ix++)
+        CHECK (fpEqual (results[ix], fpExp (as[ix])));
+
+    fpSinCosArray (as, sines, cosines, COUNT (logCases));
+    fpAtan2Array (sines, cosines, results, COUNT (logCases));
+    for (unsigned int ix = 0; ix < COUNT (logCases); ix++) {
+        CHECK (fpEqual (sines[ix], fpSin (as[ix])) && fpEqual (cosines[ix], fpCos (as[ix])));
+        CHECK (fpEqual (results[ix], fpAtan2 (sines[ix], cosines[ix])));
+    }
+
+    // In place
+    fpLogArray (as, as, COUNT (logCases));
+    for (unsigned int ix = 0; ix < COUNT (logCases); ix++)
+        CHECK (fpEqual (as[ix], fpLog (logCases[ix].a)));
+}
+
+// Identities hold to within the rounding of each side, over random
+// arguments.
+//
+static void checkIdentities (void) {
+    uint64_t seed = 13;
+
+    for (unsigned int trial = 0; trial < 100000; trial++) {
+        // Angles in (-pi, pi)
+        FixedPrec angle = newFixedPrec ((int64_t) (nextRandom (&seed) % 6) - 3, nextRandom (&seed));
+        FixedPrec sine, cosine;
+        fpSinCos (angle, &sine, &cosine);
+
+        FixedPrec one = fpAdd (fpMul (sine, sine), fpMul (cosine, cosine));
+        CHECK (within (one, fpFromInt (1), 4));
+        CHECK (within (fpAtan2 (sine, cosine), angle, 4));
+
+        // Sine is odd and cosine even, exactly.
+        FixedPrec negSine, negCosine;
+        fpSinCos (fpNeg (angle), &negSine, &negCosine);
+        CHECK (fpEqual (negSine, fpNeg (sine)) && fpEqual (negCosine, cosine));
+
+        // Positive values with up to 20 integer bits
+        FixedPrec x = newFixedPrec ((int64_t) (nextRandom (&seed) >> 44), nextRandom (&seed) | 1);
+        FixedPrec log = fpLog (x);
+        CHECK (within (fpExp (log), x, 1 + (fpBits (x).hi >> 1)));
+        CHECK (within (fpAdd (log, fpLn2), fpLog (fpAdd (x, x)), 1));
+    }
+}
+
+static void checkEdgeCases (void) {
+    FixedPrec sine, cosine;
+
+    fpSinCos (fpFromInt (0), &sine, &cosine);
+    CHECK (fpEqual (sine, fpFromInt (0)) && fpEqual (cosine, fpFromInt (1)));
+    CHECK (within (fpSin (fpPi), fpFromInt (0), 1));
+    CHECK (within (fpCos (fpHalfPi), fpFromInt (0), 1));
+    CHECK (within (fpCos (fpTwoPi), fpFromInt (1), 1));
+
+    // Reduction is exact however large the argument.
+    fpSinCos (fpMax, &sine, &cosine);
+    CHECK (within (fpAdd (fpMul (sine, sine), fpMul (cosine, cosine)), fpFromInt (1), 4));
+    fpSinCos (fpMin, &sine, &cosine);
+    CHECK (within (fpAdd (fpMul (sine, sine), fpMul (cosine, cosine)), fpFromInt (1), 4));
+
+    CHECK (fpEqual (fpAtan2 (fpFromInt (0), fpFromInt (0)), fpFromInt (0)));
+    CHECK (fpEqual (fpAtan2 (fpFromInt (0), fpFromInt (-1)), fpPi));
+    CHECK (fpEqual (fpAtan2 (fpFromInt (1), fpFromInt (0)), fpHalfPi));
+    CHECK (fpEqual (fpAtan2 (fpFromInt (-1), fpFromInt (0)), fpNeg (fpHalfPi)));
+    CHECK (within (fpAtan2 (fpMax, fpMax), fpMul (fpHalfPi, newFixedPrec (0, 1ULL << 63)), 1));
+    CHECK (fpEqual (fpAtan2 (fpMin, fpMax), fpAtan2 (fpMin, fpMax)));
+
+    CHECK (fpEqual (fpExp (fpFromInt (0)), fpFromInt (1)));
+    CHECK (fpEqual (fpExp (fpFromInt (44)), fpMax));
+    CHECK (fpEqual (fpExp (fpMax), fpMax));
+    CHECK (fpEqual (fpExp (fpFromInt (-46)), fpFromInt (0)));
+    CHECK (fpEqual (fpExp (fpMin), fpFromInt (0)));
+    CHECK (within (fpExp (fpFromInt (1)), fpE, 1));
+
+    CHECK (fpEqual (fpLog (fpFromInt (1)), fpFromInt (0)));
+    CHECK (within (fpLog (fpE), fpFromInt (1), 1));
+    CHECK (within (fpLog (fpMax), newFixedPrec (43, 0xAB13E5FCA20EF147), 1));
+
+    // Logarithms of zero or negative numbers are errors.
+    printf ("expected errors follow\n");
+    CHECK (fpEqual (fpLog (fpFromInt (0)), fpMin));
+    CHECK (fpEqual (fpLog (fpFromInt (-1)), fpMin));
+}
+
+int main (void) {
+    checkReferences ();
+    checkIdentities ();
+    checkEdgeCases ();
+
+    return checkReport ();
+}
@@ -1,13 +1,231 @@
 
 #include <stdio.h>
 
+#include "Bench.h"
 #include "FixedPrecision.h"
 
 
 
+// Random value with a random magnitude, so that both tiny and huge
+// operands get exercised.
+//
+static FixedPrec randomFixedPrec (uint64_t *seed) {
+    UInt128 bits = shr128u
+        ( newUInt128 (nextRandom (seed), nextRandom (seed))
+        , nextRandom (seed) % 128 );
+
+    return fpFromBits (bits);
+}
+
+// Compare 'r^2 * a' against '2^192', i.e. check which side of the exact
+// reciprocal square root 'r' is on. Returns -1, 0 or 1.
+//
+static int cmpRsqrt (UInt128 r, UInt128 a) {
+    UInt256 r2 = mul128u (r, r);
+    if (r2.hi.hi)
+        return 1;
+
+    UInt256
+        prodLo = mul128u (r2.lo, a),
+        prodHi = mul128u (newUInt128 (0, r2.hi.lo), a);
+
+    if (prodHi.hi.hi || prodHi.hi.lo)
+        return 1;
+
+    UInt256 prod = add256u (prodLo, (UInt256) { prodHi.lo, newUInt128 (0, 0) });
+    if (lt256u (prod, prodLo))
+        return 1;
+
+    UInt256 bound = { newUInt128 (1, 0), newUInt128 (0, 0) };
+
+    return lt256u (prod, bound) ? -1 : lt256u (bound, prod);
+}
+
+// Check 'fpDiv', 'fpSqrt' and 'fpRsqrt' against their exact definitions.
+//
+// Division and square root should be exact, truncated:
+//
+//  q * |b| <= |a| * 2^64 < (q + 1) * |b|
+//  r^2 <= a * 2^64 < (r + 1)^2
+//
+// and the reciprocal square root should be at most 1 ULP low.
+//
+static void checkNewton (FixedPrec a, FixedPrec b) {
+    UInt128
+        num = fpBits (fpAbs (a)),
+        den = fpBits (fpAbs (b));
+
+    UInt256 target = { newUInt128 (0, num.hi), newUInt128 (num.lo, 0) };
+
+    if (den.hi || den.lo) {
+        FixedPrec quot = fpDiv (a, b);
+        UInt128 q = fpBits (fpAbs (quot));
+
+        UInt256
+            lower = mul128u (q, den),
+            upper = add256u (lower, (UInt256) { newUInt128 (0, 0), den });
+
+        int
+            exact = !lt256u (target, lower) && lt256u (target, upper),
+            saturated = fpEqual (quot, fpMax) || fpEqual (quot, fpMin),
+            overflow = !lt256u
+                (target, mul128u (newUInt128 (1ULL << 63, 0), den));
+
+        CHECK (exact || (saturated && overflow));
+        CHECK ((q.hi | q.lo) == 0 ||
+            (quot.wholePart < 0) == ((a.wholePart < 0) != (b.wholePart < 0)));
+    }
+
+    // The magnitude of the most negative value doesn't fit.
+    if (MSB64(num.hi))
+        return;
+
+    UInt256 nTarget = { newUInt128 (0, num.hi), newUInt128 (num.lo, 0) };
+    UInt128
+        r = fpBits (fpSqrt (fpAbs (a))),
+        next = add128u (r, newUInt128 (0, 1));
+
+    CHECK (!lt256u (nTarget, mul128u (r, r)));
+    CHECK (lt256u (nTarget, mul128u (next, next)));
+
+    if (num.hi || num.lo) {
+        UInt128 rs = fpBits (fpRsqrt (fpAbs (a)));
+
+        CHECK (cmpRsqrt (rs, num) <= 0);
+        CHECK (cmpRsqrt (add128u (rs, newUInt128 (0, 2)), num) > 0);
+    }
+}
+
+#if defined (__SIZEOF_INT128__)
+
+typedef __int128 Native;
+
+static Native toNative (FixedPrec a) {
+    return (Native) (((unsigned __int128) (uint64_t) a.wholePart << 64) | a.decPart);
+}
+
+static FixedPrec fromNative (Native a) {
+    return newFixedPrec ((int64_t) (a >> 64), (uint64_t) a);
+}
+
+// 'a * b / 2^64' rounded down, modulo 2^128, worked out on magnitudes
+// rather than with 'fpMul''s two's complement corrections.
+//
+static Native nativeMul (Native a, Native b) {
+    unsigned __int128
+        x = a < 0 ? -(unsigned __int128) a : (unsigned __int128) a,
+        y = b < 0 ? -(unsigned __int128) b : (unsigned __int128) b,
+        p00 = (unsigned __int128) (uint64_t) x * (uint64_t) y,
+        p01 = (unsigned __int128) (uint64_t) x * (uint64_t) (y >> 64),
+        p10 = (unsigned __int128) (uint64_t) (x >> 64) * (uint64_t) y,
+        p11 = (unsigned __int128) (uint64_t) (x >> 64) * (uint64_t) (y >> 64),
+        mid = (p00 >> 64) + (uint64_t) p01 + (uint64_t) p10,
+        top = (mid >> 64) + (p01 >> 64) + (p10 >> 64) + p11,
+        scaled = (top << 64) | (uint64_t) mid;
+
+    if ((a < 0) == (b < 0))
+        return (Native) scaled;
+
+    // Rounding down a negative product rounds its magnitude up.
+    return (Native) -(scaled + ((uint64_t) p00 != 0));
+}
+
+// The basic operations against the compiler's 128-bit arithmetic.
+//
+static void checkNative (FixedPrec a, FixedPrec b) {
+    Native x = toNative (a), y = toNative (b);
+
+    CHECK (fpEqual (fpAdd (a, b), fromNative ((Native) ((unsigned __int128) x + (unsigned __int128) y))));
+    CHECK (fpEqual (fpSub (a, b), fromNative ((Native) ((unsigned __int128) x - (unsigned __int128) y))));
+    CHECK (fpEqual (fpNeg (a), fromNative ((Native) -(unsigned __int128) x)));
+    CHECK (fpEqual (fpAbs (a), fromNative (x < 0 ? (Native) -(unsigned __int128) x : x)));
+    CHECK (fpEqual (fpMul (a, b), fromNative (nativeMul (x, y))));
+    CHECK (fpEqual (fpSqr (a), fromNative (nativeMul (x, x))));
+    CHECK (fpLessThan (a, b) == (x < y));
+    CHECK (fpEqual (a, b) == (x == y));
+
+    // Algebra that holds exactly, even when it wraps.
+    CHECK (fpEqual (fpMul (a, b), fpMul (b, a)));
+    CHECK (fpEqual (fpSub (fpAdd (a, b), b), a));
+    CHECK (fpEqual (fpMul (a, fpFromInt (-1)), fpNeg (a)));
+    CHECK (fpEqual (fpFromSignMag (fpToSignMag (a)), a));
+}
+
+#else
+
+static void checkNative (FixedPrec a, FixedPrec b) {
+    (void) a;
+    (void) b;
+}
+
+#endif
+
 int main (void) {
-    FixedPrec a = {-1, 16, 0x8000000000000000};
+    FixedPrec a = fpFromSignMag
+        ((SignMagFixedPrec) {-1, 16, 0x8000000000000000});
     printf ("fixed-prec to float: %f\n", fpToFloat (a));
 
-    return 0;
+    CHECK (sizeof (FixedPrec) == 16);
+
+    // -16.5 is -17 + 0.5 in two's complement.
+    CHECK (a.wholePart == -17 && a.decPart == 0x8000000000000000);
+
+    SignMagFixedPrec back = fpToSignMag (a);
+    CHECK (back.sign == -1);
+    CHECK (back.wholePart == 16 && back.decPart == 0x8000000000000000);
+
+    FixedPrec
+        half        = newFixedPrec (0, 0x8000000000000000),
+        minusHalf   = fpNeg (half),
+        three       = fpFromInt (3);
+
+    CHECK (fpEqual (fpAdd (half, minusHalf), fpFromInt (0)));
+    CHECK (fpEqual
+        (fpSub (half, three), newFixedPrec (-3, 0x8000000000000000)));
+    CHECK (fpEqual (fpAbs (minusHalf), half));
+    CHECK (fpEqual (fpAbs (half), half));
+
+    CHECK (fpLessThan (minusHalf, half));
+    CHECK (!fpLessThan (half, minusHalf));
+    CHECK (!fpLessThan (half, half));
+    CHECK (fpLessThan (a, minusHalf));
+
+    CHECK (fpEqual
+        (fpMul (three, minusHalf), newFixedPrec (-2, 0x8000000000000000)));
+    CHECK (fpEqual
+        (fpMul (minusHalf, minusHalf), newFixedPrec (0, 0x4000000000000000)));
+    CHECK (fpEqual (fpMul (a, fpFromInt (-2)), fpFromInt (33)));
+
+    CHECK (fpEqual (fpDiv (fpFromInt (1), fpFromInt (4)), newFixedPrec (0, 1ULL << 62)));
+    CHECK (fpEqual (fpDiv (fpFromInt (-33), fpFromInt (2)), a));
+    CHECK (fpEqual (fpSqrt (fpFromInt (16)), fpFromInt (4)));
+    CHECK (fpEqual (fpAdd (fpRsqrt (fpFromInt (4)), newFixedPrec (0, 1)), half));
+
+    uint64_t seed = 1;
+    for (unsigned int ix = 0; ix < 200000; ix++) {
+        FixedPrec
+            x = randomFixedPrec (&seed),
+            y = nextRandom (&seed) & 1 ? randomFixedPrec (&seed) : fpNeg (randomFixedPrec (&seed));
+
+        checkNewton (x, fpNeg (y));
+        checkNative (x, y);
+        checkNative (fpNeg (x), y);
+    }
+
+    // Extremes of the representation.
+    FixedPrec extremes[] = {
+        newFixedPrec (0, 1), newFixedPrec (0, 2), newFixedPrec (0, 3),
+        newFixedPrec (1, 0), newFixedPrec (0, UINT64_MAX),
+        newFixedPrec (INT64_MAX, UINT64_MAX), newFixedPrec (INT64_MIN, 0),
+        newFixedPrec (INT64_MIN, 1), newFixedPrec (1ULL << 62, 0),
+        newFixedPrec (-1, UINT64_MAX)
+    };
+
+    for (unsigned int i = 0; i < sizeof (extremes) / sizeof (extremes[0]); i++)
+    for (unsigned int j = 0; j < sizeof (extremes) / sizeof (extremes[0]); j++) {
+        checkNewton (extremes[i], extremes[j]);
+        checkNative (extremes[i], extremes[j]);
+    }
+
+    return checkReport ();
 }
@@ -0,0 +1,326 @@
+
+#include <stdio.h>
+#include <string.h>
+
+#include "Bench.h"
+#include "FixedPrecision.h"
+#include "Text.h"
+#include "FixedText.h"
+
+
+
+// Shortest decimals for some values, worked out with exact fractions.
+//
+static const struct { FixedPrec a; const char *text; } formatCases[] = {
+    { { 0, 0x0000000000000000 }, "0" },
+    { { 0, 0x0000000000000001 }, "0.00000000000000000005" },
+    { { -1, 0xFFFFFFFFFFFFFFFF }, "-0.00000000000000000005" },
+    { { INT64_MAX, 0xFFFFFFFFFFFFFFFF }, "9223372036854775807.99999999999999999995" },
+    { { INT64_MIN, 0x0000000000000000 }, "-9223372036854775808" },
+    { { 0, 0x5555555555555555 }, "0.3333333333333333333" },
+    { { 3, 0x243F6A8885A308D3 }, "3.14159265358979323846" },
+    { { -17, 0x8000000000000000 }, "-16.5" },
+    { { 1, 0x4000000000000000 }, "1.25" },
+    { { -6, 0xFFFFFFFFFFFFFFFF }, "-5.00000000000000000005" },
+    { { 0, 0x1999999999999999 }, "0.09999999999999999997" },
+    { { 0, 0x199999999999999A }, "0.1" },
+    { { -8446744073709551616, 0x0000000000003039 }, "-8446744073709551615.9999999999999993308" },
+};
+
+// Decimals and the nearest fixed-precision values to them, worked out
+// with exact fractions: the first few are halfway points and values
+// either side of them, and the rest are random, with 1 to 80 digits
+// after the point.
+//
+static const struct { const char *text; FixedPrec a; } parseCases[] = {
+    { "0.1", { 0, 0x199999999999999A } },
+    { "-0.1", { -1, 0xE666666666666666 } },
+    { "1.5", { 1, 0x8000000000000000 } },
+    { "123456789.987654321", { 123456789, 0xFCD6E9E072B5C3E1 } },
+    { "0.00000000000000000002710505431213761085018632002174854278564453125", { 0, 0x0000000000000000 } },
+    { "0.000000000000000000027105054312137610850186320021748542785644531250000001", { 0, 0x0000000000000001 } },
+    { "0.00000000000000000008131516293641283255055896006524562835693359375", { 0, 0x0000000000000002 } },
+    { "0.000000000000000000081315162936412832550558960065245628356933593749999999999", { 0, 0x0000000000000001 } },
+    { "-9223372036854775808", { INT64_MIN, 0x0000000000000000 } },
+    { "-9223372036854775808.0000000000000000000000001", { INT64_MIN, 0x0000000000000000 } },
+    { "21250919908.6", { 21250919908, 0x999999999999999A } },
+    { "-840.8", { -841, 0x3333333333333333 } },
+    { "-64.30", { -65, 0xB333333333333333 } },
+    { "-33870412123023.18", { -33870412123024, 0xD1EB851EB851EB85 } },
+    { "3657.909", { 3657, 0xE8B4395810624DD3 } },
+    { "-28.082", { -29, 0xEB020C49BA5E353F } },
+    { "70868.1948", { 70868, 0x31DE69AD42C3C9EF } },
+    { "-108061.9935", { -108062, 0x01A9FBE76C8B4396 } },
+    { "-577.09378", { -578, 0xE7FE08AEFB2AAE29 } },
+    { "79309156112.75432", { 79309156112, 0xC11B1D92B7FE08AF } },
+    { "-10986393.948757", { -10986394, 0x0D1E42E126202539 } },
+    { "-120.862527", { -121, 0x23316E3715400325 } },
+    { "782.8955597", { 782, 0xE54366871D9612FC } },
+    { "945717734175441.1471049", { 945717734175441, 0x25A8AAAE94D3613C } },
+    { "-806849483587759.65075291", { -806849483587760, 0x596841DDC5EE6147 } },
+    { "-4822307.23667127", { -4822308, 0xC36982FB727C9F38 } },
+    { "-948526166.268465632", { -948526167, 0xBB45D61A75C474B1 } },
+    { "-30403.307924402", { -30404, 0xB12BDDCBC50752FD } },
+    { "-621094415095.5289078666", { -621094415096, 0x78997E7A5B1A3FE3 } },
+    { "-7213735305334027.0313721590", { -7213735305334028, 0xF7F7FE83171000C3 } },
+    { "70335.15901396245", { 70335, 0x28B523985482E0B1 } },
+    { "2078021669525163.77774121547", { 2078021669525163, 0xC71A0C5D31E78A3A } },
+    { "-541415.038528084148", { -541416, 0xF62306029B578161 } },
+    { "372974.388853933633", { 372974, 0x638BEE6FDFEBA61C } },
+    { "-33204409333.0474395755131", { -33204409334, 0xF3DAFFFEA296C556 } },
+    { "-5666294.3799075116372", { -5666295, 0x9EBE619E0373DB51 } },
+    { "54639821178.76122202972997", { 54639821178, 0xC2DF726AAF599851 } },
+    { "601965060207.82001826330434", { 601965060207, 0xD1ECB78703CDAE5E } },
+    { "74128407345.620579868282880", { 74128407345, 0x9EDE527ED4B99DB8 } },
+    { "638115.022279180588871", { 638115, 0x05B416A002C8F6C6 } },
+    { "31.3401878017598983", { 31, 0x57168C3B0E90A25B } },
+    { "-600425725592975.7838483726167513", { -600425725592976, 0x3755B68A96965251 } },
+    { "-5079806.12524273167232686", { -5079807, 0xDFF017A367D8DBC7 } },
+    { "5983003.51505877065894811", { 5983003, 0x83DAE43F7F868778 } },
+    { "-14063279.144024264628897514", { -14063280, 0xDB2139CD96A3B72D } },
+    { "-445977.140141931417058649", { -445978, 0xDC1FA88BC3F510FE } },
+    { "-34362275446141647.1240234483478245040", { -34362275446141648, 0xE03FFFD168B0D9B2 } },
+    { "-74109060210768009.7371678684335326502", { -74109060210768010, 0x4348F7716A7B7892 } },
+    { "-462504317.20168493407224704558", { -462504318, 0xCC5E604C10541273 } },
+    { "-39.35205617483380141269", { -40, 0xA5DFA582BBE51C43 } },
+    { "4.431982965724920868288", { 4, 0x6E966F8637B635E3 } },
+    { "-9.310025167800837407188", { -10, 0xB0A230CB5BC61288 } },
+    { "68290197919246570.4143337761740931925449", { 68290197919246570, 0x6A11C7424BC10988 } },
+    { "7.0741374847771834170471", { 7, 0x12FAAC98869450E8 } },
+    { "302481635843687.63319128452984153776020", { 302481635843687, 0xA218D2F32AFB80ED } },
+    { "339965582610361.26565150556130445166915", { 339965582610361, 0x4401BCB084DADF97 } },
+    { "917249610.041042346853560688310679", { 917249610, 0x0A81C0517CB4A90A } },
+    { "-2085529091.822765444463478612213878", { -2085529092, 0x2D5F3E6BC01DD336 } },
+    { "-57767140245.2833125815354930666836450", { -57767140246, 0xB778D39FC27D428D } },
+    { "752159900662.8831436676402067970168773", { 752159900662, 0xE215B4122F2687F6 } },
+    { "-20720316.28171800239042486111489364", { -20720317, 0xB7E1543909E6A181 } },
+    { "-0.84745378383064003761436537", { -1, 0x270D44D193714A89 } },
+    { "-58919788342.563048137343373441979237609", { -58919788343, 0x6FDC13C80957B836 } },
+    { "-3745444949582.092600267511253287046557210", { -3745444949583, 0xE84B594F70357731 } },
+    { "359.6183654610735873557063606071", { 359, 0x9E4D32E8497A0F6F } },
+    { "-32.3195545904544091031776467272", { -33, 0xAE31AB9CB62DFB47 } },
+    { "-3319191017.93557591836236107885261149131", { -3319191018, 0x107E18BBB55FD0F2 } },
+    { "263681671056726.26793814449454437323324935164", { 263681671056726, 0x4497981FF47A4275 } },
+    { "-33345509871332249.170107375043103993158279401995", { -33345509871332250, 0xD473D7D361A77A54 } },
+    { "-156079182669.034093056529413078716168281264", { -156079182670, 0xF745AD6D2F7C600D } },
+    { "7163193454.6049566053663062611695722008261", { 7163193454, 0x9ADE6FA38C269142 } },
+    { "-557217241251.2254282116734207509619239693729", { -557217241252, 0xC64A563344531027 } },
+    { "-9113656672306.26512330805169784649366578720097", { -9113656672307, 0xBC20E0FE82B845B5 } },
+    { "-696453701370430.72761125651788002158108620191327", { -696453701370431, 0x45BB44C90DE2927E } },
+    { "719463.315942594724873949835503262456241", { 719463, 0x50E19D27C1B81F4A } },
+    { "-81.578891486546592551732904844950032", { -82, 0x6BCDC47D597CD492 } },
+    { "-72152949557362.5027390000954185836949235972203271", { -72152949557363, 0x7F4C7F342A9B91D1 } },
+    { "87224.4640085997987320008062320109832638", { 87224, 0x76C9448132C430B5 } },
+    { "-92459975670556101.69284140780667172314301540486844318", { -92459975670556102, 0x4EA1F20C27DEF5E9 } },
+    { "971416938.33253659368778006394369919220011925", { 971416938, 0x55211E429CBCC541 } },
+    { "0.020101953816133310014712134556405440", { 0, 0x052566D239DACE52 } },
+    { "356097173639.987490606815708931942608340057172795", { 356097173639, 0xFCCC2F3561733B93 } },
+    { "-83299641989598332.2433721178155166160534468826372899059", { -83299641989598333, 0xC1B25D69395E6EAC } },
+    { "59022.8527749325738344922359852353412136224", { 59022, 0xDA4F753E40D34DEE } },
+    { "27609225829024.11436700663847024960369963932176541636", { 27609225829024, 0x1D4727F940EEDA89 } },
+    { "262207.67709682506710483238519783780585673268", { 262207, 0xAD5637AFE37E73D0 } },
+    { "-5824.044660016659413468367322137832567482753", { -5825, 0xF4912941024E15C4 } },
+    { "-4461128634951.627045345776915246019528590031449192327", { -4461128634952, 0x5F79F4CAC7758AE3 } },
+    { "27333.6829918437381718146327780772737289025797", { 27333, 0xAED88DB04A49E9DC } },
+    { "479423039880512.6125009051877203625155788346564804457658", { 479423039880512, 0x9CCCDBFC8D394ECD } },
+    { "94331913784435694.71535429106868906410037908896929130721206", { 94331913784435694, 0xB7217575317B1676 } },
+    { "5.24844260506990798016967106992768117320600", { 5, 0x3F99EF3FB5530E14 } },
+    { "-1444.312704937205214877400000916449279055977221", { -1445, 0xAFF291B967E6FED6 } },
+    { "660295.676749544099590294963666937405446290429248", { 660295, 0xAD3F75477D9B3E70 } },
+    { "-9629730484215774.1887633490673490678185136984857893333124599", { -9629730484215775, 0xCFAD348512827DFE } },
+    { "21474466498420597.3075157125905489010397993446179924053261000", { 21474466498420597, 0x4EB9598895218937 } },
+    { "-72266667897873.96114593186272533204508004870125034997175546", { -72266667897874, 0x09F25717F755A0E6 } },
+    { "-3036814091779077.73207302319527160175537152530278272466320494", { -3036814091779078, 0x4496DCC317AB656E } },
+    { "-273334.715771280387414356433164620420785827084256063", { -273335, 0x48C3369F51EC1E48 } },
+    { "-144781.283239119742329394301860855471067243295025990", { -144782, 0xB77DA41BC24520AF } },
+    { "-580546300150822.1153569041778088203139221448001340997837151204", { -580546300150823, 0xE277F84D3041E2F0 } },
+    { "-9020808227565001.4111628933297620669980605563569568058253605182", { -9020808227565002, 0x96BE0753D1E748F5 } },
+    { "-71039621440273.03266700094948091418063041452109841798271824694", { -71039621440274, 0xF7A322AB4379E1DB } },
+    { "758.84799363857849774035338869605235857443400281957", { 758, 0xD9161C70E92317C2 } },
+    { "-51033108243093898.183265523994817426106891769264991677454568896507", { -51033108243093899, 0xD11582B7F53C98BE } },
+    { "-9381117336.426969315593536000497484896886675095701831658689", { -9381117337, 0x92B223912158B8FA } },
+    { "-7066988.7679958125551482145862848383620991590600480461900", { -7066989, 0x3B64A05D9C565351 } },
+    { "-9966462028151104.9488293691228810112877960095235420419153796003690", { -9966462028151105, 0x0D1984BA2206A464 } },
+    { "-33464430.30292507469471369364670312256204685158656116583637", { -33464431, 0xB27380970C3FBBDF } },
+    { "58462080.04052321348287732553669347833724979583698321818460", { 58462080, 0x0A5FBAB4A345D61F } },
+    { "40735.061235311858431413426456724205560736512414930609263", { 40735, 0x0FAD1E0DCAD5BD41 } },
+    { "-49904.084293978469501409903105351669348156758780368273084", { -49905, 0xEA6BB5B739488D67 } },
+    { "-818791.3843025561342277330872542299351862297631405730044314", { -818792, 0x9D9E5901A260ADC1 } },
+    { "-2643.5779542810077159417673850514943120062452821495625535", { -2644, 0x6C0B30307D1938D2 } },
+    { "914131479228.43001960376724991232276107733500986241086517022640795", { 914131479228, 0x6E15C3C6D1B830B0 } },
+    { "9776801924861239.58768269910594996572458033712958965839764132381341384", { 9776801924861239, 0x96725F9515C6B96A } },
+    { "74359473.738918991617288818176823971259063050093741261939152550", { 74359473, 0xBD29CB8763B9C944 } },
+    { "3920.588570951585910345370971071142284629484700527870012996", { 3920, 0x96AC95FC6FE4C12C } },
+    { "726578.7639815583429903257597655059753037902246418459989208136", { 726578, 0xC3944B9FD48BE14A } },
+    { "5945.4321455835865055785335223076769429124449851391924957561", { 5945, 0x6EA117CC9D6880E5 } },
+    { "-25336466071.44802430306739481330290119520348050355076952060195796470", { -25336466072, 0x8D4E477E832928D0 } },
+    { "-88322305783.50695210232815565898299539470487845884240871523610921088", { -88322305784, 0x7E386313DCB449DD } },
+    { "-271699.952228053773567350101650396663040463353564473927424415073", { -271700, 0x0C3AC842B573D746 } },
+    { "652148745048211.035072624012024285127616565093300289396100511172860238288", { 652148745048211, 0x08FA84FD1DD6214B } },
+    { "11144073984301527.5331420441038068540507848564665866266620398496331190068578", { 11144073984301527, 0x887BFF3B8C669179 } },
+    { "650442610287178.0778598636516849518394475897932185838253227205656162461558", { 650442610287178, 0x13EE9FC00E14DF9A } },
+    { "-99079149874356.46471772820257839585640830940924845434718713264950765046694", { -99079149874357, 0x8908424B7F9E47F2 } },
+    { "3369911036637.95135117668670199776672176728033680485671131901713970357086", { 3369911036637, 0xF38BC02EE168A04C } },
+    { "53339.025538028484156448686044366844320385779255378050816950437433", { 53339, 0x0689A90524CE0186 } },
+    { "-500890801902696.330261021972082734382238171310634762020274395824458323605624", { -500890801902697, 0xAB74037F7C829016 } },
+    { "107902333214955382.3722656105138814750713744998132743940991053240255773552141871", { 107902333214955382, 0x5F4CCC8E9524ECF2 } },
+    { "2643.9670008916269515252150742411312748815732980845346832388310107", { 2643, 0xF78D5ED4BD97C464 } },
+    { "3846377.12240669814911933398031951039245179205660132822523335107078519", { 3846377, 0x1F560B9D5C9FA9D7 } },
+    { "-844305.56159277244079266849811433397837906656613596404790176694725831", { -844306, 0x703B74C0B2632620 } },
+    { "-36668795577536.451427683130626452523596475893268002137945188624618957445468077", { -36668795577537, 0x8C6F3C4071E585D8 } },
+    { "0.186748297057204239980629434806861675452970852380248240946524473", { 0, 0x2FCEBC8471C33B5C } },
+    { "-122077586656546.4565674139786250248786146568414700894595431819614221665667552288", { -122077586656547, 0x8B1E65E08AE2159F } },
+    { "-573656767.5161809396639422338140642694199849334159150811530727480798900871", { -573656768, 0x7BDB90E15327546F } },
+    { "2441482178.38349803208465141916689630585417926797359316243180733438409015360", { 2441482178, 0x622CED51E249AA69 } },
+    { "643046065217983499.52955410256071512577155721894863540348662622013986001703981559877", { 643046065217983499, 0x8790DB8FF5FDA0FE } },
+    { "-123089.335611923779971907263779217961330693031300706330896402707112282985", { -123090, 0xAA15564337A5F369 } },
+    { "1267025069570.081889998108947608302873136191885113115444427995301101938676993100", { 1267025069570, 0x14F6BE2FBF57B122 } },
+    { "2.6029474244505612727954306805385503518210565518172380836813340461297", { 2, 0x9A5AC32D38FBC098 } },
+    { "724186.4635401349921916411180151281784721446627175530631355490311294420271", { 724186, 0x76AA90F82CC57B05 } },
+    { "-49.41993014042558225455281324603336537400165340777117871617723670131457", { -50, 0x947F75544476BB33 } },
+    { "6677763126.18373996106803828531174772175134511774280807083792526505230971730472", { 6677763126, 0x2F099503C16AEAA0 } },
+    { "7511595489.931602057317587393373474350625609523029497788624381462282950236219764", { 7511595489, 0xEE7D78F110BB20A9 } },
+    { "-20235088.461061041422618648917378958836194962436584109735077527536138662355675", { -20235089, 0x89F7E751A1519D4F } },
+    { "-85872229.3410826961797598556527026514833935442197903098684010213023243001113275", { -85872230, 0xA8AECDEEAD2A56A2 } },
+    { "-319202653552.6745014241190425587239802664034171192377391796203931734868850030384379", { -319202653553, 0x5353DFEA4DA430CA } },
+    { "214578.44220375465840951405832237035188578411196671483757658759017142082179041", { 214578, 0x713443E86D207528 } },
+    { "70597895861.12610042811528962326655137811467329476323718530487295525360039504900535", { 70597895861, 0x20481E1EC44AE5D5 } },
+    { "392816231.459566413069302244856642385052528087577355311150035191703764764975545919", { 392816231, 0x75A624FA79019087 } },
+    { "69755375897116020.760333585190799602612848513903562616354582788029682208195003808387283227", { 69755375897116020, 0xC2A538CA71E5E5DC } },
+    { "-84740289944098.4943638701052384382392391793468070711862572385633326596442371239518426779", { -84740289944099, 0x81715E9192F23E1E } },
+    { "506191271.8379828231561615655627980075866942802565993528862412095777458058857154699", { 506191271, 0xD6860AD410C25793 } },
+    { "-17993315.56158045472601330224330641128812630766129240102100521721239535165664737022", { -17993316, 0x703C4368E103CCAF } },
+    { "46008.07890789077095682088272620880563966579925634390955849529874170261964986019", { 46008, 0x14334EBA41F20F06 } },
+    { "-6167.419674175107431445388869475671024098256348077011037971459221284522373440329", { -6168, 0x94903BB6F013F745 } },
+    { "-645.689731675063778342818562277749518795251561279456982505371475957382539344391", { -646, 0x4F6DBEB495F53D3D } },
+    { "9280486.1388131413904061459086598209323131498566019614826500069862558255482222219124", { 9280486, 0x2389420E86DD9180 } },
+    { "-9182.7678003623035317966570307830923141515164187322465186290712048050183862336471", { -9183, 0x3B716F7A0CA42607 } },
+    { "789960465181457.36136184553453066612110834168743179741972217620290115303945256427720218632411", { 789960465181457, 0x5C8235BC97CFB0AC } },
+    { "-687.30205149589798348375255889394828066920844175873886844604753754751533645048055", { -688, 0xB2ACC0CF69084AE7 } },
+    { "-85620009751526.843557127153470256746252225403502066325811478694066260515520933099934133379951", { -85620009751527, 0x280CA3DE917113D1 } },
+    { "-88115667167.918713374650315636359360884477700673992978621471473011125066874585218871548336", { -88115667168, 0x14CF33457AA639D4 } },
+    { "-84189802676.8944195158525152605360238756432725006356078738212248292854882791244438993759257", { -84189802677, 0x1B07529682610D53 } },
+    { "862092.0119909824128009371783235590255110910244413794800434187992687673344832460313757", { 862092, 0x0311D74D4F55078C } },
+    { "-3829321908516169.95632576282627833359144517469935604428899224167663126282536642129327983787103709", { -3829321908516170, 0x0B2E3C1C56C0F8FB } },
+    { "88722455419967.93925517124248109033314414724047353613015177033505668634619876987426630837938811", { 88722455419967, 0xF07306E315D893FC } },
+};
+
+static int parses (const char text[], FixedPrec a) {
+    FixedPrec result;
+    unsigned int length = strlen (text);
+    return fpParseChars (text, length, &result) == length && fpEqual (result, a);
+}
+
+static void checkFormat (void) {
+    for (unsigned int ix = 0; ix < sizeof (formatCases) / sizeof (formatCases[0]); ix++) {
+        Text text = fpToText (formatCases[ix].a);
+        CHECK (strcmp (text.array, formatCases[ix].text) == 0);
+        CHECK (text.length == strlen (formatCases[ix].text));
+        freeText (text);
+    }
+}
+
+static void checkParse (void) {
+    for (unsigned int ix = 0; ix < sizeof (parseCases) / sizeof (parseCases[0]); ix++)
+        CHECK (parses (parseCases[ix].text, parseCases[ix].a));
+
+    FixedPrec a;
+
+    // Values stop at anything that isn't part of them.
+    CHECK (fpParseChars ("1.5,2", 5, &a) == 3 && fpEqual (a, newFixedPrec (1, 1ULL << 63)));
+    CHECK (fpParseChars ("-7.", 3, &a) == 2 && fpEqual (a, fpFromInt (-7)));
+    CHECK (fpParseChars ("+12e3", 5, &a) == 3 && fpEqual (a, fpFromInt (12)));
+    CHECK (fpParseChars ("2.25", 3, &a) == 3 && fpEqual (a, newFixedPrec (2, 0x3333333333333333)));
+
+    // Nothing to read, or out of range.
+    CHECK (fpParseChars ("", 0, &a) == 0);
+    CHECK (fpParseChars ("-", 1, &a) == 0);
+    CHECK (fpParseChars (".5", 2, &a) == 0);
+    CHECK (fpParseChars ("9223372036854775808", 19, &a) == 0);
+    CHECK (fpParseChars ("9223372036854775807.99999999999999999999", 40, &a) == 0);
+    CHECK (fpParseChars ("-9223372036854775808.00000000000000000003", 41, &a) == 0);
+    CHECK (fpParseChars ("99999999999999999999999", 23, &a) == 0);
+    CHECK (parses ("9223372036854775807.99999999999999999994", fpMax));
+
+    CHECK (fpFromText (textFromString ("-16.5"), &a) && fpEqual (a, newFixedPrec (-17, 1ULL << 63)));
+
+    printf ("expected errors follow\n");
+    CHECK (!fpFromText (textFromString ("16.5 "), &a) && fpEqual (a, fpFromInt (0)));
+    CHECK (!fpFromText (textFromString (""), &a));
+}
+
+// Random values print as the fewest digits that read back as the same
+// value: dropping the last digit, rounding either way, doesn't work.
+//
+static void checkRoundTrip (void) {
+    uint64_t seed = 3;
+
+    for (unsigned int ix = 0; ix < 200000; ix++) {
+        uint64_t bits = nextRandom (&seed);
+        FixedPrec a = newFixedPrec
+            ( (int64_t) (ix % 4 == 0 ? bits : bits >> (bits & 63))
+            , ix % 3 == 0 ? nextRandom (&seed) >> (bits & 63) << (bits & 63) : nextRandom (&seed) );
+
+        char text[FP_TEXT_MAX + 1];
+        unsigned int length = fpFormatChars (a, text);
+        text[length] = '\0';
+
+        CHECK (length <= FP_TEXT_MAX);
+        CHECK (parses (text, a));
+
+        char *point = strchr (text, '.');
+        if (!point || text + length - point < 3)
+            continue;
+
+        CHECK (text[length - 1] != '0');
+
+        // Drop the last digit, then round the rest up by one.
+        text[--length] = '\0';
+        int shorterDown = parses (text, a);
+
+        unsigned int jx = length - 1;
+        while (text[jx] == '9')
+            text[jx--] = '0';
+        if (text[jx] != '.')
+            text[jx]++;
+        int shorterUp = text[jx] != '.' && parses (text, a);
+
+        CHECK (!shorterDown && !shorterUp);
+    }
+}
+
+static void checkArray (void) {
+    FixedPrec values[1000];
+    uint64_t seed = 9;
+
+    for (unsigned int ix = 0; ix < 1000; ix++)
+        values[ix] = newFixedPrec ((int64_t) nextRandom (&seed) >> 40, nextRandom (&seed));
+
+    Text text = fpArrayToText (values, 1000, '\n');
+    CHECK (strlen (text.array) == text.length);
+
+    unsigned int offset = 0;
+    for (unsigned int ix = 0; ix < 1000; ix++) {
+        FixedPrec a = fpFromInt (0);
+        unsigned int length = fpParseChars (text.array + offset, text.length - offset, &a);
+        CHECK (length > 0 && fpEqual (a, values[ix]));
+        CHECK (text.array[offset + length] == '\n');
+        offset += length + 1;
+    }
+
+    CHECK (offset == text.length);
+    freeText (text);
+
+    text = fpArrayToText (values, 0, ' ');
+    CHECK (text.length == 0 && text.array[0] == '\0');
+    freeText (text);
+}
+
+int main (void) {
+    checkFormat ();
+    checkParse ();
+    checkRoundTrip ();
+    checkArray ();
+
+    return checkReport ();
+}
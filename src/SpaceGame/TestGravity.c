@@ -0,0 +1,162 @@
+
+#include <math.h>
+#include <stdio.h>
+
+#include "Bench.h"
+#include "FixedPrecision.h"
+#include "Newtonian.h"
+#include "BodySystem.h"
+#include "Gravity.h"
+
+
+
+// Random coordinate. Every few bodies are far out, so that separations
+// with more than 53 significant bits get converted too.
+//
+static FixedPrec randomCoord (uint64_t *seed) {
+    uint64_t r = nextRandom (seed);
+    int far = r % 8 == 0;
+
+    return newFixedPrec
+        ( far ? (int64_t) nextRandom (seed) >> 8 : (int64_t) (r >> 32) % 1000
+        , nextRandom (seed) );
+}
+
+static BodySystem randomSystem (unsigned int numBodies, uint64_t seed) {
+    BodySystem system = newBodySystem (numBodies);
+
+    for (unsigned int ix = 0; ix < numBodies; ix++) {
+        Newtonian newt = {
+            .mass = newFixedPrec (nextRandom (&seed) % 100, nextRandom (&seed)),
+            .position = {
+                randomCoord (&seed), randomCoord (&seed), randomCoord (&seed)
+            }
+        };
+
+        addBody (&system, newt);
+    }
+
+    return system;
+}
+
+static int sameAccelerations (const BodySystem *a, const BodySystem *b) {
+    for (unsigned int ix = 0; ix < a->numBodies; ix++)
+        if (!fpEqual (getColumn (a->accX, ix), getColumn (b->accX, ix)) ||
+            !fpEqual (getColumn (a->accY, ix), getColumn (b->accY, ix)) ||
+            !fpEqual (getColumn (a->accZ, ix), getColumn (b->accZ, ix)))
+            return 0;
+
+    return 1;
+}
+
+static void checkConversions (void) {
+    FixedPrec minus16Half = newFixedPrec (-17, 0x8000000000000000);
+
+    CHECK (fpToDouble (minus16Half) == -16.5);
+    CHECK (fpEqual (fpFromDouble (-16.5), minus16Half));
+    CHECK (fpEqual (fpFromDouble (0x1p-64), newFixedPrec (0, 1)));
+    CHECK (fpEqual (fpFromDouble (0x1p-65), fpFromInt (0)));
+    CHECK (fpEqual (fpFromDouble (-0.0), fpFromInt (0)));
+    CHECK (fpEqual (fpFromDouble (0x1p70), fpMax));
+    CHECK (fpEqual (fpFromDouble (-INFINITY), fpNeg (fpMax)));
+    CHECK (fpEqual (fpFromDouble (0x1p62), fpFromInt (1LL << 62)));
+
+    // Anything with at most 53 significant bits makes the round trip.
+    uint64_t seed = 3;
+    for (unsigned int ix = 0; ix < 100000; ix++) {
+        FixedPrec a = newFixedPrec
+            ((int64_t) (nextRandom (&seed) % 4096) - 2048, nextRandom (&seed) << 24);
+
+        CHECK (fpEqual (fpFromDouble (fpToDouble (a)), a));
+    }
+}
+
+// Every kernel must agree with the scalar one to the last bit, whatever
+// the number of bodies is relative to the vector width and tile size.
+//
+static void checkKernelsAgree (unsigned int numBodies) {
+    BodySystem
+        reference   = randomSystem (numBodies, numBodies),
+        other       = randomSystem (numBodies, numBodies);
+
+    computeAccelerationsWith (&reference, GRAVITY_KERNEL_SCALAR);
+
+    GravityKernel kernels[] = { GRAVITY_KERNEL_AVX2, GRAVITY_KERNEL_AVX512 };
+    for (unsigned int kIx = 0; kIx < 2; kIx++) {
+        if (bestGravityKernel (kernels[kIx]) != kernels[kIx]) {
+            printf ("skipping kernel %d: not supported\n", kernels[kIx]);
+            continue;
+        }
+
+        computeAccelerationsWith (&other, kernels[kIx]);
+        CHECK (sameAccelerations (&reference, &other));
+    }
+
+    freeBodySystem (reference);
+    freeBodySystem (other);
+}
+
+// The kernel should agree with the exact fixed-point 'gravity' to about
+// double precision, for bodies far enough apart not to feel softening.
+//
+static void checkAgainstGravity (void) {
+    BodySystem system = newBodySystem (8);
+    uint64_t seed = 7;
+
+    for (unsigned int ix = 0; ix < 40; ix++) {
+        Newtonian newt = {
+            .mass = newFixedPrec (1 + nextRandom (&seed) % 10, nextRandom (&seed)),
+            .position = {
+                newFixedPrec ((int64_t) (ix % 4) * 50, nextRandom (&seed)),
+                newFixedPrec ((int64_t) (ix / 4 % 4) * 50, nextRandom (&seed)),
+                newFixedPrec ((int64_t) (ix / 16) * 50, nextRandom (&seed))
+            }
+        };
+
+        addBody (&system, newt);
+    }
+
+    computeAccelerations (&system);
+
+    for (unsigned int i = 0; i < system.numBodies; i++) {
+        Newtonian newtI = gatherBody (&system, i);
+        double expected[3] = { 0, 0, 0 };
+
+        for (unsigned int j = 0; j < system.numBodies; j++) {
+            if (j == i)
+                continue;
+
+            Vec3FixedPrec force = gravity (newtI, gatherBody (&system, j));
+            double mass = fpToDouble (newtI.mass);
+
+            expected[0] += fpToDouble (force.x) / mass;
+            expected[1] += fpToDouble (force.y) / mass;
+            expected[2] += fpToDouble (force.z) / mass;
+        }
+
+        double
+            actual[3] = {
+                fpToDouble (getColumn (system.accX, i)),
+                fpToDouble (getColumn (system.accY, i)),
+                fpToDouble (getColumn (system.accZ, i))
+            },
+            scale = fabs (expected[0]) + fabs (expected[1]) + fabs (expected[2]);
+
+        for (unsigned int axis = 0; axis < 3; axis++)
+            CHECK (fabs (actual[axis] - expected[axis]) <= 1e-9 * scale);
+    }
+
+    freeBodySystem (system);
+}
+
+int main (void) {
+    checkConversions ();
+
+    unsigned int sizes[] = { 0, 1, 2, 3, 5, 8, 9, 17, 255, 256, 257, 600 };
+    for (unsigned int ix = 0; ix < sizeof (sizes) / sizeof (sizes[0]); ix++)
+        checkKernelsAgree (sizes[ix]);
+
+    checkAgainstGravity ();
+
+    return checkReport ();
+}
@@ -0,0 +1,175 @@
+
+#include <math.h>
+#include <stdio.h>
+
+#include "Bench.h"
+#include "FixedPrecision.h"
+#include "Newtonian.h"
+#include "BodySystem.h"
+#include "Gravity.h"
+#include "Integrator.h"
+
+
+
+static Newtonian bodyAt (double mass, double x, double y, double vx, double vy) {
+    return (Newtonian) {
+        .mass       = fpFromDouble (mass),
+        .position   = { fpFromDouble (x), fpFromDouble (y), fpFromInt (0) },
+        .velocity   = { fpFromDouble (vx), fpFromDouble (vy), fpFromInt (0) }
+    };
+}
+
+static double totalEnergy (const BodySystem *system) {
+    return kineticEnergy (system) + potentialEnergy (system);
+}
+
+static double distance (const BodySystem *system, unsigned int a, unsigned int b) {
+    double
+        dx = fpToDouble (fpSub (getColumn (system->posX, a), getColumn (system->posX, b))),
+        dy = fpToDouble (fpSub (getColumn (system->posY, a), getColumn (system->posY, b))),
+        dz = fpToDouble (fpSub (getColumn (system->posZ, a), getColumn (system->posZ, b)));
+
+    return sqrt (dx * dx + dy * dy + dz * dz);
+}
+
+// A star, a planet with a moon in a tight orbit around it, and a belt of
+// asteroids far out: timescales from about 6 to 6000.
+//
+static BodySystem mixedSystem (unsigned int numAsteroids) {
+    BodySystem system = newBodySystem (3 + numAsteroids);
+    uint64_t seed = 7;
+
+    addBody (&system, bodyAt (1000, 0, 0, 0, 0));
+    addBody (&system, bodyAt (1, 100, 0, 0, sqrt (10)));
+    addBody (&system, bodyAt (0.001, 101, 0, 0, sqrt (10) + 1));
+
+    for (unsigned int ix = 0; ix < numAsteroids; ix++) {
+        double
+            radius  = 1000 + 1000 * ((nextRandom (&seed) >> 11) * 0x1p-53),
+            angle   = 6.283185307179586 * ((nextRandom (&seed) >> 11) * 0x1p-53),
+            speed   = sqrt (1000 / radius);
+
+        addBody (&system, bodyAt
+            ( 1e-6
+            , radius * cos (angle), radius * sin (angle)
+            , -speed * sin (angle), speed * cos (angle) ));
+    }
+
+    return system;
+}
+
+static int sameState (const BodySystem *a, const BodySystem *b) {
+    for (unsigned int ix = 0; ix < a->numBodies; ix++)
+        if (!fpEqual (getColumn (a->posX, ix), getColumn (b->posX, ix)) ||
+            !fpEqual (getColumn (a->posY, ix), getColumn (b->posY, ix)) ||
+            !fpEqual (getColumn (a->posZ, ix), getColumn (b->posZ, ix)) ||
+            !fpEqual (getColumn (a->velX, ix), getColumn (b->velX, ix)) ||
+            !fpEqual (getColumn (a->velY, ix), getColumn (b->velY, ix)) ||
+            !fpEqual (getColumn (a->velZ, ix), getColumn (b->velZ, ix)))
+            return 0;
+
+    return 1;
+}
+
+// Forces on a subset of bodies are the same as from a full pass, bit for
+// bit, and the other bodies' are left alone.
+//
+static void checkSubset (GravitySolver solver) {
+    BodySystem
+        full = mixedSystem (200),
+        part = mixedSystem (200);
+
+    full.gravitySolver = part.gravitySolver = solver;
+    computeAccelerations (&full);
+
+    uint32_t active[100];
+    unsigned int numActive = 0;
+    for (unsigned int ix = 0; ix < part.numBodies; ix += 3)
+        active[numActive++] = ix;
+
+    computeAccelerationsFor (&part, active, numActive);
+
+    for (unsigned int ix = 0; ix < part.numBodies; ix++) {
+        int same =
+            fpEqual (getColumn (full.accX, ix), getColumn (part.accX, ix)) &&
+            fpEqual (getColumn (full.accY, ix), getColumn (part.accY, ix)) &&
+            fpEqual (getColumn (full.accZ, ix), getColumn (part.accZ, ix));
+
+        if (ix % 3 == 0)
+            CHECK (same);
+        else
+            CHECK (fpEqual (getColumn (part.accX, ix), fpFromInt (0)));
+    }
+
+    freeBodySystem (full);
+    freeBodySystem (part);
+}
+
+int main (void) {
+    // Forces change velocities by 'F dt / m'.
+    Newtonian newt = bodyAt (4, 0, 0, 1, 0);
+    Vec3FixedPrec force = { fpFromInt (2), fpFromInt (-8), fpFromInt (0) };
+    newt = applyForce (force, fpFromDouble (0.5), newt);
+    CHECK (fpEqual (newt.velocity.x, fpFromDouble (1.25)));
+    CHECK (fpEqual (newt.velocity.y, fpFromInt (-1)));
+
+    checkSubset (GRAVITY_SOLVER_DIRECT);
+    checkSubset (GRAVITY_SOLVER_TREE);
+
+    // Two equal bodies in a circular orbit keep their energy and distance.
+    BodySystem binary = newBodySystem (2);
+    addBody (&binary, bodyAt (1, -1, 0, 0, -0.5));
+    addBody (&binary, bodyAt (1, 1, 0, 0, 0.5));
+
+    Integrator integrator = newIntegrator (fpFromInt (1), 8);
+    double startEnergy = totalEnergy (&binary);
+
+    for (unsigned int step = 0; step < 20; step++)
+        integrate (&integrator, &binary);
+
+    CHECK (fpEqual (integrator.time, fpFromInt (20)));
+    CHECK (fabs (totalEnergy (&binary) / startEnergy - 1) < 1e-5);
+    CHECK (fabs (distance (&binary, 0, 1) - 2) < 1e-3);
+    CHECK (binary.timeLevels[0] == binary.timeLevels[1]);
+    CHECK (binary.timeLevels[0] > 0 && binary.timeLevels[0] < 8);
+
+    freeBodySystem (binary);
+
+    // Bodies with very different timescales get very different steps.
+    BodySystem
+        mixed = mixedSystem (50),
+        again = mixedSystem (50);
+
+    Integrator
+        mixedInt = newIntegrator (fpFromInt (8), 12),
+        againInt = newIntegrator (fpFromInt (8), 12);
+
+    startEnergy = totalEnergy (&mixed);
+
+    for (unsigned int step = 0; step < 25; step++) {
+        integrate (&mixedInt, &mixed);
+        integrate (&againInt, &again);
+    }
+
+    // Same start, same result.
+    CHECK (sameState (&mixed, &again));
+    CHECK (mixedInt.forceEvaluations == againInt.forceEvaluations);
+
+    // The moon steps much more finely than the asteroids.
+    CHECK (mixed.timeLevels[2] >= mixed.timeLevels[1] + 3);
+    for (unsigned int ix = 3; ix < mixed.numBodies; ix++)
+        CHECK (mixed.timeLevels[ix] + 5 <= mixed.timeLevels[2]);
+
+    // Everything at the moon's level would cost at least ten times more.
+    uint64_t uniform = (uint64_t) 25 * mixed.numBodies << mixed.timeLevels[2];
+    CHECK (mixedInt.forceEvaluations * 10 <= uniform);
+
+    CHECK (distance (&mixed, 1, 2) < 1.5);
+    CHECK (fabs (distance (&mixed, 0, 1) - 100) < 1);
+    CHECK (fabs (totalEnergy (&mixed) / startEnergy - 1) < 5e-4);
+
+    freeBodySystem (mixed);
+    freeBodySystem (again);
+
+    return checkReport ();
+}
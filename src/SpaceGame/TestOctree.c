@@ -0,0 +1,224 @@
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Bench.h"
+#include "FixedPrecision.h"
+#include "Newtonian.h"
+#include "BodySystem.h"
+#include "Gravity.h"
+#include "Octree.h"
+#include "ThreadPool.h"
+
+
+
+static ThreadPool *pool;
+
+// Clustered bodies: a few dense clumps at random places, so the tree
+// gets both deep and shallow branches. 'scale' is the size of the system
+// as a shift of the unit, so tiny systems can be tested too.
+//
+static BodySystem clusteredSystem (unsigned int numBodies, int scale, uint64_t seed) {
+    BodySystem system = newBodySystem (numBodies);
+    FixedPrec centres[4][3];
+
+    for (unsigned int clump = 0; clump < 4; clump++)
+    for (unsigned int axis = 0; axis < 3; axis++)
+        centres[clump][axis] = fpFromBits (shr128u
+            (newUInt128 (nextRandom (&seed) >> 1, 0), 64 - scale));
+
+    for (unsigned int ix = 0; ix < numBodies; ix++) {
+        unsigned int clump = nextRandom (&seed) % 4;
+        FixedPrec offset[3];
+
+        for (unsigned int axis = 0; axis < 3; axis++)
+            offset[axis] = fpFromBits (shr128u
+                (newUInt128 (nextRandom (&seed) >> 1, nextRandom (&seed)), 68 - scale));
+
+        Newtonian newt = {
+            .mass = newFixedPrec (nextRandom (&seed) % 100, nextRandom (&seed)),
+            .position = {
+                fpAdd (centres[clump][0], offset[0]),
+                fpAdd (centres[clump][1], offset[1]),
+                fpAdd (centres[clump][2], offset[2])
+            }
+        };
+
+        addBody (&system, newt);
+    }
+
+    return system;
+}
+
+typedef struct Accelerations Accelerations;
+
+struct Accelerations {
+    double *x, *y, *z;
+};
+
+static Accelerations saveAccelerations (const BodySystem *system) {
+    Accelerations acc = {
+        malloc ((system->numBodies + 1) * sizeof (double)),
+        malloc ((system->numBodies + 1) * sizeof (double)),
+        malloc ((system->numBodies + 1) * sizeof (double))
+    };
+
+    for (unsigned int ix = 0; ix < system->numBodies; ix++) {
+        acc.x[ix] = fpToDouble (getColumn (system->accX, ix));
+        acc.y[ix] = fpToDouble (getColumn (system->accY, ix));
+        acc.z[ix] = fpToDouble (getColumn (system->accZ, ix));
+    }
+
+    return acc;
+}
+
+static void freeAccelerations (Accelerations acc) {
+    free (acc.x);
+    free (acc.y);
+    free (acc.z);
+}
+
+// Error of the body system's accelerations against 'exact', as the RMS
+// of the error vectors relative to the RMS acceleration. A few bodies in
+// near-balance always have large relative errors, so the largest one
+// isn't much of a measure.
+//
+static double rmsError (const BodySystem *system, Accelerations exact) {
+    Accelerations acc = saveAccelerations (system);
+    double sumErr2 = 0, sumAcc2 = 0;
+
+    for (unsigned int ix = 0; ix < system->numBodies; ix++) {
+        double
+            ex = acc.x[ix] - exact.x[ix],
+            ey = acc.y[ix] - exact.y[ix],
+            ez = acc.z[ix] - exact.z[ix];
+
+        sumErr2 += ex * ex + ey * ey + ez * ez;
+        sumAcc2 += exact.x[ix] * exact.x[ix] + exact.y[ix] * exact.y[ix] +
+            exact.z[ix] * exact.z[ix];
+    }
+
+    freeAccelerations (acc);
+    return sumAcc2 > 0 ? sqrt (sumErr2 / sumAcc2) : 0;
+}
+
+static int sameAccelerations (const BodySystem *a, const BodySystem *b) {
+    for (unsigned int ix = 0; ix < a->numBodies; ix++)
+        if (!fpEqual (getColumn (a->accX, ix), getColumn (b->accX, ix)) ||
+            !fpEqual (getColumn (a->accY, ix), getColumn (b->accY, ix)) ||
+            !fpEqual (getColumn (a->accZ, ix), getColumn (b->accZ, ix)))
+            return 0;
+
+    return 1;
+}
+
+// Every body is in exactly one leaf, nodes' ranges nest, and every
+// node's mass is the sum of its children's.
+//
+static void checkStructure (const Octree *tree) {
+    unsigned int covered = 0;
+
+    for (unsigned int nodeIx = 0; nodeIx < tree->numNodes; nodeIx++) {
+        const OctreeNode *node = &tree->nodes[nodeIx];
+
+        if (!node->numChildren) {
+            covered += node->end - node->begin;
+            continue;
+        }
+
+        double gravMass = 0;
+        uint32_t next = node->begin;
+
+        for (unsigned int child = 0; child < node->numChildren; child++) {
+            const OctreeNode *childNode = &tree->nodes[node->firstChild + child];
+
+            CHECK (childNode->begin == next && childNode->end > childNode->begin);
+            CHECK (childNode->size == node->size / 2);
+            next = childNode->end;
+            gravMass += childNode->gravMass;
+        }
+
+        CHECK (next == node->end);
+        CHECK (fabs (gravMass - node->gravMass) <= 1e-12 * node->gravMass);
+    }
+
+    CHECK (covered == tree->numBodies);
+
+    for (unsigned int rank = 1; rank < tree->numBodies; rank++)
+        CHECK (tree->keys[rank - 1] <= tree->keys[rank]);
+}
+
+static void checkSystem (unsigned int numBodies, int scale, uint64_t seed) {
+    BodySystem system = clusteredSystem (numBodies, scale, seed);
+
+    GravityPass pass;
+    Octree serial, parallel;
+
+    CHECK (newGravityPass (&pass, &system, GRAVITY_KERNEL_AUTO));
+    CHECK (buildOctree (&serial, &pass, NULL));
+    CHECK (buildOctree (&parallel, &pass, pool));
+
+    checkStructure (&serial);
+
+    // Threads don't change the tree.
+    CHECK (serial.numNodes == parallel.numNodes);
+    CHECK (memcmp (serial.nodes, parallel.nodes, serial.numNodes * sizeof (OctreeNode)) == 0);
+    CHECK (memcmp (serial.order, parallel.order, numBodies * sizeof (uint32_t)) == 0);
+
+    freeOctree (serial);
+    freeOctree (parallel);
+    freeGravityPass (pass);
+
+    BodySystem direct = clusteredSystem (numBodies, scale, seed);
+    computeAccelerationsWith (&direct, GRAVITY_KERNEL_AUTO);
+    Accelerations exact = saveAccelerations (&direct);
+
+    // Opening every node is direct summation in another order, and
+    // integer sums don't care about order.
+    computeTreeAccelerations (&system, 0);
+    CHECK (sameAccelerations (&system, &direct));
+
+    // The usual opening angle is good to a fraction of a percent.
+    computeTreeAccelerations (&system, 0.5);
+    CHECK (rmsError (&system, exact) < 0.01);
+
+    freeAccelerations (exact);
+    freeBodySystem (direct);
+    freeBodySystem (system);
+}
+
+int main (void) {
+    pool = newThreadPool (4);
+
+    checkSystem (0, 20, 1);
+    checkSystem (1, 20, 1);
+    checkSystem (10, 20, 2);
+    checkSystem (500, 20, 3);
+    checkSystem (3000, 30, 4);
+
+    // All within a fraction of a unit, so the codes come from 'decPart'.
+    checkSystem (3000, -8, 5);
+
+    // Past the threshold for building with threads.
+    checkSystem (OCTREE_PARALLEL_THRESHOLD + 100, 30, 6);
+
+    // The solver can be switched per body system.
+    BodySystem
+        system = clusteredSystem (300, 20, 7),
+        direct = clusteredSystem (300, 20, 7);
+
+    computeAccelerations (&direct);
+
+    system.gravitySolver = GRAVITY_SOLVER_TREE;
+    system.openingAngle = 0;
+    computeAccelerations (&system);
+    CHECK (sameAccelerations (&system, &direct));
+
+    freeBodySystem (system);
+    freeBodySystem (direct);
+    freeThreadPool (pool);
+
+    return checkReport ();
+}
@@ -0,0 +1,235 @@
+
+#include <math.h>
+#include <stdio.h>
+
+#include "Bench.h"
+#include "FixedPrecision.h"
+#include "Newtonian.h"
+#include "BodySystem.h"
+#include "Gravity.h"
+#include "FixedMath.h"
+#include "Integrator.h"
+#include "Planet.h"
+
+
+
+static double randomUnit (uint64_t *seed) {
+    return (nextRandom (seed) >> 11) * 0x1p-53;
+}
+
+static double length (double x, double y, double z) {
+    return sqrt (x * x + y * y + z * z);
+}
+
+// Position and velocity of 'newt' relative to 'origin', as doubles.
+//
+static void relativeState (Newtonian newt, Newtonian origin, double pos[3], double vel[3]) {
+    pos[0] = fpToDouble (fpSub (newt.position.x, origin.position.x));
+    pos[1] = fpToDouble (fpSub (newt.position.y, origin.position.y));
+    pos[2] = fpToDouble (fpSub (newt.position.z, origin.position.z));
+    vel[0] = fpToDouble (fpSub (newt.velocity.x, origin.velocity.x));
+    vel[1] = fpToDouble (fpSub (newt.velocity.y, origin.velocity.y));
+    vel[2] = fpToDouble (fpSub (newt.velocity.z, origin.velocity.z));
+}
+
+// Kepler's equation is solved to within rounding everywhere, including
+// the nearly parabolic orbits where a poor start diverges.
+//
+static double keplerError (FixedPrec ecc, FixedPrec e, FixedPrec m) {
+    FixedPrec f = fpSub (fpSub (ecc, fpMul (e, fpSin (ecc))), m);
+    return fabs (remainder (fpToDouble (f), 6.283185307179586));
+}
+
+static void checkKepler (void) {
+    double worst = 0;
+
+    for (unsigned int eIx = 0; eIx <= 1000; eIx++)
+    for (int mIx = -200; mIx <= 200; mIx++) {
+        FixedPrec
+            e   = fpFromDouble (eIx < 1000 ? eIx * 0.001 : 0.999999),
+            m   = fpDiv (fpMul (fpFromInt (mIx), fpPi), fpFromInt (200)),
+            ecc = solveKepler (m, e);
+
+        double err = keplerError (ecc, e, m);
+        if (err > worst)
+            worst = err;
+    }
+
+    CHECK (worst < 1e-18);
+
+    // Mean anomalies outside '[-pi, pi]' wrap around.
+    FixedPrec
+        e   = fpFromDouble (0.3),
+        m   = fpAdd (fpFromDouble (0.5), fpMul (fpFromInt (6), fpTwoPi)),
+        ecc = solveKepler (m, e);
+
+    CHECK (fpLessThan (fpAbs (ecc), fpPi) && keplerError (ecc, e, fpFromDouble (0.5)) < 1e-18);
+}
+
+// Orbits have the sizes, speeds and periods they should, wherever and
+// whenever they're evaluated.
+//
+static void checkOrbits (void) {
+    uint64_t seed = 11;
+
+    Planet star = newPlanet (fpFromInt (1000), NULL, (OrbitalElements) { 0 });
+
+    for (unsigned int trial = 0; trial < 200; trial++) {
+        OrbitalElements elements = {
+            .semiMajorAxis          = 10 + 1000 * randomUnit (&seed),
+            .eccentricity           = trial < 20 ? 0 : 0.99 * randomUnit (&seed),
+            .inclination            = 3.14 * randomUnit (&seed),
+            .ascendingNode          = 6.28 * randomUnit (&seed),
+            .argumentOfPeriapsis    = 6.28 * randomUnit (&seed),
+            .meanAnomaly            = 6.28 * randomUnit (&seed),
+            .epoch                  = fpFromDouble (100 * randomUnit (&seed))
+        };
+
+        Planet planet = newPlanet (fpFromDouble (1e-3), &star, elements);
+
+        double
+            a   = elements.semiMajorAxis,
+            e   = elements.eccentricity,
+            mu  = NEWTONIAN_G * (1000 + 1e-3),
+            t   = 1e6 * randomUnit (&seed);
+
+        double pos[3], vel[3];
+        relativeState
+            ( planetAt (&planet, fpFromDouble (t))
+            , planetAt (&star, fpFromDouble (t)), pos, vel );
+
+        double
+            r = length (pos[0], pos[1], pos[2]),
+            v = length (vel[0], vel[1], vel[2]),
+            // Specific angular momentum
+            hx = pos[1] * vel[2] - pos[2] * vel[1],
+            hy = pos[2] * vel[0] - pos[0] * vel[2],
+            hz = pos[0] * vel[1] - pos[1] * vel[0];
+
+        // Vis-viva, and the angular momentum of the ellipse.
+        CHECK (fabs (v * v - mu * (2 / r - 1 / a)) < 1e-9 * mu / a);
+        CHECK (fabs (length (hx, hy, hz) - sqrt (mu * a * (1 - e * e))) < 1e-9 * sqrt (mu * a));
+        CHECK (r >= a * (1 - e) * (1 - 1e-12) && r <= a * (1 + e) * (1 + 1e-12));
+
+        if (e == 0)
+            CHECK (fabs (r - a) < 1e-9 * a);
+
+        // The orbit's plane is set by the inclination.
+        CHECK (fabs (hz / length (hx, hy, hz) - cos (elements.inclination)) < 1e-9);
+
+        // A whole period on, it's back where it was, even a billion
+        // periods on.
+        FixedPrec
+            now     = fpFromDouble (t),
+            later   = fpAdd (now, planet.period),
+            much    = fpAdd (now, fpMul (fpFromInt (1000000000), planet.period));
+
+        double posLater[3], posMuch[3];
+        relativeState (planetAt (&planet, later), planetAt (&star, later), posLater, vel);
+        relativeState (planetAt (&planet, much), planetAt (&star, much), posMuch, vel);
+
+        CHECK (length (posLater[0] - pos[0], posLater[1] - pos[1], posLater[2] - pos[2]) < 1e-9 * a);
+        CHECK (length (posMuch[0] - pos[0], posMuch[1] - pos[1], posMuch[2] - pos[2]) < 1e-6 * a);
+    }
+}
+
+// A moon's state is its planet's plus its own orbit, and its velocity is
+// the rate of change of its position.
+//
+static void checkMoon (void) {
+    Planet
+        star    = newPlanet (fpFromInt (1000), NULL, (OrbitalElements) { 0 }),
+        planet  = newPlanet (fpFromInt (1), &star, (OrbitalElements) {
+            .semiMajorAxis = 100, .eccentricity = 0.1, .inclination = 0.1 }),
+        moon    = newPlanet (fpFromDouble (1e-3), &planet, (OrbitalElements) {
+            .semiMajorAxis = 1, .eccentricity = 0.05, .meanAnomaly = 1 });
+
+    FixedPrec t = fpFromDouble (37.5), dt = fpFromDouble (1e-6);
+
+    Newtonian
+        before  = planetAt (&moon, fpSub (t, dt)),
+        now     = planetAt (&moon, t),
+        after   = planetAt (&moon, fpAdd (t, dt));
+
+    double pos[3], vel[3];
+    relativeState (now, planetAt (&planet, t), pos, vel);
+
+    double r = length (pos[0], pos[1], pos[2]);
+    CHECK (r >= 0.95 * (1 - 1e-12) && r <= 1.05 * (1 + 1e-12));
+
+    double velocity[3] = {
+        fpToDouble (now.velocity.x),
+        fpToDouble (now.velocity.y),
+        fpToDouble (now.velocity.z)
+    };
+
+    double difference[3] = {
+        fpToDouble (fpSub (after.position.x, before.position.x)) / 2e-6,
+        fpToDouble (fpSub (after.position.y, before.position.y)) / 2e-6,
+        fpToDouble (fpSub (after.position.z, before.position.z)) / 2e-6
+    };
+
+    CHECK (length
+        ( velocity[0] - difference[0]
+        , velocity[1] - difference[1]
+        , velocity[2] - difference[2] ) < 1e-6);
+
+    CHECK (fpEqual (now.mass, moon.mass));
+}
+
+// A test body integrated in the field of a star on rails follows the
+// same orbit as the star's planet on rails does.
+//
+static void checkRails (void) {
+    Planet rails[2];
+    rails[0] = newPlanet (fpFromInt (1000), NULL, (OrbitalElements) { 0 });
+    rails[1] = newPlanet (fpFromInt (0), &rails[0], (OrbitalElements) {
+        .semiMajorAxis = 100, .eccentricity = 0.3, .meanAnomaly = 2 });
+
+    Newtonian start = planetAt (&rails[1], fpFromInt (0));
+    start.mass = fpFromDouble (1e-9);
+
+    BodySystem system = newBodySystem (1);
+    addBody (&system, start);
+
+    Integrator integrator = newIntegrator (fpFromInt (8), 12);
+    integrator.planets = rails;
+    integrator.numPlanets = 1;
+
+    // Roughly one orbit.
+    for (unsigned int step = 0; step < 80; step++)
+        integrate (&integrator, &system);
+
+    Newtonian
+        body    = gatherBody (&system, 0),
+        exact   = planetAt (&rails[1], integrator.time);
+
+    double pos[3], vel[3];
+    relativeState (body, exact, pos, vel);
+
+    CHECK (length (pos[0], pos[1], pos[2]) < 0.05);
+
+    // Accelerations from rails alone are the star's pull.
+    clearAccelerations (&system);
+    Newtonian star = planetAt (&rails[0], fpFromInt (0));
+    addRailAccelerations (&system, &star, 1, NULL, 0);
+
+    double
+        x = fpToDouble (getColumn (system.posX, 0)),
+        y = fpToDouble (getColumn (system.posY, 0)),
+        r = length (x, y, 0),
+        ax = fpToDouble (getColumn (system.accX, 0));
+
+    CHECK (fabs (ax + 1000 * x / (r * r * r)) < 1e-9 * 1000 / (r * r));
+
+    freeBodySystem (system);
+}
+
+int main (void) {
+    checkKepler ();
+    checkOrbits ();
+    checkMoon ();
+    checkRails ();
+
+    return checkReport ();
+}
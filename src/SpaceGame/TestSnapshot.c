@@ -0,0 +1,222 @@
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "Bench.h"
+#include "FixedPrecision.h"
+#include "Newtonian.h"
+#include "BodySystem.h"
+#include "Integrator.h"
+#include "Snapshot.h"
+
+
+
+// Bodies in a loose cluster, with some removed so that the handles are
+// out of order and some are free.
+//
+static BodySystem clusterSystem (unsigned int numBodies) {
+    BodySystem system = newBodySystem (16);
+    uint64_t seed = 5;
+
+    for (unsigned int ix = 0; ix < numBodies; ix++) {
+        Newtonian newt = {
+            .mass = newFixedPrec (1 + (nextRandom (&seed) % 1000), nextRandom (&seed)),
+            .position = {
+                newFixedPrec ((int64_t) (nextRandom (&seed) % 2000) - 1000, nextRandom (&seed)),
+                newFixedPrec ((int64_t) (nextRandom (&seed) % 2000) - 1000, nextRandom (&seed)),
+                newFixedPrec ((int64_t) (nextRandom (&seed) % 2000) - 1000, nextRandom (&seed))
+            },
+            .velocity = {
+                newFixedPrec ((int64_t) (nextRandom (&seed) % 2) - 1, nextRandom (&seed)),
+                newFixedPrec ((int64_t) (nextRandom (&seed) % 2) - 1, nextRandom (&seed)),
+                newFixedPrec (0, 0)
+            }
+        };
+
+        addBody (&system, newt);
+    }
+
+    for (BodyHandle handle = 3; handle < numBodies; handle += 7)
+        removeBody (&system, handle);
+
+    return system;
+}
+
+static int sameSystem (const BodySystem *a, const BodySystem *b) {
+    if (a->numBodies != b->numBodies || a->numHandles != b->numHandles ||
+        a->numFreeHandles != b->numFreeHandles ||
+        !fpEqual (a->softening, b->softening) ||
+        a->gravitySolver != b->gravitySolver || a->openingAngle != b->openingAngle ||
+        hashBodySystem (a) != hashBodySystem (b))
+        return 0;
+
+    return
+        memcmp (a->handleToIndex, b->handleToIndex, a->numHandles * sizeof (uint32_t)) == 0 &&
+        memcmp (a->indexToHandle, b->indexToHandle, a->numBodies * sizeof (uint32_t)) == 0 &&
+        memcmp (a->freeHandles, b->freeHandles, a->numFreeHandles * sizeof (uint32_t)) == 0;
+}
+
+// A snapshot loads back exactly, and the loaded body system behaves like
+// any other: it steps the same way, and grows out of the mapping.
+//
+static void checkRoundTrip (const char path[]) {
+    BodySystem system = clusterSystem (3000);
+    system.gravitySolver = GRAVITY_SOLVER_TREE;
+    system.openingAngle = 0.7;
+    CHECK (saveSnapshot (&system, path));
+
+    SnapshotHeader header;
+    CHECK (readSnapshotHeader (path, &header));
+    CHECK (header.stateHash == hashBodySystem (&system));
+    CHECK (header.fileSize % SNAPSHOT_PAGE_SIZE == 0);
+
+    BodySystem loaded;
+    CHECK (loadSnapshot (&loaded, path, SNAPSHOT_VERIFY));
+    CHECK (sameSystem (&system, &loaded));
+    CHECK (loaded.mapping != NULL);
+    CHECK ((uintptr_t) loaded.posX.wholePart % SNAPSHOT_PAGE_SIZE == 0);
+
+    // Handles still find the same bodies.
+    for (BodyHandle handle = 0; handle < system.numHandles; handle++)
+        CHECK (bodyIndex (&system, handle) == bodyIndex (&loaded, handle));
+
+    // Stepping both the same way keeps them the same.
+    Integrator
+        integrator          = newIntegrator (newFixedPrec (0, 1ULL << 60), 3),
+        loadedIntegrator    = integrator;
+
+    for (unsigned int step = 0; step < 2; step++) {
+        integrate (&integrator, &system);
+        integrate (&loadedIntegrator, &loaded);
+    }
+
+    CHECK (hashBodySystem (&system) == hashBodySystem (&loaded));
+
+    // Writes went to private copies of the pages, not to the file.
+    SnapshotHeader after;
+    BodySystem reloaded;
+    CHECK (readSnapshotHeader (path, &after) && after.stateHash == header.stateHash);
+    CHECK (loadSnapshot (&reloaded, path, SNAPSHOT_VERIFY));
+    CHECK (hashBodySystem (&reloaded) == header.stateHash);
+    freeBodySystem (reloaded);
+
+    // Growing past the snapshot's capacity moves everything into memory.
+    unsigned int capacity = loaded.capacity;
+    while (loaded.numBodies <= capacity) {
+        Newtonian newt = { .mass = fpFromInt (1) };
+        addBody (&system, newt);
+        addBody (&loaded, newt);
+    }
+
+    CHECK (loaded.mapping == NULL);
+    CHECK (sameSystem (&system, &loaded));
+
+    freeBodySystem (loaded);
+    freeBodySystem (system);
+}
+
+// Updating a snapshot only writes the pages that changed, and ends up
+// the same as saving a new one.
+//
+static void checkUpdate (const char path[]) {
+    BodySystem system = clusterSystem (5000);
+    unsigned int pages = 0;
+
+    // No snapshot yet: the whole thing is written.
+    unlink (path);
+    CHECK (updateSnapshot (&system, path, &pages));
+
+    SnapshotHeader header;
+    CHECK (readSnapshotHeader (path, &header));
+    CHECK (pages == header.fileSize / SNAPSHOT_PAGE_SIZE);
+
+    // Nothing changed: nothing is written.
+    CHECK (updateSnapshot (&system, path, &pages));
+    CHECK (pages == 0);
+
+    // Moving one body touches one page of each of its position's limbs,
+    // and the header.
+    unsigned int ix = 1234;
+    setColumn (system.posX, ix, fpAdd (getColumn (system.posX, ix), fpFromInt (1)));
+    setColumn (system.posY, ix, fpAdd (getColumn (system.posY, ix), fpFromInt (1)));
+
+    CHECK (updateSnapshot (&system, path, &pages));
+    CHECK (pages == 3);
+
+    BodySystem loaded;
+    CHECK (loadSnapshot (&loaded, path, SNAPSHOT_VERIFY));
+    CHECK (sameSystem (&system, &loaded));
+    freeBodySystem (loaded);
+
+    // Removing a body changes the layout within the same capacity.
+    removeBody (&system, 11);
+    CHECK (updateSnapshot (&system, path, &pages));
+    CHECK (pages > 0 && pages < header.fileSize / SNAPSHOT_PAGE_SIZE);
+    CHECK (loadSnapshot (&loaded, path, SNAPSHOT_VERIFY));
+    CHECK (sameSystem (&system, &loaded));
+    freeBodySystem (loaded);
+
+    freeBodySystem (system);
+}
+
+// Damaged or foreign files are refused.
+//
+static void checkErrors (const char path[]) {
+    BodySystem system = clusterSystem (100), loaded;
+    CHECK (saveSnapshot (&system, path));
+
+    printf ("expected errors follow\n");
+
+    // A changed body fails verification, but not a trusting load.
+    FILE *file = fopen (path, "r+b");
+    fseek (file, SNAPSHOT_PAGE_SIZE + 16, SEEK_SET);
+    fputc (0x5A, file);
+    fclose (file);
+
+    CHECK (!loadSnapshot (&loaded, path, SNAPSHOT_VERIFY));
+    CHECK (loadSnapshot (&loaded, path, SNAPSHOT_TRUST));
+    freeBodySystem (loaded);
+
+    // So does a changed handle, in the first handle section.
+    CHECK (saveSnapshot (&system, path));
+
+    SnapshotHeader header;
+    CHECK (readSnapshotHeader (path, &header));
+
+    long handles = SNAPSHOT_PAGE_SIZE +
+        (long) (header.capacity * BODY_SYSTEM_LIMB_ARRAYS * sizeof (uint64_t));
+
+    file = fopen (path, "r+b");
+    fseek (file, handles, SEEK_SET);
+    fputc (0x5A, file);
+    fclose (file);
+
+    CHECK (!loadSnapshot (&loaded, path, SNAPSHOT_VERIFY));
+
+    // A truncated file, or one that isn't a snapshot at all
+    CHECK (truncate (path, SNAPSHOT_PAGE_SIZE * 2) == 0);
+    CHECK (!loadSnapshot (&loaded, path, SNAPSHOT_TRUST));
+
+    file = fopen (path, "r+b");
+    fputs ("not a snapshot", file);
+    fclose (file);
+    CHECK (!loadSnapshot (&loaded, path, SNAPSHOT_TRUST));
+
+    CHECK (!loadSnapshot (&loaded, "/nonexistent/snapshot", SNAPSHOT_TRUST));
+
+    freeBodySystem (system);
+}
+
+int main (void) {
+    char path[64];
+    snprintf (path, sizeof (path), "/tmp/TestSnapshot.%d", (int) getpid ());
+
+    checkRoundTrip (path);
+    checkUpdate (path);
+    checkErrors (path);
+
+    unlink (path);
+
+    return checkReport ();
+}
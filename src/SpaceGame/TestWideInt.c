@@ -0,0 +1,247 @@
+
+#include <stdio.h>
+
+#include "Bench.h"
+#include "WideInt.h"
+
+
+
+// Differential test between the selected 'WideInt.h' backend and the
+// reference limb implementation. Build it once per backend, e.g. with
+// '-DWIDE_INT_BACKEND=WIDE_INT_INTRINSIC -mbmi2', to cover all of them.
+//
+// Where the compiler has '__int128', both are also checked against it,
+// so that a mistake shared by a backend and its reference can't hide.
+
+static const uint64_t edgeCases[] = {
+    0, 1, 2,
+    0x00000000FFFFFFFFULL, 0x0000000100000000ULL, 0x00000001FFFFFFFFULL,
+    0x7FFFFFFFFFFFFFFFULL, 0x8000000000000000ULL, 0x8000000000000001ULL,
+    0xFFFFFFFF00000000ULL, 0xFFFFFFFFFFFFFFFEULL, 0xFFFFFFFFFFFFFFFFULL
+};
+
+#define NUM_EDGE_CASES (sizeof (edgeCases) / sizeof (edgeCases[0]))
+
+static void check128
+    (const char name[], UInt128 got, UInt128 want, UInt128 a, UInt128 b)
+{
+    if (got.hi == want.hi && got.lo == want.lo)
+        return;
+
+    if (failures++ < 16)
+        printf
+            ( "FAIL %s (%016llx%016llx, %016llx%016llx):\n"
+              "     got  %016llx%016llx\n"
+              "     want %016llx%016llx\n"
+            , name
+            , (unsigned long long) a.hi, (unsigned long long) a.lo
+            , (unsigned long long) b.hi, (unsigned long long) b.lo
+            , (unsigned long long) got.hi, (unsigned long long) got.lo
+            , (unsigned long long) want.hi, (unsigned long long) want.lo );
+}
+
+static void checkAll (UInt128 a, UInt128 b) {
+    check128 ("add128u", add128u (a, b), add128uRef (a, b), a, b);
+    check128 ("sub128u", sub128u (a, b), sub128uRef (a, b), a, b);
+    check128 ("adc64u", adc64u (a.lo, b.lo), adc64uRef (a.lo, b.lo), a, b);
+    check128 ("mul64u", mul64u (a.lo, b.lo), mul64uRef (a.lo, b.lo), a, b);
+
+    if (b.hi == 0 && b.lo == 0)
+        return;
+
+    Quotient128
+        want = div128uRef (a, b),
+        got = div128u (a, b);
+
+    check128 ("div128u (quotient)", got.quotient, want.quotient, a, b);
+    check128 ("div128u (remainder)", got.remainder, want.remainder, a, b);
+
+    if (b.lo == 0)
+        return;
+
+    got = divByReciprocal128u (a, newReciprocal64 (b.lo));
+    want = div128u (a, newUInt128 (0, b.lo));
+
+    check128
+        ( "divByReciprocal128u (quotient)"
+        , got.quotient, want.quotient, a, b );
+    check128
+        ( "divByReciprocal128u (remainder)"
+        , got.remainder, want.remainder, a, b );
+
+    uint64_t
+        hi      = a.hi % b.lo,
+        rem, remRef,
+        quot    = div128by64u (hi, a.lo, b.lo, &rem),
+        quotRef = div128by64uRef (hi, a.lo, b.lo, &remRef);
+
+    check128
+        ( "div128by64u (quotient)"
+        , newUInt128 (0, quot), newUInt128 (0, quotRef), a, b );
+    check128
+        ( "div128by64u (remainder)"
+        , newUInt128 (0, rem), newUInt128 (0, remRef), a, b );
+}
+
+#if defined (__SIZEOF_INT128__)
+
+typedef unsigned __int128 Native;
+
+static Native toNative (UInt128 a) {
+    return ((Native) a.hi << 64) | a.lo;
+}
+
+static UInt128 fromNative (Native a) {
+    return newUInt128 ((uint64_t) (a >> 64), (uint64_t) a);
+}
+
+// Schoolbook product of 64-bit digits, as the independent oracle for
+// 'mul128u'.
+//
+static UInt256 nativeMul256 (UInt128 a, UInt128 b) {
+    Native
+        p00 = (Native) a.lo * b.lo,
+        p01 = (Native) a.lo * b.hi,
+        p10 = (Native) a.hi * b.lo,
+        p11 = (Native) a.hi * b.hi,
+        mid = (p00 >> 64) + (uint64_t) p01 + (uint64_t) p10,
+        top = (mid >> 64) + (p01 >> 64) + (p10 >> 64) + p11;
+
+    return (UInt256) {
+        .hi = fromNative (top),
+        .lo = newUInt128 ((uint64_t) mid, (uint64_t) p00)
+    };
+}
+
+static uint32_t nativeClz (Native a) {
+    uint32_t n = 0;
+    while (!(a >> (127 - n) & 1))
+        n++;
+    return n;
+}
+
+// Every primitive, and its reference version, against the compiler's
+// 128-bit arithmetic. 'n' is a shift count, taken modulo 128.
+//
+static void checkNative (UInt128 a, UInt128 b, uint32_t n) {
+    Native x = toNative (a), y = toNative (b);
+    n &= 127;
+
+    check128 ("add128u", add128u (a, b), fromNative (x + y), a, b);
+    check128 ("add128uRef", add128uRef (a, b), fromNative (x + y), a, b);
+    check128 ("wrapSub128u", wrapSub128u (a, b), fromNative (x - y), a, b);
+    check128 ("sub128u", sub128u (a, b), fromNative (x < y ? 0 : x - y), a, b);
+    check128 ("sub128uRef", sub128uRef (a, b), fromNative (x < y ? 0 : x - y), a, b);
+    check128
+        ( "lt128u", newUInt128 (0, (uint64_t) lt128u (a, b))
+        , newUInt128 (0, x < y), a, b );
+
+    check128 ("shl128u", shl128u (a, n), fromNative (x << n), a, b);
+    check128 ("shr128u", shr128u (a, n), fromNative (x >> n), a, b);
+    check128
+        ( "sar128", sar128 (a, n)
+        , fromNative ((Native) ((__int128) x >> n)), a, b );
+
+    if (x != 0)
+        check128
+            ( "clz128u", newUInt128 (0, clz128u (a))
+            , newUInt128 (0, nativeClz (x)), a, b );
+
+    check128 ("adc64u", adc64u (a.lo, b.lo), fromNative ((Native) a.lo + b.lo), a, b);
+    check128 ("adc64uRef", adc64uRef (a.lo, b.lo), fromNative ((Native) a.lo + b.lo), a, b);
+    check128 ("mul64u", mul64u (a.lo, b.hi), fromNative ((Native) a.lo * b.hi), a, b);
+    check128 ("mul64uRef", mul64uRef (a.lo, b.hi), fromNative ((Native) a.lo * b.hi), a, b);
+
+    UInt256
+        product = mul128u (a, b),
+        expected = nativeMul256 (a, b);
+
+    check128 ("mul128u (high)", product.hi, expected.hi, a, b);
+    check128 ("mul128u (low)", product.lo, expected.lo, a, b);
+
+    // The product plus 'a * 2^128 + b', and the top of it shifted down.
+    UInt256
+        sum = add256u (product, (UInt256) { a, b }),
+        shifted = shr256u (sum, n + 64);
+    Native
+        sumLo = toNative (expected.lo) + y,
+        sumHi = toNative (expected.hi) + x + (sumLo < y),
+        top = n >= 64 ? sumHi >> (n - 64)
+            : (sumLo >> (n + 64)) | (sumHi << (64 - n));
+
+    check128 ("add256u (high)", sum.hi, fromNative (sumHi), a, b);
+    check128 ("add256u (low)", sum.lo, fromNative (sumLo), a, b);
+    check128 ("shr256u", shifted.lo, fromNative (top), a, b);
+
+    if (y == 0)
+        return;
+
+    Quotient128 got = div128u (a, b), ref = div128uRef (a, b);
+    check128 ("div128u (quotient)", got.quotient, fromNative (x / y), a, b);
+    check128 ("div128u (remainder)", got.remainder, fromNative (x % y), a, b);
+    check128 ("div128uRef (quotient)", ref.quotient, fromNative (x / y), a, b);
+    check128 ("div128uRef (remainder)", ref.remainder, fromNative (x % y), a, b);
+
+    if (b.lo == 0)
+        return;
+
+    Native n2 = ((Native) (a.hi % b.lo) << 64) | a.lo;
+    uint64_t rem, quot = div128by64u (a.hi % b.lo, a.lo, b.lo, &rem);
+
+    check128
+        ( "div128by64u", newUInt128 (rem, quot)
+        , newUInt128 ((uint64_t) (n2 % b.lo), (uint64_t) (n2 / b.lo)), a, b );
+
+    got = divByReciprocal128u (a, newReciprocal64 (b.lo));
+    check128
+        ( "divByReciprocal128u (quotient)"
+        , got.quotient, fromNative (x / b.lo), a, b );
+    check128
+        ( "divByReciprocal128u (remainder)"
+        , got.remainder, fromNative (x % b.lo), a, b );
+}
+
+#else
+
+static void checkNative (UInt128 a, UInt128 b, uint32_t n) {
+    (void) a;
+    (void) b;
+    (void) n;
+}
+
+#endif
+
+int main (void) {
+    printf ("wide-int backend: %d\n", WIDE_INT_BACKEND);
+
+    // Every combination of edge cases in every limb.
+    for (unsigned int i = 0; i < NUM_EDGE_CASES * NUM_EDGE_CASES; i++)
+    for (unsigned int j = 0; j < NUM_EDGE_CASES * NUM_EDGE_CASES; j++) {
+        UInt128
+            a = newUInt128
+                ( edgeCases[i / NUM_EDGE_CASES]
+                , edgeCases[i % NUM_EDGE_CASES] ),
+            b = newUInt128
+                ( edgeCases[j / NUM_EDGE_CASES]
+                , edgeCases[j % NUM_EDGE_CASES] );
+
+        checkAll (a, b);
+        checkNative (a, b, i + j);
+    }
+
+    // Plenty of random inputs. The second operand is scaled down by a
+    // random amount, so that divisors of every width get exercised.
+    uint64_t seed = 1;
+    for (unsigned int ix = 0; ix < 1000000; ix++) {
+        UInt128
+            a = newUInt128 (nextRandom (&seed), nextRandom (&seed)),
+            b = newUInt128 (nextRandom (&seed), nextRandom (&seed));
+
+        b = shr128u (b, nextRandom (&seed) % 128);
+
+        checkAll (a, b);
+        checkNative (a, b, (uint32_t) nextRandom (&seed));
+    }
+
+    return checkReport ();
+}
@@ -0,0 +1,289 @@
+
+// SpaceGame.ThreadPool
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "ThreadPool.h"
+
+
+
+// Work-stealing thread pool.
+//
+// Each worker has a queue holding a range of task numbers. The owner
+// takes tasks from the front; a thief takes the back half in one go and
+// makes it its own range. Ranges only ever shrink or move whole, so a
+// task is never lost or run twice, and a worker that finds every queue
+// empty can leave the loop: whatever's left is already in someone's
+// hands.
+//
+// The thread that calls 'parallelFor' is worker 0 and does its share,
+// then waits for the others to leave the loop. Queues are a cache line
+// each, so that workers don't fight over each other's.
+
+typedef struct ThreadQueue ThreadQueue;
+
+struct ThreadQueue {
+    pthread_mutex_t lock;
+    unsigned int begin, end;
+} __attribute__ ((aligned (64)));
+
+typedef struct ThreadWorker ThreadWorker;
+
+struct ThreadWorker {
+    ThreadPool *pool;
+    unsigned int index;
+};
+
+struct ThreadPool {
+    unsigned int numWorkers;
+
+    // Threads of workers 1 onwards
+    pthread_t *threads;
+    ThreadWorker *workers;
+    unsigned int numStarted;
+
+    ThreadQueue *queues;
+
+    // Current loop, numbered so that workers can tell a new one from the
+    // one they've just finished
+    ThreadTask task;
+    void *context;
+    uint64_t loop;
+
+    // Workers still in the current loop
+    unsigned int busy;
+    int quit;
+
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t finish;
+};
+
+// Take the next task from a worker's own queue.
+//
+static int popTask (ThreadQueue *queue, unsigned int *task) {
+    pthread_mutex_lock (&queue->lock);
+
+    int found = queue->begin < queue->end;
+    if (found)
+        *task = queue->begin++;
+
+    pthread_mutex_unlock (&queue->lock);
+    return found;
+}
+
+// Move the back half of some other worker's queue to this one, trying
+// them in turn from the next worker up. Returns 0 if they're all empty.
+//
+static int stealTasks (ThreadPool *pool, unsigned int worker) {
+    for (unsigned int offset = 1; offset < pool->numWorkers; offset++) {
+        ThreadQueue *victim = &pool->queues[(worker + offset) % pool->numWorkers];
+
+        pthread_mutex_lock (&victim->lock);
+
+        unsigned int
+            end     = victim->end,
+            left    = end - victim->begin,
+            begin   = end - (left + 1) / 2;
+
+        if (left)
+            victim->end = begin;
+
+        pthread_mutex_unlock (&victim->lock);
+
+        if (left) {
+            ThreadQueue *own = &pool->queues[worker];
+
+            pthread_mutex_lock (&own->lock);
+            own->begin = begin;
+            own->end = end;
+            pthread_mutex_unlock (&own->lock);
+
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+// Run tasks of the current loop until there are none left anywhere.
+//
+static void runTasks (ThreadPool *pool, unsigned int worker) {
+    unsigned int task;
+
+    do
+        while (popTask (&pool->queues[worker], &task))
+            pool->task (pool->context, task, worker);
+    while (stealTasks (pool, worker));
+}
+
+static void *runWorker (void *arg) {
+    ThreadWorker *self = arg;
+    ThreadPool *pool = self->pool;
+    uint64_t seen = 0;
+
+    pthread_mutex_lock (&pool->lock);
+
+    for (;;) {
+        while (pool->loop == seen && !pool->quit)
+            pthread_cond_wait (&pool->start, &pool->lock);
+
+        if (pool->quit)
+            break;
+
+        seen = pool->loop;
+        pthread_mutex_unlock (&pool->lock);
+
+        runTasks (pool, self->index);
+
+        pthread_mutex_lock (&pool->lock);
+        if (--pool->busy == 0)
+            pthread_cond_signal (&pool->finish);
+    }
+
+    pthread_mutex_unlock (&pool->lock);
+    return NULL;
+}
+
+
+// type ThreadPool
+
+// Number of cores the operating system says are online.
+//
+unsigned int availableCores (void) {
+    long cores = sysconf (_SC_NPROCESSORS_ONLN);
+    return cores < 1 ? 1 : cores > THREAD_POOL_MAX_WORKERS ? THREAD_POOL_MAX_WORKERS : cores;
+}
+
+// Create a thread pool with 'numWorkers' workers, counting the calling
+// thread, or one per core if that's 0. Returns NULL if out of memory or
+// threads.
+//
+ThreadPool *newThreadPool (unsigned int numWorkers) {
+    if (!numWorkers)
+        numWorkers = availableCores ();
+    if (numWorkers > THREAD_POOL_MAX_WORKERS)
+        numWorkers = THREAD_POOL_MAX_WORKERS;
+
+    ThreadPool *pool = calloc (1, sizeof (ThreadPool));
+    if (!pool) {
+        printf ("error: newThreadPool: out of memory\n");
+        return NULL;
+    }
+
+    pool->numWorkers = numWorkers;
+    pool->threads = malloc (numWorkers * sizeof (pthread_t));
+    pool->workers = malloc (numWorkers * sizeof (ThreadWorker));
+    pool->queues = aligned_alloc (64, numWorkers * sizeof (ThreadQueue));
+
+    if (!pool->threads || !pool->workers || !pool->queues) {
+        printf ("error: newThreadPool: out of memory\n");
+        free (pool->threads);
+        free (pool->workers);
+        free (pool->queues);
+        free (pool);
+        return NULL;
+    }
+
+    pthread_mutex_init (&pool->lock, NULL);
+    pthread_cond_init (&pool->start, NULL);
+    pthread_cond_init (&pool->finish, NULL);
+
+    for (unsigned int worker = 0; worker < numWorkers; worker++) {
+        pool->queues[worker] = (ThreadQueue) { .begin = 0, .end = 0 };
+        pthread_mutex_init (&pool->queues[worker].lock, NULL);
+        pool->workers[worker] = (ThreadWorker) { .pool = pool, .index = worker };
+    }
+
+    for (unsigned int worker = 1; worker < numWorkers; worker++) {
+        if (pthread_create
+            (&pool->threads[worker], NULL, runWorker, &pool->workers[worker]))
+        {
+            printf ("error: newThreadPool: can't start thread %u\n", worker);
+            freeThreadPool (pool);
+            return NULL;
+        }
+
+        pool->numStarted = worker;
+    }
+
+    return pool;
+}
+
+// Stop a thread pool's threads and free it.
+//
+void freeThreadPool (ThreadPool *pool) {
+    if (!pool)
+        return;
+
+    pthread_mutex_lock (&pool->lock);
+    pool->quit = 1;
+    pthread_cond_broadcast (&pool->start);
+    pthread_mutex_unlock (&pool->lock);
+
+    for (unsigned int worker = 1; worker <= pool->numStarted; worker++)
+        pthread_join (pool->threads[worker], NULL);
+
+    for (unsigned int worker = 0; worker < pool->numWorkers; worker++)
+        pthread_mutex_destroy (&pool->queues[worker].lock);
+
+    pthread_mutex_destroy (&pool->lock);
+    pthread_cond_destroy (&pool->start);
+    pthread_cond_destroy (&pool->finish);
+
+    free (pool->threads);
+    free (pool->workers);
+    free (pool->queues);
+    free (pool);
+}
+
+// Number of workers of a thread pool, 1 for no pool at all.
+//
+unsigned int threadPoolWorkers (const ThreadPool *pool) {
+    return pool ? pool->numWorkers : 1;
+}
+
+// Run tasks '0' to 'numTasks - 1' of 'task' across a thread pool's
+// workers, and return once they've all finished.
+//
+// With no pool, or only one task, they all run on the calling thread,
+// in order. Tasks mustn't start loops of their own on the same pool.
+//
+void parallelFor (ThreadPool *pool, unsigned int numTasks, ThreadTask task, void *context) {
+    if (!pool || pool->numWorkers == 1 || numTasks <= 1) {
+        for (unsigned int ix = 0; ix < numTasks; ix++)
+            task (context, ix, 0);
+
+        return;
+    }
+
+    unsigned int numWorkers = pool->numWorkers;
+
+    for (unsigned int worker = 0; worker < numWorkers; worker++) {
+        ThreadQueue *queue = &pool->queues[worker];
+
+        pthread_mutex_lock (&queue->lock);
+        queue->begin = (uint64_t) numTasks * worker / numWorkers;
+        queue->end = (uint64_t) numTasks * (worker + 1) / numWorkers;
+        pthread_mutex_unlock (&queue->lock);
+    }
+
+    pthread_mutex_lock (&pool->lock);
+    pool->task = task;
+    pool->context = context;
+    pool->busy = numWorkers - 1;
+    pool->loop++;
+    pthread_cond_broadcast (&pool->start);
+    pthread_mutex_unlock (&pool->lock);
+
+    runTasks (pool, 0);
+
+    pthread_mutex_lock (&pool->lock);
+    while (pool->busy)
+        pthread_cond_wait (&pool->finish, &pool->lock);
+    pthread_mutex_unlock (&pool->lock);
+}
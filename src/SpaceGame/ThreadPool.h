@@ -0,0 +1,37 @@
+
+#ifndef SPACE_GAME_THREAD_POOL_H
+#define SPACE_GAME_THREAD_POOL_H
+
+// Most workers a thread pool can have.
+//
+#define THREAD_POOL_MAX_WORKERS 256
+
+// Task of a parallel loop: run task number 'task' on worker 'worker'.
+//
+// Workers are numbered from 0, the thread that started the loop, to
+// 'numWorkers - 1', so tasks can use the worker number to pick scratch
+// space of their own.
+//
+typedef void (*ThreadTask) (void *, unsigned int, unsigned int);
+
+// Fixed set of worker threads that run parallel loops.
+//
+// A loop's tasks are split into a contiguous range per worker. Each
+// worker runs its own range front to back, and when that's empty steals
+// the back half of someone else's, so uneven tasks still balance.
+//
+// Which worker runs which task depends on timing, so anything that must
+// come out the same every time has to be written per task, or summed
+// per worker and then combined in worker order.
+//
+typedef struct ThreadPool ThreadPool;
+
+ThreadPool *newThreadPool (unsigned int);
+void freeThreadPool (ThreadPool *);
+
+unsigned int threadPoolWorkers (const ThreadPool *);
+unsigned int availableCores (void);
+
+void parallelFor (ThreadPool *, unsigned int, ThreadTask, void *);
+
+#endif
@@ -2,11 +2,51 @@
 #ifndef SPACE_GAME_WIDE_INT_H
 #define SPACE_GAME_WIDE_INT_H
 
+#include <stdint.h>
+#include <stdio.h>
+
 #define MSB64(x)    (0x8000000000000000ULL & (x))
 
 #define HI64(x)     (0x00000000FFFFFFFFULL & ((x) >> 32))
 #define LO64(x)     (0x00000000FFFFFFFFULL & (x))
 
+// Arithmetic backends.
+//
+// Every primitive below has a portable reference implementation built
+// out of 32-bit limbs (the '...Ref' functions), and a public entry
+// point that dispatches to whichever backend is selected at compile
+// time:
+//
+//  - 'WIDE_INT_LIMB': the reference limb code, usable everywhere;
+//  - 'WIDE_INT_NATIVE': the compiler's 'unsigned __int128', which lowers
+//    to 'add'/'adc', 'sub'/'sbb' and a single widening 'mul' (or 'mulx');
+//  - 'WIDE_INT_INTRINSIC': the '_addcarry_u64'/'_subborrow_u64' and
+//    '_umul128'/'_mulx_u64' intrinsics, for compilers without '__int128'.
+//
+// Define 'WIDE_INT_BACKEND' to one of these to override the choice.
+//
+#define WIDE_INT_LIMB       0
+#define WIDE_INT_NATIVE     1
+#define WIDE_INT_INTRINSIC  2
+
+#ifndef WIDE_INT_BACKEND
+#   if defined (__SIZEOF_INT128__)
+#       define WIDE_INT_BACKEND WIDE_INT_NATIVE
+#   elif defined (_MSC_VER) && defined (_M_X64)
+#       define WIDE_INT_BACKEND WIDE_INT_INTRINSIC
+#   else
+#       define WIDE_INT_BACKEND WIDE_INT_LIMB
+#   endif
+#endif
+
+#if WIDE_INT_BACKEND == WIDE_INT_INTRINSIC
+#   if defined (_MSC_VER)
+#       include <intrin.h>
+#   else
+#       include <x86intrin.h>
+#   endif
+#endif
+
 // 128-bit unsigned integer representation.
 //
 typedef struct UInt128 UInt128;
@@ -22,14 +62,42 @@ static inline UInt128 newUInt128 (uint64_t hi, uint64_t lo) {
     return (UInt128) { hi, lo };
 }
 
+#if WIDE_INT_BACKEND == WIDE_INT_NATIVE
+// Convert between our representation and the compiler's native one.
+//
+static inline unsigned __int128 toNative128u (UInt128 a) {
+    return ((unsigned __int128) a.hi << 64) | a.lo;
+}
+
+static inline UInt128 fromNative128u (unsigned __int128 a) {
+    return (UInt128) {
+        .hi = (uint64_t) (a >> 64),
+        .lo = (uint64_t) a
+    };
+}
+#endif
+
+// Is the first 128-bit integer less than the second?
+//
+static inline int lt128u (UInt128 a, UInt128 b) {
+    return a.hi < b.hi || (a.hi == b.hi && a.lo < b.lo);
+}
+
 // Shift a 128-bit integer left by an arbitrary amount.
 //
+// Shift counts are taken modulo 128. The whole-word and zero cases are
+// split out, since shifting a 64-bit word by 64 is undefined in C.
+//
 static inline UInt128 shl128u (UInt128 a, uint32_t n) {
-    uint64_t carry =
-        n < 64 ? a.lo >> (64 - n) : a.lo << (n - 64);
+    n &= 127;
+
+    if (n == 0)
+        return a;
+    if (n >= 64)
+        return newUInt128 (a.lo << (n - 64), 0);
 
     return (UInt128) {
-        .hi = (a.hi << n) | carry,
+        .hi = (a.hi << n) | (a.lo >> (64 - n)),
         .lo = a.lo << n
     };
 }
@@ -37,46 +105,100 @@ static inline UInt128 shl128u (UInt128 a, uint32_t n) {
 // Shift a 128-bit integer right by an arbitrary amount.
 //
 static inline UInt128 shr128u (UInt128 a, uint32_t n) {
-    uint64_t borrow =
-        n < 64 ? a.hi << (64 - n) : a.hi >> (n - 64);
+    n &= 127;
+
+    if (n == 0)
+        return a;
+    if (n >= 64)
+        return newUInt128 (0, a.hi >> (n - 64));
 
     return (UInt128) {
         .hi = a.hi >> n,
-        .lo = (a.lo >> n) | borrow
+        .lo = (a.lo >> n) | (a.hi << (64 - n))
     };
 }
 
+// Shift a 128-bit two's complement integer right by an arbitrary amount,
+// copying the sign bit in from the top.
+//
+// Shifting the complement of a negative number and complementing back
+// shifts in ones rather than zeroes.
+//
+static inline UInt128 sar128 (UInt128 a, uint32_t n) {
+    uint64_t mask = (uint64_t) ((int64_t) a.hi >> 63);
+    UInt128 shifted = shr128u (newUInt128 (a.hi ^ mask, a.lo ^ mask), n);
+
+    return newUInt128 (shifted.hi ^ mask, shifted.lo ^ mask);
+}
+
+// Count the leading zero bits of a non-zero 64-bit integer.
+//
+static inline uint32_t clz64 (uint64_t a) {
+#if defined (__GNUC__) || defined (__clang__)
+    return __builtin_clzll (a);
+#else
+    uint32_t n = 0;
+    for (uint32_t step = 32; step; step >>= 1)
+        if (!(a >> (64 - step))) {
+            n += step;
+            a <<= step;
+        }
+    return n;
+#endif
+}
+
 // Add two 128-bit unsigned integers together.
 //
-static inline UInt128 add128u (UInt128 a, UInt128 b) {
+// The reference version works the same way as 'adc64uRef' below, just
+// with four 32-bit limbs instead of two: each limb is summed in 64 bits
+// and its upper half is carried into the next one.
+//
+static inline UInt128 add128uRef (UInt128 a, UInt128 b) {
     uint64_t
         sum1 = LO64(a.lo) + LO64(b.lo),
-        sum2 = HI64(a.lo) + HI64(b.lo),
-        sum3 = LO64(a.hi) + LO64(b.hi),
-        sum4 = HI64(a.hi) + HI64(b.hi);
+        sum2 = HI64(a.lo) + HI64(b.lo) + HI64(sum1),
+        sum3 = LO64(a.hi) + LO64(b.hi) + HI64(sum2),
+        sum4 = HI64(a.hi) + HI64(b.hi) + HI64(sum3);
 
     return (UInt128) {
-        .lo = (sum2 << 32) + sum1,
-        .hi = (sum4 << 32) + sum3 + HI64(sum2)
+        .lo = (sum2 << 32) | LO64(sum1),
+        .hi = (sum4 << 32) | LO64(sum3)
     };
 }
 
+static inline UInt128 add128u (UInt128 a, UInt128 b) {
+#if WIDE_INT_BACKEND == WIDE_INT_NATIVE
+    return fromNative128u (toNative128u (a) + toNative128u (b));
+#elif WIDE_INT_BACKEND == WIDE_INT_INTRINSIC
+    unsigned long long lo, hi;
+    unsigned char carry = _addcarry_u64 (0, a.lo, b.lo, &lo);
+    _addcarry_u64 (carry, a.hi, b.hi, &hi);
+    return newUInt128 (hi, lo);
+#else
+    return add128uRef (a, b);
+#endif
+}
+
 // Subtract two 128-bit unsigned integers.
 //
 // Returns 0 if second operand is greater than the first.
 //
-static inline UInt128 sub128u (UInt128 a, UInt128 b) {
+// Each 32-bit limb is biased by 'extra' so that it never goes negative.
+// Afterwards the upper half of a limb is 2 if it didn't need to borrow,
+// and 1 if it did, so '2 - HI64' is the borrow into the next limb.
+//
+static inline UInt128 sub128uRef (UInt128 a, UInt128 b) {
     const uint64_t extra = 0x200000000ULL;
 
     uint64_t
         sub1 = extra + LO64(a.lo) - LO64(b.lo),
-        sub2 = extra + HI64(a.lo) - LO64(b.lo),
+        sub2 = extra + HI64(a.lo) - HI64(b.lo),
         sub3 = extra + LO64(a.hi) - LO64(b.hi),
-        sub4 = extra + HI64(a.hi) - LO64(b.hi);
+        sub4 = extra + HI64(a.hi) - HI64(b.hi);
 
-    sub2 -= HI64(sub1) ^ 2;
-    sub3 -= HI64(sub2) ^ 2;
-    sub4 -= HI64(sub3) ^ 2;
+    sub2 -= 2 - HI64(sub1);
+    sub3 -= 2 - HI64(sub2);
+    sub4 -= 2 - HI64(sub3);
 
     uint64_t nuke = HI64(sub4) >> 1;
 
@@ -86,45 +208,46 @@ static inline UInt128 sub128u (UInt128 a, UInt128 b) {
     };
 }
 
-// Divide two 128-bit unsigned integers.
-//
-typedef struct Quotient128 Quotient128;
-
-struct Quotient128 {
-    UInt128 quotient;
-    UInt128 remainder;
-};
-
-static inline Quotient128 div128u (UInt128 a, UInt128 b) {
-    // Exceptional case
-    if (b.hi == 0 && b.lo == 0) {
-        printf ("error: div128u: divide by zero exception\n");
-        return b;
-    }
-
-    UInt128
-        quotient    = newUInt128 (0, 0),
-        remainder   = newUInt128 (0, 0);
-
-    for (uint32_t ix = 0; ix < 128; ix++) {
-        quotient = shl128u (quotient, 1);
-        remainder = shl128u (remainder, 1);
-
-        remainder.lo |= shr128u (a, ix).lo & 1;
-
-        if (lt128u (remainder, b)) {
-            remainder = sub128u (remainder, b);
-            quotient = add128u (quotient, 1);
-        }
-    }
+static inline UInt128 sub128u (UInt128 a, UInt128 b) {
+#if WIDE_INT_BACKEND == WIDE_INT_NATIVE
+    unsigned __int128
+        x = toNative128u (a),
+        y = toNative128u (b);
+
+    return fromNative128u (x < y ? 0 : x - y);
+#elif WIDE_INT_BACKEND == WIDE_INT_INTRINSIC
+    unsigned long long lo, hi;
+    unsigned char borrow = _subborrow_u64 (0, a.lo, b.lo, &lo);
+    borrow = _subborrow_u64 (borrow, a.hi, b.hi, &hi);
+    uint64_t nuke = (uint64_t) borrow - 1;
+    return newUInt128 (hi & nuke, lo & nuke);
+#else
+    return sub128uRef (a, b);
+#endif
+}
 
-    return (Quotient128) {
-        .quotient   = quotient,
-        .remainder  = remainder
+// Subtract two 128-bit unsigned integers, wrapping around modulo 2^128
+// like native unsigned arithmetic does.
+//
+// Unlike 'sub128u', this is what two's complement arithmetic is built
+// on, so it stays branch-free on every backend.
+//
+static inline UInt128 wrapSub128u (UInt128 a, UInt128 b) {
+#if WIDE_INT_BACKEND == WIDE_INT_NATIVE
+    return fromNative128u (toNative128u (a) - toNative128u (b));
+#elif WIDE_INT_BACKEND == WIDE_INT_INTRINSIC
+    unsigned long long lo, hi;
+    unsigned char borrow = _subborrow_u64 (0, a.lo, b.lo, &lo);
+    _subborrow_u64 (borrow, a.hi, b.hi, &hi);
+    return newUInt128 (hi, lo);
+#else
+    return (UInt128) {
+        .hi = a.hi - b.hi - (a.lo < b.lo),
+        .lo = a.lo - b.lo
     };
+#endif
 }
 
-
 // Add together two 64-bit integers, and encode the carry overflow
 // result in the highest 64 bits of 'UInt128'.
 //
@@ -142,7 +265,7 @@ static inline Quotient128 div128u (UInt128 a, UInt128 b) {
 // If the top half overflows after all this, its own upper bits will
 // provide us exactly the carry-out we're looking for.
 //
-static inline UInt128 adc64u (uint64_t a, uint64_t b) {
+static inline UInt128 adc64uRef (uint64_t a, uint64_t b) {
     uint64_t
         sum1 = LO64(a) + LO64(b),
         sum2 = HI64(a) + HI64(b);
@@ -150,9 +273,21 @@ static inline UInt128 adc64u (uint64_t a, uint64_t b) {
     sum2 += HI64(sum1);
 
     return (UInt128) {
-        .lo = (sum2 << 32) + sum1,
+        .lo = (sum2 << 32) + LO64(sum1),
         .hi = HI64(sum2)
-    }
+    };
+}
+
+static inline UInt128 adc64u (uint64_t a, uint64_t b) {
+#if WIDE_INT_BACKEND == WIDE_INT_NATIVE
+    return fromNative128u ((unsigned __int128) a + b);
+#elif WIDE_INT_BACKEND == WIDE_INT_INTRINSIC
+    unsigned long long lo;
+    unsigned char carry = _addcarry_u64 (0, a, b, &lo);
+    return newUInt128 (carry, lo);
+#else
+    return adc64uRef (a, b);
+#endif
 }
 
 // Multiply two 64-bit integers together to get a 128-bit integer.
@@ -176,13 +311,18 @@ static inline UInt128 adc64u (uint64_t a, uint64_t b) {
 // product to the highest product, and then adding the remaining lower
 // 32 bits to the lowest product.
 //
+// The two middle products can't simply be summed, since that might
+// overflow 64 bits. Instead we fold in one of them alongside the upper
+// half of the lowest product, which is guaranteed to fit, and carry the
+// other one's upper half straight into the highest product.
+//
 // Our procedure for multiplying 64-bit integers is:
 //  - disassemble each into 32-bit halves;
 //  - compute the four partial products of these halves;
 //  - get the overlaps to be added to each significant term;
 //  - add everything up and return.
 //
-static inline UInt128 mul64u (uint64_t a, uint64_t b) {
+static inline UInt128 mul64uRef (uint64_t a, uint64_t b) {
     uint64_t
         prod1 = LO64(a) * LO64(b),
         prod2 = HI64(a) * LO64(b),
@@ -190,20 +330,410 @@ static inline UInt128 mul64u (uint64_t a, uint64_t b) {
         prod4 = HI64(a) * HI64(b);
 
     uint64_t
-        middle  = prod2 + prod3,
+        middle  = HI64(prod1) + LO64(prod2) + prod3,
         over1   = LO64(middle) << 32,
         // ^ overlap highest bits of 'prod1' with lowest bits of
         // 'prod2 + prod3'.
-        over4   = HI64(middle);
+        over4   = HI64(middle) + HI64(prod2);
         // ^ overlap lowest bits of 'prod4' with highest bits of
         // 'prod2 + prod3'.
 
     return (UInt128) {
-        .lo = prod1 + over1,
+        .lo = LO64(prod1) | over1,
         .hi = prod4 + over4
     };
 }
 
+static inline UInt128 mul64u (uint64_t a, uint64_t b) {
+#if WIDE_INT_BACKEND == WIDE_INT_NATIVE
+    return fromNative128u ((unsigned __int128) a * b);
+#elif WIDE_INT_BACKEND == WIDE_INT_INTRINSIC && defined (_MSC_VER)
+    unsigned long long hi;
+    uint64_t lo = _umul128 (a, b, &hi);
+    return newUInt128 (hi, lo);
+#elif WIDE_INT_BACKEND == WIDE_INT_INTRINSIC && defined (__BMI2__)
+    unsigned long long hi;
+    uint64_t lo = _mulx_u64 (a, b, &hi);
+    return newUInt128 (hi, lo);
+#else
+    return mul64uRef (a, b);
+#endif
+}
+
+
+// 256-bit unsigned integer representation, only used to hold the full
+// product of two 128-bit integers.
+//
+typedef struct UInt256 UInt256;
+
+struct UInt256 {
+    UInt128 hi;
+    UInt128 lo;
+};
+
+// Multiply two 128-bit integers together to get a 256-bit integer.
+//
+// This is the same algebra as 'mul64u', only with 64-bit halves and
+// 128-bit partial products. The sum of the lowest product's upper half
+// and one middle product always fits in 128 bits; adding the other middle
+// product might not, so its carry-out goes into the highest product.
+//
+static inline UInt256 mul128u (UInt128 a, UInt128 b) {
+    UInt128
+        prod1 = mul64u (a.lo, b.lo),
+        prod2 = mul64u (a.hi, b.lo),
+        prod3 = mul64u (a.lo, b.hi),
+        prod4 = mul64u (a.hi, b.hi);
+
+    UInt128
+        middle  = add128u (add128u (prod2, newUInt128 (0, prod1.hi)), prod3);
+
+    uint64_t carry = lt128u (middle, prod3);
+
+    return (UInt256) {
+        .hi = add128u (prod4, newUInt128 (carry, middle.hi)),
+        .lo = newUInt128 (middle.lo, prod1.lo)
+    };
+}
+
+// Add, subtract and compare 256-bit unsigned integers. Both add and
+// subtract wrap around modulo 2^256.
+//
+static inline UInt256 add256u (UInt256 a, UInt256 b) {
+    UInt128 lo = add128u (a.lo, b.lo);
+    uint64_t carry = lt128u (lo, b.lo);
+
+    return (UInt256) {
+        .hi = add128u (add128u (a.hi, b.hi), newUInt128 (0, carry)),
+        .lo = lo
+    };
+}
+
+static inline UInt256 wrapSub256u (UInt256 a, UInt256 b) {
+    uint64_t borrow = lt128u (a.lo, b.lo);
+
+    return (UInt256) {
+        .hi = wrapSub128u (wrapSub128u (a.hi, b.hi), newUInt128 (0, borrow)),
+        .lo = wrapSub128u (a.lo, b.lo)
+    };
+}
+
+static inline int lt256u (UInt256 a, UInt256 b) {
+    return lt128u (a.hi, b.hi) ||
+        (a.hi.hi == b.hi.hi && a.hi.lo == b.hi.lo && lt128u (a.lo, b.lo));
+}
+
+// Shift a 256-bit integer right by 0 to 255 bits.
+//
+static inline UInt256 shr256u (UInt256 a, uint32_t n) {
+    if (n >= 128)
+        return (UInt256) {
+            .hi = newUInt128 (0, 0),
+            .lo = shr128u (a.hi, n - 128)
+        };
+    if (n == 0)
+        return a;
+
+    UInt128 lo = shr128u (a.lo, n);
+    UInt128 carry = shl128u (a.hi, 128 - n);
+
+    return (UInt256) {
+        .hi = shr128u (a.hi, n),
+        .lo = newUInt128 (lo.hi | carry.hi, lo.lo | carry.lo)
+    };
+}
+
+// Count the leading zero bits of a non-zero 128-bit integer.
+//
+static inline uint32_t clz128u (UInt128 a) {
+    return a.hi ? clz64 (a.hi) : 64 + clz64 (a.lo);
+}
+
+// Divide a 128-bit unsigned integer by a 64-bit one, returning a 64-bit
+// quotient and storing the remainder in 'rem'.
+//
+// The quotient has to fit in 64 bits, so the caller must make sure that
+// 'hi < d'. This is exactly the contract of the x86-64 'div' instruction,
+// which the hardware backends use directly.
+//
+// The reference version is Knuth's algorithm D specialised to a divisor
+// of two base 2^32 digits (see Hacker's Delight, 'divlu'). We normalise
+// the divisor so its top bit is set, then estimate each 32-bit quotient
+// digit from the leading digits alone. Normalisation guarantees the
+// estimate is at most two too large, and the inner loops correct it.
+//
+static inline uint64_t div128by64uRef
+    (uint64_t hi, uint64_t lo, uint64_t d, uint64_t *rem)
+{
+    const uint64_t base = 0x100000000ULL;
+
+    uint32_t shift = clz64 (d);
+    d <<= shift;
+
+    uint64_t
+        dHi     = HI64(d),
+        dLo     = LO64(d),
+        top     = shift ? (hi << shift) | (lo >> (64 - shift)) : hi,
+        bottom  = lo << shift;
+
+    uint64_t
+        q1      = top / dHi,
+        rhat    = top - q1 * dHi;
+
+    while (q1 >= base || q1 * dLo > (rhat << 32) + HI64(bottom)) {
+        q1--;
+        rhat += dHi;
+        if (rhat >= base)
+            break;
+    }
+
+    uint64_t
+        mid     = (top << 32) + HI64(bottom) - q1 * d,
+        q0      = mid / dHi;
+
+    rhat = mid - q0 * dHi;
+
+    while (q0 >= base || q0 * dLo > (rhat << 32) + LO64(bottom)) {
+        q0--;
+        rhat += dHi;
+        if (rhat >= base)
+            break;
+    }
+
+    *rem = ((mid << 32) + LO64(bottom) - q0 * d) >> shift;
+    return (q1 << 32) + q0;
+}
+
+static inline uint64_t div128by64u
+    (uint64_t hi, uint64_t lo, uint64_t d, uint64_t *rem)
+{
+#if WIDE_INT_BACKEND != WIDE_INT_LIMB && \
+    defined (__x86_64__) && (defined (__GNUC__) || defined (__clang__))
+    uint64_t quot;
+    __asm__ ("divq %[d]"
+        : "=a" (quot), "=d" (*rem)
+        : [d] "rm" (d), "a" (lo), "d" (hi));
+    return quot;
+#elif WIDE_INT_BACKEND == WIDE_INT_INTRINSIC && \
+    defined (_MSC_VER) && _MSC_VER >= 1920
+    return _udiv128 (hi, lo, d, rem);
+#elif WIDE_INT_BACKEND == WIDE_INT_NATIVE
+    unsigned __int128 n = ((unsigned __int128) hi << 64) | lo;
+    *rem = (uint64_t) (n % d);
+    return (uint64_t) (n / d);
+#else
+    return div128by64uRef (hi, lo, d, rem);
+#endif
+}
+
+// Divide two 128-bit unsigned integers.
+//
+typedef struct Quotient128 Quotient128;
+
+struct Quotient128 {
+    UInt128 quotient;
+    UInt128 remainder;
+};
+
+// The reference version is plain shift-and-subtract long division, one
+// quotient bit per iteration. It's slow, but obviously correct.
+//
+// Since the remainder can reach '2 * b' right after the shift, the bit
+// shifted out of the top has to be kept around, and the subtraction has
+// to wrap rather than saturate.
+//
+static inline Quotient128 div128uRef (UInt128 a, UInt128 b) {
+    // Exceptional case
+    if (b.hi == 0 && b.lo == 0) {
+        printf ("error: div128uRef: divide by zero exception\n");
+        return (Quotient128) { b, b };
+    }
+
+    UInt128
+        quotient    = newUInt128 (0, 0),
+        remainder   = newUInt128 (0, 0),
+        negB        = add128u (newUInt128 (~b.hi, ~b.lo), newUInt128 (0, 1));
+
+    for (uint32_t ix = 0; ix < 128; ix++) {
+        uint64_t over = MSB64(remainder.hi);
+
+        quotient = shl128u (quotient, 1);
+        remainder = shl128u (remainder, 1);
+
+        remainder.lo |= shr128u (a, 127 - ix).lo & 1;
+
+        if (over || !lt128u (remainder, b)) {
+            remainder = add128u (remainder, negB);
+            quotient.lo |= 1;
+        }
+    }
+
+    return (Quotient128) {
+        .quotient   = quotient,
+        .remainder  = remainder
+    };
+}
+
+// The fast version picks between two cases.
+//
+// If the divisor fits in 64 bits, this is schoolbook division with two
+// 64-bit digits: one native 64-bit division for the top digit, and one
+// 128-by-64 division for the bottom digit.
+//
+// Otherwise the quotient is known to fit in 64 bits. We normalise the
+// divisor, and divide the dividend (halved, so the quotient can't
+// overflow) by its top 64 bits. After undoing the normalisation, this
+// estimate is either exact or one too large, so we step it back by one
+// and correct upwards with a single comparison (see Hacker's Delight,
+// 'divllu').
+//
+static inline Quotient128 div128u (UInt128 a, UInt128 b) {
+    // Exceptional case
+    if (b.hi == 0 && b.lo == 0) {
+        printf ("error: div128u: divide by zero exception\n");
+        return (Quotient128) { b, b };
+    }
+
+    uint64_t rem;
+
+    if (b.hi == 0) {
+        uint64_t
+            quotHi  = a.hi / b.lo,
+            quotLo  = div128by64u (a.hi % b.lo, a.lo, b.lo, &rem);
+
+        return (Quotient128) {
+            .quotient   = newUInt128 (quotHi, quotLo),
+            .remainder  = newUInt128 (0, rem)
+        };
+    }
+
+    uint32_t shift = clz64 (b.hi);
+
+    uint64_t
+        divisor = shl128u (b, shift).hi,
+        estimate;
+
+    UInt128 half = shr128u (a, 1);
+    estimate = div128by64u (half.hi, half.lo, divisor, &rem);
+    estimate >>= 63 - shift;
+    if (estimate != 0)
+        estimate--;
+
+    UInt128 product = mul64u (estimate, b.lo);
+    product.hi += estimate * b.hi;
+
+    UInt128 remainder = sub128u (a, product);
+    if (!lt128u (remainder, b)) {
+        estimate++;
+        remainder = sub128u (remainder, b);
+    }
+
+    return (Quotient128) {
+        .quotient   = newUInt128 (0, estimate),
+        .remainder  = remainder
+    };
+}
+
+
+// Precomputed reciprocal of a 64-bit divisor, for dividing many numbers
+// by the same value.
+//
+// This is the method of Möller and Granlund, "Improved division by
+// invariant integers". With the divisor normalised so that its top bit
+// is set, we store
+//
+//  inverse == floor ((2^128 - 1) / divisor) - 2^64
+//
+// Each subsequent 128-by-64 division then costs two multiplications and
+// a couple of cheap corrections, instead of a hardware division.
+//
+typedef struct Reciprocal64 Reciprocal64;
+
+struct Reciprocal64 {
+    uint64_t divisor;
+    // ^ divisor, shifted left by 'shift'.
+    uint64_t inverse;
+    uint32_t shift;
+};
+
+static inline Reciprocal64 newReciprocal64 (uint64_t d) {
+    // Exceptional case
+    if (d == 0) {
+        printf ("error: newReciprocal64: divide by zero exception\n");
+        return (Reciprocal64) { 0, 0, 0 };
+    }
+
+    uint32_t shift = clz64 (d);
+    uint64_t rem;
+
+    d <<= shift;
+
+    return (Reciprocal64) {
+        .divisor    = d,
+        .inverse    = div128by64u (~d, ~0ULL, d, &rem),
+        .shift      = shift
+    };
+}
+
+// Divide a normalised two-word number by a reciprocal, storing the
+// remainder in 'rem'. Like 'div128by64u', this requires 'hi < divisor'.
+//
+// The first correction is taken about half the time, so it's done with
+// a mask rather than a branch. The second is very rarely needed.
+//
+static inline uint64_t div2by1Reciprocal
+    (uint64_t hi, uint64_t lo, Reciprocal64 recip, uint64_t *rem)
+{
+    UInt128 estimate = add128u
+        ( mul64u (recip.inverse, hi)
+        , newUInt128 (hi, lo) );
+
+    uint64_t
+        quot    = estimate.hi + 1,
+        r       = lo - quot * recip.divisor,
+        mask    = -(uint64_t) (r > estimate.lo);
+
+    quot    += mask;
+    r       += mask & recip.divisor;
+
+    if (r >= recip.divisor) {
+        quot++;
+        r -= recip.divisor;
+    }
+
+    *rem = r;
+    return quot;
+}
+
+// Divide a 128-bit unsigned integer by a precomputed reciprocal.
+//
+static inline Quotient128 divByReciprocal128u (UInt128 a, Reciprocal64 recip) {
+    UInt128 n = shl128u (a, recip.shift);
+
+    uint64_t
+        top = recip.shift ? a.hi >> (64 - recip.shift) : 0,
+        rem,
+        quotHi = div2by1Reciprocal (top, n.hi, recip, &rem),
+        quotLo = div2by1Reciprocal (rem, n.lo, recip, &rem);
+
+    return (Quotient128) {
+        .quotient   = newUInt128 (quotHi, quotLo),
+        .remainder  = newUInt128 (0, rem >> recip.shift)
+    };
+}
+
+// Divide every element of 'as' by the same precomputed reciprocal.
+//
+static inline void divAllByReciprocal128u
+    ( unsigned int n
+    , const UInt128 as[]
+    , Quotient128 quotients[]
+    , Reciprocal64 recip )
+{
+    for (unsigned int ix = 0; ix < n; ix++)
+        quotients[ix] = divByReciprocal128u (as[ix], recip);
+}
+
 
 // 128-bit signed integer representation.
 //
@@ -218,7 +748,7 @@ struct Int128 {
 //
 // The final result will inherit the sign of the top half.
 //
-static inline newInt128 (int64_t top, uint64_t bottom) {
+static inline Int128 newInt128 (int64_t top, uint64_t bottom) {
     int sign = top < 0 ? -1 : 1;
 
     return (Int128) {
@@ -239,14 +769,13 @@ static inline newInt128 (int64_t top, uint64_t bottom) {
 // perform our unsigned addition on them, and then cast them back to
 // signed integers.
 //
-static inline Int64_t adc64i (int64_t a, int64_t b) {
+static inline Int128 adc64i (int64_t a, int64_t b) {
     UInt128 ones = adc64u ((uint64_t) a, (uint64_t) b);
 
-    return (Int64_t) {
+    return (Int128) {
         .lo = (int64_t) ones.lo,
         .hi = (int64_t) ones.hi
     };
 }
 
 #endif
-